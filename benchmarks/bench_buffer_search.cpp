@@ -0,0 +1,141 @@
+#include "bench_common.h"
+#include "match_index.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// In-buffer find on a 1M-line buffer (pass another count as the first
+// argument), typing a query one character at a time with the cursor near
+// the top, then deleting its last character, then editing one line with
+// the search open. The legacy variant is what perform_search() did for
+// each of these: lowercase a copy of every line and std::string::find.
+// The index variant is MatchIndex: the first match after the cursor,
+// then the full count, narrowing on typed characters, and a rescan of
+// only the edited line.
+
+namespace {
+using Match = MatchIndex::Match;
+
+constexpr std::size_t kCursorLine = 100;
+constexpr std::size_t kSlice = 4096;
+const char *const kQuery = "Value_12";
+
+std::string lower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return (char)std::tolower(c); });
+  return text;
+}
+
+std::vector<Match> legacy_search(const LineStore &lines,
+                                 const std::string &query) {
+  std::vector<Match> out;
+  const std::string q = lower(query);
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    const std::string line = lower(lines[i]);
+    for (std::size_t pos = line.find(q); pos != std::string::npos;
+         pos = line.find(q, pos + 1)) {
+      out.push_back({(int)i, (int)pos});
+    }
+  }
+  return out;
+}
+
+struct Timing {
+  double first = 0; // until the cursor can move to a match
+  double all = 0;   // until the count is known
+  std::size_t count = 0;
+};
+
+Timing index_search(MatchIndex &index, const LineStore &lines,
+                    const std::string &query) {
+  Timing t;
+  const double start = bench::now_seconds();
+  index.set_query(lines, query, false, false);
+  const Match anchor((int)kCursorLine, 0);
+  while (true) {
+    const auto &m = index.matches();
+    const auto it = std::lower_bound(m.begin(), m.end(), anchor);
+    if ((it != m.end() && index.scanned(kCursorLine, it->first + 1)) ||
+        index.complete()) {
+      break;
+    }
+    index.scan(lines, kCursorLine, kSlice);
+  }
+  t.first = bench::now_seconds() - start;
+  while (!index.complete()) {
+    index.scan(lines, kCursorLine, kSlice);
+  }
+  t.all = bench::now_seconds() - start;
+  t.count = index.matches().size();
+  return t;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const int line_count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  LineStore lines;
+  for (int i = 0; i < line_count; i++) {
+    lines.push_back("    const auto value_" + std::to_string(i) +
+                    " = compute(" + std::to_string(i * 7) + ");");
+  }
+  std::printf("%d lines, query typed as \"%s\"\n", line_count, kQuery);
+
+  const std::string full(kQuery);
+  double legacy_typing = 0;
+  double legacy_worst = 0;
+  std::size_t legacy_count = 0;
+  for (std::size_t n = 1; n <= full.size(); n++) {
+    const double start = bench::now_seconds();
+    legacy_count = legacy_search(lines, full.substr(0, n)).size();
+    const double took = bench::now_seconds() - start;
+    legacy_typing += took;
+    legacy_worst = std::max(legacy_worst, took);
+  }
+
+  MatchIndex index;
+  double first_worst = 0;
+  double all_worst = 0;
+  double typing = 0;
+  std::size_t count = 0;
+  for (std::size_t n = 1; n <= full.size(); n++) {
+    const Timing t = index_search(index, lines, full.substr(0, n));
+    first_worst = std::max(first_worst, t.first);
+    all_worst = std::max(all_worst, t.all);
+    typing += t.all;
+    count = t.count;
+  }
+
+  const std::string shorter = full.substr(0, full.size() - 1);
+  double start = bench::now_seconds();
+  legacy_search(lines, shorter);
+  const double legacy_backspace = bench::now_seconds() - start;
+  const Timing backspace = index_search(index, lines, shorter);
+
+  lines.mut(line_count / 2) += " value_12";
+  start = bench::now_seconds();
+  legacy_search(lines, shorter);
+  const double legacy_edit = bench::now_seconds() - start;
+  start = bench::now_seconds();
+  index.sync(lines);
+  index.scan(lines, kCursorLine, kSlice);
+  const double edit = bench::now_seconds() - start;
+
+  bench::report("typing", "legacy total ms", legacy_typing * 1000, "ms");
+  bench::report("typing", "legacy worst key ms", legacy_worst * 1000, "ms");
+  bench::report("typing", "index total ms", typing * 1000, "ms");
+  bench::report("typing", "index first match ms", first_worst * 1000, "ms");
+  bench::report("typing", "index full count ms", all_worst * 1000, "ms");
+  bench::report("typing", "matches (legacy)", (double)legacy_count, "");
+  bench::report("typing", "matches (index)", (double)count, "");
+  bench::report("backspace", "legacy ms", legacy_backspace * 1000, "ms");
+  bench::report("backspace", "index first match ms", backspace.first * 1000,
+                "ms");
+  bench::report("backspace", "index full count ms", backspace.all * 1000,
+                "ms");
+  bench::report("edit one line", "legacy ms", legacy_edit * 1000, "ms");
+  bench::report("edit one line", "index ms", edit * 1000, "ms");
+  return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Small helpers shared by the micro-benchmarks. Each benchmark is a plain
+// executable that prints one line per measurement.
+
+namespace bench {
+
+inline double now_seconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Resident set size in KiB, or -1 where /proc is unavailable.
+inline long resident_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmRSS:") {
+      long kb = -1;
+      status >> kb;
+      return kb;
+    }
+    std::getline(status, key);
+  }
+  return -1;
+}
+
+// Peak resident set size in KiB, or -1 where /proc is unavailable.
+inline long peak_resident_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string key;
+  while (status >> key) {
+    if (key == "VmHWM:") {
+      long kb = -1;
+      status >> kb;
+      return kb;
+    }
+    std::getline(status, key);
+  }
+  return -1;
+}
+
+inline void report(const char *name, const char *metric, double value,
+                   const char *unit) {
+  std::printf("%-28s %-24s %14.3f %s\n", name, metric, value, unit);
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,174 @@
+#include "bench_common.h"
+#include "content_search.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Searches the contents of a synthetic tree of about 200 MB (pass another
+// size in MB as the first argument) for literals from rare to common. The
+// legacy variant is the obvious loop: every file through ifstream and
+// getline, a case-folded copy of each line, std::string::find. The live
+// grep variant is ContentSearch: mapped files, the vector prefilter, one
+// thread per core, .gitignore and binary skipping. Both count matching
+// lines; live grep also reports its time to first result. Timings are the
+// best of three rounds with a warm page cache.
+
+namespace {
+namespace fs = std::filesystem;
+
+constexpr int kFilesPerDir = 200;
+constexpr int kRounds = 3;
+constexpr std::size_t kLimit = 1000000;
+const char *const kQueries[] = {"xylophone_quartz", "handler", "return"};
+
+const char *const kLines[] = {
+    "  int value = compute(index, offset);",
+    "  if (buffer.empty()) {",
+    "    return std::string();",
+    "  }",
+    "// Handles one request from the client.",
+    "static void flush_pending(Writer &writer, std::size_t count) {",
+    "  for (std::size_t i = 0; i < items.size(); ++i) {",
+    "#include <vector>",
+    "    const auto &entry = table[key];",
+    "  Status status = Handler::dispatch(message);",
+};
+
+fs::path make_tree(std::size_t megabytes) {
+  const fs::path root = fs::temp_directory_path() / "jot-bench-content-search";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  const std::size_t target = megabytes << 20;
+  std::size_t written = 0;
+  unsigned seed = 7;
+  for (int i = 0; written < target; i++) {
+    const fs::path dir = root / ("src" + std::to_string(i / kFilesPerDir));
+    if (i % kFilesPerDir == 0) {
+      fs::create_directories(dir);
+    }
+    std::string text;
+    const int lines = 200 + (int)(seed % 1800);
+    for (int l = 0; l < lines; l++) {
+      seed = seed * 1103515245u + 12345u;
+      text += kLines[(seed >> 16) % 10];
+      text += '\n';
+    }
+    if (i % 997 == 0) {
+      text += "  // xylophone_quartz marker\n";
+    }
+    std::ofstream(dir / ("file" + std::to_string(i) + ".cpp"),
+                  std::ios::binary)
+        << text;
+    written += text.size();
+  }
+  return root;
+}
+
+std::shared_ptr<FileIndexSnapshot> index_tree(const fs::path &root) {
+  std::vector<std::pair<std::string, bool>> entries;
+  for (auto it = fs::recursive_directory_iterator(root);
+       it != fs::recursive_directory_iterator(); ++it) {
+    entries.emplace_back(fs::relative(it->path(), root).generic_string(),
+                         it->is_directory());
+  }
+  std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+    return file_index_path_less(a.first, b.first);
+  });
+  auto snap = std::make_shared<FileIndexSnapshot>();
+  snap->root = root.string();
+  for (const auto &entry : entries) {
+    snap->append(entry.first, entry.second);
+  }
+  snap->complete = true;
+  return snap;
+}
+
+std::size_t legacy_search(const FileIndexSnapshot &snap,
+                          const std::string &query) {
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < snap.size(); i++) {
+    if (snap.is_directory(i)) {
+      continue;
+    }
+    std::ifstream in(snap.root + "/" + std::string(snap.path(i)));
+    std::string line;
+    while (std::getline(in, line)) {
+      for (char &c : line) {
+        c = (char)std::tolower((unsigned char)c);
+      }
+      if (line.find(query) != std::string::npos) {
+        found++;
+      }
+    }
+  }
+  return found;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+  const fs::path root = make_tree(megabytes);
+  const auto snap = index_tree(root);
+  std::printf("%zu MB in %zu entries, %u hardware threads\n", megabytes,
+              snap->size(), std::thread::hardware_concurrency());
+
+  for (const char *query : kQueries) {
+    double legacy = 1e9;
+    std::size_t legacy_found = 0;
+    for (int round = 0; round < kRounds; round++) {
+      const double start = bench::now_seconds();
+      legacy_found = legacy_search(*snap, query);
+      legacy = std::min(legacy, bench::now_seconds() - start);
+    }
+
+    double total = 1e9;
+    double first = 1e9;
+    std::size_t found = 0;
+    std::uint64_t bytes = 0;
+    ContentSearch search;
+    for (int round = 0; round < kRounds; round++) {
+      const double start = bench::now_seconds();
+      const std::uint64_t generation = search.start(snap, "", query, kLimit);
+      double first_at = -1;
+      while (true) {
+        const auto results = search.results();
+        if (results->generation == generation) {
+          if (first_at < 0 && !results->matches.empty()) {
+            first_at = bench::now_seconds() - start;
+          }
+          if (results->done) {
+            found = results->matches.size();
+            bytes = results->bytes_searched;
+            break;
+          }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+      total = std::min(total, bench::now_seconds() - start);
+      if (first_at >= 0) {
+        first = std::min(first, first_at);
+      }
+    }
+
+    const std::string name = std::string("query \"") + query + "\"";
+    bench::report(name.c_str(), "legacy ms", legacy * 1000, "ms");
+    bench::report(name.c_str(), "legacy lines", (double)legacy_found, "");
+    bench::report(name.c_str(), "live grep ms", total * 1000, "ms");
+    bench::report(name.c_str(), "live grep first ms",
+                  first < 1e9 ? first * 1000 : -1, "ms");
+    bench::report(name.c_str(), "live grep lines", (double)found, "");
+    bench::report(name.c_str(), "live grep MB/s",
+                  (double)bytes / (1 << 20) / total, "MB/s");
+  }
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  return 0;
+}
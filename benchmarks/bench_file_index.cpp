@@ -0,0 +1,150 @@
+#include "bench_common.h"
+#include "telescope.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Find Files in a synthetic tree of 500k files (pass another count as the
+// first argument), three directory levels deep. The rescan variant walks
+// the tree the way every keystroke used to (depth 4, first 2000 entries)
+// and reports how much of the tree that could ever find. The index
+// variant reports the background build, the memory it takes, how long
+// each keystroke blocks input and how long its results take to stream
+// in, and how long a new file takes to show up.
+
+namespace {
+namespace fs = std::filesystem;
+
+constexpr int kFilesPerDir = 100;
+constexpr int kDirsPerLevel = 50;
+constexpr int kLegacyMaxDepth = 4;
+constexpr int kLegacyMaxResults = 2000;
+const char *const kQueries[] = {"s", "sr", "src", "srcm", "srcmod", "srcmod12",
+                                "srcmod12file", "srcmod12file1234"};
+
+fs::path make_tree(int files) {
+  const fs::path root = fs::temp_directory_path() / "jot-bench-file-index";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  static const char *const kExts[] = {".cpp", ".h", ".py", ".md"};
+  for (int i = 0; i < files; ++i) {
+    const int leaf = i / kFilesPerDir;
+    const fs::path dir = root / ("src" + std::to_string(leaf / kDirsPerLevel)) /
+                         ("mod" + std::to_string(leaf % kDirsPerLevel));
+    if (i % kFilesPerDir == 0) {
+      fs::create_directories(dir);
+    }
+    std::ofstream(dir / ("file" + std::to_string(i) + kExts[i % 4]));
+  }
+  return root;
+}
+
+int legacy_scan(const fs::path &dir, int depth, int found) {
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(dir, ec);
+       !ec && it != fs::end(it) && found < kLegacyMaxResults; it.increment(ec)) {
+    ++found;
+    if (depth < kLegacyMaxDepth && it->is_directory(ec)) {
+      found = legacy_scan(it->path(), depth + 1, found);
+    }
+  }
+  return found;
+}
+
+void run_legacy(const fs::path &root, int files) {
+  const int keystrokes = (int)(sizeof(kQueries) / sizeof(kQueries[0]));
+  int found = 0;
+  const double start = bench::now_seconds();
+  for (int k = 0; k < keystrokes; ++k) {
+    found = legacy_scan(root, 0, 0);
+  }
+  bench::report("file_index/rescan", "keystroke (avg)",
+                (bench::now_seconds() - start) * 1e3 / keystrokes, "ms");
+  bench::report("file_index/rescan", "reachable entries", found, "");
+  bench::report("file_index/rescan", "reachable share",
+                100.0 * std::min(found, files) / files, "%");
+}
+
+void run_index(const fs::path &root) {
+  const long rss_before = bench::resident_kb();
+  Telescope telescope;
+  const double start = bench::now_seconds();
+  telescope.open(root.string());
+  while (telescope.indexing()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bench::report("file_index/index", "build", bench::now_seconds() - start,
+                "s");
+  bench::report("file_index/index", "entries", telescope.indexed_count(), "");
+  bench::report("file_index/index", "resident growth",
+                (bench::resident_kb() - rss_before) / 1024.0, "MiB");
+
+  // set_query() is what blocks the UI; the rest streams in.
+  double blocked_worst = 0;
+  double first_total = 0;
+  double complete_total = 0;
+  for (const char *q : kQueries) {
+    const double key_start = bench::now_seconds();
+    telescope.set_query(q);
+    blocked_worst = std::max(blocked_worst, bench::now_seconds() - key_start);
+    double first_ms = telescope.take_time_to_first_result_ms();
+    while (telescope.searching() || first_ms < 0) {
+      telescope.refresh_results();
+      if (first_ms < 0) {
+        first_ms = telescope.take_time_to_first_result_ms();
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    first_total += first_ms;
+    complete_total += bench::now_seconds() - key_start;
+  }
+  const int keystrokes = (int)(sizeof(kQueries) / sizeof(kQueries[0]));
+  bench::report("file_index/index", "keystroke UI (worst)",
+                blocked_worst * 1e3, "ms");
+  bench::report("file_index/index", "first result (avg)",
+                first_total / keystrokes, "ms");
+  bench::report("file_index/index", "all results (avg)",
+                complete_total * 1e3 / keystrokes, "ms");
+  bench::report("file_index/index", "final matches",
+                telescope.get_results().size(), "");
+
+  // A file created under the tree shows up without a rescan.
+  const fs::path added = root / "src0" / "mod0" / "zz_added_file.txt";
+  telescope.set_query("zzadded");
+  while (telescope.searching()) {
+    telescope.refresh_results();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  const double created = bench::now_seconds();
+  std::ofstream(added).put('\n');
+  auto visible = [&] {
+    const auto &results = telescope.get_results();
+    return !results.empty() && results[0].name == added.filename().string();
+  };
+  while (!visible() && bench::now_seconds() - created < 10) {
+    telescope.refresh_results();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bench::report("file_index/index", "new file visible after",
+                (bench::now_seconds() - created) * 1e3, "ms");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const int files = argc > 1 ? std::max(1, std::atoi(argv[1])) : 500000;
+  const double setup_start = bench::now_seconds();
+  const fs::path root = make_tree(files);
+  bench::report("file_index", "files", files, "");
+  bench::report("file_index", "tree setup", bench::now_seconds() - setup_start,
+                "s");
+  run_legacy(root, files);
+  run_index(root);
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  return 0;
+}
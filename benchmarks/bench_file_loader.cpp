@@ -0,0 +1,93 @@
+#include "bench_common.h"
+#include "file_loader.h"
+#include "line_store.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// Opens a generated log file of 128 MB (pass another size in MB as the
+// first argument) and reports throughput and peak resident memory. The
+// legacy load is the one Editor::open_file() made before load_file_lines():
+// std::getline into a string, stripping a trailing '\r', and copying each
+// line into a LineStore with push_back. Each load runs in a child process
+// so the peak resident figures are its own.
+
+namespace fs = std::filesystem;
+
+namespace {
+void legacy_load(const std::string &path, LineStore &lines) {
+  std::ifstream file(path);
+  std::string line;
+  lines.clear();
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    lines.push_back(line);
+  }
+  if (lines.empty()) {
+    lines.push_back("");
+  }
+}
+
+void run_child(const char *name, const std::string &path, double mb,
+               bool legacy) {
+  std::fflush(stdout);
+  const pid_t pid = fork();
+  if (pid == 0) {
+    LineStore lines;
+    const double start = bench::now_seconds();
+    if (legacy) {
+      legacy_load(path, lines);
+    } else {
+      load_file_lines(path, lines);
+    }
+    const double elapsed = bench::now_seconds() - start;
+    bench::report(name, "lines", (double)lines.size(), "lines");
+    bench::report(name, "time", elapsed * 1000.0, "ms");
+    bench::report(name, "throughput", mb / elapsed, "MB/s");
+    bench::report(name, "peak_rss", bench::peak_resident_kb() / 1024.0, "MB");
+    std::fflush(stdout);
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t size_mb =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 128;
+  const fs::path root = fs::temp_directory_path() / "jot-bench-loader";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  const std::string path = (root / "server.log").string();
+
+  {
+    std::ofstream out(path, std::ios::binary);
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; bytes < size_mb << 20; i++) {
+      const std::string line =
+          "2024-05-01T12:00:" + std::to_string(i % 60) +
+          "Z INFO request id=" + std::to_string(i) +
+          " path=/api/v1/items status=200 latency_ms=" +
+          std::to_string(i % 997) + (i % 5 == 0 ? "\r\n" : "\n");
+      out << line;
+      bytes += line.size();
+    }
+  }
+  const double mb = (double)fs::file_size(path) / (1 << 20);
+  bench::report("file_loader", "file_size", mb, "MB");
+
+  run_child("legacy_getline", path, mb, true);
+  run_child("mapped_split", path, mb, false);
+
+  fs::remove_all(root, ec);
+  return 0;
+}
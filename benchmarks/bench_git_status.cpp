@@ -0,0 +1,133 @@
+#include "bench_common.h"
+#include "git_status.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// UI stall caused by git status in a synthetic repository of 100k tracked
+// files (pass another count as the first argument). The synchronous
+// variant runs the status commands on the UI thread, as the editor did on
+// every 1.5 s refresh. The service variant draws 60 fps frames that only
+// swap in published snapshots while files are edited underneath, and
+// reports the frame stall and how long an edit takes to show up.
+
+namespace {
+namespace fs = std::filesystem;
+
+constexpr int kFilesPerDir = 100;
+constexpr int kSyncRefreshes = 5;
+constexpr int kEdits = 10;
+
+bool run(const std::string &command) {
+  return std::system(command.c_str()) == 0;
+}
+
+fs::path make_repo(int files) {
+  const fs::path root = fs::temp_directory_path() / "jot-bench-git-status";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  for (int i = 0; i < files; ++i) {
+    const fs::path dir = root / ("dir" + std::to_string(i / kFilesPerDir));
+    if (i % kFilesPerDir == 0) {
+      fs::create_directories(dir);
+    }
+    std::ofstream(dir / ("file" + std::to_string(i) + ".txt"))
+        << "line " << i << "\n";
+  }
+  const std::string git = "git -C '" + root.string() + "' ";
+  if (!run(git + "init -q") ||
+      !run(git + "-c user.name=bench -c user.email=bench@example.com add -A") ||
+      !run(git + "-c user.name=bench -c user.email=bench@example.com "
+                 "commit -qm init")) {
+    std::fprintf(stderr, "failed to create %s\n", root.string().c_str());
+    std::exit(1);
+  }
+  return root;
+}
+
+void touch(const fs::path &root, int edit) {
+  std::ofstream(root / "dir0" / "file0.txt", std::ios::app) << edit << "\n";
+}
+
+void run_sync(const fs::path &root) {
+  double total = 0;
+  double worst = 0;
+  for (int i = 0; i < kSyncRefreshes; ++i) {
+    const double start = bench::now_seconds();
+    GitStatusSnapshot status = read_git_status(root.string());
+    const double stall = bench::now_seconds() - start;
+    total += stall;
+    worst = std::max(worst, stall);
+  }
+  bench::report("git_status/sync", "refresh stall (avg)",
+                total * 1e3 / kSyncRefreshes, "ms");
+  bench::report("git_status/sync", "refresh stall (worst)", worst * 1e3,
+                "ms");
+}
+
+void run_service(const fs::path &root) {
+  GitStatusService service;
+  service.set_repo_hint(root.string());
+  service.refresh_and_wait();
+  std::shared_ptr<const GitStatusSnapshot> current = service.snapshot();
+
+  double worst = 0;
+  double total = 0;
+  long long frames = 0;
+  double latency = 0;
+  int seen = 0;
+  for (int edit = 0; edit < kEdits; ++edit) {
+    touch(root, edit);
+    const double edited = bench::now_seconds();
+    // Alternate between dirtying the file and restoring it, so each edit
+    // changes the status.
+    if (edit % 2 == 1) {
+      run("git -C '" + root.string() + "' checkout -q -- dir0/file0.txt");
+    }
+    const std::uint64_t before = current->sequence;
+    while (bench::now_seconds() - edited < 10) {
+      const double frame_start = bench::now_seconds();
+      service.set_repo_hint(root.string());
+      auto latest = service.snapshot();
+      if (latest->sequence != current->sequence) {
+        current = std::move(latest);
+      }
+      const double frame_time = bench::now_seconds() - frame_start;
+      total += frame_time;
+      worst = std::max(worst, frame_time);
+      ++frames;
+      if (current->sequence != before) {
+        latency += bench::now_seconds() - edited;
+        ++seen;
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(16667));
+    }
+  }
+  bench::report("git_status/service", "frame stall (avg)",
+                total * 1e6 / std::max<long long>(1, frames), "us");
+  bench::report("git_status/service", "frame stall (worst)", worst * 1e6,
+                "us");
+  bench::report("git_status/service", "edit to snapshot (avg)",
+                latency * 1e3 / std::max(1, seen), "ms");
+  bench::report("git_status/service", "edits seen", seen, "");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const int files = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100000;
+  const double setup_start = bench::now_seconds();
+  const fs::path root = make_repo(files);
+  bench::report("git_status", "tracked files", files, "");
+  bench::report("git_status", "repository setup",
+                bench::now_seconds() - setup_start, "s");
+  run_sync(root);
+  run_service(root);
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  return 0;
+}
@@ -0,0 +1,188 @@
+#include "bench_common.h"
+#include "highlight_scheduler.h"
+#include "line_store.h"
+#include "syntax_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Keystroke-to-paint benchmark for background highlighting. Every frame
+// opens or closes a block comment on a line in the middle of a 50k-line
+// file, which changes the lexer state of every line below it, then
+// draws a 60-row viewport around it plus a 60-row minimap sampling lines
+// across the whole file. The synchronous variant lexes on the UI thread
+// (the previous behavior); the background variant only applies published
+// batches, schedules a job and reads whatever is ready.
+
+namespace {
+constexpr int kLineCount = 50000;
+constexpr int kViewportTop = 25000;
+constexpr int kViewportRows = 60;
+constexpr int kMinimapRows = 60;
+constexpr int kFrames = 200;
+
+LineStore make_file() {
+  static const char *const templates[] = {
+      "// line comment",
+      "int value = 42;",
+      "static int total = compute(0x1F, 3.5e2);",
+      "  for (int i = 0; i < count; ++i) {",
+      "    result += format(\"item %d\", i);",
+      "  }",
+      "",
+  };
+  const int count = sizeof(templates) / sizeof(templates[0]);
+  LineStore lines;
+  for (int i = 0; i < kLineCount; ++i) {
+    lines.push_back(templates[i % count]);
+  }
+  return lines;
+}
+
+std::vector<int> frame_rows() {
+  std::vector<int> rows;
+  for (int row = 0; row < kViewportRows; ++row) {
+    rows.push_back(kViewportTop + row);
+  }
+  for (int row = 0; row < kMinimapRows; ++row) {
+    rows.push_back((int)((long long)row * kLineCount / kMinimapRows));
+  }
+  return rows;
+}
+
+void toggle_comment(LineStore &lines, SyntaxCache &cache) {
+  const int row = kViewportTop + kViewportRows / 2;
+  std::string &line = lines.mut(row);
+  if (line.compare(0, 2, "/*") == 0) {
+    line.erase(0, 2);
+  } else {
+    line.insert(0, "/*");
+  }
+  cache.invalidate_from(row);
+}
+
+void run_sync() {
+  LineStore lines = make_file();
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(".cpp");
+  SyntaxCache cache;
+  const std::vector<int> rows = frame_rows();
+  const double open_start = bench::now_seconds();
+  for (int row : rows) {
+    cache.line_colors(lines, row, highlighter);
+  }
+  bench::report("highlight/sync", "first frame",
+                (bench::now_seconds() - open_start) * 1e6, "us");
+
+  double worst = 0;
+  const double start = bench::now_seconds();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    const double frame_start = bench::now_seconds();
+    toggle_comment(lines, cache);
+    for (int row : rows) {
+      cache.line_colors(lines, row, highlighter);
+    }
+    worst = std::max(worst, bench::now_seconds() - frame_start);
+  }
+  const double elapsed = bench::now_seconds() - start;
+  bench::report("highlight/sync", "frame time (avg)", elapsed * 1e6 / kFrames,
+                "us");
+  bench::report("highlight/sync", "frame time (worst)", worst * 1e6, "us");
+}
+
+// One UI frame: apply what the worker published, schedule more work, then
+// read the colors of every drawn row. Returns the rows drawn with colors.
+int background_frame(HighlightScheduler &scheduler, LineStore &lines,
+                     SyntaxCache &cache, const std::vector<int> &rows) {
+  std::vector<HighlightScheduler::Batch> batches;
+  scheduler.take(batches);
+  for (auto &batch : batches) {
+    HighlightScheduler::apply(lines, cache, batch);
+  }
+  cache.sync(lines);
+  if (cache.settled_lines() < lines.size() &&
+      (scheduler.scheduled_generation() != cache.generation() ||
+       !scheduler.busy())) {
+    scheduler.schedule(HighlightScheduler::make_job(
+        lines, cache, ".cpp", kViewportTop, kViewportTop + kViewportRows));
+  }
+
+  int ready = 0;
+  for (int row : rows) {
+    const SyntaxLineCache &entry = cache.entry((std::size_t)row);
+    if (entry.valid && entry.line_length == lines[row].length() &&
+        entry.line_hash == std::hash<std::string>{}(lines[row])) {
+      ++ready;
+    }
+  }
+  return ready;
+}
+
+void run_background() {
+  LineStore lines = make_file();
+  SyntaxCache cache;
+  HighlightScheduler scheduler;
+  const std::vector<int> rows = frame_rows();
+  const double open_start = bench::now_seconds();
+  background_frame(scheduler, lines, cache, rows);
+  bench::report("highlight/background", "first frame",
+                (bench::now_seconds() - open_start) * 1e6, "us");
+  while (cache.settled_lines() < lines.size()) {
+    scheduler.wait_idle();
+    background_frame(scheduler, lines, cache, rows);
+  }
+
+  double worst = 0;
+  double total = 0;
+  double ready = 0;
+  for (int frame = 0; frame < kFrames; ++frame) {
+    const double frame_start = bench::now_seconds();
+    toggle_comment(lines, cache);
+    ready += background_frame(scheduler, lines, cache, rows);
+    const double frame_time = bench::now_seconds() - frame_start;
+    total += frame_time;
+    worst = std::max(worst, frame_time);
+    // Leave the worker the rest of a 60 fps frame.
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+  }
+
+  const double settle_start = bench::now_seconds();
+  while (cache.settled_lines() < lines.size()) {
+    background_frame(scheduler, lines, cache, rows);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  const double settle = bench::now_seconds() - settle_start;
+
+  bench::report("highlight/background", "frame time (avg)",
+                total * 1e6 / kFrames, "us");
+  bench::report("highlight/background", "frame time (worst)", worst * 1e6,
+                "us");
+  bench::report("highlight/background", "rows drawn with colors",
+                ready * 100.0 / (kFrames * rows.size()), "%");
+  bench::report("highlight/background", "settle after last key",
+                settle * 1e3, "ms");
+}
+
+// Jumping to the end of a file nothing has been highlighted in yet: the
+// job reaches from line 0 through the viewport.
+void run_jump_to_end() {
+  const LineStore lines = make_file();
+  SyntaxCache cache;
+  cache.sync(lines);
+  const double start = bench::now_seconds();
+  HighlightScheduler::Job job = HighlightScheduler::make_job(
+      lines, cache, ".cpp", lines.size() - kViewportRows, lines.size());
+  bench::report("highlight/background", "job at end of unlexed file",
+                (bench::now_seconds() - start) * 1e6, "us");
+}
+} // namespace
+
+int main() {
+  run_sync();
+  run_background();
+  run_jump_to_end();
+  return 0;
+}
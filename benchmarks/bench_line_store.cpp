@@ -0,0 +1,121 @@
+#include "bench_common.h"
+#include "line_store.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compares LineStore with the plain std::vector<std::string> layout it
+// replaced, on the operations the editor leans on: inserting lines near the
+// top of a large file, random line access, and materializing the full text
+// for saves and LSP sync.
+
+namespace {
+constexpr int kLineCount = 2000000;
+constexpr int kInserts = 2000;
+constexpr int kLookups = 2000000;
+
+std::string make_line(int i) {
+  return "    const auto value_" + std::to_string(i) + " = compute(" +
+         std::to_string(i * 7) + ");";
+}
+
+// Deterministic xorshift so both layouts see the same access pattern.
+struct Rng {
+  std::uint64_t state = 0x9e3779b97f4a7c15ull;
+  std::size_t next(std::size_t bound) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (std::size_t)(state % bound);
+  }
+};
+
+template <typename Lines> void fill(Lines &lines) {
+  for (int i = 0; i < kLineCount; ++i) {
+    lines.push_back(make_line(i));
+  }
+}
+
+template <typename Lines> void bench_insert(const char *name, Lines &lines) {
+  const double start = bench::now_seconds();
+  for (int i = 0; i < kInserts; ++i) {
+    lines.insert(lines.begin() + 10 + i, "// inserted");
+  }
+  bench::report(name, "insert near top",
+                (bench::now_seconds() - start) * 1e6 / kInserts, "us/op");
+
+  const double erase_start = bench::now_seconds();
+  for (int i = 0; i < kInserts; ++i) {
+    lines.erase(lines.begin() + 10);
+  }
+  bench::report(name, "erase near top",
+                (bench::now_seconds() - erase_start) * 1e6 / kInserts,
+                "us/op");
+}
+
+template <typename Lines> void bench_access(const char *name, Lines &lines) {
+  Rng rng;
+  std::size_t checksum = 0;
+  const double start = bench::now_seconds();
+  for (int i = 0; i < kLookups; ++i) {
+    checksum += lines[rng.next(lines.size())].size();
+  }
+  bench::report(name, "random line access",
+                (bench::now_seconds() - start) * 1e9 / kLookups, "ns/op");
+
+  const double seq_start = bench::now_seconds();
+  for (std::size_t i = 0; i < lines.size(); ++i) {
+    checksum += lines[i].size();
+  }
+  bench::report(name, "sequential line access",
+                (bench::now_seconds() - seq_start) * 1e9 / lines.size(),
+                "ns/op");
+  if (checksum == 0) {
+    std::printf("unexpected empty lines\n");
+  }
+}
+
+std::string join_vector(const std::vector<std::string> &lines) {
+  std::size_t total = lines.empty() ? 0 : lines.size() - 1;
+  for (const auto &line : lines) {
+    total += line.size();
+  }
+  std::string text;
+  text.reserve(total);
+  for (std::size_t i = 0; i < lines.size(); ++i) {
+    if (i > 0) {
+      text.push_back('\n');
+    }
+    text.append(lines[i]);
+  }
+  return text;
+}
+
+template <typename Lines, typename Join>
+void bench_materialize(const char *name, const Lines &lines, Join join) {
+  const double start = bench::now_seconds();
+  const std::string text = join(lines);
+  const double elapsed = bench::now_seconds() - start;
+  bench::report(name, "full-text materialize",
+                (double)text.size() / (1024.0 * 1024.0) / elapsed, "MB/s");
+}
+} // namespace
+
+int main() {
+  {
+    std::vector<std::string> lines;
+    fill(lines);
+    bench_insert("lines/vector", lines);
+    bench_access("lines/vector", lines);
+    bench_materialize("lines/vector", lines, join_vector);
+  }
+  {
+    LineStore lines;
+    fill(lines);
+    bench_insert("lines/line-store", lines);
+    bench_access("lines/line-store", lines);
+    bench_materialize("lines/line-store", lines,
+                      [](const LineStore &l) { return l.join('\n'); });
+  }
+  return 0;
+}
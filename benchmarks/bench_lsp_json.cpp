@@ -0,0 +1,240 @@
+#include "bench_common.h"
+#include "json_tree_parser.h"
+#include "lsp_protocol.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Decoding cost of large language server responses: a rust-analyzer style
+// publishDiagnostics for a file with thousands of warnings and a tsserver
+// style completion list, both a few MB. The tree variant frames the stream
+// the way LSPClient used to (4 KB reads, a copy and an erase per message)
+// and parses every message into a JsonValue tree before picking fields;
+// the streaming variant frames 64 KB reads in place and pulls only the
+// fields LSPClient uses.
+
+namespace {
+long long g_allocations = 0;
+long long g_live_bytes = 0;
+long long g_peak_bytes = 0;
+} // namespace
+
+// Counting allocator, so each variant can report allocations and the peak
+// heap it needed on top of the input.
+void *operator new(std::size_t size) {
+  void *block = std::malloc(size + sizeof(std::max_align_t));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *static_cast<std::size_t *>(block) = size;
+  ++g_allocations;
+  g_live_bytes += (long long)size;
+  if (g_live_bytes > g_peak_bytes) {
+    g_peak_bytes = g_live_bytes;
+  }
+  return static_cast<char *>(block) + sizeof(std::max_align_t);
+}
+
+void operator delete(void *ptr) noexcept {
+  if (!ptr) {
+    return;
+  }
+  void *block = static_cast<char *>(ptr) - sizeof(std::max_align_t);
+  g_live_bytes -= (long long)*static_cast<std::size_t *>(block);
+  std::free(block);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+
+namespace {
+constexpr int kDiagnostics = 12000;
+constexpr int kCompletionItems = 8000;
+constexpr int kRounds = 5;
+
+std::string frame(const std::string &body) {
+  return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+std::string make_diagnostics() {
+  std::string body = R"({"jsonrpc":"2.0","method":"textDocument/)"
+                     R"(publishDiagnostics","params":{"uri":"file:///)"
+                     R"(work/src/lib.rs","version":7,"diagnostics":[)";
+  for (int i = 0; i < kDiagnostics; ++i) {
+    const std::string line = std::to_string(i);
+    if (i > 0) {
+      body += ',';
+    }
+    body += R"({"range":{"start":{"line":)" + line +
+            R"(,"character":8},"end":{"line":)" + line +
+            R"(,"character":21}},"severity":2,"code":"unused_variables",)"
+            R"("codeDescription":{"href":"https://doc.rust-lang.org/rustc/)"
+            R"(lints/listing/warn-by-default.html#unused-variables"},)"
+            R"("source":"rustc","message":"unused variable: `value_)" +
+            line +
+            R"(`\n`#[warn(unused_variables)]` on by default",)"
+            R"("relatedInformation":[{"location":{"uri":"file:///work/src/)"
+            R"(lib.rs","range":{"start":{"line":)" +
+            line + R"(,"character":8},"end":{"line":)" + line +
+            R"(,"character":21}}},"message":"if this is intentional, )"
+            R"(prefix it with an underscore: `_value"}],"tags":[1],)"
+            R"("data":{"rendered":"warning: unused variable\n  --> src/)"
+            R"(lib.rs\n   |\n   = note: on by default\n"}})";
+  }
+  body += "]}}";
+  return frame(body);
+}
+
+std::string make_completions() {
+  std::string body =
+      R"({"jsonrpc":"2.0","id":42,"result":{"isIncomplete":false,"items":[)";
+  for (int i = 0; i < kCompletionItems; ++i) {
+    const std::string name = "createElement" + std::to_string(i);
+    if (i > 0) {
+      body += ',';
+    }
+    body += R"({"label":")" + name +
+            R"(","labelDetails":{"description":"react-dom/client"},)"
+            R"("kind":3,"detail":"function )" +
+            name +
+            R"(<K extends keyof HTMLElementTagNameMap>(tagName: K, )"
+            R"(options?: ElementCreationOptions): HTMLElementTagNameMap[K]",)"
+            R"("sortText":"\u0016)" +
+            std::to_string(i) +
+            R"(","filterText":")" + name +
+            R"(","insertTextFormat":2,"textEdit":{"newText":")" + name +
+            R"json(($1)","range":{"start":{"line":120,"character":4},)json"
+            R"("end":{"line":120,"character":10}}},"commitCharacters":)"
+            R"([".",",",";","("],"data":{"file":"/work/src/app.tsx",)"
+            R"("line":121,"offset":11,"entryNames":[")" +
+            name + R"("]}})";
+  }
+  body += "]}}";
+  return frame(body);
+}
+
+struct Decoded {
+  std::size_t diagnostics = 0;
+  std::size_t completions = 0;
+};
+
+// The previous LSPClient::handle_stdout_data().
+void tree_receive(std::string &buffer, const char *data, std::size_t size,
+                  Decoded &decoded) {
+  buffer.append(data, size);
+  while (true) {
+    const size_t header_end = buffer.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+      return;
+    }
+    size_t content_length = 0;
+    if (!read_lsp_content_length(buffer.substr(0, header_end),
+                                 content_length)) {
+      buffer.erase(0, header_end + 4);
+      continue;
+    }
+    const size_t body_start = header_end + 4;
+    if (buffer.size() < body_start + content_length) {
+      return;
+    }
+    std::string message = buffer.substr(body_start, content_length);
+    buffer.erase(0, body_start + content_length);
+
+    size_t pos = 0;
+    JsonValue root;
+    if (!parse_json_value(message, pos, root)) {
+      continue;
+    }
+    const JsonValue *params = json_object_get(root, "params");
+    const JsonValue *diagnostics =
+        params ? json_object_get(*params, "diagnostics") : nullptr;
+    if (diagnostics) {
+      decoded.diagnostics += diagnostics_from_json(*diagnostics).size();
+    }
+    const JsonValue *result = json_object_get(root, "result");
+    if (result) {
+      decoded.completions += completion_items_from_json(*result).size();
+    }
+  }
+}
+
+// Same framing and dispatch as LSPClient::handle_stdout_data() and
+// handle_message().
+void stream_receive(std::string &buffer, const char *data, std::size_t size,
+                    Decoded &decoded) {
+  buffer.append(data, size);
+  const std::string_view view(buffer);
+  std::size_t offset = 0;
+  while (true) {
+    const size_t header_end = view.find("\r\n\r\n", offset);
+    if (header_end == std::string_view::npos) {
+      break;
+    }
+    size_t content_length = 0;
+    if (!read_lsp_content_length(view.substr(offset, header_end - offset),
+                                 content_length)) {
+      offset = header_end + 4;
+      continue;
+    }
+    const size_t body_start = header_end + 4;
+    if (view.size() - body_start < content_length) {
+      break;
+    }
+    LSPEnvelope envelope;
+    if (read_lsp_envelope(view.substr(body_start, content_length),
+                          envelope)) {
+      if (!envelope.params.empty()) {
+        std::string uri;
+        std::vector<Diagnostic> diagnostics;
+        read_lsp_diagnostics(envelope.params, uri, diagnostics);
+        decoded.diagnostics += diagnostics.size();
+      }
+      if (!envelope.result.empty()) {
+        std::vector<LSPCompletionItem> items;
+        read_lsp_completion_items(envelope.result, items);
+        decoded.completions += items.size();
+      }
+    }
+    offset = body_start + content_length;
+  }
+  buffer.erase(0, offset);
+}
+
+template <typename Receive>
+void run(const char *name, const std::string &stream, std::size_t chunk,
+         Receive receive) {
+  Decoded decoded;
+  const long long allocations_before = g_allocations;
+  const long long live_before = g_live_bytes;
+  g_peak_bytes = g_live_bytes;
+  const double start = bench::now_seconds();
+  for (int round = 0; round < kRounds; ++round) {
+    std::string buffer;
+    for (std::size_t pos = 0; pos < stream.size(); pos += chunk) {
+      receive(buffer, stream.data() + pos,
+              std::min(chunk, stream.size() - pos), decoded);
+    }
+  }
+  const double elapsed = bench::now_seconds() - start;
+  if (decoded.diagnostics != (std::size_t)kDiagnostics * kRounds ||
+      decoded.completions != (std::size_t)kCompletionItems * kRounds) {
+    std::fprintf(stderr, "%s: decoded %zu diagnostics, %zu completions\n",
+                 name, decoded.diagnostics, decoded.completions);
+  }
+  bench::report(name, "decode time / round", elapsed * 1e3 / kRounds, "ms");
+  bench::report(name, "allocations / round",
+                (double)(g_allocations - allocations_before) / kRounds, "");
+  bench::report(name, "peak heap", (g_peak_bytes - live_before) / 1024.0,
+                "KiB");
+}
+} // namespace
+
+int main() {
+  const std::string stream = make_diagnostics() + make_completions();
+  bench::report("lsp_json", "stream size", stream.size() / 1024.0, "KiB");
+  run("lsp_json/tree", stream, 4096, tree_receive);
+  run("lsp_json/streaming", stream, 64 * 1024, stream_receive);
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench_common.h"
+#include "regex_highlighter.h"
+#include "syntax.h"
+#include <string>
+#include <vector>
+
+// Highlights a generated 100k-line file with the old std::regex rule tables
+// and with the hand-written lexer, and reports throughput for each. Lines
+// whose colors differ are counted so behavior drift stays visible.
+
+namespace {
+constexpr int kLineCount = 100000;
+
+std::vector<std::string> make_cpp_file() {
+  static const char *const templates[] = {
+      "#include <vector>",
+      "// Compute the running total for block %d",
+      "static int total_%d = compute(%d, 0x1F, 3.5e2);",
+      "  for (int i = 0; i < %d; ++i) {",
+      "    if (values[i] != nullptr && flags & 0b101) {",
+      "      result += format(\"item %d: \\\"%s\\\"\", i, name);",
+      "    }  /* inline note */ return value_%d;",
+      "  }",
+      "class Widget_%d : public Base { public: virtual void draw() override; };",
+      "",
+  };
+  std::vector<std::string> lines;
+  lines.reserve(kLineCount);
+  const int count = sizeof(templates) / sizeof(templates[0]);
+  for (int i = 0; i < kLineCount; ++i) {
+    std::string line = templates[i % count];
+    const std::string number = std::to_string(i);
+    for (std::size_t pos; (pos = line.find("%d")) != std::string::npos;) {
+      line.replace(pos, 2, number);
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+std::vector<std::string> make_python_file() {
+  static const char *const templates[] = {
+      "from collections import defaultdict as dd",
+      "@cache",
+      "def handler_%d(self, value=0x10, scale=1.5):",
+      "    \"\"\"Handle event %d.\"\"\"",
+      "    if value is None or not self.ready:  # guard",
+      "        return compute('key', value * %d)",
+      "    return [x for x in range(%d) if x % 2]",
+      "",
+  };
+  std::vector<std::string> lines;
+  lines.reserve(kLineCount);
+  const int count = sizeof(templates) / sizeof(templates[0]);
+  for (int i = 0; i < kLineCount; ++i) {
+    std::string line = templates[i % count];
+    const std::string number = std::to_string(i);
+    for (std::size_t pos; (pos = line.find("%d")) != std::string::npos;) {
+      line.replace(pos, 2, number);
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+template <typename Highlighter>
+std::vector<std::vector<std::pair<int, int>>>
+run(const char *name, Highlighter &highlighter, const std::string &ext,
+    const std::vector<std::string> &lines) {
+  std::vector<std::vector<std::pair<int, int>>> colors;
+  colors.reserve(lines.size());
+  highlighter.set_language(ext);
+  const double start = bench::now_seconds();
+  for (const auto &line : lines) {
+    colors.push_back(highlighter.get_colors(line));
+  }
+  const double elapsed = bench::now_seconds() - start;
+  bench::report(name, "highlight throughput", lines.size() / elapsed,
+                "lines/s");
+  return colors;
+}
+
+void compare(const char *label, const std::string &ext,
+             const std::vector<std::string> &lines) {
+  const std::string regex_name = std::string("syntax/regex") + label;
+  const std::string lexer_name = std::string("syntax/lexer") + label;
+  RegexHighlighter regex;
+  SyntaxHighlighter lexer;
+  const auto expected = run(regex_name.c_str(), regex, ext, lines);
+  const auto actual = run(lexer_name.c_str(), lexer, ext, lines);
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < lines.size(); ++i) {
+    if (expected[i] != actual[i]) {
+      ++mismatches;
+    }
+  }
+  bench::report(lexer_name.c_str(), "lines differing from regex",
+                (double)mismatches, "lines");
+}
+} // namespace
+
+int main() {
+  compare("/cpp", ".cpp", make_cpp_file());
+  compare("/python", ".py", make_python_file());
+  return 0;
+}
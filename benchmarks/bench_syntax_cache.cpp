@@ -0,0 +1,80 @@
+#include "bench_common.h"
+#include "line_store.h"
+#include "syntax_cache.h"
+#include <algorithm>
+#include <string>
+
+// Frame-time benchmark for the per-buffer syntax cache. A viewport in the
+// middle of a 100k-line file is re-highlighted after every simulated Enter
+// press, once with the cache shifting entries along with the edit and once
+// dropping the whole cache whenever the line count changes (the previous
+// behavior). Hit/miss counters show how much of each frame was re-lexed.
+
+namespace {
+constexpr int kLineCount = 100000;
+constexpr int kViewportTop = 50000;
+constexpr int kViewportRows = 60;
+constexpr int kFrames = 200;
+
+LineStore make_file() {
+  static const char *const templates[] = {
+      "/* block comment",
+      "   spanning two lines */",
+      "static int total = compute(0x1F, 3.5e2);",
+      "  for (int i = 0; i < count; ++i) {",
+      "    result += format(\"item %d\", i);",
+      "  }",
+      "",
+  };
+  const int count = sizeof(templates) / sizeof(templates[0]);
+  LineStore lines;
+  for (int i = 0; i < kLineCount; ++i) {
+    lines.push_back(templates[i % count]);
+  }
+  return lines;
+}
+
+void render(SyntaxCache &cache, const LineStore &lines,
+            const SyntaxHighlighter &highlighter) {
+  for (int row = 0; row < kViewportRows; ++row) {
+    cache.line_colors(lines, kViewportTop + row, highlighter);
+  }
+}
+
+void run(const char *name, bool shift) {
+  LineStore lines = make_file();
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(".cpp");
+  SyntaxCache cache;
+  render(cache, lines, highlighter);
+  cache.reset_stats();
+
+  double worst = 0;
+  const double start = bench::now_seconds();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    const double frame_start = bench::now_seconds();
+    const int row = kViewportTop + kViewportRows / 2;
+    lines.insert(lines.begin() + row, "    int inserted = 0;");
+    if (!shift) {
+      cache.clear();
+    }
+    cache.invalidate_from(row);
+    render(cache, lines, highlighter);
+    worst = std::max(worst, bench::now_seconds() - frame_start);
+  }
+  const double elapsed = bench::now_seconds() - start;
+
+  bench::report(name, "frame time (avg)", elapsed * 1e6 / kFrames, "us");
+  bench::report(name, "frame time (worst)", worst * 1e6, "us");
+  bench::report(name, "cache hits per frame",
+                (double)cache.stats().hits / kFrames, "lines");
+  bench::report(name, "cache misses per frame",
+                (double)cache.stats().misses / kFrames, "lines");
+}
+} // namespace
+
+int main() {
+  run("syntax-cache/full-invalidate", false);
+  run("syntax-cache/shifting", true);
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include "bench_common.h"
+#include "integrated_terminal.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Runs `yes` through `head -c` (32 MB by default, pass another size in MB
+// as the first argument) in a shell and measures what a keystroke in an
+// editor pane waits for meanwhile. The legacy loop is the one Editor::run()
+// had: drain the PTY in 4 KB reads on the UI thread, then redraw, so a key
+// waits for a whole drain and redraw. With IntegratedTerminal's reader
+// thread the UI thread only waits for the screen lock while it draws, and
+// is woken at most once per frame; that wait is sampled every millisecond.
+
+namespace {
+constexpr int kCols = 160;
+constexpr int kRows = 40;
+constexpr int kFrameMs = 16;
+
+std::string command(std::size_t bytes) {
+  return "yes 'src/core/module.cpp:42:9: warning: unused variable' | head -c " +
+         std::to_string(bytes);
+}
+
+double percentile(std::vector<double> samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[(std::size_t)(p * (double)(samples.size() - 1))];
+}
+
+unsigned long draw(const VtScreen &screen) {
+  unsigned long sum = 0;
+  for (int y = 0; y < screen.rows(); y++) {
+    const Cell *row = screen.row(y);
+    for (int x = 0; x < screen.cols(); x++) {
+      sum += row[x].glyph;
+    }
+  }
+  return sum;
+}
+
+void report(const char *name, double mb, double seconds, long redraws,
+            const std::vector<double> &waits) {
+  bench::report(name, "MB/s", mb / seconds, "MB/s");
+  bench::report(name, "redraws/s", (double)redraws / seconds, "/s");
+  bench::report(name, "key wait p50", percentile(waits, 0.5) * 1e3, "ms");
+  bench::report(name, "key wait p99", percentile(waits, 0.99) * 1e3, "ms");
+  bench::report(name, "key wait max", percentile(waits, 1.0) * 1e3, "ms");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t megabytes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+  const std::size_t bytes = megabytes << 20;
+  const double mb = (double)megabytes;
+  unsigned long sink = 0;
+
+  {
+    int fd = -1;
+    const pid_t pid = forkpty(&fd, nullptr, nullptr, nullptr);
+    if (pid < 0) {
+      return 1;
+    }
+    if (pid == 0) {
+      execl("/bin/sh", "sh", "-c", command(bytes).c_str(), (char *)nullptr);
+      _exit(127);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    VtScreen screen(kCols, kRows, 10000);
+    std::vector<double> waits;
+    long redraws = 0;
+    bool done = false;
+    const double start = bench::now_seconds();
+    while (!done) {
+      pollfd pfd = {fd, POLLIN, 0};
+      ::poll(&pfd, 1, -1);
+      const double woke = bench::now_seconds();
+      char buf[4096];
+      while (true) {
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+          // EIO once the command has exited.
+          done = n == 0 || errno != EAGAIN;
+          break;
+        }
+        screen.feed(buf, (std::size_t)n);
+      }
+      sink += draw(screen);
+      redraws++;
+      waits.push_back(bench::now_seconds() - woke);
+    }
+    const double seconds = bench::now_seconds() - start;
+    close(fd);
+    waitpid(pid, nullptr, 0);
+    report("legacy ui-thread drain", mb, seconds, redraws, waits);
+  }
+
+  {
+    setenv("SHELL", "/bin/sh", 1);
+    std::atomic<long> wakes{0};
+    IntegratedTerminal term(10000);
+    term.set_ready_callback([&] { wakes++; });
+    term.set_refresh_interval_ms(kFrameMs);
+    term.resize(kCols, kRows);
+    if (!term.open_shell()) {
+      return 1;
+    }
+    for (char c : command(bytes) + "; exit") {
+      term.send_key(c, false, false, false);
+    }
+    std::vector<double> waits;
+    long redraws = 0;
+    const double start = bench::now_seconds();
+    term.send_key('\r', false, false, false);
+    while (term.is_active()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      const bool changed = term.poll_output();
+      const double key = bench::now_seconds();
+      {
+        auto lock = term.lock_screen();
+        for (CellSpan row : term.view(kRows)) {
+          for (int x = 0; x < row.width; x++) {
+            sink += row.cells[x].glyph;
+          }
+        }
+      }
+      waits.push_back(bench::now_seconds() - key);
+      redraws += changed ? 1 : 0;
+    }
+    const double seconds = bench::now_seconds() - start;
+    report("reader thread", mb, seconds, redraws, waits);
+    bench::report("reader thread", "ready callbacks/s",
+                  (double)wakes / seconds, "/s");
+  }
+  return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+#include "bench_common.h"
+#include "vt_screen.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Fills a terminal with 100k lines of compiler output (pass another count
+// as the first argument), then scrolls through all of it three lines per
+// frame over a 40-row viewport, the way the panel renders on mouse wheel.
+// The legacy variant keeps rows as deques of per-cell std::string cells and
+// copies the visible window into a fresh vector of rows every frame, as
+// IntegratedTerminal did before the packed scrollback ring; the ring hands
+// the renderer spans into its own storage instead. Memory per line is the
+// heap held by each store divided by its row count.
+
+namespace {
+constexpr int kCols = 160;
+constexpr int kRows = 40;
+constexpr int kStep = 3;
+
+struct StyledCell {
+  std::string ch;
+  int fg;
+  int bg;
+};
+
+std::string compiler_output(std::size_t lines) {
+  std::string out;
+  for (std::size_t i = 0; i < lines; i += 4) {
+    const std::string n = std::to_string(i % 900 + 1);
+    out += "\x1b[1msrc/core/module_" + n + ".cpp:" + n +
+           ":9: \x1b[0;1;35mwarning: \x1b[0m\x1b[1munused variable 'result' "
+           "[-Wunused-variable]\x1b[0m\r\n";
+    out += "  " + n + " |     int result = compute(index, offset);\r\n";
+    out += "      |         \x1b[0;1;32m^~~~~~\x1b[0m\r\n";
+    out += "[" + n + "/900] Building CXX object src/CMakeFiles/jot_core_obj.dir/"
+           "core/module_" + n + ".cpp.o\r\n";
+  }
+  return out;
+}
+
+// Heap estimate for one legacy row: the vector of cells plus each cell's
+// std::string, which holds one glyph inline.
+std::size_t legacy_row_bytes(const std::vector<StyledCell> &row) {
+  return row.capacity() * sizeof(StyledCell) + sizeof(row);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t lines =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  const std::string stream = compiler_output(lines);
+
+  VtScreen screen(kCols, kRows, lines);
+  double start = bench::now_seconds();
+  screen.feed(stream);
+  const double fill = bench::now_seconds() - start;
+  const std::size_t kept = screen.history_size();
+
+  // The same rows in the legacy layout, built from the ring.
+  std::deque<std::vector<StyledCell>> legacy;
+  std::size_t legacy_bytes = 0;
+  for (std::size_t i = 0; i < kept; i++) {
+    const CellSpan span = screen.history_row(i);
+    std::vector<StyledCell> row;
+    row.reserve((std::size_t)span.width);
+    for (int x = 0; x < span.width; x++) {
+      std::string ch;
+      append_utf8(ch, span.cells[x].glyph);
+      row.push_back({ch, span.cells[x].fg, span.cells[x].bg});
+    }
+    legacy_bytes += legacy_row_bytes(row);
+    legacy.push_back(std::move(row));
+  }
+
+  const int frames = (int)std::max<std::size_t>(1, (kept - kRows) / kStep);
+  unsigned long sink = 0;
+
+  start = bench::now_seconds();
+  for (int frame = 0; frame < frames; frame++) {
+    const std::size_t top = (std::size_t)frame * kStep;
+    std::vector<std::vector<StyledCell>> visible;
+    for (std::size_t i = top; i < top + kRows && i < legacy.size(); i++) {
+      visible.push_back(legacy[i]);
+    }
+    for (const auto &row : visible) {
+      for (const StyledCell &cell : row) {
+        sink += (unsigned char)cell.ch[0] + (unsigned)cell.fg;
+      }
+    }
+  }
+  const double copied = bench::now_seconds() - start;
+
+  start = bench::now_seconds();
+  for (int frame = 0; frame < frames; frame++) {
+    const std::size_t top = (std::size_t)frame * kStep;
+    for (std::size_t i = top; i < top + kRows && i < kept; i++) {
+      const CellSpan row = screen.history_row(i);
+      for (int x = 0; x < row.width; x++) {
+        sink += row.cells[x].glyph + row.cells[x].fg;
+      }
+    }
+  }
+  const double spans = bench::now_seconds() - start;
+
+  bench::report("scrollback", "lines kept", (double)kept, "lines");
+  bench::report("scrollback", "fill MB/s",
+                (double)stream.size() / (1 << 20) / fill, "MB/s");
+  bench::report("scrollback", "legacy bytes/line",
+                (double)legacy_bytes / (double)kept, "B");
+  bench::report("scrollback", "ring bytes/line",
+                (double)screen.history_bytes() / (double)kept, "B");
+  bench::report("scroll frames", "legacy copy us/frame",
+                copied * 1e6 / frames, "us");
+  bench::report("scroll frames", "ring spans us/frame", spans * 1e6 / frames,
+                "us");
+  return sink == 0 ? 1 : 0;
+}
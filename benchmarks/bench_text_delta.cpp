@@ -0,0 +1,90 @@
+#include "bench_common.h"
+#include "line_store.h"
+#include "text_delta.h"
+#include <string>
+
+// Cost of syncing one keystroke to a language server in a ~2 MB file:
+// joining and JSON-escaping the whole document for a full-text didChange
+// (the previous behavior) versus building a ranged one from the LineStore
+// journal.
+
+namespace {
+constexpr int kLineCount = 60000;
+constexpr int kEdits = 200;
+
+LineStore make_file() {
+  LineStore lines;
+  for (int i = 0; i < kLineCount; ++i) {
+    lines.push_back("    result += format(\"item %d\", values[" +
+                    std::to_string(i) + "]);");
+  }
+  return lines;
+}
+
+// Same escaping as LSPClient::json_escape().
+std::string json_escape(const std::string &value) {
+  std::string out;
+  out.reserve(value.size() + 8);
+  for (char c : value) {
+    switch (c) {
+    case '\\':
+      out += "\\\\";
+      break;
+    case '"':
+      out += "\\\"";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      out.push_back(c);
+      break;
+    }
+  }
+  return out;
+}
+} // namespace
+
+int main() {
+  LineStore lines = make_file();
+  TextSyncPoint sent = text_sync_point(lines);
+
+  double full_time = 0;
+  double delta_time = 0;
+  double full_bytes = 0;
+  double delta_bytes = 0;
+  for (int edit = 0; edit < kEdits; ++edit) {
+    const std::size_t row = (std::size_t)(edit * 7919) % kLineCount;
+    lines.mut(row).insert(4, "x");
+
+    double start = bench::now_seconds();
+    const std::string text = json_escape(lines.join('\n'));
+    full_time += bench::now_seconds() - start;
+    full_bytes += (double)text.size();
+
+    start = bench::now_seconds();
+    TextDelta delta;
+    if (compute_text_delta(sent, lines, delta) != TEXT_DELTA_NONE) {
+      sent = text_sync_point(lines);
+    }
+    const std::string change = json_escape(delta.text);
+    delta_time += bench::now_seconds() - start;
+    delta_bytes += (double)change.size() + 64; // range and framing
+  }
+
+  bench::report("lsp-sync/full", "time per edit", full_time * 1e6 / kEdits,
+                "us");
+  bench::report("lsp-sync/full", "payload per edit", full_bytes / kEdits,
+                "bytes");
+  bench::report("lsp-sync/incremental", "time per edit",
+                delta_time * 1e6 / kEdits, "us");
+  bench::report("lsp-sync/incremental", "payload per edit",
+                delta_bytes / kEdits, "bytes");
+  return 0;
+}
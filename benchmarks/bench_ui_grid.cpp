@@ -0,0 +1,194 @@
+#include "bench_common.h"
+#include "legacy_ui.h"
+#include "terminal.h"
+#include "ui.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+// Frame time of the UI cell grid at 300x100 (a 4K terminal). Every frame
+// clears the grid, draws a synthetic editor screen (tab bar, four bordered
+// panes of coloured code with box-drawing and non-ASCII text, status line)
+// and diffs it against what the terminal shows. Three scenes:
+//   idle   - nothing changes, so the frame is all clear/draw/diff
+//   cursor - the cursor line of one pane and the status line change
+//   scroll - every pane scrolls a line per frame, so most cells are sent
+// The cursor scene is also run with damage tracking, redrawing only what
+// changed. The terminal output goes to /dev/null; its size per frame is
+// reported from the terminal's byte counters, for the old cell-by-cell
+// escapes of the string-cell UI and for the screen encoder.
+
+namespace {
+constexpr int kWidth = 300;
+constexpr int kHeight = 100;
+constexpr int kFrames = 300;
+
+const char *const kCode[] = {
+    "int main(int argc, char **argv) {",
+    "  std::vector<std::string> names = load(argv[1]);",
+    "  for (const auto &name : names) {",
+    "    // naïve grüße — λx → x²",
+    "    if (name.empty()) continue;",
+    "    std::printf(\"%s\\n\", name.c_str());",
+    "  }",
+    "  return 0; // 完成",
+    "}",
+    "",
+};
+constexpr int kCodeLines = sizeof(kCode) / sizeof(kCode[0]);
+
+constexpr int kPaneW = kWidth / 2;
+constexpr int kPaneH = (kHeight - 2) / 2;
+
+UIRect pane_rect(int pane) {
+  return {(pane % 2) * kPaneW, 1 + (pane / 2) * kPaneH, kPaneW, kPaneH};
+}
+
+// One bordered pane of code; the first pane highlights the cursor line.
+template <typename Grid>
+void draw_pane(Grid &ui, int pane, int scroll, int cursor) {
+  const UIRect rect = pane_rect(pane);
+  ui.draw_border(rect, 8, 0);
+  for (int row = 1; row < rect.h - 1; ++row) {
+    const int line = scroll + row + pane * 7;
+    const int bg = pane == 0 && row == 1 + cursor % (rect.h - 2) ? 236 : 0;
+    const std::string number = std::to_string(line + 1);
+    ui.draw_text(rect.x + 1, rect.y + row,
+                 std::string(5 - number.size(), ' ') + number + " ", 8, bg);
+    const std::string &code = kCode[line % kCodeLines];
+    // Keyword, body and comment runs in different colours.
+    const std::size_t split = std::min<std::size_t>(code.size(), 6);
+    ui.draw_text(rect.x + 7, rect.y + row, code.substr(0, split), 6, bg, true);
+    ui.draw_text(rect.x + 7 + (int)split, rect.y + row, code.substr(split), 7,
+                 bg);
+    ui.draw_text(rect.x + 60, rect.y + row, "// " + std::to_string(line * 31),
+                 8, bg, false, true);
+  }
+}
+
+template <typename Grid> void draw_status(Grid &ui, int cursor) {
+  ui.fill_rect({0, kHeight - 1, kWidth, 1}, " ", 7, 0);
+  ui.draw_text(1, kHeight - 1,
+               " NORMAL  main  src/main.cpp  Ln " + std::to_string(cursor + 1),
+               0, 2, true);
+}
+
+template <typename Grid>
+void draw_scene(Grid &ui, int scroll, int cursor) {
+  ui.clear();
+  ui.fill_rect({0, 0, kWidth, 1}, " ", 7, 4);
+  for (int tab = 0; tab < 6; ++tab) {
+    ui.draw_text(tab * 24, 0, " file_" + std::to_string(tab) + ".cpp  × ",
+                 tab == 0 ? 7 : 8, tab == 0 ? 4 : 0, tab == 0);
+  }
+  for (int pane = 0; pane < 4; ++pane) {
+    draw_pane(ui, pane, scroll, cursor);
+  }
+  draw_status(ui, cursor);
+}
+
+struct Scene {
+  const char *name;
+  int scroll_step;
+  int cursor_step;
+};
+
+struct FrameCost {
+  double ms;
+  double bytes;
+};
+
+template <typename Grid>
+FrameCost measure_frames(Grid &ui, Terminal &terminal, const Scene &scene) {
+  ui.invalidate();
+  draw_scene(ui, 0, 0);
+  ui.render();
+  terminal.flush();
+  const std::uint64_t bytes_before = terminal.output_stats().bytes;
+  const double start = bench::now_seconds();
+  for (int frame = 1; frame <= kFrames; ++frame) {
+    draw_scene(ui, frame * scene.scroll_step, frame * scene.cursor_step);
+    ui.render();
+    terminal.flush();
+  }
+  return {(bench::now_seconds() - start) * 1e3 / kFrames,
+          double(terminal.output_stats().bytes - bytes_before) / kFrames};
+}
+
+// Cursor moves as Editor::render() draws them with damage tracking: only
+// the pane holding the cursor and the status line are cleared and drawn,
+// the other panes keep their cells and their rows are not compared.
+double damaged_frame_ms(UI &ui, int &rows) {
+  ui.invalidate();
+  draw_scene(ui, 0, 0);
+  ui.render();
+  ui.present();
+  rows = 0;
+  const double start = bench::now_seconds();
+  for (int frame = 1; frame <= kFrames; ++frame) {
+    ui.clear_rect(pane_rect(0));
+    draw_pane(ui, 0, 0, frame);
+    draw_status(ui, frame);
+    ui.render();
+    ui.present();
+    rows += ui.last_rendered_rows();
+  }
+  rows /= kFrames;
+  return (bench::now_seconds() - start) * 1e3 / kFrames;
+}
+} // namespace
+
+int main() {
+  // Terminal::flush() writes to stdout; keep the escape codes out of the
+  // report.
+  std::fflush(stdout);
+  const int saved_stdout = dup(STDOUT_FILENO);
+  const int null_fd = open("/dev/null", O_WRONLY);
+  dup2(null_fd, STDOUT_FILENO);
+
+  const Scene scenes[] = {
+      {"idle", 0, 0}, {"cursor", 0, 1}, {"scroll", 1, 1}};
+  FrameCost results[3][2];
+  double damaged = 0;
+  int damaged_rows = 0;
+  {
+    // Scoped so the terminal's shutdown sequence also goes to /dev/null.
+    Terminal terminal;
+    LegacyUI legacy(&terminal);
+    legacy.resize(kWidth, kHeight);
+    UI ui(&terminal);
+    ui.resize(kWidth, kHeight);
+    for (int i = 0; i < 3; ++i) {
+      results[i][0] = measure_frames(legacy, terminal, scenes[i]);
+      results[i][1] = measure_frames(ui, terminal, scenes[i]);
+    }
+    damaged = damaged_frame_ms(ui, damaged_rows);
+  }
+
+  std::fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  close(null_fd);
+
+  bench::report("ui_grid", "cell size (before)", sizeof(LegacyCell), "B");
+  bench::report("ui_grid", "cell size (after)", sizeof(Cell), "B");
+  for (int i = 0; i < 3; ++i) {
+    const std::string name = std::string("ui_grid/") + scenes[i].name;
+    bench::report(name.c_str(), "frame (string cells)", results[i][0].ms,
+                  "ms");
+    bench::report(name.c_str(), "frame (packed cells)", results[i][1].ms,
+                  "ms");
+    bench::report(name.c_str(), "frame bytes (per-cell escapes)",
+                  results[i][0].bytes, "B");
+    bench::report(name.c_str(), "frame bytes (screen encoder)",
+                  results[i][1].bytes, "B");
+  }
+  bench::report("ui_grid/cursor", "frame (damaged only)", damaged, "ms");
+  bench::report("ui_grid/cursor", "rows compared (full)", kHeight, "");
+  bench::report("ui_grid/cursor", "rows compared (damaged)", damaged_rows,
+                "");
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "bench_common.h"
+#include "types.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Types characters into a large buffer, recording an undo step before each
+// keystroke the way Editor::insert_char does. The snapshot variant replays
+// the previous behaviour (a full copy of the buffer per keystroke) for a
+// handful of keystrokes, since doing 10k of them would exhaust memory.
+
+namespace {
+constexpr int kLineCount = 1000000;
+constexpr int kKeystrokes = 10000;
+constexpr int kSnapshotKeystrokes = 20;
+
+LineStore make_buffer() {
+  LineStore lines;
+  for (int i = 0; i < kLineCount; ++i) {
+    lines.push_back("2024-01-01T00:00:00Z INFO request " + std::to_string(i) +
+                    " handled in 12ms");
+  }
+  return lines;
+}
+
+State state_at(int x, int y) {
+  State s{};
+  s.cursor = {x, y};
+  s.selection = {{x, y}, {x, y}, false};
+  return s;
+}
+
+void bench_snapshot(LineStore &lines) {
+  std::vector<LineStore> history;
+  const long rss_before = bench::resident_kb();
+  const double start = bench::now_seconds();
+  int x = 0;
+  const int y = kLineCount / 2;
+  for (int i = 0; i < kSnapshotKeystrokes; ++i) {
+    history.push_back(lines);
+    lines.mut(y).insert(x++, 1, 'a' + (i % 26));
+  }
+  const double elapsed = bench::now_seconds() - start;
+  bench::report("undo/snapshot", "per keystroke",
+                elapsed * 1e6 / kSnapshotKeystrokes, "us");
+  bench::report("undo/snapshot", "rss growth per step",
+                (double)(bench::resident_kb() - rss_before) /
+                    kSnapshotKeystrokes,
+                "KiB");
+}
+
+void bench_operation_log(LineStore &lines) {
+  UndoHistory history;
+  const long rss_before = bench::resident_kb();
+  const double start = bench::now_seconds();
+  int x = 0;
+  int y = kLineCount / 2;
+  long long clock_ms = 0;
+  for (int i = 0; i < kKeystrokes; ++i) {
+    // Break the typing run every 40 characters, as a pause would.
+    if (i % 40 == 0) {
+      clock_ms += 5000;
+      y += 1;
+      x = 0;
+    }
+    history.record(lines, y, y, state_at(x, y), true, clock_ms);
+    lines.mut(y).insert(x++, 1, 'a' + (i % 26));
+  }
+  const double elapsed = bench::now_seconds() - start;
+  bench::report("undo/operation-log", "per keystroke",
+                elapsed * 1e6 / kKeystrokes, "us");
+  bench::report("undo/operation-log", "undo steps",
+                (double)history.undo_depth(), "");
+  bench::report("undo/operation-log", "history bytes",
+                (double)history.memory_usage(), "B");
+  bench::report("undo/operation-log", "rss growth",
+                (double)(bench::resident_kb() - rss_before), "KiB");
+
+  State state = state_at(x, y);
+  const double undo_start = bench::now_seconds();
+  int undone = 0;
+  while (history.undo(lines, state)) {
+    ++undone;
+  }
+  bench::report("undo/operation-log", "per undo step",
+                (bench::now_seconds() - undo_start) * 1e6 / std::max(1, undone),
+                "us");
+}
+} // namespace
+
+int main() {
+  LineStore lines = make_buffer();
+  bench::report("undo", "buffer rss", (double)bench::resident_kb(), "KiB");
+  bench_operation_log(lines);
+  bench_snapshot(lines);
+  return 0;
+}
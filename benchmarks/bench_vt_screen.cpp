@@ -0,0 +1,148 @@
+#include "bench_common.h"
+#include "legacy_terminal.h"
+#include "vt_screen.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+// Feeds shell output to the terminal model in 64 KB reads, as the PTY
+// delivers it, and reports MB/s. The streams are synthetic recordings of
+// about 32 MB each (pass another size in MB as the first argument):
+// `cat` of source files, a `ninja` build that redraws its status line with
+// CR and EL between coloured compiler warnings, and full-screen frames of
+// a `top`-style monitor drawn with cursor addressing. The legacy variant is
+// the line-based model IntegratedTerminal used before VtScreen; VtScreen is
+// also run with a 100k-row history to show the cost does not follow it.
+
+namespace {
+constexpr std::size_t kChunk = 64 * 1024;
+constexpr int kRounds = 3;
+
+const char *const kSource[] = {
+    "  int value = compute(index, offset);",
+    "  if (buffer.empty()) {",
+    "    return std::string();",
+    "  }",
+    "// Handles one request from the client.",
+    "static void flush_pending(Writer &writer, std::size_t count) {",
+    "  for (std::size_t i = 0; i < items.size(); ++i) {",
+    "#include <vector>",
+    "\tconst auto &entry = table[key];",
+    "",
+};
+
+std::string cat_stream(std::size_t bytes) {
+  std::string out;
+  unsigned seed = 7;
+  while (out.size() < bytes) {
+    seed = seed * 1103515245u + 12345u;
+    out += kSource[(seed >> 16) % 10];
+    out += "\r\n";
+  }
+  return out;
+}
+
+std::string ninja_stream(std::size_t bytes) {
+  std::string out;
+  const int total = 4000;
+  for (int step = 1; out.size() < bytes; step = step % total + 1) {
+    out += "\r\x1b[K[" + std::to_string(step) + "/" + std::to_string(total) +
+           "] Building CXX object src/CMakeFiles/jot_core_obj.dir/core/"
+           "module_" +
+           std::to_string(step) + ".cpp.o";
+    if (step % 25 == 0) {
+      out += "\r\n\x1b[1msrc/core/module_" + std::to_string(step) +
+             ".cpp:42:9: \x1b[0;1;35mwarning: \x1b[0m\x1b[1munused variable "
+             "'result' [-Wunused-variable]\x1b[0m\r\n"
+             "   42 |     int result = compute(index, offset);\r\n"
+             "      |         \x1b[0;1;32m^~~~~~\x1b[0m\r\n";
+    }
+  }
+  return out;
+}
+
+std::string top_stream(std::size_t bytes, int cols, int rows) {
+  std::string out;
+  unsigned seed = 11;
+  while (out.size() < bytes) {
+    out += "\x1b[H\x1b[1;37;44m";
+    out += " top - load average: 0.42, 0.37, 0.31";
+    out += "\x1b[K\x1b[0m";
+    for (int row = 2; row <= rows; row++) {
+      seed = seed * 1103515245u + 12345u;
+      const int bar = (int)((seed >> 16) % 30);
+      out += "\x1b[" + std::to_string(row) + ";1H";
+      out += "\x1b[32m" + std::to_string(1000 + row) + "\x1b[0m user  ";
+      out += "\x1b[" + std::to_string(31 + row % 6) + "m[";
+      out += std::string((std::size_t)bar, '|');
+      out += std::string((std::size_t)(30 - bar), ' ');
+      out += "]\x1b[0m ";
+      out += std::to_string((seed >> 8) % 100) + ".0%";
+      out += "\x1b[K";
+    }
+    out += "\x1b[" + std::to_string(rows) + ";" + std::to_string(cols) + "H";
+  }
+  return out;
+}
+
+template <typename Feed>
+double best_seconds(const std::string &stream, Feed feed) {
+  double best = 1e9;
+  for (int round = 0; round < kRounds; round++) {
+    const double start = feed(stream);
+    best = std::min(best, bench::now_seconds() - start);
+  }
+  return best;
+}
+
+template <typename Model> void feed_chunks(Model &model, const std::string &s) {
+  for (std::size_t at = 0; at < s.size(); at += kChunk) {
+    model.feed(s.data() + at, std::min(kChunk, s.size() - at));
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::size_t megabytes =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+  const std::size_t bytes = megabytes << 20;
+  const int cols = 120;
+  const int rows = 40;
+
+  struct Workload {
+    const char *name;
+    std::string stream;
+  };
+  const Workload workloads[] = {
+      {"cat source", cat_stream(bytes)},
+      {"ninja build", ninja_stream(bytes)},
+      {"top frames", top_stream(bytes, cols, rows)},
+  };
+
+  for (const Workload &w : workloads) {
+    const double mb = (double)w.stream.size() / (1 << 20);
+    const double legacy = best_seconds(w.stream, [](const std::string &s) {
+      LegacyTerminal model;
+      const double start = bench::now_seconds();
+      feed_chunks(model, s);
+      return start;
+    });
+    const double grid = best_seconds(w.stream, [&](const std::string &s) {
+      VtScreen model(cols, rows);
+      const double start = bench::now_seconds();
+      feed_chunks(model, s);
+      return start;
+    });
+    const double deep = best_seconds(w.stream, [&](const std::string &s) {
+      VtScreen model(cols, rows, 100000);
+      const double start = bench::now_seconds();
+      feed_chunks(model, s);
+      return start;
+    });
+
+    bench::report(w.name, "legacy MB/s", mb / legacy, "MB/s");
+    bench::report(w.name, "vt screen MB/s", mb / grid, "MB/s");
+    bench::report(w.name, "vt screen 100k hist MB/s", mb / deep, "MB/s");
+  }
+  return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef JSON_TREE_PARSER_H
+#define JSON_TREE_PARSER_H
+
+#include "lsp_protocol.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// The JSON tree LSPClient parsed every message into before the
+// JsonReader-based decoders in lsp_protocol.h. Kept only as the baseline
+// for bench_lsp_json.
+struct JsonValue {
+  enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+  bool bool_value = false;
+  long long number_value = 0;
+  std::string string_value;
+  std::vector<JsonValue> array_value;
+  std::map<std::string, JsonValue> object_value;
+};
+
+bool parse_json_value(const std::string &text, size_t &pos, JsonValue &out);
+const JsonValue *json_object_get(const JsonValue &value,
+                                 const std::string &key);
+std::string json_string_or_empty(const JsonValue *value);
+std::vector<Diagnostic> diagnostics_from_json(const JsonValue &diagnostics);
+std::vector<LSPCompletionItem> completion_items_from_json(
+    const JsonValue &result);
+
+#endif
@@ -0,0 +1,355 @@
+#include "legacy_terminal.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+int parse_csi_number(const std::string &value, int fallback) {
+  if (value.empty()) {
+    return fallback;
+  }
+
+  int result = 0;
+  for (char c : value) {
+    if (!std::isdigit((unsigned char)c)) {
+      return fallback;
+    }
+    result = result * 10 + (c - '0');
+  }
+  return result;
+}
+} // namespace
+
+void LegacyTerminal::push_line(const std::string &line) {
+  sync_current_line();
+  lines.push_back(line);
+  styled_lines.push_back(current_styled_line);
+  while ((int)lines.size() > 2000) {
+    lines.pop_front();
+    styled_lines.pop_front();
+  }
+}
+
+void LegacyTerminal::sync_current_line() {
+  current_line.clear();
+  for (const auto &cell : current_styled_line) {
+    current_line += cell.ch;
+  }
+}
+
+void LegacyTerminal::put_glyph_at_cursor(const std::string &glyph) {
+  if (glyph.empty()) {
+    return;
+  }
+
+  while (current_column > current_styled_line.size()) {
+    current_styled_line.push_back({" ", current_fg, current_bg});
+  }
+  if (current_column < current_styled_line.size()) {
+    current_styled_line[current_column] = {glyph, current_fg, current_bg};
+  } else {
+    current_styled_line.push_back({glyph, current_fg, current_bg});
+  }
+  current_column++;
+}
+
+namespace {
+std::vector<int> parse_sgr_params(const std::string &params) {
+  std::vector<int> out;
+  if (params.empty()) {
+    out.push_back(0);
+    return out;
+  }
+
+  size_t start = 0;
+  while (start <= params.size()) {
+    size_t end = params.find(';', start);
+    std::string part = (end == std::string::npos)
+                           ? params.substr(start)
+                           : params.substr(start, end - start);
+    if (part.empty()) {
+      out.push_back(0);
+    } else {
+      out.push_back(parse_csi_number(part, 0));
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return out;
+}
+} // namespace
+
+void LegacyTerminal::handle_csi_sequence(char final_char) {
+  std::string params = csi_buffer;
+  csi_buffer.clear();
+
+  if (!params.empty() && (params[0] == '?' || params[0] == '>' ||
+                          params[0] == '!')) {
+    params.erase(params.begin());
+  }
+
+  int default_param = 1;
+  if (final_char == 'J' || final_char == 'K') {
+    // ANSI defaults for ED/EL are 0 (erase to end), not 1.
+    default_param = 0;
+  }
+
+  int first = default_param;
+  size_t sep = params.find(';');
+  if (sep == std::string::npos) {
+    first = parse_csi_number(params, default_param);
+  } else {
+    first = parse_csi_number(params.substr(0, sep), default_param);
+  }
+
+  switch (final_char) {
+  case 'A':
+  case 'B':
+    break;
+  case 'C':
+    current_column += (size_t)std::max(1, first);
+    while (current_column > current_styled_line.size()) {
+      current_styled_line.push_back({" ", current_fg, current_bg});
+    }
+    break;
+  case 'D': {
+    size_t amount = (size_t)std::max(1, first);
+    current_column = (amount > current_column) ? 0 : current_column - amount;
+    break;
+  }
+  case 'G':
+    current_column = (size_t)std::max(0, first - 1);
+    while (current_column > current_styled_line.size()) {
+      current_styled_line.push_back({" ", current_fg, current_bg});
+    }
+    break;
+  case 'H':
+  case 'f':
+    current_column = 0;
+    break;
+  case 'J':
+    // ED (Erase in Display):
+    // 0 = cursor -> end (common during prompt redraw; do NOT full-clear)
+    // 1 = start -> cursor
+    // 2/3 = full clear
+    // For this line-based view, only treat full clear modes as full reset.
+    if (first == 2 || first == 3) {
+      lines.clear();
+      styled_lines.clear();
+      current_line.clear();
+      current_styled_line.clear();
+      current_column = 0;
+    }
+    break;
+  case 'K':
+    if (first == 2) {
+      current_styled_line.clear();
+      current_line.clear();
+      current_column = 0;
+    } else if (first == 1) {
+      // Erase from start to cursor without shifting the remainder.
+      size_t erase_to = std::min(current_column, current_styled_line.size());
+      for (size_t i = 0; i < erase_to; i++) {
+        current_styled_line[i] = {" ", current_fg, current_bg};
+      }
+    } else {
+      if (current_column < current_styled_line.size()) {
+        current_styled_line.erase(current_styled_line.begin() + (long)current_column,
+                                  current_styled_line.end());
+      }
+    }
+    sync_current_line();
+    break;
+  case 'm': {
+    auto params_vec = parse_sgr_params(params);
+    for (size_t i = 0; i < params_vec.size(); i++) {
+      int p = params_vec[i];
+      if (p == 0) {
+        current_fg = 7;
+        current_bg = 0;
+      } else if (p == 39) {
+        current_fg = 7;
+      } else if (p == 49) {
+        current_bg = 0;
+      } else if (p >= 30 && p <= 37) {
+        current_fg = p - 30;
+      } else if (p >= 90 && p <= 97) {
+        current_fg = 8 + (p - 90);
+      } else if (p >= 40 && p <= 47) {
+        current_bg = p - 40;
+      } else if (p >= 100 && p <= 107) {
+        current_bg = 8 + (p - 100);
+      } else if (p == 38) {
+        if (i + 2 < params_vec.size() && params_vec[i + 1] == 5) {
+          current_fg = std::clamp(params_vec[i + 2], 0, 255);
+          i += 2;
+        } else if (i + 4 < params_vec.size() && params_vec[i + 1] == 2) {
+          i += 4; // RGB not directly supported in 256 UI; ignore for now.
+        }
+      } else if (p == 48) {
+        if (i + 2 < params_vec.size() && params_vec[i + 1] == 5) {
+          current_bg = std::clamp(params_vec[i + 2], 0, 255);
+          i += 2;
+        } else if (i + 4 < params_vec.size() && params_vec[i + 1] == 2) {
+          i += 4;
+        }
+      }
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void LegacyTerminal::feed(const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+
+    if (escape_state == ESC_PENDING) {
+      if (c == '[') {
+        escape_state = ESC_CSI;
+        csi_buffer.clear();
+      } else if (c == ']') {
+        escape_state = ESC_OSC;
+        osc_escape_pending = false;
+      } else if (c >= 0x20 && c <= 0x2f) {
+        escape_state = ESC_OTHER;
+      } else {
+        escape_state = ESC_NONE;
+      }
+      continue;
+    }
+
+    if (escape_state == ESC_CSI) {
+      if (c >= 0x30 && c <= 0x3f) {
+        csi_buffer.push_back((char)c);
+        continue;
+      }
+      if (c >= 0x20 && c <= 0x2f) {
+        continue;
+      }
+      if (c >= '@' && c <= '~') {
+        handle_csi_sequence((char)c);
+        escape_state = ESC_NONE;
+      }
+      continue;
+    }
+
+    if (escape_state == ESC_OSC) {
+      if (osc_escape_pending) {
+        osc_escape_pending = false;
+        if (c == '\\') {
+          escape_state = ESC_NONE;
+          continue;
+        }
+      }
+
+      if (c == '\a') {
+        escape_state = ESC_NONE;
+        continue;
+      }
+
+      if (c == 27) {
+        osc_escape_pending = true;
+      }
+      continue;
+    }
+
+    if (escape_state == ESC_OTHER) {
+      if (c >= 0x30 && c <= 0x7e) {
+        escape_state = ESC_NONE;
+      }
+      continue;
+    }
+
+    if (c == 27) {
+      escape_state = ESC_PENDING;
+      continue;
+    }
+
+    if (c == '\r') {
+      current_column = 0;
+    } else if (c == '\f') {
+      lines.clear();
+      styled_lines.clear();
+      current_line.clear();
+      current_styled_line.clear();
+      current_column = 0;
+      utf8_pending.clear();
+      utf8_expected_bytes = 0;
+    } else if (c == '\n') {
+      if (!utf8_pending.empty()) {
+        put_glyph_at_cursor("?");
+        utf8_pending.clear();
+        utf8_expected_bytes = 0;
+      }
+      push_line(current_line);
+      current_line.clear();
+      current_styled_line.clear();
+      current_column = 0;
+    } else if (c == '\b' || c == 127) {
+      if (current_column > 0) {
+        current_column--;
+        if (current_column < current_styled_line.size()) {
+          current_styled_line.erase(current_styled_line.begin() +
+                                    (long)current_column);
+        }
+        sync_current_line();
+      }
+    } else if (c == '\t') {
+      for (int j = 0; j < 2; j++) {
+        put_glyph_at_cursor(" ");
+      }
+      sync_current_line();
+    } else if (c >= 32) {
+      if (utf8_expected_bytes > 0) {
+        if ((c & 0xC0) == 0x80) {
+          utf8_pending.push_back((char)c);
+          if ((int)utf8_pending.size() >= utf8_expected_bytes) {
+            put_glyph_at_cursor(utf8_pending);
+            utf8_pending.clear();
+            utf8_expected_bytes = 0;
+            sync_current_line();
+          }
+        } else {
+          put_glyph_at_cursor("?");
+          utf8_pending.clear();
+          utf8_expected_bytes = 0;
+          if (c < 0x80) {
+            put_glyph_at_cursor(std::string(1, (char)c));
+            sync_current_line();
+          } else if ((c & 0xE0) == 0xC0) {
+            utf8_pending = std::string(1, (char)c);
+            utf8_expected_bytes = 2;
+          } else if ((c & 0xF0) == 0xE0) {
+            utf8_pending = std::string(1, (char)c);
+            utf8_expected_bytes = 3;
+          } else if ((c & 0xF8) == 0xF0) {
+            utf8_pending = std::string(1, (char)c);
+            utf8_expected_bytes = 4;
+          } else {
+            put_glyph_at_cursor("?");
+            sync_current_line();
+          }
+        }
+      } else if (c < 0x80) {
+        put_glyph_at_cursor(std::string(1, (char)c));
+        sync_current_line();
+      } else if ((c & 0xE0) == 0xC0) {
+        utf8_pending = std::string(1, (char)c);
+        utf8_expected_bytes = 2;
+      } else if ((c & 0xF0) == 0xE0) {
+        utf8_pending = std::string(1, (char)c);
+        utf8_expected_bytes = 3;
+      } else if ((c & 0xF8) == 0xF0) {
+        utf8_pending = std::string(1, (char)c);
+        utf8_expected_bytes = 4;
+      } else {
+        put_glyph_at_cursor("?");
+        sync_current_line();
+      }
+    }
+  }
+}
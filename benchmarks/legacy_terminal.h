@@ -0,0 +1,46 @@
+#ifndef LEGACY_TERMINAL_H
+#define LEGACY_TERMINAL_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+// The line-based output model IntegratedTerminal used before VtScreen: a
+// deque of text lines beside a deque of std::string cells, with cursor
+// movement between rows ignored. Kept only as the baseline for
+// bench_vt_screen.
+class LegacyTerminal {
+public:
+  void feed(const char *data, size_t size);
+  size_t line_count() const { return lines.size(); }
+
+private:
+  struct TerminalCell {
+    std::string ch;
+    int fg;
+    int bg;
+  };
+
+  enum EscapeState { ESC_NONE, ESC_PENDING, ESC_CSI, ESC_OSC, ESC_OTHER };
+
+  std::deque<std::string> lines;
+  std::deque<std::vector<TerminalCell>> styled_lines;
+  std::string current_line;
+  std::vector<TerminalCell> current_styled_line;
+  size_t current_column = 0;
+  int current_fg = 7;
+  int current_bg = 0;
+  std::string utf8_pending;
+  int utf8_expected_bytes = 0;
+  EscapeState escape_state = ESC_NONE;
+  bool osc_escape_pending = false;
+  std::string csi_buffer;
+
+  void push_line(const std::string &line);
+  void handle_csi_sequence(char final_char);
+  void sync_current_line();
+  void put_glyph_at_cursor(const std::string &glyph);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LEGACY_UI_H
+#define LEGACY_UI_H
+
+#include "terminal.h"
+#include "ui.h"
+#include <string>
+#include <vector>
+
+// The cell grid UI used before Cell and CellGrid: a std::string per cell in
+// a vector of rows, diffed with string compares. Kept only as the baseline
+// for bench_ui_grid.
+struct LegacyCell {
+  std::string ch;
+  int fg;
+  int bg;
+  bool bold;
+  bool italic;
+  bool reverse;
+
+  bool operator==(const LegacyCell &other) const {
+    return ch == other.ch && fg == other.fg && bg == other.bg &&
+           bold == other.bold && italic == other.italic &&
+           reverse == other.reverse;
+  }
+  bool operator!=(const LegacyCell &other) const { return !(*this == other); }
+};
+
+class LegacyUI {
+private:
+  Terminal *term;
+  std::vector<std::vector<LegacyCell>> grid;
+  std::vector<std::vector<LegacyCell>> last_grid;
+  int width, height;
+  int cursor_x, cursor_y;
+  bool cursor_hidden;
+
+  void set_cell(int x, int y, const LegacyCell &cell);
+
+public:
+  LegacyUI(Terminal *t);
+  void resize(int w, int h);
+  void invalidate();
+
+  void clear();
+  void render();
+
+  void draw_text(int x, int y, const std::string &text, int fg = 7, int bg = 0,
+                 bool bold = false, bool italic = false);
+  void draw_rect(const UIRect &rect, int fg, int bg);
+  void draw_border(const UIRect &rect, int fg, int bg);
+  void fill_rect(const UIRect &rect, const std::string &ch, int fg, int bg);
+};
+
+#endif
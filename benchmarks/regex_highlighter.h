@@ -0,0 +1,25 @@
+#ifndef REGEX_HIGHLIGHTER_H
+#define REGEX_HIGHLIGHTER_H
+
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The std::regex rule tables the editor used before SyntaxHighlighter became
+// a hand-written lexer. Kept only as the baseline for bench_syntax.
+class RegexHighlighter {
+private:
+  struct Rule {
+    std::regex pattern;
+    int color;
+  };
+  std::vector<Rule> rules;
+  std::string file_extension;
+
+public:
+  void set_language(const std::string &ext);
+  std::vector<std::pair<int, int>> get_colors(const std::string &line);
+};
+
+#endif
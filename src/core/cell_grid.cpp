@@ -0,0 +1,110 @@
+#include "cell_grid.h"
+#include <algorithm>
+#include <array>
+
+std::uint32_t GlyphTable::intern(std::string_view text) {
+  if (text.size() == 1 && (unsigned char)text[0] < kFirstInterned) {
+    return (unsigned char)text[0];
+  }
+  std::string key(text);
+  auto found = ids.find(key);
+  if (found != ids.end()) {
+    return found->second;
+  }
+  const std::uint32_t id = kFirstInterned + (std::uint32_t)glyphs.size();
+  glyphs.push_back(key);
+  ids.emplace(std::move(key), id);
+  return id;
+}
+
+std::uint32_t GlyphTable::intern_code_point(std::uint32_t code_point) {
+  if (code_point < kFirstInterned) {
+    return code_point >= 0x20 && code_point != 0x7F ? code_point : '?';
+  }
+  auto found = code_point_ids.find(code_point);
+  if (found != code_point_ids.end()) {
+    return found->second;
+  }
+  std::uint32_t id = '?';
+  if (code_point >= 0xA0 && code_point <= 0x10FFFF &&
+      (code_point < 0xD800 || code_point > 0xDFFF)) {
+    std::string text;
+    append_utf8(text, code_point);
+    id = intern(text);
+  }
+  code_point_ids.emplace(code_point, id);
+  return id;
+}
+
+std::string_view GlyphTable::text(std::uint32_t id) const {
+  static const std::array<char, kFirstInterned> kAscii = [] {
+    std::array<char, kFirstInterned> chars{};
+    for (std::uint32_t c = 0; c < kFirstInterned; ++c) {
+      chars[c] = (char)c;
+    }
+    return chars;
+  }();
+  if (id < kFirstInterned) {
+    return std::string_view(kAscii.data() + id, 1);
+  }
+  const std::size_t index = id - kFirstInterned;
+  if (index < glyphs.size()) {
+    return glyphs[index];
+  }
+  return std::string_view();
+}
+
+void append_utf8(std::string &out, std::uint32_t cp) {
+  if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+    cp = 0xFFFD;
+  }
+  if (cp < 0x80) {
+    out += (char)cp;
+  } else if (cp < 0x800) {
+    out += (char)(0xC0 | (cp >> 6));
+    out += (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += (char)(0xE0 | (cp >> 12));
+    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+    out += (char)(0x80 | (cp & 0x3F));
+  } else {
+    out += (char)(0xF0 | (cp >> 18));
+    out += (char)(0x80 | ((cp >> 12) & 0x3F));
+    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+    out += (char)(0x80 | (cp & 0x3F));
+  }
+}
+
+void CellGrid::resize(int width, int height, const Cell &fill_with) {
+  cols = width;
+  rows = height;
+  cells.assign((std::size_t)width * height, fill_with);
+}
+
+void CellGrid::fill(const Cell &cell) {
+  std::fill(cells.begin(), cells.end(), cell);
+}
+
+int first_cell_difference(const Cell *a, const Cell *b, int from, int count) {
+  // Compare four cells (32 bytes) per step without branching inside the
+  // block, which compilers turn into vector compares; only a block that
+  // differs is searched cell by cell.
+  int x = from;
+  for (; x + 4 <= count; x += 4) {
+    std::uint64_t wa[4];
+    std::uint64_t wb[4];
+    std::memcpy(wa, a + x, sizeof(wa));
+    std::memcpy(wb, b + x, sizeof(wb));
+    const std::uint64_t diff =
+        (wa[0] ^ wb[0]) | (wa[1] ^ wb[1]) | (wa[2] ^ wb[2]) | (wa[3] ^ wb[3]);
+    if (diff != 0) {
+      break;
+    }
+  }
+  for (; x < count; ++x) {
+    if (a[x] != b[x]) {
+      return x;
+    }
+  }
+  return count;
+}
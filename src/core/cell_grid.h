@@ -0,0 +1,108 @@
+#ifndef CELL_GRID_H
+#define CELL_GRID_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Maps the UTF-8 text of a screen cell to a 32-bit id. ASCII characters
+// are their own id and never touch the table; anything else is interned on
+// first use and keeps its id for the life of the table.
+class GlyphTable {
+public:
+  static constexpr std::uint32_t kNone = 0xFFFFFFFFu; // matches no glyph
+
+  std::uint32_t intern(std::string_view text);
+  // The id of one Unicode code point, as terminal screens store them.
+  // Controls, surrogates and values past U+10FFFF become '?'.
+  std::uint32_t intern_code_point(std::uint32_t code_point);
+  std::string_view text(std::uint32_t id) const;
+  std::size_t size() const { return glyphs.size(); }
+
+private:
+  static constexpr std::uint32_t kFirstInterned = 0x80;
+
+  std::vector<std::string> glyphs; // id - kFirstInterned
+  std::unordered_map<std::string, std::uint32_t> ids;
+  std::unordered_map<std::uint32_t, std::uint32_t> code_point_ids;
+};
+
+// Appends the UTF-8 encoding of a code point; invalid ones become U+FFFD.
+void append_utf8(std::string &out, std::uint32_t code_point);
+
+enum CellAttr : std::uint8_t {
+  CELL_BOLD = 1 << 0,
+  CELL_ITALIC = 1 << 1,
+  CELL_REVERSE = 1 << 2,
+};
+
+// One screen cell in 8 bytes. All bytes, including the padding one, are
+// always written so cells and rows can be compared as raw memory.
+struct Cell {
+  std::uint32_t glyph = ' ';
+  std::uint8_t fg = 7;
+  std::uint8_t bg = 0;
+  std::uint8_t attrs = 0;
+  std::uint8_t unused = 0;
+
+  static Cell make(std::uint32_t glyph, int fg, int bg, std::uint8_t attrs) {
+    Cell cell;
+    cell.glyph = glyph;
+    cell.fg = palette_index(fg);
+    cell.bg = palette_index(bg);
+    cell.attrs = attrs;
+    return cell;
+  }
+  // 256-colour palette index; out of range values are clamped.
+  static std::uint8_t palette_index(int color) {
+    return (std::uint8_t)(color < 0 ? 0 : color > 255 ? 255 : color);
+  }
+
+  bool same_style(const Cell &other) const {
+    return fg == other.fg && bg == other.bg && attrs == other.attrs;
+  }
+  bool operator==(const Cell &other) const {
+    return std::memcmp(this, &other, sizeof(Cell)) == 0;
+  }
+  bool operator!=(const Cell &other) const { return !(*this == other); }
+};
+static_assert(sizeof(Cell) == 8, "Cell must stay packed");
+
+// Row-major width x height block of cells in one allocation.
+class CellGrid {
+public:
+  void resize(int width, int height, const Cell &fill_with);
+  void fill(const Cell &cell);
+
+  int width() const { return cols; }
+  int height() const { return rows; }
+  Cell *row(int y) { return cells.data() + (std::size_t)y * cols; }
+  const Cell *row(int y) const { return cells.data() + (std::size_t)y * cols; }
+  Cell &at(int x, int y) { return row(y)[x]; }
+  const Cell &at(int x, int y) const { return row(y)[x]; }
+
+  void copy_row_from(const CellGrid &other, int y) {
+    copy_span_from(other, y, 0, cols);
+  }
+  void copy_span_from(const CellGrid &other, int y, int x0, int x1) {
+    std::memcpy(row(y) + x0, other.row(y) + x0,
+                (std::size_t)(x1 - x0) * sizeof(Cell));
+  }
+  bool row_equals(const CellGrid &other, int y) const {
+    return std::memcmp(row(y), other.row(y), (std::size_t)cols * sizeof(Cell)) ==
+           0;
+  }
+
+private:
+  std::vector<Cell> cells;
+  int cols = 0;
+  int rows = 0;
+};
+
+// First x in [from, count) where the rows differ, or count.
+int first_cell_difference(const Cell *a, const Cell *b, int from, int count);
+
+#endif
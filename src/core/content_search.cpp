@@ -0,0 +1,475 @@
+#include "content_search.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kPublishInterval = std::chrono::milliseconds(16);
+constexpr std::size_t kMaxThreads = 16;
+// Like Find Files' preview: a NUL in the first bytes means binary.
+constexpr std::size_t kBinaryProbeBytes = 8192;
+// A long file is searched in pieces so a cancelled search stops soon.
+constexpr std::size_t kPieceBytes = 16u << 20;
+constexpr std::size_t kMaxLineText = 240;
+
+char lower_char(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+// 0x20 when `c` is a letter matched without case: OR-ing it into a byte
+// folds 'A'..'Z' onto 'a'..'z' and no other byte onto a letter.
+unsigned char fold_bit(char c, bool exact) {
+  return !exact && c >= 'a' && c <= 'z' ? 0x20 : 0;
+}
+
+// A file's bytes, memory-mapped where possible.
+class FileBytes {
+public:
+  FileBytes() = default;
+  FileBytes(const FileBytes &) = delete;
+  FileBytes &operator=(const FileBytes &) = delete;
+  ~FileBytes() {
+#if defined(JOT_PLATFORM_POSIX)
+    if (mapped) {
+      munmap(mapped, length);
+    }
+#endif
+  }
+
+  bool open(const std::string &path) {
+#if defined(JOT_PLATFORM_POSIX)
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return false;
+    }
+    length = (std::size_t)st.st_size;
+    if (length > 0) {
+      void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+        mapped = map;
+        madvise(map, length, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+    if (mapped || length == 0) {
+      bytes = static_cast<const char *>(mapped);
+      return true;
+    }
+#endif
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+      return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    copy = text.str();
+    bytes = copy.data();
+    length = copy.size();
+    return true;
+  }
+
+  const char *data() const { return bytes; }
+  std::size_t size() const { return length; }
+
+private:
+  const char *bytes = nullptr;
+  std::size_t length = 0;
+  void *mapped = nullptr;
+  std::string copy;
+};
+
+struct LineHit {
+  std::uint32_t line;
+  std::uint32_t column;
+  std::string text;
+};
+
+// Appends up to `limit` matching lines of [data, data + size) to `hits`,
+// stopping early once `cancelled` says so.
+template <typename Cancelled>
+void search_bytes(const char *data, std::size_t size,
+                  const LiteralFinder &finder, Cancelled &cancelled,
+                  std::size_t limit, std::vector<LineHit> &hits) {
+  if (std::memchr(data, 0, std::min(size, kBinaryProbeBytes))) {
+    return;
+  }
+  const char *end = data + size;
+  const char *pos = data;
+  // Lines before `counted` are in `line`.
+  const char *counted = data;
+  std::uint32_t line = 0;
+  while (pos < end && hits.size() < limit) {
+    const char *piece_end =
+        (std::size_t)(end - pos) > kPieceBytes ? pos + kPieceBytes : end;
+    const char *hit = finder.find(pos, piece_end);
+    if (!hit) {
+      if (piece_end == end) {
+        break;
+      }
+      if (cancelled()) {
+        return;
+      }
+      // The next piece overlaps so a match across the seam is not missed.
+      pos = piece_end - (finder.size() - 1);
+      continue;
+    }
+
+    const char *line_start = hit;
+    while (line_start > counted && line_start[-1] != '\n') {
+      line_start--;
+    }
+    line += (std::uint32_t)std::count(counted, line_start, '\n');
+    counted = line_start;
+    const void *newline = std::memchr(hit, '\n', end - hit);
+    const char *line_end = newline ? static_cast<const char *>(newline) : end;
+
+    std::size_t text_length =
+        std::min<std::size_t>(line_end - line_start, kMaxLineText);
+    if (text_length > 0 && line_start[text_length - 1] == '\r') {
+      text_length--;
+    }
+    hits.push_back({line, (std::uint32_t)(hit - line_start),
+                    std::string(line_start, text_length)});
+    pos = line_end + 1;
+  }
+}
+} // namespace
+
+LiteralFinder::LiteralFinder(std::string_view text) : needle(text) {
+  exact = std::any_of(needle.begin(), needle.end(),
+                      [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+LiteralFinder::LiteralFinder(std::string_view text, bool case_sensitive)
+    : needle(text), exact(case_sensitive) {
+  if (!exact) {
+    std::transform(needle.begin(), needle.end(), needle.begin(), lower_char);
+  }
+}
+
+bool LiteralFinder::equal_at(const char *at) const {
+  if (exact) {
+    return std::memcmp(at, needle.data(), needle.size()) == 0;
+  }
+  for (std::size_t i = 0; i < needle.size(); i++) {
+    if (lower_char(at[i]) != needle[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char *LiteralFinder::find(const char *begin, const char *end) const {
+  const std::size_t n = needle.size();
+  if (n == 0 || end - begin < (std::ptrdiff_t)n) {
+    return nullptr;
+  }
+  const char *last_start = end - n;
+  const char first = needle[0];
+  const unsigned char first_fold = fold_bit(first, exact);
+  const char *p = begin;
+#if defined(__SSE2__)
+  // Positions where both the first and the last byte of the needle line
+  // up; most blocks have none.
+  const char last = needle[n - 1];
+  const __m128i want_first = _mm_set1_epi8(first);
+  const __m128i want_last = _mm_set1_epi8(last);
+  const __m128i fold_first = _mm_set1_epi8((char)first_fold);
+  const __m128i fold_last = _mm_set1_epi8((char)fold_bit(last, exact));
+  for (; last_start - p >= 15; p += 16) {
+    const __m128i a = _mm_or_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), fold_first);
+    const __m128i b = _mm_or_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1)),
+        fold_last);
+    unsigned mask = (unsigned)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, want_first),
+                      _mm_cmpeq_epi8(b, want_last)));
+    while (mask) {
+      const int bit = __builtin_ctz(mask);
+      if (equal_at(p + bit)) {
+        return p + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; p <= last_start; p++) {
+    if ((char)(*p | first_fold) == first && equal_at(p)) {
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<std::uint32_t>
+content_search_files(const FileIndexSnapshot &snap, std::string_view dir) {
+  struct Frame {
+    std::string dir;
+    std::size_t end;
+    GitIgnoreRules rules;
+  };
+  std::vector<Frame> frames;
+  auto enter = [&](std::string rel, std::size_t end) {
+    Frame frame{std::move(rel), end, {}};
+    const std::string base =
+        frame.dir.empty() ? snap.root : snap.root + "/" + frame.dir;
+    frame.rules.load(base + "/.gitignore");
+    if (frame.dir.empty()) {
+      frame.rules.load(snap.root + "/.git/info/exclude");
+    }
+    if (!frame.rules.empty()) {
+      frames.push_back(std::move(frame));
+    }
+  };
+
+  // The directories from the index root down to `dir` count too.
+  enter("", snap.size());
+  for (std::size_t slash = 0; slash < dir.size() && !dir.empty();) {
+    slash = dir.find('/', slash + 1);
+    if (slash == std::string_view::npos) {
+      slash = dir.size();
+    }
+    enter(std::string(dir.substr(0, slash)), snap.size());
+  }
+
+  std::vector<std::uint32_t> files;
+  const auto range = snap.subtree(dir);
+  for (std::size_t i = range.first; i < range.second;) {
+    while (!frames.empty() && i >= frames.back().end) {
+      frames.pop_back();
+    }
+    const std::string_view rel = snap.path(i);
+    const bool is_dir = snap.is_directory(i);
+    int verdict = 0;
+    for (const Frame &frame : frames) {
+      const std::string_view below =
+          frame.dir.empty() ? rel : rel.substr(frame.dir.size() + 1);
+      const int rule = frame.rules.match(below, is_dir);
+      if (rule != 0) {
+        verdict = rule;
+      }
+    }
+    if (is_dir) {
+      const std::size_t end = snap.subtree(rel).second;
+      if (verdict > 0) {
+        i = end;
+        continue;
+      }
+      enter(std::string(rel), end);
+    } else if (verdict <= 0) {
+      files.push_back((std::uint32_t)i);
+    }
+    i++;
+  }
+  return files;
+}
+
+ContentSearch::~ContentSearch() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    ready_callback = nullptr;
+    current++;
+  }
+  work.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void ContentSearch::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+std::uint64_t
+ContentSearch::start(std::shared_ptr<const FileIndexSnapshot> snapshot,
+                     const std::string &dir, const std::string &query,
+                     std::size_t limit) {
+  std::uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation = ++current;
+    pending.generation = generation;
+    pending.snapshot = std::move(snapshot);
+    pending.dir = dir;
+    pending.query = query;
+    pending.limit = limit;
+    has_pending = true;
+    if (!worker.joinable()) {
+      worker = std::thread([this] { run(); });
+    }
+  }
+  work.notify_one();
+  return generation;
+}
+
+void ContentSearch::cancel() {
+  std::lock_guard<std::mutex> lock(mutex);
+  current++;
+  has_pending = false;
+  pending.snapshot.reset();
+}
+
+void ContentSearch::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work.wait(lock, [this] { return stopping || has_pending; });
+    if (stopping) {
+      return;
+    }
+    const Request request = std::move(pending);
+    pending.snapshot.reset();
+    has_pending = false;
+    lock.unlock();
+    search(request);
+    lock.lock();
+  }
+}
+
+void ContentSearch::search(const Request &request) {
+  const FileIndexSnapshot &snap = *request.snapshot;
+  if (listed_snapshot != request.snapshot || listed_dir != request.dir) {
+    listed_files = content_search_files(snap, request.dir);
+    listed_snapshot = request.snapshot;
+    listed_dir = request.dir;
+  }
+  const std::vector<std::uint32_t> &files = listed_files;
+  const LiteralFinder finder(request.query);
+
+  struct Found {
+    std::size_t order; // position in `files`
+    ContentMatch match;
+  };
+  std::mutex found_mutex;
+  std::vector<Found> found;
+  std::size_t files_searched = 0;
+  std::uint64_t bytes_searched = 0;
+  bool published_any = false;
+  // Each publish copies every match so far; with many matches the next
+  // one waits long enough to keep that to a fraction of the search.
+  Clock::time_point next_publish = Clock::now();
+  std::atomic<std::size_t> next_file{0};
+  std::atomic<bool> full{false};
+
+  auto cancelled = [&] { return full || current != request.generation; };
+  // Under found_mutex.
+  auto results = [&](bool done) {
+    auto next = std::make_shared<ContentSearchResults>();
+    next->generation = request.generation;
+    next->root = snap.root;
+    next->files_searched = files_searched;
+    next->files_total = files.size();
+    next->bytes_searched = bytes_searched;
+    next->truncated = full;
+    next->done = done;
+    std::vector<const Found *> order;
+    order.reserve(found.size());
+    for (const Found &f : found) {
+      order.push_back(&f);
+    }
+    std::sort(order.begin(), order.end(), [](const Found *a, const Found *b) {
+      return a->order != b->order ? a->order < b->order
+                                  : a->match.line < b->match.line;
+    });
+    next->matches.reserve(order.size());
+    for (const Found *f : order) {
+      next->matches.push_back(f->match);
+    }
+    return next;
+  };
+
+  auto work = [&] {
+    std::vector<LineHit> hits;
+    while (!cancelled()) {
+      const std::size_t k = next_file++;
+      if (k >= files.size()) {
+        break;
+      }
+      const std::string rel(snap.path(files[k]));
+      hits.clear();
+      std::size_t size = 0;
+      {
+        FileBytes file;
+        if (file.open(snap.root + "/" + rel)) {
+          size = file.size();
+          search_bytes(file.data(), file.size(), finder, cancelled,
+                       request.limit, hits);
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(found_mutex);
+      files_searched++;
+      bytes_searched += size;
+      for (LineHit &hit : hits) {
+        if (found.size() >= request.limit) {
+          full = true;
+          break;
+        }
+        found.push_back({k, {rel, hit.line, hit.column, std::move(hit.text)}});
+      }
+      if (found.size() >= request.limit) {
+        full = true;
+      }
+      const Clock::time_point now = Clock::now();
+      if ((!published_any && !found.empty()) || now >= next_publish) {
+        publish(results(false));
+        published_any = published_any || !found.empty();
+        const Clock::time_point after = Clock::now();
+        next_publish = after + std::max<Clock::duration>(
+                                   kPublishInterval, (after - now) * 8);
+      }
+    }
+  };
+
+  const std::size_t threads = std::max<std::size_t>(
+      1, std::min({(std::size_t)std::thread::hardware_concurrency(),
+                   kMaxThreads, files.size()}));
+  std::vector<std::thread> helpers;
+  for (std::size_t t = 1; t < threads; t++) {
+    helpers.emplace_back(work);
+  }
+  work();
+  for (std::thread &helper : helpers) {
+    helper.join();
+  }
+
+  if (current != request.generation) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(found_mutex);
+  publish(results(true));
+}
+
+void ContentSearch::publish(std::shared_ptr<ContentSearchResults> next) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (next->generation != current) {
+    return;
+  }
+  std::atomic_store(
+      &published, std::shared_ptr<const ContentSearchResults>(std::move(next)));
+  if (ready_callback) {
+    ready_callback();
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef CONTENT_SEARCH_H
+#define CONTENT_SEARCH_H
+
+#include "file_index.h"
+#include "gitignore.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Finds a literal in a byte range. Case-insensitive (ASCII) unless the
+// needle has an uppercase letter. Candidates are found 16 positions at a
+// time by comparing the needle's first and last bytes where SSE2 is
+// available, and confirmed with a full compare.
+class LiteralFinder {
+public:
+  explicit LiteralFinder(std::string_view needle);
+  // Exact, or case-insensitive (ASCII) regardless of the needle.
+  LiteralFinder(std::string_view needle, bool case_sensitive);
+
+  std::size_t size() const { return needle.size(); }
+  bool case_sensitive() const { return exact; }
+  // First occurrence in [begin, end), or nullptr.
+  const char *find(const char *begin, const char *end) const;
+
+private:
+  std::string needle; // lowercase unless exact
+  bool exact = false;
+
+  bool equal_at(const char *at) const;
+};
+
+// One matching line.
+struct ContentMatch {
+  std::string path; // relative to ContentSearchResults::root
+  std::uint32_t line = 0;   // from 0
+  std::uint32_t column = 0; // byte offset of the match in the line
+  std::string text;         // the line, clipped
+};
+
+struct ContentSearchResults {
+  std::uint64_t generation = 0;
+  std::string root;
+  std::vector<ContentMatch> matches; // in tree order, then by line
+  std::size_t files_searched = 0;
+  std::size_t files_total = 0;
+  std::uint64_t bytes_searched = 0;
+  bool truncated = false; // stopped at the match limit
+  bool done = false;
+};
+
+// The files below the relative directory `dir` that are not ignored by a
+// .gitignore at or below the index root, as entry indices. Ignored
+// directories are not entered.
+std::vector<std::uint32_t>
+content_search_files(const FileIndexSnapshot &snap, std::string_view dir);
+
+// Searches the contents of the files in a FileIndexSnapshot for a literal,
+// on a worker thread that shares the files out to one thread per core.
+// Files are memory-mapped where possible; ones with a NUL byte near the
+// start are taken to be binary and skipped. Matches are published as they
+// are found, at most one per line. Generations and cancellation work as in
+// FileSearch.
+//
+// The ready callback runs on a search thread, under the search's lock,
+// after each publish; it must not call back into the search.
+class ContentSearch {
+public:
+  ContentSearch() = default;
+  ~ContentSearch();
+  ContentSearch(const ContentSearch &) = delete;
+  ContentSearch &operator=(const ContentSearch &) = delete;
+
+  void set_ready_callback(std::function<void()> callback);
+  // Searches the files below the relative directory `dir` for `query`,
+  // stopping after `limit` matches. Returns the new generation.
+  std::uint64_t start(std::shared_ptr<const FileIndexSnapshot> snapshot,
+                      const std::string &dir, const std::string &query,
+                      std::size_t limit);
+  void cancel();
+  std::uint64_t generation() const { return current; }
+
+  std::shared_ptr<const ContentSearchResults> results() const {
+    return std::atomic_load(&published);
+  }
+
+private:
+  struct Request {
+    std::uint64_t generation = 0;
+    std::shared_ptr<const FileIndexSnapshot> snapshot;
+    std::string dir;
+    std::string query;
+    std::size_t limit = 0;
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable work;
+  std::thread worker;
+  std::function<void()> ready_callback;
+  Request pending;
+  bool has_pending = false;
+  bool stopping = false;
+  std::atomic<std::uint64_t> current{0};
+  std::shared_ptr<const ContentSearchResults> published =
+      std::make_shared<ContentSearchResults>();
+
+  // The file list of the last search, reused while the snapshot and
+  // directory stay the same. Worker only.
+  std::shared_ptr<const FileIndexSnapshot> listed_snapshot;
+  std::string listed_dir;
+  std::vector<std::uint32_t> listed_files;
+
+  void run();
+  void search(const Request &request);
+  void publish(std::shared_ptr<ContentSearchResults> next);
+};
+
+#endif
@@ -60,6 +60,8 @@ Editor::Editor() {
   current_integrated_terminal = -1;
   integrated_terminal_height =
       std::clamp(config.get_int("terminal_height", 10), 5, 20);
+  integrated_terminal_scrollback = (size_t)std::clamp(
+      config.get_int("terminal_scrollback", 100000), 0, 1000000);
   show_search = false;
   show_command_palette = false;
   command_palette_selected = 0;
@@ -82,11 +84,11 @@ Editor::Editor() {
   root_dir = ".";
   workspace_session_enabled = false;
   workspace_session_root.clear();
-  git_root.clear();
-  git_branch.clear();
-  git_dirty_count = 0;
-  git_file_status.clear();
-  git_last_refresh_ms = 0;
+  git_status = git_status_service.snapshot();
+  git_status_service.set_ready_callback([this] { terminal.wake(); });
+  highlight_scheduler.set_ready_callback([this] { terminal.wake(); });
+  telescope.set_ready_callback([this] { terminal.wake(); });
+  save_pipeline.set_ready_callback([this] { terminal.wake(); });
   file_tree_selected = 0;
   file_tree_scroll = 0;
   sidebar_show_hidden = false;
@@ -128,6 +130,9 @@ Editor::Editor() {
   lsp_change_debounce_ms =
       std::clamp(config.get_int("lsp_change_debounce_ms", 120), 25, 1000);
   last_cursor_shape = -1;
+  scene_render_key = 0;
+  sidebar_render_key = 0;
+  last_frame_had_overlay = true;
   show_context_menu = false;
   context_menu_x = 0;
   context_menu_y = 0;
@@ -193,6 +198,13 @@ EditorHostAPI &Editor::host() { return *host_api; }
 const EditorHostAPI &Editor::host() const { return *host_api; }
 
 Editor::~Editor() {
+  // The scheduler and telescope are declared before the terminal and
+  // outlive it. The save pipeline and file loads go first, but the
+  // pipeline still drains queued writes; nothing needs waking by then.
+  highlight_scheduler.set_ready_callback(nullptr);
+  telescope.set_ready_callback(nullptr);
+  save_pipeline.set_ready_callback(nullptr);
+  file_loads.clear();
   save_workspace_session();
   save_recent_files();
   save_recent_workspaces();
@@ -4,10 +4,17 @@
 #include "autoclose.h"
 #include "bracket.h"
 #include "config.h"
+#include "file_loader.h"
+#include "git_status.h"
+#include "highlight_scheduler.h"
+#include "reactor.h"
+#include "save_pipeline.h"
 #include "types.h"
 #include "imageviewer.h"
 #include "integrated_terminal.h"
 #include "lsp_client.h"
+#include "pane_rows.h"
+#include "syntax.h"
 #include "telescope.h"
 #include "terminal.h"
 #include "ui.h"
@@ -18,16 +25,6 @@
 #include <vector>
 // #include "python_api.h"
 
-class SyntaxHighlighter {
-private:
-  std::vector<SyntaxRule> rules;
-  std::string file_extension;
-
-public:
-  void set_language(const std::string &ext);
-  std::vector<std::pair<int, int>> get_colors(const std::string &line);
-};
-
 class PythonAPI; // Forward declaration
 class EditorHostAPI;
 class HostCoreAPI;
@@ -82,8 +79,11 @@ private:
   // Search panel
   bool show_search;
   std::string search_query;
-  std::vector<std::pair<int, int>> search_results; // (line, col)
-  int search_result_index;
+  int search_result_index; // into the current buffer's search_index
+  // Where the search started; the cursor moves to the first match from
+  // there once the lines up to it are scanned.
+  std::pair<int, int> search_anchor;
+  bool search_jump_pending = false;
   bool search_case_sensitive;
   bool search_whole_word;
   
@@ -99,8 +99,11 @@ private:
   int minimap_width;
   bool show_integrated_terminal;
   int integrated_terminal_height;
+  size_t integrated_terminal_scrollback; // rows of history per terminal
 
   SyntaxHighlighter highlighter;
+  HighlightScheduler highlight_scheduler;
+  std::vector<HighlightScheduler::Batch> highlight_batches;
   Config config;
   ImageViewer image_viewer;
   std::vector<std::unique_ptr<IntegratedTerminal>> integrated_terminals;
@@ -108,8 +111,11 @@ private:
   std::unordered_map<std::string, long long> lsp_pending_changes;
   int current_integrated_terminal;
   Terminal terminal;
+  Reactor reactor;
+  LoopStats loop_stats;
   UI *ui;
   Theme theme;
+  std::uint64_t theme_revision = 0; // bumped whenever `theme` changes
   std::string current_theme_name; // tracks active color scheme
 
   int status_height;
@@ -143,6 +149,21 @@ private:
   int idle_fps;
   int lsp_change_debounce_ms;
   int last_cursor_shape;
+  // Damage tracking: what the layout and each pane were last drawn from.
+  // Panes whose key is unchanged keep their cells instead of being drawn
+  // again, and in the others only the damaged rows are unless something
+  // every row depends on changed.
+  struct PaneRender {
+    std::uint64_t key = 0;       // everything the pane shows
+    std::uint64_t frame_key = 0; // what all of its rows depend on
+    std::uint64_t minimap_key = 0;
+    std::size_t line_count = 0; // sizes the scroll bar thumb
+    PaneRows rows;
+  };
+  std::uint64_t scene_render_key;
+  std::uint64_t sidebar_render_key;
+  std::vector<PaneRender> pane_renders;
+  bool last_frame_had_overlay;
 
   bool show_context_menu;
   int context_menu_x;
@@ -167,7 +188,7 @@ private:
 
   struct ClosedBufferSnapshot {
     std::string filepath;
-    std::vector<std::string> lines;
+    LineStore lines;
     Cursor cursor;
     Selection selection;
     int scroll_offset;
@@ -178,14 +199,16 @@ private:
   std::vector<std::string> recent_files;
   std::vector<std::string> recent_workspaces;
   std::unordered_map<std::string, int> workspace_diagnostic_severity;
-  std::string git_root;
-  std::string git_branch;
-  int git_dirty_count;
-  std::unordered_map<std::string, std::string> git_file_status;
-  long long git_last_refresh_ms;
+  GitStatusService git_status_service;
+  std::shared_ptr<const GitStatusSnapshot> git_status;
+  SavePipeline save_pipeline;
+  std::vector<SavePipeline::Result> save_results;
+  std::vector<std::unique_ptr<BackgroundFileLoad>> file_loads;
+  std::vector<std::string> file_load_lines;
   bool auto_save_enabled;
   int auto_save_interval_ms;
   long long last_auto_save_ms;
+  int auto_saved_count = 0; // buffers queued by the autosave under way
 
   struct HomeMenuEntry {
     int action;
@@ -238,10 +261,15 @@ private:
   std::unique_ptr<EditorHostAPI> host_api;
 
   void render();
+  Event wait_for_event();
+  int loop_timeout_ms() const;
+  bool has_auto_save_work() const;
+  bool has_search_work() const;
+  void draw_frame(); // builds the frame that render() then sends
   void render_tabs();
-  void render_panes();
+  void render_panes(bool changed_only = false);
   void render_easter_egg();
-  void render_pane(const SplitPane &pane);
+  void render_pane(const SplitPane &pane, PaneRender &state, bool rows_only);
   void render_scrollbar(const SplitPane &pane, int draw_w);
   void render_telescope();
   void render_minimap(int x, int y, int w, int h, int buffer_id);
@@ -256,7 +284,14 @@ private:
   void render_popup(); // New
   void render_home_menu();
   void render_input_prompt();
-  void render_buffer_content(const SplitPane &pane, int buffer_id);
+  void render_buffer_content(const SplitPane &pane, int buffer_id,
+                             PaneRows &rows, bool rows_only);
+  bool render_has_overlay() const;
+  std::uint64_t render_scene_key() const;
+  std::uint64_t render_pane_key(const SplitPane &pane) const;
+  std::uint64_t render_pane_frame_key(const SplitPane &pane) const;
+  std::uint64_t render_minimap_key(const SplitPane &pane) const;
+  std::uint64_t render_sidebar_key() const;
   void poll_lsp_clients();
   LSPClient *find_lsp_client(const std::string &language,
                              const std::string &root_path);
@@ -278,6 +313,9 @@ private:
   const std::vector<std::pair<int, int>> &
   get_line_syntax_colors(FileBuffer &buf, int line_idx);
   void invalidate_syntax_cache(FileBuffer &buf);
+  void invalidate_syntax_from(FileBuffer &buf, int line_idx);
+  bool sync_syntax_language(FileBuffer &buf);
+  void update_background_highlighting();
 
   void handle_input(int ch, bool is_ctrl = false, bool is_shift = false,
                     bool is_alt = false, int original_ch = 0);
@@ -365,7 +403,19 @@ private:
   void cut();
   void paste();
 
-  void save_state();
+  // True if `buf` may be edited; otherwise says why in the message line.
+  bool ensure_editable(const FileBuffer &buf);
+  // Records an undo step for an edit about to touch lines
+  // [first_line, last_line]; the default covers the whole buffer, which is
+  // copied and re-highlighted, so it is only for edits that span it. Returns
+  // false, recording nothing, if the buffer is read-only; the caller must
+  // then leave it alone.
+  [[nodiscard]] bool save_state(int first_line = -1, int last_line = -1,
+                                bool coalesce = false);
+  // Same, scoped to the active selection's lines, or else to the cursor
+  // line widened by `above`/`below` neighbours the edit may join.
+  [[nodiscard]] bool save_cursor_state(int above = 0, int below = 0,
+                                       bool coalesce = false);
   void undo();
   void redo();
 
@@ -389,9 +439,18 @@ private:
   void close_buffer();
   void create_new_buffer();
   void save_file();
+  // Snapshots the buffer and queues it for writing; false if it has no
+  // path. Failures are reported once the write is done.
   bool save_buffer_at(int index, bool announce = true);
+  // Takes finished saves and merges formatter output back.
+  void finish_background_saves();
+  // Appends the lines background loads have split since the last call.
+  void update_file_loads();
   void save_file_as();
-  void auto_save_modified_buffers();
+  // Queues modified buffers for saving within a small time budget, so a
+  // pass over many large buffers is spread over several loop iterations.
+  // Returns true once none is left.
+  bool auto_save_modified_buffers();
   void set_auto_save(bool enabled, bool persist = true);
   void set_auto_save_interval(int interval_ms, bool persist = true);
   void track_recent_file(const std::string &path);
@@ -402,8 +461,11 @@ private:
   void save_recent_workspaces();
   void save_workspace_session();
   bool restore_workspace_session();
+  // Points the git status worker at the current workspace and swaps in its
+  // latest snapshot. `force` schedules a refresh without waiting for it.
   void refresh_git_status(bool force = false);
-  void clear_git_status();
+  // Refreshes and waits, for commands that report the status right away.
+  void refresh_git_status_now();
   bool has_git_repo() const;
   std::string run_git_capture(const std::string &args) const;
   std::string to_git_relative_path(const std::string &path) const;
@@ -421,6 +483,9 @@ private:
   void find_next();
   void find_prev();
   void perform_search();
+  bool update_search_index();
+  bool settle_search_jump();
+  void report_search_count();
 
   void split_pane_horizontal();
   void split_pane_vertical();
@@ -456,6 +521,8 @@ private:
   void copy_current_file_name();
   void insert_current_datetime();
   void show_buffer_stats();
+  void show_output_stats();
+  void show_loop_stats();
   void replace_all_text(const std::string &needle, const std::string &replacement,
                         bool case_sensitive = true, bool whole_word = false);
   void replace_all_regex(const std::string &pattern,
@@ -469,7 +536,7 @@ private:
   std::vector<std::string> list_available_themes();
   void apply_theme(const std::string &name, bool persist = true,
                    bool announce = true);
-  int detect_indent_width(const std::vector<std::string> &lines) const;
+  int detect_indent_width(const LineStore &lines) const;
 
   FileBuffer &get_buffer(int id = -1);
   SplitPane &get_pane(int id = -1);
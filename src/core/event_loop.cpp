@@ -1,6 +1,7 @@
 #include "editor.h"
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
 
 // Local definition of MEVENT used by handle_mouse()
 struct MEVENT {
@@ -8,34 +9,137 @@ struct MEVENT {
   int bstate;
 };
 
+namespace {
+long long steady_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+bool Editor::has_auto_save_work() const {
+  if (!auto_save_enabled || auto_save_interval_ms <= 0) {
+    return false;
+  }
+  for (const auto &buf : buffers) {
+    if (buf.modified && !buf.filepath.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Milliseconds until the nearest timer of the main loop, or -1 when
+// nothing is due and only an event source can wake it.
+int Editor::loop_timeout_ms() const {
+  const long long now = steady_now_ms();
+  long long deadline = -1;
+  auto consider = [&](long long at) {
+    if (deadline < 0 || at < deadline) {
+      deadline = at;
+    }
+  };
+  // A frame asked for another one (animations).
+  if (needs_redraw) {
+    consider(now + std::max(1, 1000 / render_fps));
+  }
+  if (has_auto_save_work()) {
+    consider(last_auto_save_ms + auto_save_interval_ms);
+  }
+  if (has_search_work()) {
+    consider(now);
+  }
+  for (const auto &entry : lsp_pending_changes) {
+    consider(entry.second);
+  }
+  if (deadline < 0) {
+    return -1;
+  }
+  return (int)std::clamp(deadline - now, 0LL, 60000LL);
+}
+
+// Sleeps until input, a wake() from a background thread (LSP, git status,
+// highlighting, shell output), a resize or the nearest timer. The returned
+// event is the terminal's.
+Event Editor::wait_for_event() {
+  const int timeout_ms = loop_timeout_ms();
+  if (terminal.input_fd() < 0) {
+    // No pollable console: poll input at the frame rate instead.
+    terminal.set_poll_timeout_ms(
+        timeout_ms < 0 ? 1000 / idle_fps : std::min(timeout_ms, 1000 / render_fps));
+    Event ev = terminal.poll_event();
+    for (auto &term : integrated_terminals) {
+      if (term && term->poll_output()) {
+        needs_redraw = true;
+      }
+    }
+    return ev;
+  }
+
+  reactor.reset();
+  reactor.watch(terminal.input_fd());
+  reactor.watch(terminal.wake_fd());
+  reactor.watch(terminal.resize_fd());
+  reactor.wait(timeout_ms);
+
+  // Shells are read on their own threads, which wake the loop at most once
+  // a frame; this only picks up what they parsed.
+  for (auto &term : integrated_terminals) {
+    if (term && term->poll_output()) {
+      needs_redraw = true;
+    }
+  }
+  return terminal.read_event();
+}
+
 void Editor::run() {
   while (running) {
-    const auto now = std::chrono::steady_clock::now();
-    const long long now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                 now.time_since_epoch())
-                                 .count();
-
-    if (auto_save_enabled && auto_save_interval_ms > 0 &&
-        (last_auto_save_ms <= 0 ||
-         now_ms - last_auto_save_ms >= auto_save_interval_ms)) {
-      auto_save_modified_buffers();
+    const long long now_ms = steady_now_ms();
+    // The interval runs from the last save or the last moment nothing was
+    // unsaved, so an edit after a long idle is not saved at once.
+    if (!has_auto_save_work()) {
       last_auto_save_ms = now_ms;
+    } else if (now_ms - last_auto_save_ms >= auto_save_interval_ms) {
+      // A pass cut short stays due and goes on next iteration.
+      if (auto_save_modified_buffers()) {
+        last_auto_save_ms = now_ms;
+      }
     }
 
+    finish_background_saves();
+    update_file_loads();
     poll_lsp_clients();
     refresh_git_status(false);
-
-    for (auto &term : integrated_terminals) {
-      if (term && term->poll_output()) {
+    update_background_highlighting();
+    if (update_search_index()) {
+      needs_redraw = true;
+    }
+    if (telescope.refresh_results()) {
+      needs_redraw = true;
+    }
+#if defined(JOT_DEBUG)
+    if (telescope.is_active()) {
+      const double first_ms = telescope.take_time_to_first_result_ms();
+      if (first_ms >= 0) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%s: first result in %.1f ms",
+                      telescope.is_content_search() ? "Live Grep"
+                                                    : "Find Files",
+                      first_ms);
+        set_message(text);
         needs_redraw = true;
       }
     }
+#endif
 
+    const std::uint64_t writes = terminal.output_stats().writes;
     render();
+    loop_stats.frame_done(std::chrono::steady_clock::now(),
+                          terminal.output_stats().writes != writes);
 
-    int target_fps = needs_redraw ? render_fps : idle_fps;
-    terminal.set_poll_timeout_ms(std::max(1, 1000 / target_fps));
-    Event ev = terminal.poll_event();
+    Event ev = wait_for_event();
+    loop_stats.woke(std::chrono::steady_clock::now(),
+                    ev.type == EVENT_KEY || ev.type == EVENT_MOUSE);
 
     if (ev.type == EVENT_REDRAW) {
       // nothing
@@ -1,7 +1,9 @@
 #include "editor.h"
+#include "fuzzy_match.h"
 #include "python_api.h"
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <dirent.h>
 #include <filesystem>
@@ -15,6 +17,8 @@ namespace {
 constexpr int kMaxRecentFiles = 50;
 constexpr int kMaxRecentWorkspaces = 30;
 constexpr int kMaxClosedBufferHistory = 20;
+// Files at least this large are loaded on a worker and shown as they load.
+constexpr std::uintmax_t kBackgroundLoadBytes = 64ull << 20;
 
 std::string normalize_existing_path(const std::string &path) {
   if (path.empty()) {
@@ -144,25 +148,6 @@ bool supports_clang_format_on_save(const std::string &path) {
   return exts.find(ext) != exts.end();
 }
 
-bool read_file_lines(const std::string &path, std::vector<std::string> &out) {
-  std::ifstream file(path);
-  if (!file.is_open()) {
-    return false;
-  }
-  out.clear();
-  std::string line;
-  while (std::getline(file, line)) {
-    if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
-    }
-    out.push_back(line);
-  }
-  if (out.empty()) {
-    out.push_back("");
-  }
-  return true;
-}
-
 bool is_supported_image_path(const std::string &path) {
   fs::path p(path);
   std::string ext = p.extension().string();
@@ -175,6 +160,14 @@ bool is_supported_image_path(const std::string &path) {
   return exts.find(ext) != exts.end();
 }
 
+// Formatter rewrites replace the whole buffer outside the edit layer; log
+// them as one step so the undo history's line ranges stay aligned.
+void record_external_rewrite(FileBuffer &buf) {
+  const State state{buf.cursor,       buf.preferred_x, buf.selection,
+                    buf.scroll_offset, buf.scroll_x,    buf.modified};
+  buf.undo.record(buf.lines, 0, (int)buf.lines.size() - 1, state);
+}
+
 void normalize_buffer_after_external_edit(FileBuffer &buf) {
   if (buf.lines.empty()) {
     buf.lines.push_back("");
@@ -203,7 +196,7 @@ void normalize_buffer_after_external_edit(FileBuffer &buf) {
 
 void Editor::load_file(const std::string &fname) { open_file(fname, false); }
 
-int Editor::detect_indent_width(const std::vector<std::string> &lines) const {
+int Editor::detect_indent_width(const LineStore &lines) const {
   std::map<int, int> delta_score;
   int tab_indented_lines = 0;
   int space_indented_lines = 0;
@@ -353,22 +346,20 @@ void Editor::open_file(const std::string &path, bool preview) {
   fb.modified = false;
   fb.is_preview = preview;
 
-  std::ifstream file(path_to_open);
-  if (file.is_open()) {
-    std::string line;
-    while (std::getline(file, line)) {
-      if (!line.empty() && line.back() == '\r') {
-        line.pop_back();
-      }
-      fb.lines.push_back(line);
-    }
-    file.close();
+  std::error_code size_ec;
+  const std::uintmax_t file_size = fs::file_size(path_to_open, size_ec);
+  if (!size_ec && file_size >= kBackgroundLoadBytes) {
+    fb.loading = true;
+    file_loads.push_back(std::make_unique<BackgroundFileLoad>(
+        path_to_open, [this] { terminal.wake(); }));
+  } else {
+    load_file_lines(path_to_open, fb.lines);
   }
 
   if (fb.lines.empty())
     fb.lines.push_back("");
 
-  if (config.get_bool("auto_detect_indent", false)) {
+  if (!fb.loading && config.get_bool("auto_detect_indent", false)) {
     int detected_tab_size = detect_indent_width(fb.lines);
     if (detected_tab_size != tab_size && detected_tab_size >= 1 &&
         detected_tab_size <= 8) {
@@ -377,7 +368,8 @@ void Editor::open_file(const std::string &path, bool preview) {
     }
   }
 
-  buffers.push_back(fb);
+  const bool loading = fb.loading;
+  buffers.push_back(std::move(fb));
   current_buffer = buffers.size() - 1;
   auto &pane = get_pane();
   pane.buffer_id = current_buffer;
@@ -393,7 +385,10 @@ void Editor::open_file(const std::string &path, bool preview) {
   highlighter.set_language(get_file_extension(path_to_open));
   if (python_api)
     python_api->on_buffer_open(path_to_open);
-  notify_lsp_open(path_to_open);
+  // A loading buffer is announced to the language server once complete.
+  if (!loading) {
+    notify_lsp_open(path_to_open);
+  }
   refresh_git_status(true);
   needs_redraw = true;
 }
@@ -440,64 +435,44 @@ bool Editor::save_buffer_at(int index, bool announce) {
   if (buf.filepath.empty()) {
     return false;
   }
-
-  std::ofstream file(buf.filepath);
-  if (!file.is_open()) {
-    if (announce) {
-      message = "Save failed: cannot open " + buf.filepath;
-      needs_redraw = true;
-    }
-    return false;
-  }
-  for (const auto &line : buf.lines) {
-    file << line << '\n';
-  }
-  if (!file.good()) {
+  // Saving now would cut the file short.
+  if (buf.loading) {
     if (announce) {
-      message = "Save failed: write error";
+      message = "Save skipped: " + get_filename(buf.filepath) +
+                " is still loading";
       needs_redraw = true;
     }
     return false;
   }
-  file.close();
 
-  bool formatted_with_prettier = false;
-  bool formatted_with_clang = false;
+  // The worker writes the text atomically and runs the formatter;
+  // finish_background_saves() merges what comes back.
+  SavePipeline::Job job;
+  job.path = buf.filepath;
+  job.lines = buf.lines;
+  job.announce = announce;
+  job.journal_id = buf.lines.journal_id();
+  job.revision = buf.lines.revision();
   if (config.get_bool("prettier_on_save", true) &&
       supports_prettier_on_save(buf.filepath)) {
     const std::string runner = detect_prettier_runner();
     if (!runner.empty()) {
-      std::string cmd = runner + " --write " + shell_quote(buf.filepath) +
-                        " >/dev/null 2>&1";
-      if (std::system(cmd.c_str()) == 0) {
-        std::vector<std::string> refreshed_lines;
-        if (read_file_lines(buf.filepath, refreshed_lines)) {
-          buf.lines.swap(refreshed_lines);
-          normalize_buffer_after_external_edit(buf);
-          invalidate_syntax_cache(buf);
-          formatted_with_prettier = true;
-        }
-      }
+      job.formatter = runner + " --stdin-filepath " + shell_quote(buf.filepath) +
+                      " < " + shell_quote(buf.filepath) + " 2>/dev/null";
+      job.formatter_name = "prettier";
     }
   }
-  if (!formatted_with_prettier &&
-      config.get_bool("clang_format_on_save", true) &&
+  if (job.formatter.empty() && config.get_bool("clang_format_on_save", true) &&
       supports_clang_format_on_save(buf.filepath)) {
     const std::string runner = detect_clang_format_runner();
     if (!runner.empty()) {
-      std::string cmd = runner + " -i " + shell_quote(buf.filepath) +
-                        " >/dev/null 2>&1";
-      if (std::system(cmd.c_str()) == 0) {
-        std::vector<std::string> refreshed_lines;
-        if (read_file_lines(buf.filepath, refreshed_lines)) {
-          buf.lines.swap(refreshed_lines);
-          normalize_buffer_after_external_edit(buf);
-          invalidate_syntax_cache(buf);
-          formatted_with_clang = true;
-        }
-      }
+      job.formatter = runner + " --assume-filename=" +
+                      shell_quote(buf.filepath) + " < " +
+                      shell_quote(buf.filepath) + " 2>/dev/null";
+      job.formatter_name = "clang-format";
     }
   }
+  save_pipeline.submit(std::move(job));
 
   buf.modified = false;
   if (buf.is_preview) {
@@ -507,20 +482,125 @@ bool Editor::save_buffer_at(int index, bool announce) {
     }
   }
   track_recent_file(buf.filepath);
-  if (announce) {
-    message = "Saved: " + get_filename(buf.filepath);
-    if (formatted_with_prettier) {
-      message += " (formatted: prettier)";
-    } else if (formatted_with_clang) {
-      message += " (formatted: clang-format)";
+  return true;
+}
+
+void Editor::finish_background_saves() {
+  save_results.clear();
+  if (!save_pipeline.take(save_results)) {
+    return;
+  }
+  auto find_buffer = [&](const SavePipeline::Result &result) -> FileBuffer * {
+    for (auto &buf : buffers) {
+      if (buf.filepath == result.path &&
+          buf.lines.journal_id() == result.journal_id) {
+        return &buf;
+      }
+    }
+    return nullptr;
+  };
+
+  bool saved = false;
+  for (auto &result : save_results) {
+    FileBuffer *buf = find_buffer(result);
+    const bool unchanged = buf && buf->lines.revision() == result.revision;
+    if (!result.ok) {
+      if (unchanged) {
+        buf->modified = true;
+      }
+      message = "Save failed: " + result.error;
+      needs_redraw = true;
+      continue;
+    }
+
+    bool formatted = false;
+    if (result.formatted && unchanged && !result.formatted_text.empty()) {
+      std::vector<std::string> split;
+      split_lines(result.formatted_text.data(), result.formatted_text.size(),
+                  split);
+      if (split.empty()) {
+        split.push_back("");
+      }
+      LineStore formatted_lines(std::move(split));
+      if (formatted_lines != buf->lines) {
+        record_external_rewrite(*buf);
+        buf->lines.swap(formatted_lines);
+        normalize_buffer_after_external_edit(*buf);
+        invalidate_syntax_cache(*buf);
+        SavePipeline::Job job;
+        job.path = buf->filepath;
+        job.lines = buf->lines;
+        job.journal_id = buf->lines.journal_id();
+        job.revision = buf->lines.revision();
+        save_pipeline.submit(std::move(job));
+        buf->modified = false;
+        formatted = true;
+        needs_redraw = true;
+      }
+    }
+
+    if (result.announce) {
+      message = "Saved: " + get_filename(result.path);
+      if (formatted) {
+        message += " (formatted: " + result.formatter_name + ")";
+      }
+      needs_redraw = true;
+    }
+    if (python_api)
+      python_api->on_buffer_save(result.path);
+    notify_lsp_save(result.path);
+    saved = true;
+  }
+  if (saved) {
+    refresh_git_status(true);
+  }
+}
+
+void Editor::update_file_loads() {
+  for (std::size_t i = 0; i < file_loads.size();) {
+    BackgroundFileLoad &load = *file_loads[i];
+    FileBuffer *buf = nullptr;
+    for (auto &candidate : buffers) {
+      if (candidate.loading && candidate.filepath == load.path()) {
+        buf = &candidate;
+        break;
+      }
+    }
+    if (!buf) {
+      // Closed while loading; this cancels the load.
+      file_loads.erase(file_loads.begin() + (std::ptrdiff_t)i);
+      continue;
     }
+
+    file_load_lines.clear();
+    if (load.take(file_load_lines)) {
+      // Lines only ever go on the end; the buffer is read-only meanwhile.
+      append_loaded_lines(*buf, std::move(file_load_lines));
+      needs_redraw = true;
+    }
+
+    const std::string name = get_filename(load.path());
+    if (!load.done()) {
+      const std::uint64_t total = std::max<std::uint64_t>(1, load.bytes_total());
+      set_message("Loading " + name + ": " +
+                  std::to_string(load.bytes_done() * 100 / total) + "%");
+      i++;
+      continue;
+    }
+    buf->loading = false;
+    if (buf->lines.empty()) {
+      buf->lines.push_back("");
+    }
+    if (load.failed()) {
+      set_message("Open failed: cannot read " + name);
+    } else {
+      set_message("Loaded " + name + " (" +
+                  std::to_string(buf->lines.size()) + " lines)");
+      notify_lsp_open(buf->filepath);
+    }
+    file_loads.erase(file_loads.begin() + (std::ptrdiff_t)i);
     needs_redraw = true;
   }
-  if (python_api)
-    python_api->on_buffer_save(buf.filepath);
-  notify_lsp_save(buf.filepath);
-  refresh_git_status(true);
-  return true;
 }
 
 void Editor::save_file_as() {
@@ -537,8 +617,11 @@ void Editor::close_buffer_at(int index) {
   if (closed_buffer_history.size() >= kMaxClosedBufferHistory) {
     closed_buffer_history.erase(closed_buffer_history.begin());
   }
-  if (!snapshot_source.filepath.empty() ||
-      (snapshot_source.modified && !snapshot_source.lines.empty())) {
+  // A partly loaded buffer is not kept; reopening it would show, and could
+  // save, a truncated file.
+  if (!snapshot_source.loading &&
+      (!snapshot_source.filepath.empty() ||
+       (snapshot_source.modified && !snapshot_source.lines.empty()))) {
     closed_buffer_history.push_back(
         {snapshot_source.filepath, snapshot_source.lines, snapshot_source.cursor,
          snapshot_source.selection, snapshot_source.scroll_offset,
@@ -557,8 +640,8 @@ void Editor::close_buffer_at(int index) {
     buf.scroll_x = 0;
     buf.modified = false;
     buf.is_preview = false;
-    buf.undo_stack = std::stack<State>();
-    buf.redo_stack = std::stack<State>();
+    buf.loading = false;
+    buf.undo.clear();
     buf.bookmarks.clear();
     buf.diagnostics.clear();
     current_buffer = 0;
@@ -898,17 +981,26 @@ void Editor::open_recent_file(const std::string &query) {
     }
   }
 
-  std::string needle = query_trimmed.empty() ? query : query_trimmed;
-  std::transform(needle.begin(), needle.end(), needle.begin(),
-                 [](unsigned char c) { return std::tolower(c); });
-  for (const auto &path : recent_files) {
-    std::string haystack = path;
-    std::transform(haystack.begin(), haystack.end(), haystack.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    if (haystack.find(needle) != std::string::npos) {
-      open_path(path);
-      return;
-    }
+  // The most recent file containing the query wins; failing that, the best
+  // fuzzy match.
+  const FuzzyPattern pattern(query_trimmed.empty() ? query : query_trimmed);
+  const auto best = fuzzy_rank(
+      recent_files.size(), 1, nullptr, 0,
+      [&](std::size_t i) {
+        std::string haystack = recent_files[i];
+        std::transform(haystack.begin(), haystack.end(), haystack.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        if (haystack.find(pattern.text()) != std::string::npos) {
+          return 1 << 20;
+        }
+        return pattern.matches(haystack) ? pattern.score(haystack) : -1;
+      },
+      [](const FuzzyHit &a, const FuzzyHit &b) {
+        return a.score != b.score ? a.score > b.score : a.index < b.index;
+      });
+  if (!best.empty()) {
+    open_path(recent_files[best[0].index]);
+    return;
   }
 
   set_message("No recent file matched: " + query);
@@ -930,22 +1022,30 @@ void Editor::set_auto_save_interval(int interval_ms, bool persist) {
   }
 }
 
-void Editor::auto_save_modified_buffers() {
+bool Editor::auto_save_modified_buffers() {
   if (!auto_save_enabled) {
-    return;
+    return true;
   }
 
-  int saved = 0;
+  // Each buffer costs a snapshot here, O(lines / 1024); the budget bounds a
+  // pass over very many of them.
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(4);
   for (int i = 0; i < (int)buffers.size(); i++) {
     if (!buffers[i].modified || buffers[i].filepath.empty()) {
       continue;
     }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
     if (save_buffer_at(i, false)) {
-      saved++;
+      auto_saved_count++;
     }
   }
 
-  if (saved > 0) {
-    set_message("Auto-saved " + std::to_string(saved) + " file(s)");
+  if (auto_saved_count > 0) {
+    set_message("Auto-saved " + std::to_string(auto_saved_count) + " file(s)");
   }
+  auto_saved_count = 0;
+  return true;
 }
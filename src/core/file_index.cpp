@@ -0,0 +1,737 @@
+#include "file_index.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace {
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// Quiet time before reported changes are applied, so a checkout or an
+// unpacked archive is re-listed once.
+constexpr auto kSettleTime = std::chrono::milliseconds(50);
+// How often a first scan shows what it has found so far.
+constexpr auto kPartialPublishInterval = std::chrono::milliseconds(200);
+
+char lower_char(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+bool should_skip_dir_name(const std::string &name) {
+  static const std::unordered_set<std::string> kSkipped = {
+      ".git",       ".svn",      ".hg",       "node_modules", "dist",
+      "build",      ".cache",    "__pycache__", ".venv",      "target"};
+  return kSkipped.find(name) != kSkipped.end();
+}
+
+bool should_skip_name(std::string_view name) {
+  return name.empty() || name[0] == '.';
+}
+
+std::string join_relative(const std::string &dir, const std::string &name) {
+  return dir.empty() ? name : dir + "/" + name;
+}
+
+std::string absolute_path(const std::string &root, const std::string &rel) {
+  if (rel.empty()) {
+    return root;
+  }
+  return root.back() == '/' ? root + rel : root + "/" + rel;
+}
+
+struct Child {
+  std::string name;
+  bool is_dir;
+  bool descend; // false for symlinked directories
+};
+
+// The indexed children of one directory, sorted by name. False when it
+// cannot be listed.
+bool list_children(const std::string &dir, std::vector<Child> &children) {
+  children.clear();
+  std::error_code ec;
+  for (auto it = fs::directory_iterator(dir, ec); !ec && it != fs::end(it);
+       it.increment(ec)) {
+    std::string name = it->path().filename().string();
+    if (should_skip_name(name)) {
+      continue;
+    }
+    std::error_code type_ec;
+    const bool is_dir = it->is_directory(type_ec);
+    if (type_ec || (is_dir && should_skip_dir_name(name))) {
+      continue;
+    }
+    const bool is_link = it->is_symlink(type_ec);
+    children.push_back({std::move(name), is_dir, is_dir && !is_link});
+  }
+  if (ec) {
+    return false;
+  }
+  std::sort(children.begin(), children.end(),
+            [](const Child &a, const Child &b) { return a.name < b.name; });
+  return true;
+}
+
+// inotify watches on every indexed directory, by watch descriptor.
+// Without inotify it watches nothing and reports itself incomplete.
+class DirWatcher {
+public:
+  ~DirWatcher() { close_fd(); }
+
+  int fd() const { return inotify_fd; }
+  bool complete() const { return inotify_fd >= 0 && all_watched; }
+
+  void reset(const std::string &root) {
+    close_fd();
+    watched_root = root;
+#if defined(__linux__)
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    all_watched = inotify_fd >= 0;
+#endif
+  }
+
+  void add(const std::string &rel) {
+#if defined(__linux__)
+    if (inotify_fd < 0) {
+      return;
+    }
+    // Watching a directory again returns its existing descriptor, which
+    // then follows the directory to its new name after a move.
+    const int wd = inotify_add_watch(
+        inotify_fd, absolute_path(watched_root, rel).c_str(),
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) {
+      all_watched = false; // out of watches; rescans cover the rest
+    } else {
+      dirs[wd] = rel;
+    }
+#else
+    (void)rel;
+#endif
+  }
+
+  // Drains pending events into the directories whose listing changed.
+  // Returns true when there were any; `rescan` is set when events were
+  // lost.
+  bool read_events(std::vector<std::string> &dirty, bool &rescan) {
+    bool changed = false;
+#if defined(__linux__)
+    alignas(inotify_event) char buf[16 * 1024];
+    while (true) {
+      const ssize_t n = read(inotify_fd, buf, sizeof(buf));
+      if (n <= 0) {
+        break;
+      }
+      for (ssize_t pos = 0; pos < n;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buf + pos);
+        pos += (ssize_t)(sizeof(inotify_event) + event->len);
+        if (event->mask & IN_Q_OVERFLOW) {
+          rescan = changed = true;
+          continue;
+        }
+        if (event->mask & IN_IGNORED) {
+          dirs.erase(event->wd);
+          continue;
+        }
+        auto it = dirs.find(event->wd);
+        if (it != dirs.end() &&
+            !should_skip_name(event->len ? event->name : "")) {
+          dirty.push_back(it->second);
+          changed = true;
+        }
+      }
+    }
+#else
+    (void)dirty;
+    (void)rescan;
+#endif
+    return changed;
+  }
+
+private:
+  int inotify_fd = -1;
+  bool all_watched = false;
+  std::string watched_root;
+  std::unordered_map<int, std::string> dirs;
+
+  void close_fd() {
+#if defined(JOT_PLATFORM_POSIX)
+    if (inotify_fd >= 0) {
+      close(inotify_fd);
+    }
+#endif
+    inotify_fd = -1;
+    all_watched = false;
+    dirs.clear();
+  }
+};
+
+struct ScanContext {
+  const std::string &root;
+  DirWatcher &watcher;
+  const std::atomic<bool> &interrupted;
+  // Called after each directory with what has been built so far.
+  std::function<void(const FileIndexSnapshot &)> progress;
+};
+
+// Appends everything below `rel_dir` in tree order and watches its
+// directories. False when interrupted.
+bool scan_directory(ScanContext &ctx, const std::string &rel_dir,
+                    FileIndexSnapshot &out) {
+  if (ctx.interrupted.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  ctx.watcher.add(rel_dir);
+  std::vector<Child> children;
+  if (!list_children(absolute_path(ctx.root, rel_dir), children)) {
+    return true;
+  }
+  for (const Child &child : children) {
+    const std::string rel = join_relative(rel_dir, child.name);
+    if (!out.append(rel, child.is_dir)) {
+      continue;
+    }
+    if (child.descend && !scan_directory(ctx, rel, out)) {
+      return false;
+    }
+  }
+  if (ctx.progress) {
+    ctx.progress(out);
+  }
+  return true;
+}
+
+// Re-lists the directories in `dirty` and returns `old` with their
+// differences applied, or nullptr when nothing changed or the scan was
+// interrupted. Added directories are scanned whole; removed ones drop
+// their subtree.
+std::shared_ptr<FileIndexSnapshot>
+apply_changes(const FileIndexSnapshot &old, std::vector<std::string> dirty,
+              ScanContext &ctx) {
+  std::sort(dirty.begin(), dirty.end(), file_index_path_less);
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+  struct Removal {
+    std::size_t first, last;
+  };
+  struct Insertion {
+    std::size_t pos;
+    FileIndexSnapshot entries;
+  };
+  std::vector<Removal> removals;
+  std::vector<Insertion> insertions;
+  // Children added or removed so far; directories below them are done.
+  std::unordered_set<std::string> touched;
+  auto covered = [&](const std::string &dir) {
+    for (std::size_t slash = dir.find('/'); slash != std::string::npos;
+         slash = dir.find('/', slash + 1)) {
+      if (touched.count(dir.substr(0, slash))) {
+        return true;
+      }
+    }
+    return !dir.empty() && touched.count(dir) > 0;
+  };
+  auto subtree_end = [&](std::size_t i) {
+    return old.is_directory(i) ? old.subtree(old.path(i)).second : i + 1;
+  };
+
+  std::vector<Child> on_disk;
+  for (const std::string &dir : dirty) {
+    if (covered(dir)) {
+      continue;
+    }
+    std::size_t first = 0;
+    std::size_t last = old.size();
+    if (!dir.empty()) {
+      const std::size_t at = old.find(dir);
+      if (at == FileIndexSnapshot::npos || !old.is_directory(at)) {
+        continue; // gone again, or its parent's listing covers it
+      }
+      std::tie(first, last) = old.subtree(dir);
+    }
+    if (!list_children(absolute_path(ctx.root, dir), on_disk)) {
+      continue;
+    }
+
+    // Walk the indexed children (skipping their subtrees) and the listing
+    // side by side; both are sorted by name.
+    const std::size_t prefix = dir.empty() ? 0 : dir.size() + 1;
+    std::size_t i = first;
+    std::size_t k = 0;
+    while (i < last || k < on_disk.size()) {
+      int cmp = 1;
+      if (i < last && k < on_disk.size()) {
+        cmp = old.path(i).substr(prefix).compare(on_disk[k].name);
+      } else if (i < last) {
+        cmp = -1;
+      }
+      if (cmp == 0 && old.is_directory(i) == on_disk[k].is_dir) {
+        i = subtree_end(i);
+        k++;
+        continue;
+      }
+      if (cmp <= 0) {
+        const std::size_t end = subtree_end(i);
+        removals.push_back({i, end});
+        touched.insert(std::string(old.path(i)));
+        i = end;
+        if (cmp < 0) {
+          continue;
+        }
+      }
+      const Child &child = on_disk[k++];
+      const std::string rel = join_relative(dir, child.name);
+      Insertion insertion{old.lower_bound(rel), FileIndexSnapshot()};
+      if (!insertion.entries.append(rel, child.is_dir)) {
+        continue;
+      }
+      if (child.descend && !scan_directory(ctx, rel, insertion.entries)) {
+        return nullptr;
+      }
+      touched.insert(rel);
+      insertions.push_back(std::move(insertion));
+    }
+  }
+  if (removals.empty() && insertions.empty()) {
+    return nullptr;
+  }
+
+  // One merge pass over the old entries.
+  std::sort(removals.begin(), removals.end(),
+            [](const Removal &a, const Removal &b) { return a.first < b.first; });
+  std::sort(insertions.begin(), insertions.end(),
+            [](const Insertion &a, const Insertion &b) {
+              if (a.pos != b.pos) {
+                return a.pos < b.pos;
+              }
+              return file_index_path_less(a.entries.path(0), b.entries.path(0));
+            });
+  auto next = std::make_shared<FileIndexSnapshot>();
+  next->root = old.root;
+  next->complete = old.complete;
+  next->reserve(old.size(), 0);
+  std::size_t r = 0;
+  std::size_t s = 0;
+  std::size_t i = 0;
+  while (true) {
+    while (s < insertions.size() && insertions[s].pos == i) {
+      const FileIndexSnapshot &added = insertions[s++].entries;
+      next->append_range(added, 0, added.size());
+    }
+    if (i >= old.size()) {
+      break;
+    }
+    if (r < removals.size() && removals[r].first == i) {
+      i = removals[r++].last;
+      continue;
+    }
+    std::size_t stop = old.size();
+    if (r < removals.size()) {
+      stop = std::min(stop, removals[r].first);
+    }
+    if (s < insertions.size()) {
+      stop = std::min(stop, insertions[s].pos);
+    }
+    next->append_range(old, i, stop);
+    i = stop;
+  }
+  return next;
+}
+} // namespace
+
+bool file_index_path_less(std::string_view a, std::string_view b) {
+  // '/' sorts before every other byte, so a directory's subtree comes
+  // right after it, before its next sibling.
+  const std::size_t n = std::min(a.size(), b.size());
+  for (std::size_t i = 0; i < n; i++) {
+    if (a[i] != b[i]) {
+      const int ca = a[i] == '/' ? 0 : (unsigned char)a[i] + 1;
+      const int cb = b[i] == '/' ? 0 : (unsigned char)b[i] + 1;
+      return ca < cb;
+    }
+  }
+  return a.size() < b.size();
+}
+
+std::size_t FileIndexSnapshot::lower_bound(std::string_view rel) const {
+  std::size_t lo = 0;
+  std::size_t hi = entries.size();
+  while (lo < hi) {
+    const std::size_t mid = lo + (hi - lo) / 2;
+    if (file_index_path_less(path(mid), rel)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+std::size_t FileIndexSnapshot::find(std::string_view rel) const {
+  const std::size_t i = lower_bound(rel);
+  return i < entries.size() && path(i) == rel ? i : npos;
+}
+
+std::pair<std::size_t, std::size_t>
+FileIndexSnapshot::subtree(std::string_view dir) const {
+  if (dir.empty()) {
+    return {0, entries.size()};
+  }
+  const std::size_t first = lower_bound(dir);
+  std::size_t lo = first < entries.size() && path(first) == dir ? first + 1
+                                                                 : first;
+  const std::size_t begin = lo;
+  // Everything under dir/ is contiguous from here on.
+  std::size_t hi = entries.size();
+  while (lo < hi) {
+    const std::size_t mid = lo + (hi - lo) / 2;
+    const std::string_view p = path(mid);
+    if (p.size() > dir.size() && p[dir.size()] == '/' &&
+        p.compare(0, dir.size(), dir) == 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return {begin, lo};
+}
+
+bool FileIndexSnapshot::append(std::string_view rel, bool is_dir) {
+  if (rel.size() > UINT16_MAX || !arena_fits(rel.size())) {
+    return false;
+  }
+  const std::size_t slash = rel.rfind('/');
+  Entry entry;
+  entry.offset = (std::uint32_t)paths.size();
+  entry.length = (std::uint16_t)rel.size();
+  entry.name_start =
+      (std::uint16_t)(slash == std::string_view::npos ? 0 : slash + 1);
+  entry.is_dir = is_dir;
+  entries.push_back(entry);
+  paths.append(rel.data(), rel.size());
+  for (char c : rel) {
+    lower.push_back(lower_char(c));
+  }
+  masks.push_back(fuzzy_char_mask(lower_path(entries.size() - 1)));
+  return true;
+}
+
+bool FileIndexSnapshot::append_range(const FileIndexSnapshot &other,
+                                     std::size_t first, std::size_t last) {
+  if (first >= last) {
+    return true;
+  }
+  // The range's paths are contiguous in the other arena.
+  const std::size_t from = other.entries[first].offset;
+  const std::size_t to =
+      other.entries[last - 1].offset + other.entries[last - 1].length;
+  if (!arena_fits(to - from)) {
+    return false;
+  }
+  const std::uint32_t shift = (std::uint32_t)paths.size();
+  paths.append(other.paths, from, to - from);
+  lower.append(other.lower, from, to - from);
+  for (std::size_t i = first; i < last; i++) {
+    Entry entry = other.entries[i];
+    entry.offset = entry.offset - (std::uint32_t)from + shift;
+    entries.push_back(entry);
+  }
+  masks.insert(masks.end(), other.masks.begin() + first,
+               other.masks.begin() + last);
+  return true;
+}
+
+void FileIndexSnapshot::reserve(std::size_t entry_count,
+                                std::size_t path_bytes) {
+  entries.reserve(entry_count);
+  masks.reserve(entry_count);
+  paths.reserve(path_bytes);
+  lower.reserve(path_bytes);
+}
+
+std::size_t FileIndexSnapshot::memory_bytes() const {
+  return paths.capacity() + lower.capacity() +
+         entries.capacity() * sizeof(Entry) +
+         masks.capacity() * sizeof(std::uint64_t);
+}
+
+FileIndexRanker::FileIndexRanker(const FileIndexSnapshot &snap,
+                                 std::string_view dir, std::string_view query)
+    : snap(snap), pattern(query), slash_query("/" + pattern.text()),
+      skip(dir.empty() ? 0 : dir.size() + 1), range(snap.subtree(dir)) {}
+
+int FileIndexRanker::score(std::size_t i) const {
+  if (pattern.empty()) {
+    return 0;
+  }
+  // The name is the tail of the path, so this covers both.
+  const std::string_view rel = snap.lower_path(i).substr(skip);
+  const int rel_score = pattern.score(rel);
+  if (rel_score == 0) {
+    return -1;
+  }
+  const int name_score = pattern.score(snap.lower_name(i));
+  int total = name_score * 2 + rel_score;
+  // A gapped match can score 300 and up as well, so the query is looked
+  // for as is.
+  if (name_score >= 300 &&
+      snap.lower_name(i).find(pattern.text()) != std::string_view::npos) {
+    total += 30;
+  }
+  if (rel_score >= 300 && rel.find(slash_query) != std::string_view::npos) {
+    total += 12;
+  }
+  if (snap.is_directory(i)) {
+    total -= 6;
+  }
+  return total;
+}
+
+bool FileIndexRanker::before(const FuzzyHit &a, const FuzzyHit &b) const {
+  const bool a_dir = snap.is_directory(a.index);
+  const bool b_dir = snap.is_directory(b.index);
+  if (pattern.empty()) {
+    if (a_dir != b_dir) {
+      return a_dir;
+    }
+  } else {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    if (a_dir != b_dir) {
+      return !a_dir;
+    }
+  }
+  const std::string_view an = snap.lower_name(a.index);
+  const std::string_view bn = snap.lower_name(b.index);
+  if (an != bn) {
+    return an < bn;
+  }
+  return a.index < b.index;
+}
+
+void FileIndexRanker::rank(std::size_t from, std::size_t to,
+                           std::size_t limit,
+                           std::vector<FuzzyHit> &best) const {
+  auto by_rank = [this](const FuzzyHit &a, const FuzzyHit &b) {
+    return before(a, b);
+  };
+  std::vector<FuzzyHit> hits = fuzzy_rank(
+      to - from, limit, pattern.empty() ? nullptr : snap.char_masks() + from,
+      pattern.mask(), [&](std::size_t k) { return score(from + k); },
+      [&](const FuzzyHit &a, const FuzzyHit &b) {
+        return before({a.score, a.index + (std::uint32_t)from},
+                      {b.score, b.index + (std::uint32_t)from});
+      });
+  for (FuzzyHit &hit : hits) {
+    hit.index += (std::uint32_t)from;
+  }
+  if (best.empty()) {
+    best = std::move(hits);
+    return;
+  }
+  const std::size_t middle = best.size();
+  best.insert(best.end(), hits.begin(), hits.end());
+  std::inplace_merge(best.begin(), best.begin() + middle, best.end(),
+                     by_rank);
+  if (best.size() > limit) {
+    best.resize(limit);
+  }
+}
+
+std::vector<FuzzyHit> rank_file_index(const FileIndexSnapshot &snap,
+                                      std::string_view dir,
+                                      std::string_view query,
+                                      std::size_t limit) {
+  const FileIndexRanker ranker(snap, dir, query);
+  std::vector<FuzzyHit> best;
+  ranker.rank(ranker.first(), ranker.last(), limit, best);
+  return best;
+}
+
+FileIndex::~FileIndex() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    ready_callback = nullptr;
+    interrupted = true;
+  }
+  wake();
+  if (worker.joinable()) {
+    worker.join();
+  }
+#if defined(JOT_PLATFORM_POSIX)
+  for (int fd : wake_pipe) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+void FileIndex::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+void FileIndex::set_root(const std::string &root) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (root == requested_root && worker.joinable()) {
+    if (fully_watched) {
+      return;
+    }
+    rescan_requested = true;
+  } else {
+    requested_root = root;
+    root_for_worker = root;
+    root_changed = true;
+    interrupted = true;
+  }
+  start_locked();
+  wake();
+}
+
+void FileIndex::start_locked() {
+  if (worker.joinable()) {
+    return;
+  }
+#if defined(JOT_PLATFORM_POSIX)
+  if (pipe(wake_pipe) == 0) {
+    for (int fd : wake_pipe) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+#endif
+  worker = std::thread([this] { run(); });
+}
+
+void FileIndex::wake() {
+#if defined(JOT_PLATFORM_POSIX)
+  if (wake_pipe[1] >= 0) {
+    const char byte = 1;
+    // A full pipe already guarantees a wakeup.
+    (void)!write(wake_pipe[1], &byte, 1);
+    return;
+  }
+#endif
+  work.notify_all();
+}
+
+void FileIndex::publish(std::shared_ptr<FileIndexSnapshot> next) {
+  next->sequence = snapshot()->sequence + 1;
+  std::atomic_store(&published,
+                    std::shared_ptr<const FileIndexSnapshot>(std::move(next)));
+  std::lock_guard<std::mutex> lock(mutex);
+  if (ready_callback) {
+    ready_callback();
+  }
+}
+
+void FileIndex::run() {
+  DirWatcher watcher;
+  std::string root;
+  std::vector<std::string> dirty;
+  bool rescan = false;
+  bool progressive = false;
+  bool due = false;
+  Clock::time_point due_at;
+
+  while (true) {
+    int timeout_ms = -1;
+    if (due) {
+      // Round up, or the last fraction of a millisecond would spin.
+      timeout_ms = (int)std::max<long long>(
+          0, std::chrono::ceil<std::chrono::milliseconds>(due_at - Clock::now())
+                 .count());
+    }
+#if defined(JOT_PLATFORM_POSIX)
+    pollfd fds[2] = {{wake_pipe[0], POLLIN, 0}, {watcher.fd(), POLLIN, 0}};
+    ::poll(fds, watcher.fd() >= 0 ? 2 : 1, timeout_ms);
+    if (fds[0].revents) {
+      char drained[64];
+      while (read(wake_pipe[0], drained, sizeof(drained)) > 0) {
+      }
+    }
+#endif
+    if (watcher.fd() >= 0 && watcher.read_events(dirty, rescan) && !due) {
+      due = true;
+      due_at = Clock::now() + kSettleTime;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+#if !defined(JOT_PLATFORM_POSIX)
+      if (!root_changed && !rescan_requested && !stopping) {
+        if (timeout_ms < 0) {
+          work.wait(lock);
+        } else {
+          work.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+        }
+      }
+#endif
+      if (stopping) {
+        return;
+      }
+      if (root_changed || rescan_requested) {
+        progressive = progressive || root_changed;
+        rescan = due = true;
+        due_at = Clock::now();
+      }
+      if (root_changed) {
+        root = root_for_worker;
+      }
+      root_changed = rescan_requested = false;
+      interrupted = false;
+    }
+    if (!due || Clock::now() < due_at) {
+      continue;
+    }
+    due = false;
+
+    if (rescan) {
+      watcher.reset(root);
+      auto building = std::make_shared<FileIndexSnapshot>();
+      building->root = root;
+      Clock::time_point last_publish = Clock::now();
+      ScanContext ctx{root, watcher, interrupted, nullptr};
+      if (progressive) {
+        publish(std::make_shared<FileIndexSnapshot>(*building));
+        ctx.progress = [&](const FileIndexSnapshot &so_far) {
+          if (Clock::now() - last_publish >= kPartialPublishInterval) {
+            publish(std::make_shared<FileIndexSnapshot>(so_far));
+            last_publish = Clock::now();
+          }
+        };
+      }
+      if (!scan_directory(ctx, "", *building)) {
+        continue; // a new root or stop is waiting
+      }
+      rescan = progressive = false;
+      dirty.clear();
+      building->complete = true;
+      fully_watched = watcher.complete();
+      publish(std::move(building));
+    } else if (!dirty.empty()) {
+      ScanContext ctx{root, watcher, interrupted, nullptr};
+      auto next = apply_changes(*snapshot(), std::move(dirty), ctx);
+      dirty.clear();
+      fully_watched = watcher.complete();
+      if (next) {
+        publish(std::move(next));
+      }
+    }
+  }
+}
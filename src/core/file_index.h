@@ -0,0 +1,177 @@
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include "fuzzy_match.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Every file and directory below one root, as paths relative to it. The
+// paths live back to back in one arena, with a lowercase copy and a
+// fuzzy_char_mask() per entry beside it, so matching needs no allocation
+// or case folding per entry. Entries are in tree order (a directory, then
+// everything under it, siblings by name), so each subtree is one
+// contiguous range.
+//
+// Published snapshots are never modified, so readers can keep using one
+// while a newer one is built.
+class FileIndexSnapshot {
+public:
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  std::string root;      // absolute and normalized
+  bool complete = false; // false while the first scan is still running
+  std::uint64_t sequence = 0;
+
+  std::size_t size() const { return entries.size(); }
+  std::string_view path(std::size_t i) const {
+    return {paths.data() + entries[i].offset, entries[i].length};
+  }
+  std::string_view lower_path(std::size_t i) const {
+    return {lower.data() + entries[i].offset, entries[i].length};
+  }
+  std::string_view name(std::size_t i) const {
+    return path(i).substr(entries[i].name_start);
+  }
+  std::string_view lower_name(std::size_t i) const {
+    return lower_path(i).substr(entries[i].name_start);
+  }
+  bool is_directory(std::size_t i) const { return entries[i].is_dir; }
+  const std::uint64_t *char_masks() const { return masks.data(); }
+
+  // Index of the relative path `rel`, or npos.
+  std::size_t find(std::string_view rel) const;
+  // Position `rel` has, or would have, in tree order.
+  std::size_t lower_bound(std::string_view rel) const;
+  // The entries below the relative directory `dir`, not counting `dir`
+  // itself; "" is the whole index.
+  std::pair<std::size_t, std::size_t> subtree(std::string_view dir) const;
+
+  // Adds an entry after all others; callers keep to tree order. False,
+  // adding nothing, for a path of 64 KiB or more or one that would take
+  // the path arena past 4 GiB: entries address it with 16/32-bit fields.
+  bool append(std::string_view rel, bool is_dir);
+  // Appends other's entries [first, last). False, appending nothing, when
+  // their paths would take the arena past 4 GiB.
+  bool append_range(const FileIndexSnapshot &other, std::size_t first,
+                    std::size_t last);
+  void reserve(std::size_t entry_count, std::size_t path_bytes);
+  std::size_t memory_bytes() const;
+
+private:
+  struct Entry {
+    std::uint32_t offset;
+    std::uint16_t length;
+    std::uint16_t name_start;
+    bool is_dir;
+  };
+
+  std::string paths;
+  std::string lower;
+  std::vector<Entry> entries;
+  std::vector<std::uint64_t> masks;
+
+  bool arena_fits(std::size_t bytes) const {
+    return bytes <= UINT32_MAX - paths.size();
+  }
+};
+
+// Tree order of relative paths: component by component, names bytewise.
+bool file_index_path_less(std::string_view a, std::string_view b);
+
+// Find Files ranking of the entries below the relative directory `dir`.
+// With a query, fuzzy matches against the path below `dir`, the name
+// counting double; without one, directories first, then by name. Hits
+// carry absolute entry indices. The ranker refers to the snapshot, which
+// must outlive it.
+class FileIndexRanker {
+public:
+  FileIndexRanker(const FileIndexSnapshot &snap, std::string_view dir,
+                  std::string_view query);
+
+  // The entries below `dir`.
+  std::size_t first() const { return range.first; }
+  std::size_t last() const { return range.second; }
+
+  // Entry i's score, or -1 when it does not match.
+  int score(std::size_t i) const;
+  bool before(const FuzzyHit &a, const FuzzyHit &b) const;
+  // Merges the best `limit` of entries [from, to) into `best`, which is in
+  // order and stays so. Ranking a subtree in pieces gives the same result
+  // as ranking it at once.
+  void rank(std::size_t from, std::size_t to, std::size_t limit,
+            std::vector<FuzzyHit> &best) const;
+
+private:
+  const FileIndexSnapshot &snap;
+  FuzzyPattern pattern;
+  std::string slash_query;
+  std::size_t skip;
+  std::pair<std::size_t, std::size_t> range;
+};
+
+// The best `limit` entries below `dir`, ranked in one go.
+std::vector<FuzzyHit> rank_file_index(const FileIndexSnapshot &snap,
+                                      std::string_view dir,
+                                      std::string_view query,
+                                      std::size_t limit);
+
+// Builds a FileIndexSnapshot of one directory tree on a worker thread and
+// keeps it current. Hidden entries and build/VCS directories are left
+// out, and symlinked directories are listed but not entered. On Linux
+// inotify watches every indexed directory; a change re-lists only the
+// directories it touched, after a short settle time. Elsewhere, or when
+// the tree has more directories than can be watched, set_root() on the
+// same root rescans.
+//
+// During the first scan partial snapshots are published as they grow. The
+// ready callback runs on the worker, under the index's lock, after each
+// publish; it must not call back into the index.
+class FileIndex {
+public:
+  FileIndex() = default;
+  ~FileIndex();
+  FileIndex(const FileIndex &) = delete;
+  FileIndex &operator=(const FileIndex &) = delete;
+
+  void set_ready_callback(std::function<void()> callback);
+  // Directory to index. Cheap when unchanged and fully watched.
+  void set_root(const std::string &root);
+  const std::string &root() const { return requested_root; }
+
+  std::shared_ptr<const FileIndexSnapshot> snapshot() const {
+    return std::atomic_load(&published);
+  }
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable work; // where there is no wake pipe
+  std::thread worker;
+  std::function<void()> ready_callback;
+  std::string requested_root; // UI thread only
+  std::string root_for_worker;
+  bool root_changed = false;
+  bool rescan_requested = false;
+  bool stopping = false;
+  std::atomic<bool> interrupted{false}; // cuts a running scan short
+  std::atomic<bool> fully_watched{false};
+  int wake_pipe[2] = {-1, -1};
+  std::shared_ptr<const FileIndexSnapshot> published =
+      std::make_shared<FileIndexSnapshot>();
+
+  void start_locked();
+  void wake();
+  void run();
+  void publish(std::shared_ptr<FileIndexSnapshot> next);
+};
+
+#endif
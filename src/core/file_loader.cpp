@@ -0,0 +1,292 @@
+#include "file_loader.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Below this a file is split on the calling thread alone.
+constexpr std::size_t kParallelBytes = 8 << 20;
+constexpr unsigned kMaxSplitThreads = 8;
+// Mapped pages are dropped after each slice of this size is split.
+constexpr std::size_t kSliceBytes = 4 << 20;
+// Lines a background load hands out at a time, in bytes of file.
+constexpr std::size_t kBatchBytes = 4 << 20;
+// Chunk size where the file cannot be mapped.
+constexpr std::size_t kReadChunk = 1 << 20;
+
+// The contents of a file: mapped read-only, or read into memory where it
+// cannot be mapped (pipes, /proc, other platforms).
+class FileContents {
+public:
+  FileContents() = default;
+  FileContents(const FileContents &) = delete;
+  FileContents &operator=(const FileContents &) = delete;
+  ~FileContents() {
+#if defined(JOT_PLATFORM_POSIX)
+    if (mapped) {
+      munmap((void *)mapped, length);
+    }
+#endif
+  }
+
+  bool open(const std::string &path) {
+#if defined(JOT_PLATFORM_POSIX)
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || S_ISDIR(st.st_mode)) {
+      close(fd);
+      return false;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *p = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                     fd, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, (std::size_t)st.st_size, MADV_SEQUENTIAL);
+        mapped = (const char *)p;
+        length = (std::size_t)st.st_size;
+        close(fd);
+        return true;
+      }
+    }
+    char buf[64 * 1024];
+    ssize_t n = 0;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+      text.append(buf, (std::size_t)n);
+    }
+    close(fd);
+    length = text.size();
+    return n == 0;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+      return false;
+    }
+    std::vector<char> buf(kReadChunk);
+    while (in.read(buf.data(), (std::streamsize)buf.size()) || in.gcount() > 0) {
+      text.append(buf.data(), (std::size_t)in.gcount());
+    }
+    length = text.size();
+    return true;
+#endif
+  }
+
+  const char *data() const { return mapped ? mapped : text.data(); }
+  std::size_t size() const { return length; }
+
+  // Start of the line after the first newline at or past `pos`.
+  std::size_t next_line(std::size_t pos) const {
+    if (pos >= length) {
+      return length;
+    }
+    const void *nl = std::memchr(data() + pos, '\n', length - pos);
+    return nl ? (std::size_t)((const char *)nl - data()) + 1 : length;
+  }
+
+  // Drops the pages wholly inside [begin, end) once they have been split;
+  // they are file-backed, so nothing is lost.
+  void release(std::size_t begin, std::size_t end) const {
+#if defined(JOT_PLATFORM_POSIX)
+    if (!mapped) {
+      return;
+    }
+    const std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (begin < end) {
+      madvise((void *)(mapped + begin), end - begin, MADV_DONTNEED);
+    }
+#else
+    (void)begin;
+    (void)end;
+#endif
+  }
+
+private:
+  const char *mapped = nullptr;
+  std::size_t length = 0;
+  std::string text;
+};
+
+// Splits [begin, end) in slices, handing each slice's lines to `sink`
+// before the next is split, so only one slice of lines is held at a time.
+template <typename Sink>
+void split_range(const FileContents &file, std::size_t begin, std::size_t end,
+                 Sink sink) {
+  while (begin < end) {
+    const std::size_t stop =
+        std::min(end, file.next_line(std::min(end, begin + kSliceBytes)));
+    std::vector<std::string> lines;
+    // Most lines are longer than this; an overestimate is freed right after.
+    lines.reserve((stop - begin) / 32 + 1);
+    split_lines(file.data() + begin, stop - begin, lines);
+    file.release(begin, stop);
+    sink(std::move(lines));
+    begin = stop;
+  }
+}
+} // namespace
+
+void split_lines(const char *data, std::size_t size,
+                 std::vector<std::string> &out) {
+  const char *p = data;
+  const char *const end = data + size;
+  while (p < end) {
+    const char *nl = (const char *)std::memchr(p, '\n', (std::size_t)(end - p));
+    std::size_t len = (std::size_t)((nl ? nl : end) - p);
+    if (len > 0 && p[len - 1] == '\r') {
+      len--;
+    }
+    out.emplace_back(p, len);
+    if (!nl) {
+      break;
+    }
+    p = nl + 1;
+  }
+}
+
+bool load_file_lines(const std::string &path, LineStore &out) {
+  FileContents file;
+  if (!file.open(path)) {
+    return false;
+  }
+
+  const std::size_t size = file.size();
+  unsigned threads = 1;
+  if (size >= kParallelBytes) {
+    threads = std::clamp(std::thread::hardware_concurrency(), 1u,
+                         kMaxSplitThreads);
+    threads = (unsigned)std::min<std::size_t>(threads, size / kParallelBytes);
+  }
+
+  // Each part starts after a newline, so parts split independently.
+  std::vector<std::size_t> starts(threads + 1, size);
+  starts[0] = 0;
+  for (unsigned i = 1; i < threads; i++) {
+    starts[i] = std::max(starts[i - 1],
+                         file.next_line(size / threads * i));
+  }
+  // The first part goes straight into the store; the others are kept in
+  // slices until the parts before them are in.
+  LineStore lines;
+  std::vector<std::vector<std::vector<std::string>>> parts(threads);
+  std::vector<std::thread> helpers;
+  for (unsigned i = 1; i < threads; i++) {
+    helpers.emplace_back([&, i] {
+      split_range(file, starts[i], starts[i + 1],
+                  [&](std::vector<std::string> &&slice) {
+                    parts[i].push_back(std::move(slice));
+                  });
+    });
+  }
+  split_range(file, starts[0], starts[1],
+              [&](std::vector<std::string> &&slice) {
+                lines.append(std::move(slice));
+              });
+  for (unsigned i = 1; i < threads; i++) {
+    helpers[i - 1].join();
+    for (auto &slice : parts[i]) {
+      lines.append(std::move(slice));
+    }
+    parts[i].clear();
+  }
+  out = std::move(lines);
+  return true;
+}
+
+void append_loaded_lines(FileBuffer &buf, std::vector<std::string> lines) {
+  if (lines.empty()) {
+    return;
+  }
+  buf.undo.seal(buf.lines);
+  const LineStore &current = buf.lines;
+  if (!buf.modified && current.size() == 1 && current.front().empty()) {
+    buf.lines = LineStore(std::move(lines));
+  } else {
+    buf.lines.append(std::move(lines));
+  }
+}
+
+BackgroundFileLoad::BackgroundFileLoad(std::string path,
+                                       std::function<void()> ready_callback)
+    : file_path(std::move(path)), ready_callback(std::move(ready_callback)) {
+  worker = std::thread(&BackgroundFileLoad::run, this);
+}
+
+BackgroundFileLoad::~BackgroundFileLoad() {
+  cancelled = true;
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+bool BackgroundFileLoad::take(std::vector<std::string> &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (ready_lines.empty()) {
+    return false;
+  }
+  if (out.empty()) {
+    out.swap(ready_lines);
+  } else {
+    out.insert(out.end(), std::make_move_iterator(ready_lines.begin()),
+               std::make_move_iterator(ready_lines.end()));
+    ready_lines.clear();
+  }
+  return true;
+}
+
+bool BackgroundFileLoad::done() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return finished && ready_lines.empty();
+}
+
+void BackgroundFileLoad::publish(std::vector<std::string> &lines, bool last) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ready_lines.empty()) {
+      ready_lines.swap(lines);
+    } else {
+      ready_lines.insert(ready_lines.end(),
+                         std::make_move_iterator(lines.begin()),
+                         std::make_move_iterator(lines.end()));
+    }
+    lines.clear();
+    finished = last;
+  }
+  if (ready_callback) {
+    ready_callback();
+  }
+}
+
+void BackgroundFileLoad::run() {
+  FileContents file;
+  std::vector<std::string> lines;
+  if (!file.open(file_path)) {
+    read_failed = true;
+    publish(lines, true);
+    return;
+  }
+  total_bytes = file.size();
+  std::size_t at = 0;
+  while (at < file.size() && !cancelled) {
+    const std::size_t stop =
+        file.next_line(std::min(file.size(), at + kBatchBytes));
+    split_lines(file.data() + at, stop - at, lines);
+    file.release(at, stop);
+    at = stop;
+    done_bytes = at;
+    publish(lines, at >= file.size());
+  }
+  if (file.size() == 0) {
+    publish(lines, true);
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Splits text into lines on '\n', dropping a '\r' before it, with no empty
+// line after a final newline. Newlines are found with memchr.
+void split_lines(const char *data, std::size_t size,
+                 std::vector<std::string> &out);
+
+// Reads the file at `path` into `out`, replacing its contents. The file is
+// mapped where mmap is available and read in large chunks otherwise; big
+// files are split by several threads, each starting after a newline, and
+// the lines are moved into `out` without copies. Mapped pages are dropped
+// as they are split, so memory does not hold the file twice. Returns false
+// when the file cannot be read; `out` is then untouched.
+bool load_file_lines(const std::string &path, LineStore &out);
+
+// Adds a batch from a BackgroundFileLoad to the end of `buf`, replacing the
+// empty placeholder line with the first one. An open undo step is sealed
+// first, so undoing it cannot take the new lines with it.
+void append_loaded_lines(FileBuffer &buf, std::vector<std::string> lines);
+
+// Loads one file on a worker thread, handing out lines in batches as they
+// are split so the buffer can be shown while the rest arrives. Destroying
+// it cancels the load.
+class BackgroundFileLoad {
+public:
+  BackgroundFileLoad(std::string path, std::function<void()> ready_callback);
+  ~BackgroundFileLoad();
+  BackgroundFileLoad(const BackgroundFileLoad &) = delete;
+  BackgroundFileLoad &operator=(const BackgroundFileLoad &) = delete;
+
+  const std::string &path() const { return file_path; }
+  // Moves the lines split so far onto `out`. Returns false if there were
+  // none.
+  bool take(std::vector<std::string> &out);
+  // True once every line has been split and taken.
+  bool done() const;
+  bool failed() const { return read_failed; }
+  std::uint64_t bytes_done() const { return done_bytes; }
+  std::uint64_t bytes_total() const { return total_bytes; }
+
+private:
+  std::string file_path;
+  std::function<void()> ready_callback;
+  mutable std::mutex mutex;
+  std::vector<std::string> ready_lines;
+  bool finished = false;
+  std::atomic<bool> cancelled{false};
+  std::atomic<bool> read_failed{false};
+  std::atomic<std::uint64_t> done_bytes{0};
+  std::atomic<std::uint64_t> total_bytes{0};
+  std::thread worker;
+
+  void run();
+  void publish(std::vector<std::string> &lines, bool last);
+};
+
+#endif
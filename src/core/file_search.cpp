@@ -0,0 +1,132 @@
+#include "file_search.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// The first piece is small so something shows quickly; later ones grow so
+// ranking can use several threads. A cancelled search stops within one.
+constexpr std::size_t kFirstPiece = 32 * 1024;
+constexpr std::size_t kMaxPiece = 256 * 1024;
+// Between partial publishes, so a long search does not redraw constantly.
+constexpr auto kPublishInterval = std::chrono::milliseconds(16);
+} // namespace
+
+FileSearch::~FileSearch() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    ready_callback = nullptr;
+    current++;
+  }
+  work.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+void FileSearch::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+std::uint64_t
+FileSearch::start(std::shared_ptr<const FileIndexSnapshot> snapshot,
+                  const std::string &dir, const std::string &query,
+                  std::size_t limit) {
+  std::uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    generation = ++current;
+    pending.generation = generation;
+    pending.snapshot = std::move(snapshot);
+    pending.dir = dir;
+    pending.query = query;
+    pending.limit = limit;
+    has_pending = true;
+    if (!worker.joinable()) {
+      worker = std::thread([this] { run(); });
+    }
+  }
+  work.notify_one();
+  return generation;
+}
+
+void FileSearch::cancel() {
+  std::lock_guard<std::mutex> lock(mutex);
+  current++;
+  has_pending = false;
+  pending.snapshot.reset();
+}
+
+void FileSearch::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work.wait(lock, [this] { return stopping || has_pending; });
+    if (stopping) {
+      return;
+    }
+    const Request request = std::move(pending);
+    pending.snapshot.reset();
+    has_pending = false;
+    lock.unlock();
+    search(request);
+    lock.lock();
+  }
+}
+
+void FileSearch::search(const Request &request) {
+  const FileIndexRanker ranker(*request.snapshot, request.dir, request.query);
+  std::vector<FuzzyHit> best;
+  bool shown_any = false;
+  Clock::time_point last_publish = Clock::now();
+
+  auto results = [&](bool done) {
+    auto next = std::make_shared<FileSearchResults>();
+    next->generation = request.generation;
+    next->snapshot = request.snapshot;
+    next->hits = best;
+    next->total = ranker.last() - ranker.first();
+    next->done = done;
+    return next;
+  };
+
+  std::size_t piece = kFirstPiece;
+  for (std::size_t from = ranker.first(); from < ranker.last();) {
+    if (current != request.generation) {
+      return;
+    }
+    const std::size_t to = std::min(ranker.last(), from + piece);
+    ranker.rank(from, to, request.limit, best);
+    from = to;
+    piece = std::min(kMaxPiece, piece * 2);
+
+    const Clock::time_point now = Clock::now();
+    if (from < ranker.last() &&
+        ((!shown_any && !best.empty()) ||
+         now - last_publish >= kPublishInterval)) {
+      auto partial = results(false);
+      partial->searched = from - ranker.first();
+      publish(std::move(partial));
+      shown_any = shown_any || !best.empty();
+      last_publish = now;
+    }
+  }
+
+  auto final_results = results(true);
+  final_results->searched = final_results->total;
+  publish(std::move(final_results));
+}
+
+void FileSearch::publish(std::shared_ptr<FileSearchResults> next) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (next->generation != current) {
+    return;
+  }
+  std::atomic_store(&published,
+                    std::shared_ptr<const FileSearchResults>(std::move(next)));
+  if (ready_callback) {
+    ready_callback();
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef FILE_SEARCH_H
+#define FILE_SEARCH_H
+
+#include "file_index.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What one search has found so far. `hits` are the best so far, in order,
+// with absolute indices into `snapshot`.
+struct FileSearchResults {
+  std::uint64_t generation = 0;
+  std::shared_ptr<const FileIndexSnapshot> snapshot;
+  std::vector<FuzzyHit> hits;
+  std::size_t searched = 0; // entries looked at so far
+  std::size_t total = 0;    // entries below the search directory
+  bool done = false;
+};
+
+// Ranks a FileIndexSnapshot on a worker thread, in pieces, publishing the
+// best so far after each. Every start() begins a new generation and
+// cancels the one in flight, which stops at its next piece and never
+// publishes again, so results() only ever moves forward.
+//
+// The ready callback runs on the worker, under the search's lock, after
+// each publish; it must not call back into the search.
+class FileSearch {
+public:
+  FileSearch() = default;
+  ~FileSearch();
+  FileSearch(const FileSearch &) = delete;
+  FileSearch &operator=(const FileSearch &) = delete;
+
+  void set_ready_callback(std::function<void()> callback);
+  // Searches `snapshot` below the relative directory `dir`. Returns the
+  // new generation.
+  std::uint64_t start(std::shared_ptr<const FileIndexSnapshot> snapshot,
+                      const std::string &dir, const std::string &query,
+                      std::size_t limit);
+  // Stops the search in flight, if any, without starting another.
+  void cancel();
+  std::uint64_t generation() const { return current; }
+
+  std::shared_ptr<const FileSearchResults> results() const {
+    return std::atomic_load(&published);
+  }
+
+private:
+  struct Request {
+    std::uint64_t generation = 0;
+    std::shared_ptr<const FileIndexSnapshot> snapshot;
+    std::string dir;
+    std::string query;
+    std::size_t limit = 0;
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable work;
+  std::thread worker;
+  std::function<void()> ready_callback;
+  Request pending;
+  bool has_pending = false;
+  bool stopping = false;
+  std::atomic<std::uint64_t> current{0};
+  std::shared_ptr<const FileSearchResults> published =
+      std::make_shared<FileSearchResults>();
+
+  void run();
+  void search(const Request &request);
+  // Publishes unless a newer generation has started.
+  void publish(std::shared_ptr<FileSearchResults> next);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "fuzzy_match.h"
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr std::size_t kMaxWorkers = 8;
+// Below this many candidates per thread, starting threads costs more than
+// it saves.
+constexpr std::size_t kMinCandidatesPerWorker = 32768;
+
+int char_bit(unsigned char c) {
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a';
+  }
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= '0' && c <= '9') {
+    return 26 + (c - '0');
+  }
+  switch (c) {
+  case '.': return 36;
+  case '_': return 37;
+  case '-': return 38;
+  case '/': return 39;
+  case ' ': return 40;
+  default: return 41 + c % 23;
+  }
+}
+
+char lower_char(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+} // namespace
+
+std::uint64_t fuzzy_char_mask(std::string_view text) {
+  std::uint64_t mask = 0;
+  for (char c : text) {
+    mask |= std::uint64_t(1) << char_bit((unsigned char)c);
+  }
+  return mask;
+}
+
+FuzzyPattern::FuzzyPattern(std::string_view pattern) {
+  lower.reserve(pattern.size());
+  for (char c : pattern) {
+    lower.push_back(lower_char(c));
+  }
+  char_mask = fuzzy_char_mask(lower);
+}
+
+bool FuzzyPattern::matches(std::string_view text) const {
+  // memchr skips ahead to each pattern character with SIMD in most libcs.
+  const char *at = text.data();
+  const char *end = at + text.size();
+  for (char c : lower) {
+    const void *found = at < end ? std::memchr(at, c, end - at) : nullptr;
+    if (!found) {
+      return false;
+    }
+    at = static_cast<const char *>(found) + 1;
+  }
+  return true;
+}
+
+int FuzzyPattern::score(std::string_view text) const {
+  if (lower.empty() || text.empty()) {
+    return 0;
+  }
+
+  // The greedy leftmost match, found with memchr like matches(); only the
+  // matched positions are visited. Most candidates fail here, so the
+  // substring checks come after.
+  int score = 0;
+  int prev = -2;
+  const char *begin = text.data();
+  const char *end = begin + text.size();
+  const char *at = begin;
+  for (char c : lower) {
+    const void *found = at < end ? std::memchr(at, c, end - at) : nullptr;
+    if (!found) {
+      return 0;
+    }
+    at = static_cast<const char *>(found);
+    const int i = (int)(at - begin);
+    score += 12;
+    if (i == prev + 1) {
+      score += 10;
+    }
+    if (i == 0 || at[-1] == '/' || at[-1] == '_' || at[-1] == '-' ||
+        at[-1] == ' ') {
+      score += 8;
+    }
+    score += std::max(0, 12 - i);
+    prev = i;
+    at++;
+  }
+
+  if (text == lower) {
+    return 500;
+  }
+  if (text.find(lower) != std::string_view::npos) {
+    return 300;
+  }
+  return score;
+}
+
+void fuzzy_prefilter(const std::uint64_t *masks, std::size_t first,
+                     std::size_t last, std::uint64_t need,
+                     std::vector<std::uint32_t> &out) {
+  std::size_t i = first;
+#if defined(__SSE2__)
+  // Eight masks per step; a mask passes when need & ~mask is zero in both
+  // of its 32-bit halves. Most steps of a selective pattern pass nothing.
+  const __m128i want = _mm_set1_epi64x((long long)need);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= last; i += 8) {
+    unsigned passed = 0;
+    for (int pair = 0; pair < 4; pair++) {
+      const __m128i m = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(masks + i + 2 * pair));
+      const __m128i missing = _mm_andnot_si128(m, want);
+      const unsigned halves = (unsigned)_mm_movemask_ps(
+          _mm_castsi128_ps(_mm_cmpeq_epi32(missing, zero)));
+      const unsigned both = halves & (halves >> 1);
+      passed |= ((both & 1) | ((both >> 1) & 2)) << (2 * pair);
+    }
+    for (unsigned bit = 0; passed; bit++, passed >>= 1) {
+      if (passed & 1) {
+        out.push_back((std::uint32_t)(i + bit));
+      }
+    }
+  }
+#endif
+  for (; i < last; i++) {
+    if ((masks[i] & need) == need) {
+      out.push_back((std::uint32_t)i);
+    }
+  }
+}
+
+namespace fuzzy_detail {
+std::size_t worker_count(std::size_t count) {
+  const std::size_t cores =
+      std::max<std::size_t>(1, std::thread::hardware_concurrency());
+  return std::max<std::size_t>(
+      1, std::min({cores, kMaxWorkers, count / kMinCandidatesPerWorker}));
+}
+
+void run_parallel(std::size_t workers,
+                  const std::function<void(std::size_t)> &work) {
+  std::vector<std::thread> threads;
+  threads.reserve(workers > 0 ? workers - 1 : 0);
+  for (std::size_t w = 1; w < workers; w++) {
+    threads.emplace_back([&work, w] { work(w); });
+  }
+  work(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+} // namespace fuzzy_detail
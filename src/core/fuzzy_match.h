@@ -0,0 +1,137 @@
+#ifndef FUZZY_MATCH_H
+#define FUZZY_MATCH_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fuzzy matching shared by Find Files, the command palette, recent files
+// and LSP completion. A candidate matches when the pattern's characters
+// appear in it in order, ignoring ASCII case.
+
+// One bit per letter, digit and common path punctuation, the rest hashed
+// into the remaining bits. A candidate can only match when its mask has
+// every bit of the pattern's mask.
+std::uint64_t fuzzy_char_mask(std::string_view text);
+
+class FuzzyPattern {
+public:
+  explicit FuzzyPattern(std::string_view pattern);
+
+  const std::string &text() const { return lower; }
+  bool empty() const { return lower.empty(); }
+  std::uint64_t mask() const { return char_mask; }
+
+  // Both take lowercase text.
+  bool matches(std::string_view text) const;
+  // 500 for the whole text, 300 for a substring, otherwise points for each
+  // character with bonuses for runs, word starts and early positions; 0
+  // when it does not match.
+  int score(std::string_view text) const;
+
+private:
+  std::string lower;
+  std::uint64_t char_mask = 0;
+};
+
+// Appends the candidates in [first, last) whose masks contain all of
+// `need`, several masks per step where SIMD is available.
+void fuzzy_prefilter(const std::uint64_t *masks, std::size_t first,
+                     std::size_t last, std::uint64_t need,
+                     std::vector<std::uint32_t> &out);
+
+struct FuzzyHit {
+  int score;
+  std::uint32_t index;
+};
+
+namespace fuzzy_detail {
+// Threads worth using for `count` candidates.
+std::size_t worker_count(std::size_t count);
+// Runs work(0) .. work(workers - 1), all but the first on new threads.
+void run_parallel(std::size_t workers,
+                  const std::function<void(std::size_t)> &work);
+
+// Trims hits to the best `limit`. Returns the lowest score a later hit
+// needs to have a chance, which is INT_MIN while fewer than limit are kept.
+template <typename Before>
+int keep_best(std::vector<FuzzyHit> &hits, std::size_t limit,
+              Before &before) {
+  if (hits.size() > limit) {
+    std::nth_element(hits.begin(), hits.begin() + limit, hits.end(), before);
+    hits.resize(limit);
+  }
+  if (limit == 0 || hits.size() < limit) {
+    return INT_MIN;
+  }
+  int lowest = hits[0].score;
+  for (const FuzzyHit &hit : hits) {
+    lowest = std::min(lowest, hit.score);
+  }
+  return lowest;
+}
+} // namespace fuzzy_detail
+
+// The best `limit` of candidates [0, count), ordered by `before`, which
+// must put higher scores first. score(i) returns a candidate's score, or a
+// negative value to drop it. With `masks`, candidates lacking a character
+// of `need` are dropped before score() sees them. Once `limit` hits are
+// kept, lower scores are dropped as they come. Large inputs are split
+// across threads, so score and before must be safe to call concurrently.
+// Only the kept hits are sorted.
+template <typename Score, typename Before>
+std::vector<FuzzyHit> fuzzy_rank(std::size_t count, std::size_t limit,
+                                 const std::uint64_t *masks,
+                                 std::uint64_t need, Score &&score,
+                                 Before &&before) {
+  constexpr std::size_t kBlock = 4096;
+  // Trim a worker's hits at this size, which bounds memory when most
+  // candidates match.
+  const std::size_t trim_at =
+      limit > (SIZE_MAX - kBlock) / 4 ? SIZE_MAX : 4 * limit + kBlock;
+  const std::size_t workers = fuzzy_detail::worker_count(count);
+  std::vector<std::vector<FuzzyHit>> parts(workers);
+  fuzzy_detail::run_parallel(workers, [&](std::size_t w) {
+    std::vector<FuzzyHit> &hits = parts[w];
+    std::vector<std::uint32_t> passed;
+    int lowest = INT_MIN;
+    const std::size_t last = count * (w + 1) / workers;
+    for (std::size_t block = count * w / workers; block < last;
+         block += kBlock) {
+      const std::size_t block_end = std::min(last, block + kBlock);
+      passed.clear();
+      if (masks) {
+        fuzzy_prefilter(masks, block, block_end, need, passed);
+      } else {
+        for (std::size_t i = block; i < block_end; i++) {
+          passed.push_back((std::uint32_t)i);
+        }
+      }
+      for (std::uint32_t i : passed) {
+        const int s = score(i);
+        if (s >= 0 && s >= lowest) {
+          hits.push_back({s, i});
+        }
+      }
+      if (hits.size() >= trim_at) {
+        lowest = fuzzy_detail::keep_best(hits, limit, before);
+      }
+    }
+    fuzzy_detail::keep_best(hits, limit, before);
+  });
+
+  std::vector<FuzzyHit> best = std::move(parts[0]);
+  for (std::size_t w = 1; w < workers; w++) {
+    best.insert(best.end(), parts[w].begin(), parts[w].end());
+  }
+  fuzzy_detail::keep_best(best, limit, before);
+  std::sort(best.begin(), best.end(), before);
+  return best;
+}
+
+#endif
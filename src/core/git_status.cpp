@@ -0,0 +1,482 @@
+#include "git_status.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <unordered_set>
+#include <vector>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace {
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// Quiet time before a reported change is acted on, so one save or
+// checkout causes one refresh.
+constexpr auto kSettleTime = std::chrono::milliseconds(150);
+// Refresh interval when changes cannot all be watched.
+constexpr auto kFallbackInterval = std::chrono::milliseconds(1500);
+
+std::string trim_right_newlines(std::string s) {
+  while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) {
+    s.pop_back();
+  }
+  return s;
+}
+
+std::string shell_quote(const std::string &value) {
+  std::string out = "'";
+  out.reserve(value.size() + 8);
+  for (char c : value) {
+    if (c == '\'') {
+      out += "'\\''";
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('\'');
+  return out;
+}
+
+std::string capture_command_output(const std::string &command) {
+  std::string out;
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    return "";
+  }
+  char buf[16 * 1024];
+  std::size_t n = 0;
+  while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+    out.append(buf, n);
+  }
+  pclose(pipe);
+  return out;
+}
+
+std::string normalize_path(const std::string &path) {
+  if (path.empty()) {
+    return "";
+  }
+  std::error_code ec;
+  fs::path p = fs::absolute(path, ec);
+  if (ec) {
+    p = fs::path(path);
+  }
+  return p.lexically_normal().string();
+}
+
+std::string parse_branch_name(const std::string &line) {
+  if (line.rfind("## ", 0) != 0) {
+    return "";
+  }
+  std::string body = line.substr(3);
+  size_t dots = body.find("...");
+  size_t space = body.find(' ');
+  size_t cut = std::string::npos;
+  if (dots != std::string::npos) {
+    cut = dots;
+  } else if (space != std::string::npos) {
+    cut = space;
+  }
+  if (cut != std::string::npos) {
+    body = body.substr(0, cut);
+  }
+  if (body == "HEAD" || body.empty()) {
+    return "";
+  }
+  return body;
+}
+
+bool same_status(const GitStatusSnapshot &a, const GitStatusSnapshot &b) {
+  return a.root == b.root && a.branch == b.branch &&
+         a.dirty_count == b.dirty_count && a.file_status == b.file_status;
+}
+
+// inotify watches on the git directory and on every tracked directory of
+// one worktree. Without inotify it watches nothing and reports itself
+// incomplete, which keeps the fallback timer running.
+class TreeWatcher {
+public:
+  ~TreeWatcher() { close_fd(); }
+
+  int fd() const { return inotify_fd; }
+  bool complete() const { return inotify_fd >= 0 && all_watched; }
+
+  void watch(const std::string &root) {
+    close_fd();
+    watched_root = root;
+#if defined(__linux__)
+    if (root.empty()) {
+      return;
+    }
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+      return;
+    }
+    const std::string git_dir =
+        run_git_command(root, "rev-parse --absolute-git-dir");
+    git_dir_wd = git_dir.empty()
+                     ? -1
+                     : inotify_add_watch(inotify_fd, git_dir.c_str(),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO |
+                                             IN_DELETE);
+    all_watched = git_dir_wd >= 0;
+    sync_directories();
+#endif
+  }
+
+  // Adds watches for tracked directories that appeared since watch().
+  void sync_directories() {
+#if defined(__linux__)
+    if (inotify_fd < 0) {
+      return;
+    }
+    const std::string files =
+        capture_command_output("git -C " + shell_quote(watched_root) +
+                               " ls-files -z 2>/dev/null");
+    std::unordered_set<std::string> dirs = {""};
+    std::size_t start = 0;
+    while (start < files.size()) {
+      std::size_t end = files.find('\0', start);
+      if (end == std::string::npos) {
+        end = files.size();
+      }
+      std::size_t slash = files.rfind('/', end);
+      while (slash != std::string::npos && slash > start &&
+             dirs.insert(files.substr(start, slash - start)).second) {
+        slash = files.rfind('/', slash - 1);
+      }
+      start = end + 1;
+    }
+    for (const std::string &dir : dirs) {
+      const std::string path = dir.empty() ? watched_root
+                                           : watched_root + "/" + dir;
+      if (inotify_add_watch(inotify_fd, path.c_str(),
+                            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                IN_CREATE | IN_DELETE | IN_ONLYDIR) < 0) {
+        all_watched = false; // out of watches; the timer covers the rest
+      }
+    }
+#endif
+  }
+
+  // Drains pending events. Returns true when any of them can change the
+  // status; `git_dir` is set when one came from the git directory.
+  bool read_events(bool &git_dir) {
+    bool changed = false;
+#if defined(__linux__)
+    alignas(inotify_event) char buf[16 * 1024];
+    while (true) {
+      const ssize_t n = read(inotify_fd, buf, sizeof(buf));
+      if (n <= 0) {
+        break;
+      }
+      for (ssize_t pos = 0; pos < n;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(buf + pos);
+        pos += (ssize_t)(sizeof(inotify_event) + event->len);
+        const std::string name = event->len ? event->name : "";
+        if (event->mask & IN_Q_OVERFLOW) {
+          changed = git_dir = true;
+        } else if (event->wd == git_dir_wd) {
+          // Lock files and objects come and go; these are the results.
+          if (name == "index" || name == "HEAD" || name == "packed-refs") {
+            changed = git_dir = true;
+          }
+        } else if (name != ".git" && !(event->mask & IN_IGNORED)) {
+          changed = true;
+        }
+      }
+    }
+#else
+    (void)git_dir;
+#endif
+    return changed;
+  }
+
+private:
+  int inotify_fd = -1;
+  int git_dir_wd = -1;
+  bool all_watched = false;
+  std::string watched_root;
+
+  void close_fd() {
+#if defined(JOT_PLATFORM_POSIX)
+    if (inotify_fd >= 0) {
+      close(inotify_fd);
+    }
+#endif
+    inotify_fd = -1;
+    git_dir_wd = -1;
+    all_watched = false;
+  }
+};
+} // namespace
+
+std::string run_git_command(const std::string &dir, const std::string &args) {
+  if (dir.empty()) {
+    return "";
+  }
+  return trim_right_newlines(capture_command_output(
+      "git -C " + shell_quote(dir) + " " + args + " 2>/dev/null"));
+}
+
+GitStatusSnapshot read_git_status(const std::string &repo_hint) {
+  GitStatusSnapshot status;
+  const std::string top =
+      run_git_command(repo_hint, "rev-parse --show-toplevel");
+  if (top.empty()) {
+    return status;
+  }
+
+  status.root = normalize_path(top);
+  status.branch = run_git_command(status.root, "symbolic-ref --short HEAD");
+  if (status.branch.empty()) {
+    status.branch = run_git_command(status.root, "rev-parse --short HEAD");
+  }
+  if (status.branch.empty()) {
+    status.branch = "(detached)";
+  }
+
+  // --no-optional-locks keeps status from rewriting the index, which
+  // would otherwise report itself as a change.
+  const std::string status_text = capture_command_output(
+      "git --no-optional-locks -C " + shell_quote(status.root) +
+      " status --porcelain=v1 --branch 2>/dev/null");
+  std::size_t line_start = 0;
+  while (line_start < status_text.size()) {
+    std::size_t line_end = status_text.find('\n', line_start);
+    if (line_end == std::string::npos) {
+      line_end = status_text.size();
+    }
+    const std::string line =
+        status_text.substr(line_start, line_end - line_start);
+    line_start = line_end + 1;
+    if (line.empty()) {
+      continue;
+    }
+    if (line.rfind("## ", 0) == 0) {
+      std::string from_status = parse_branch_name(line);
+      if (!from_status.empty()) {
+        status.branch = from_status;
+      }
+      continue;
+    }
+    if (line.size() < 3) {
+      continue;
+    }
+    const std::string xy = line.substr(0, 2);
+    std::string rel_path = line.substr(3);
+    size_t arrow = rel_path.find(" -> ");
+    if (arrow != std::string::npos) {
+      rel_path = rel_path.substr(arrow + 4);
+    }
+    if (!rel_path.empty() && rel_path.front() == '"' && rel_path.back() == '"' &&
+        rel_path.size() >= 2) {
+      rel_path = rel_path.substr(1, rel_path.size() - 2);
+    }
+
+    std::string abs_path =
+        normalize_path((fs::path(status.root) / fs::path(rel_path)).string());
+    if (!abs_path.empty()) {
+      status.file_status[abs_path] = xy;
+    }
+    if (xy != "  ") {
+      status.dirty_count++;
+    }
+  }
+  return status;
+}
+
+GitStatusService::~GitStatusService() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake();
+  done.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+#if defined(JOT_PLATFORM_POSIX)
+  for (int fd : wake_pipe) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+void GitStatusService::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+void GitStatusService::set_repo_hint(const std::string &repo_hint) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (repo_hint == hint && worker.joinable()) {
+    return;
+  }
+  hint = repo_hint;
+  hint_changed = true;
+  start_locked();
+  wake();
+}
+
+void GitStatusService::request_refresh() {
+  std::lock_guard<std::mutex> lock(mutex);
+  requested++;
+  start_locked();
+  wake();
+}
+
+void GitStatusService::refresh_and_wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  const std::uint64_t target = ++requested;
+  start_locked();
+  wake();
+  done.wait(lock, [&] { return completed >= target || stopping; });
+}
+
+void GitStatusService::start_locked() {
+  if (worker.joinable()) {
+    return;
+  }
+#if defined(JOT_PLATFORM_POSIX)
+  if (pipe(wake_pipe) == 0) {
+    for (int fd : wake_pipe) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+#endif
+  worker = std::thread([this] { run(); });
+}
+
+void GitStatusService::wake() {
+#if defined(JOT_PLATFORM_POSIX)
+  if (wake_pipe[1] >= 0) {
+    const char byte = 1;
+    // A full pipe already guarantees a wakeup.
+    (void)!write(wake_pipe[1], &byte, 1);
+    return;
+  }
+#endif
+  work.notify_all();
+}
+
+void GitStatusService::run() {
+  TreeWatcher watcher;
+  std::string repo_hint;
+  std::uint64_t serving = 0;
+  bool due = false;
+  Clock::time_point due_at;
+  Clock::time_point last_refresh = Clock::now();
+  bool resync_directories = false;
+
+  while (true) {
+    // Sleep until woken, a watched change, or the next deadline.
+    const Clock::time_point now = Clock::now();
+    Clock::time_point deadline = Clock::time_point::max();
+    if (due) {
+      deadline = due_at;
+    } else if (!watcher.complete() && !repo_hint.empty()) {
+      deadline = last_refresh + kFallbackInterval;
+    }
+    int timeout_ms = -1;
+    if (deadline != Clock::time_point::max()) {
+      // Round up, or the last fraction of a millisecond would spin.
+      timeout_ms = (int)std::max<long long>(
+          0, std::chrono::ceil<std::chrono::milliseconds>(deadline - now)
+                 .count());
+    }
+#if defined(JOT_PLATFORM_POSIX)
+    pollfd fds[2] = {{wake_pipe[0], POLLIN, 0}, {watcher.fd(), POLLIN, 0}};
+    ::poll(fds, watcher.fd() >= 0 ? 2 : 1, timeout_ms);
+    if (fds[0].revents) {
+      char drained[64];
+      while (read(wake_pipe[0], drained, sizeof(drained)) > 0) {
+      }
+    }
+#endif
+    bool from_git_dir = false;
+    if (watcher.fd() >= 0 && watcher.read_events(from_git_dir)) {
+      if (!due) {
+        due = true;
+        due_at = Clock::now() + kSettleTime;
+      }
+      resync_directories = resync_directories || from_git_dir;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+#if !defined(JOT_PLATFORM_POSIX)
+      const bool has_work = hint_changed || requested != serving || stopping;
+      if (!has_work) {
+        if (timeout_ms < 0) {
+          work.wait(lock);
+        } else {
+          work.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+        }
+      }
+#endif
+      if (stopping) {
+        return;
+      }
+      if (hint_changed || requested != serving) {
+        due = true;
+        due_at = Clock::now();
+      }
+      if (hint_changed) {
+        repo_hint = hint;
+        hint_changed = false;
+      }
+      serving = requested;
+    }
+    if (!due && deadline != Clock::time_point::max() &&
+        Clock::now() >= deadline) {
+      due = true;
+      due_at = deadline;
+    }
+    if (!due || Clock::now() < due_at) {
+      continue;
+    }
+
+    due = false;
+    GitStatusSnapshot next = read_git_status(repo_hint);
+    last_refresh = Clock::now();
+    const auto current = snapshot();
+    if (next.root != current->root) {
+      watcher.watch(next.root);
+      resync_directories = false;
+    } else if (resync_directories) {
+      watcher.sync_directories();
+      resync_directories = false;
+    }
+
+    const bool changed = !same_status(next, *current);
+    if (changed) {
+      next.sequence = current->sequence + 1;
+      std::atomic_store(&published, std::shared_ptr<const GitStatusSnapshot>(
+                                        std::make_shared<GitStatusSnapshot>(
+                                            std::move(next))));
+    }
+    std::function<void()> callback;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      completed = serving;
+      callback = ready_callback;
+    }
+    done.notify_all();
+    if (changed && callback) {
+      callback();
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef GIT_STATUS_H
+#define GIT_STATUS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Result of one `git status`. Published snapshots are never modified, so
+// readers can keep using one while a newer one is built.
+struct GitStatusSnapshot {
+  std::string root; // empty outside a repository
+  std::string branch;
+  int dirty_count = 0;
+  // Porcelain XY code by normalized absolute path.
+  std::unordered_map<std::string, std::string> file_status;
+  std::uint64_t sequence = 0; // increases with every published change
+};
+
+// Runs git for the repository containing `repo_hint` and collects its
+// status. Blocks for as long as git does.
+GitStatusSnapshot read_git_status(const std::string &repo_hint);
+// Output of `git -C dir <args>`, without trailing newlines; empty on error.
+std::string run_git_command(const std::string &dir, const std::string &args);
+
+// Keeps a GitStatusSnapshot for one repository up to date on a worker
+// thread. A refresh runs when the repository hint changes, when asked to,
+// and on Linux when inotify reports a change to .git/index, .git/HEAD or a
+// tracked directory of the worktree. Bursts of changes are coalesced.
+// Elsewhere, or when the worktree has more directories than can be
+// watched, it also refreshes on a timer.
+//
+// The UI thread reads snapshot() and swaps the pointer in; the ready
+// callback runs on the worker after each publish.
+class GitStatusService {
+public:
+  GitStatusService() = default;
+  ~GitStatusService();
+  GitStatusService(const GitStatusService &) = delete;
+  GitStatusService &operator=(const GitStatusService &) = delete;
+
+  void set_ready_callback(std::function<void()> callback);
+  // Directory whose repository to track; empty stops tracking. Cheap when
+  // unchanged, so it can be called every frame.
+  void set_repo_hint(const std::string &hint);
+  // Schedules a refresh even if nothing was reported as changed.
+  void request_refresh();
+  // request_refresh(), then blocks until its snapshot is published.
+  void refresh_and_wait();
+
+  std::shared_ptr<const GitStatusSnapshot> snapshot() const {
+    return std::atomic_load(&published);
+  }
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable work; // where there is no wake pipe
+  std::condition_variable done;
+  std::thread worker;
+  std::function<void()> ready_callback;
+  std::string hint;
+  bool hint_changed = false;
+  bool stopping = false;
+  std::uint64_t requested = 0; // refresh requests made
+  std::uint64_t completed = 0; // refresh requests served
+  int wake_pipe[2] = {-1, -1};
+  std::shared_ptr<const GitStatusSnapshot> published =
+      std::make_shared<GitStatusSnapshot>();
+
+  void start_locked();
+  void wake();
+  void run();
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "gitignore.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+// Matches "[...]" at p against c; on success p moves past the class.
+bool match_class(const char *&p, const char *end, char c, bool &matched) {
+  const char *q = p + 1;
+  bool negate = false;
+  if (q < end && (*q == '!' || *q == '^')) {
+    negate = true;
+    q++;
+  }
+  bool hit = false;
+  bool first = true;
+  while (q < end && (*q != ']' || first)) {
+    first = false;
+    char lo = *q;
+    if (lo == '\\' && q + 1 < end) {
+      lo = *++q;
+    }
+    char hi = lo;
+    if (q + 2 < end && q[1] == '-' && q[2] != ']') {
+      hi = q[2];
+      q += 2;
+    }
+    if (c >= lo && c <= hi) {
+      hit = true;
+    }
+    q++;
+  }
+  if (q >= end) {
+    return false; // no closing bracket: not a class
+  }
+  p = q + 1;
+  matched = hit != negate;
+  return true;
+}
+
+bool glob(const char *p, const char *pe, const char *t, const char *te) {
+  while (p < pe) {
+    if (*p == '*') {
+      if (p + 1 < pe && p[1] == '*') {
+        const char *rest = p + 2;
+        if (rest < pe && *rest == '/') {
+          // "**/": zero or more whole directories.
+          rest++;
+          for (const char *s = t;;) {
+            if (glob(rest, pe, s, te)) {
+              return true;
+            }
+            s = static_cast<const char *>(std::memchr(s, '/', te - s));
+            if (!s) {
+              return false;
+            }
+            s++;
+          }
+        }
+        for (const char *s = t; s <= te; s++) {
+          if (glob(rest, pe, s, te)) {
+            return true;
+          }
+        }
+        return false;
+      }
+      p++;
+      for (const char *s = t;; s++) {
+        if (glob(p, pe, s, te)) {
+          return true;
+        }
+        if (s == te || *s == '/') {
+          return false;
+        }
+      }
+    }
+    if (t == te) {
+      return false;
+    }
+    if (*p == '?') {
+      if (*t == '/') {
+        return false;
+      }
+      p++;
+      t++;
+      continue;
+    }
+    if (*p == '[') {
+      bool matched = false;
+      if (match_class(p, pe, *t, matched)) {
+        if (!matched || *t == '/') {
+          return false;
+        }
+        t++;
+        continue;
+      }
+    }
+    if (*p == '\\' && p + 1 < pe) {
+      p++;
+    }
+    if (*p != *t) {
+      return false;
+    }
+    p++;
+    t++;
+  }
+  return t == te;
+}
+} // namespace
+
+bool gitignore_glob_match(std::string_view pattern, std::string_view path) {
+  return glob(pattern.data(), pattern.data() + pattern.size(), path.data(),
+              path.data() + path.size());
+}
+
+void GitIgnoreRules::add_line(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  // Trailing spaces do not count unless escaped.
+  while (!line.empty() && line.back() == ' ' &&
+         !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+    line.remove_suffix(1);
+  }
+  if (line.empty() || line[0] == '#') {
+    return;
+  }
+
+  Rule rule;
+  if (line[0] == '!') {
+    rule.negate = true;
+    line.remove_prefix(1);
+  } else if (line[0] == '\\' && line.size() > 1 &&
+             (line[1] == '#' || line[1] == '!')) {
+    line.remove_prefix(1);
+  }
+  if (!line.empty() && line.back() == '/') {
+    rule.dir_only = true;
+    line.remove_suffix(1);
+  }
+  if (!line.empty() && line[0] == '/') {
+    rule.anchored = true;
+    line.remove_prefix(1);
+  }
+  if (line.find('/') != std::string_view::npos) {
+    rule.anchored = true;
+  }
+  if (line.empty()) {
+    return;
+  }
+  rule.pattern = std::string(line);
+  rules.push_back(std::move(rule));
+}
+
+void GitIgnoreRules::add_text(std::string_view text) {
+  while (!text.empty()) {
+    const std::size_t eol = text.find('\n');
+    add_line(text.substr(0, eol));
+    if (eol == std::string_view::npos) {
+      break;
+    }
+    text.remove_prefix(eol + 1);
+  }
+}
+
+bool GitIgnoreRules::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::ostringstream text;
+  text << file.rdbuf();
+  add_text(text.str());
+  return true;
+}
+
+int GitIgnoreRules::match(std::string_view rel, bool is_dir) const {
+  const std::size_t slash = rel.rfind('/');
+  const std::string_view name =
+      slash == std::string_view::npos ? rel : rel.substr(slash + 1);
+  for (auto it = rules.rbegin(); it != rules.rend(); ++it) {
+    if (it->dir_only && !is_dir) {
+      continue;
+    }
+    if (gitignore_glob_match(it->pattern, it->anchored ? rel : name)) {
+      return it->negate ? -1 : 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef GITIGNORE_H
+#define GITIGNORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Glob matching as .gitignore uses it: `*` and `?` stop at '/', `**`
+// crosses directories, and `[...]` is a character class.
+bool gitignore_glob_match(std::string_view pattern, std::string_view path);
+
+// The rules of one .gitignore file, applied to paths relative to the
+// directory that holds it.
+class GitIgnoreRules {
+public:
+  void add_line(std::string_view line);
+  void add_text(std::string_view text);
+  // Adds the rules of the file at `path`; false when it cannot be read.
+  bool load(const std::string &path);
+  bool empty() const { return rules.empty(); }
+
+  // 1 when the last rule that applies ignores `rel`, -1 when it is a
+  // negation that brings it back, 0 when no rule applies.
+  int match(std::string_view rel, bool is_dir) const;
+
+private:
+  struct Rule {
+    std::string pattern;
+    bool negate = false;
+    bool dir_only = false;
+    bool anchored = false; // matched against the whole path, not the name
+  };
+  std::vector<Rule> rules;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "highlight_scheduler.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace {
+// Lines lexed between two publishes (and supersession checks) in the
+// settling pass.
+constexpr std::size_t kBatchLines = 1024;
+// Lines a job covers past the first unsettled one, unless the viewport
+// lies further down. Bounds the cache entries copied on the UI thread; the
+// rest of the file is covered by the jobs scheduled on later frames.
+constexpr std::size_t kJobLines = 4096;
+} // namespace
+
+HighlightScheduler::~HighlightScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    latest.store(0);
+  }
+  wake.notify_one();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+HighlightScheduler::Job
+HighlightScheduler::make_job(const LineStore &lines, SyntaxCache &cache,
+                             const std::string &extension,
+                             std::size_t viewport_begin,
+                             std::size_t viewport_end) {
+  cache.sync(lines);
+  Job job;
+  job.generation = cache.generation();
+  job.extension = extension;
+  job.first_line = std::min(cache.settled_lines(), lines.size());
+  job.entry_state =
+      job.first_line > 0 ? cache.entry(job.first_line - 1).end_state : 0;
+  job.viewport_begin = viewport_begin;
+  job.viewport_end = viewport_end;
+
+  const std::size_t last =
+      std::min(lines.size(),
+               std::max(job.first_line + kJobLines, viewport_end));
+  const std::size_t count = last - job.first_line;
+  job.lines = lines;
+  job.cached.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const SyntaxLineCache &entry = cache.entry(job.first_line + i);
+    SyntaxLineCache &key = job.cached[i];
+    key.valid = entry.valid;
+    key.line_hash = entry.line_hash;
+    key.line_length = entry.line_length;
+    key.start_state = entry.start_state;
+    key.end_state = entry.end_state;
+  }
+  return job;
+}
+
+bool HighlightScheduler::apply(const LineStore &lines, SyntaxCache &cache,
+                               Batch &batch) {
+  cache.sync(lines);
+  if (batch.generation != cache.generation()) {
+    return false;
+  }
+  for (auto &result : batch.results) {
+    cache.store(result.line, std::move(result.entry));
+  }
+  cache.settle(batch.settled_lines);
+  return !batch.results.empty();
+}
+
+void HighlightScheduler::schedule(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    latest.store(job.generation);
+    queued = std::move(job);
+    has_job = true;
+    if (!worker.joinable()) {
+      worker = std::thread(&HighlightScheduler::run, this);
+    }
+  }
+  wake.notify_one();
+}
+
+void HighlightScheduler::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+bool HighlightScheduler::busy() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return has_job || running || !published.empty();
+}
+
+bool HighlightScheduler::take(std::vector<Batch> &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (published.empty()) {
+    return false;
+  }
+  for (auto &batch : published) {
+    out.push_back(std::move(batch));
+  }
+  published.clear();
+  return true;
+}
+
+void HighlightScheduler::wait_idle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return !has_job && !running; });
+}
+
+void HighlightScheduler::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || has_job; });
+    if (stopping) {
+      return;
+    }
+    Job job = std::move(queued);
+    queued = Job();
+    has_job = false;
+    running = true;
+    lock.unlock();
+    process(job);
+    lock.lock();
+    running = false;
+    if (!has_job) {
+      idle.notify_all();
+    }
+    // The UI may have more to schedule now that busy() turns false.
+    if (ready_callback) {
+      ready_callback();
+    }
+  }
+}
+
+void HighlightScheduler::process(Job &job) {
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(job.extension);
+  const std::size_t count = job.cached.size();
+  Batch batch;
+  batch.generation = job.generation;
+  batch.settled_lines = job.first_line;
+
+  // Lexes snapshot line `i` entered in `entry` unless its cached entry
+  // already matches, and returns the state the line ends in.
+  auto lex = [&](std::size_t i, SyntaxState entry) {
+    const std::string &line = job.lines[job.first_line + i];
+    SyntaxLineCache &key = job.cached[i];
+    const std::size_t line_hash = std::hash<std::string>{}(line);
+    if (key.valid && key.line_hash == line_hash &&
+        key.line_length == line.length() && key.start_state == entry) {
+      return key.end_state;
+    }
+    SyntaxState state = entry;
+    Result result;
+    result.line = job.first_line + i;
+    result.entry.colors = highlighter.get_colors(line, state);
+    result.entry.valid = true;
+    result.entry.line_hash = line_hash;
+    result.entry.line_length = line.length();
+    result.entry.start_state = entry;
+    result.entry.end_state = state;
+    key.valid = true;
+    key.line_hash = line_hash;
+    key.line_length = line.length();
+    key.start_state = entry;
+    key.end_state = state;
+    batch.results.push_back(std::move(result));
+    return state;
+  };
+
+  // The viewport first, entered in whatever state the line above it was
+  // last known to end in. The settling pass corrects it if that was wrong.
+  const std::size_t end = job.first_line + count;
+  const std::size_t view_begin =
+      std::clamp(job.viewport_begin, job.first_line, end) - job.first_line;
+  const std::size_t view_end =
+      std::clamp(job.viewport_end, job.first_line, end) - job.first_line;
+  if (view_begin < view_end) {
+    SyntaxState state = view_begin == 0
+                            ? job.entry_state
+                            : job.cached[view_begin - 1].end_state;
+    for (std::size_t i = view_begin; i < view_end; ++i) {
+      state = lex(i, state);
+    }
+    if (!publish(batch)) {
+      return;
+    }
+  }
+
+  SyntaxState state = job.entry_state;
+  for (std::size_t i = 0; i < count; ++i) {
+    state = lex(i, state);
+    if ((i + 1) % kBatchLines == 0 || i + 1 == count) {
+      batch.settled_lines = job.first_line + i + 1;
+      if (!publish(batch)) {
+        return;
+      }
+    }
+  }
+}
+
+// Hands `batch` to the UI thread and starts a new one. Returns false when
+// a newer job has been scheduled, so the current one should stop.
+bool HighlightScheduler::publish(Batch &batch) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (latest.load() != batch.generation) {
+    return false;
+  }
+  Batch next;
+  next.generation = batch.generation;
+  next.settled_lines = batch.settled_lines;
+  published.push_back(std::move(batch));
+  batch = std::move(next);
+  if (ready_callback) {
+    ready_callback();
+  }
+  return true;
+}
@@ -0,0 +1,102 @@
+#ifndef HIGHLIGHT_SCHEDULER_H
+#define HIGHLIGHT_SCHEDULER_H
+
+#include "line_store.h"
+#include "syntax.h"
+#include "syntax_cache.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs the syntax lexer on a worker thread so the renderer never has to.
+//
+// A job is a snapshot of the buffer, a LineStore copy sharing its blocks
+// (O(blocks) on the UI thread), plus the cached entries (without colors)
+// of the next lines the SyntaxCache has not settled yet. The worker lexes
+// the visible viewport first, entered in the state cached for the line
+// above it, and publishes that right away. It then walks forward from the
+// first unsettled line carrying the real state, re-lexing only lines whose
+// content or entry state differ from the cached ones, and publishes in
+// batches as it goes. The UI thread moves batches into the cache with
+// apply() on its next frame; lines not published yet are drawn without
+// colors.
+//
+// Scheduling a new job supersedes the running one, which stops at its next
+// batch boundary.
+class HighlightScheduler {
+public:
+  struct Job {
+    std::uint64_t generation = 0; // SyntaxCache::generation() at snapshot
+    std::string extension;
+    std::size_t first_line = 0;   // buffer line of cached[0]
+    SyntaxState entry_state = 0;  // state first_line is entered in
+    LineStore lines;              // the whole buffer
+    std::vector<SyntaxLineCache> cached; // from first_line on, no colors
+    std::size_t viewport_begin = 0;      // buffer lines, end exclusive
+    std::size_t viewport_end = 0;
+  };
+
+  struct Result {
+    std::size_t line = 0;
+    SyntaxLineCache entry;
+  };
+
+  struct Batch {
+    std::uint64_t generation = 0;
+    std::vector<Result> results;
+    std::size_t settled_lines = 0; // lines before this one are final
+  };
+
+  HighlightScheduler() = default;
+  ~HighlightScheduler();
+  HighlightScheduler(const HighlightScheduler &) = delete;
+  HighlightScheduler &operator=(const HighlightScheduler &) = delete;
+
+  // Snapshots the next lines of `cache` that are not settled yet, at least
+  // through the end of the viewport.
+  static Job make_job(const LineStore &lines, SyntaxCache &cache,
+                      const std::string &extension,
+                      std::size_t viewport_begin, std::size_t viewport_end);
+  // Stores `batch` into `cache` if it was computed for the cache's current
+  // generation. Returns true when any entry changed.
+  static bool apply(const LineStore &lines, SyntaxCache &cache, Batch &batch);
+
+  // Runs on the worker after each publish and when it runs out of work,
+  // under the scheduler's lock: it must not call back into the scheduler,
+  // and once set_ready_callback() returns the old callback is not running.
+  void set_ready_callback(std::function<void()> callback);
+  void schedule(Job job);
+  // Generation of the most recently scheduled job, 0 before the first.
+  std::uint64_t scheduled_generation() const { return latest.load(); }
+  // True while a job is queued or running, or batches wait to be taken.
+  bool busy() const;
+  // Moves the batches published so far into `out`. Returns false if none.
+  bool take(std::vector<Batch> &out);
+  // Blocks until the worker has nothing left to do.
+  void wait_idle();
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::thread worker;
+  std::function<void()> ready_callback;
+  bool stopping = false;
+  bool has_job = false;
+  bool running = false;
+  Job queued;
+  std::vector<Batch> published;
+  std::atomic<std::uint64_t> latest{0};
+
+  void run();
+  void process(Job &job);
+  bool publish(Batch &batch);
+};
+
+#endif
@@ -77,7 +77,9 @@ void HostCoreAPI::set_buffer_content(const std::string &text) {
     return;
   }
 
-  editor.save_state();
+  if (!editor.save_state()) {
+    return;
+  }
   FileBuffer &buf = editor.get_buffer();
   buf.lines.clear();
 
@@ -29,7 +29,16 @@ void Editor::activate_integrated_terminal(int index, bool focus) {
 
 void Editor::create_integrated_terminal() {
   show_home_menu = false;
-  auto term = std::make_unique<IntegratedTerminal>();
+  auto term =
+      std::make_unique<IntegratedTerminal>(integrated_terminal_scrollback);
+  // Shell output is parsed off the UI thread, which redraws at most once a
+  // frame for it.
+  term->set_ready_callback([this] { terminal.wake(); });
+  term->set_refresh_interval_ms(std::max(1, 1000 / render_fps));
+  // Start the shell at the panel's size so it does not redraw right away.
+  int panel_h = std::clamp(integrated_terminal_height, 5,
+                           std::max(5, ui->get_height() / 2));
+  term->resize(std::max(1, ui->get_width() - 2), std::max(1, panel_h - 3));
   if (!term->open_shell()) {
     set_message("Failed to open integrated terminal");
     return;
@@ -279,22 +288,13 @@ void Editor::place_integrated_terminal_cursor() {
   int content_w = std::max(1, panel_w - 2);
   int content_h = std::max(1, panel_h - 3);
 
-  auto lines = term->get_recent_lines(content_h);
-  int cursor_line_index = std::max(0, (int)lines.size() - 1);
-  int cursor_y = panel_y + 2 + std::min(cursor_line_index, content_h - 1);
-
-  const std::string &line = term->get_current_line();
-  size_t display_start = 0;
-  if ((int)line.size() > content_w) {
-    display_start = line.size() - (size_t)content_w;
-  }
-
-  size_t cursor_column = term->get_cursor_column();
-  if (cursor_column < display_start) {
-    cursor_column = display_start;
+  int cursor_row = term->get_cursor_row(content_h);
+  if (cursor_row < 0) {
+    return;
   }
-  int cursor_x = 1 + (int)std::min((size_t)(content_w - 1),
-                                   cursor_column - display_start);
+  int cursor_y = panel_y + 2 + cursor_row;
+  int cursor_x =
+      1 + (int)std::min((size_t)(content_w - 1), term->get_cursor_column());
 
   ui->set_cursor(cursor_x, cursor_y);
 }
@@ -355,56 +355,34 @@ void Editor::render_integrated_terminal() {
   }
 
   int content_h = std::max(1, panel_h - 3);
-  auto lines = term->get_recent_lines(content_h);
-  auto styled_lines = term->get_recent_styled_lines(content_h);
-  auto all_blank = [](const std::vector<std::string> &v) {
-    for (const auto &s : v) {
-      if (!s.empty()) {
-        return false;
-      }
+  int max_cols = std::max(1, panel_w - 2);
+  term->resize(max_cols, content_h);
+  auto screen_lock = term->lock_screen();
+  auto rows = term->view(content_h);
+  bool blank = true;
+  for (CellSpan row : rows) {
+    if (row.width > 0) {
+      blank = false;
+      break;
     }
-    return true;
-  };
-  if (term->is_active() && lines.size() == 1 && lines.front().empty()) {
-    lines.front() = "[terminal ready]  (Esc: unfocus, Ctrl+X: toggle)";
-  }
-  if (!term->is_active() && (lines.empty() || all_blank(lines))) {
-    lines.clear();
-    lines.push_back("[terminal inactive: shell failed or exited]");
-    lines.push_back("[try :terminalnew or check $SHELL]");
   }
   int start_y = panel_y + 2;
-  int start = std::max(0, (int)lines.size() - content_h);
-  for (int i = 0; i < content_h; i++) {
-    int idx = start + i;
-    if (idx >= (int)lines.size()) {
-      break;
-    }
-    std::string line = lines[idx];
-    int max_cols = std::max(1, panel_w - 2);
-    int trim_from = std::max(0, (int)line.size() - max_cols);
-    if ((int)line.size() > max_cols) {
-      line = line.substr(trim_from);
-    }
-
-    bool drew_styled = false;
-    if (idx >= 0 && idx < (int)styled_lines.size()) {
-      auto &styled = styled_lines[idx];
-      if (!styled.empty()) {
-        int sx = 1;
-        int start_cell = std::max(0, (int)styled.size() - max_cols);
-        for (int j = start_cell; j < (int)styled.size() && sx < 1 + max_cols; j++) {
-          int fg = std::clamp(styled[j].fg, 0, 255);
-          int bg = std::clamp(styled[j].bg, 0, 255);
-          ui->draw_text(sx, start_y + i, styled[j].ch, fg, bg);
-          sx++;
-        }
-        drew_styled = true;
-      }
+  if (blank) {
+    std::vector<std::string> notes;
+    if (term->is_active()) {
+      notes.push_back("[terminal ready]  (Esc: unfocus, Ctrl+X: toggle)");
+    } else {
+      notes.push_back("[terminal inactive: shell failed or exited]");
+      notes.push_back("[try :terminalnew or check $SHELL]");
     }
-
-    if (!drew_styled) {
-      ui->draw_text(1, start_y + i, line, term_fg, term_bg);
+    for (int i = 0; i < (int)notes.size() && i < content_h; i++) {
+      ui->draw_text(1, start_y + i, notes[i].substr(0, (size_t)max_cols),
+                    term_fg, term_bg);
     }
+    return;
+  }
+  for (int i = 0; i < rows.size(); i++) {
+    CellSpan row = rows[i];
+    ui->draw_cells(1, start_y + i, row.cells, row.width, max_cols);
   }
 }
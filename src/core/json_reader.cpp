@@ -0,0 +1,377 @@
+#include "json_reader.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr std::size_t kArenaBlock = 16 * 1024;
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return 10 + c - 'a';
+  if (c >= 'A' && c <= 'F')
+    return 10 + c - 'A';
+  return -1;
+}
+
+bool read_hex4(const char *&pos, const char *end, unsigned int &out) {
+  if (end - pos < 4) {
+    return false;
+  }
+  out = 0;
+  for (int i = 0; i < 4; i++) {
+    const int digit = hex_value(*pos++);
+    if (digit < 0) {
+      return false;
+    }
+    out = (out << 4) | (unsigned int)digit;
+  }
+  return true;
+}
+
+char *put_utf8(char *out, unsigned int codepoint) {
+  if (codepoint <= 0x7F) {
+    *out++ = (char)codepoint;
+  } else if (codepoint <= 0x7FF) {
+    *out++ = (char)(0xC0 | (codepoint >> 6));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  } else if (codepoint <= 0xFFFF) {
+    *out++ = (char)(0xE0 | (codepoint >> 12));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  } else {
+    *out++ = (char)(0xF0 | (codepoint >> 18));
+    *out++ = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  }
+  return out;
+}
+} // namespace
+
+JsonReader::JsonReader(std::string_view text)
+    : pos(text.data()), end(text.data() + text.size()) {}
+
+void JsonReader::skip_ws() {
+  while (pos < end &&
+         (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+    pos++;
+  }
+}
+
+bool JsonReader::fail() {
+  error = true;
+  pos = end;
+  return false;
+}
+
+JsonReader::Type JsonReader::peek() {
+  skip_ws();
+  if (error || pos >= end) {
+    return Invalid;
+  }
+  switch (*pos) {
+  case '{':
+    return Object;
+  case '[':
+    return Array;
+  case '"':
+    return String;
+  case 't':
+  case 'f':
+    return Bool;
+  case 'n':
+    return Null;
+  default:
+    return (*pos == '-' || (*pos >= '0' && *pos <= '9')) ? Number : Invalid;
+  }
+}
+
+bool JsonReader::begin_object() {
+  if (peek() != Object) {
+    return fail();
+  }
+  pos++;
+  return true;
+}
+
+bool JsonReader::next_key(std::string_view &key) {
+  skip_ws();
+  if (error || pos >= end) {
+    return fail();
+  }
+  if (*pos == '}') {
+    pos++;
+    return false;
+  }
+  if (*pos == ',') {
+    pos++;
+    skip_ws();
+  }
+  if (!read_string(key)) {
+    return false;
+  }
+  skip_ws();
+  if (pos >= end || *pos != ':') {
+    return fail();
+  }
+  pos++;
+  return true;
+}
+
+bool JsonReader::begin_array() {
+  if (peek() != Array) {
+    return fail();
+  }
+  pos++;
+  return true;
+}
+
+bool JsonReader::next_element() {
+  skip_ws();
+  if (error || pos >= end) {
+    return fail();
+  }
+  if (*pos == ']') {
+    pos++;
+    return false;
+  }
+  if (*pos == ',') {
+    pos++;
+  }
+  return true;
+}
+
+bool JsonReader::read_string(std::string_view &out) {
+  if (peek() != String) {
+    return fail();
+  }
+  const char *first = ++pos;
+  while (pos < end && *pos != '"' && *pos != '\\') {
+    pos++;
+  }
+  if (pos >= end) {
+    return fail();
+  }
+  if (*pos == '"') {
+    out = std::string_view(first, (std::size_t)(pos - first));
+    pos++;
+    return true;
+  }
+  return decode_string(first, out);
+}
+
+// Slow path of read_string() for strings with escapes. The decoded text
+// is never longer than the raw text, so the raw length bounds the arena
+// allocation.
+bool JsonReader::decode_string(const char *first, std::string_view &out) {
+  const char *raw_end = pos;
+  while (raw_end < end && *raw_end != '"') {
+    raw_end += *raw_end == '\\' ? 2 : 1;
+  }
+  if (raw_end >= end) {
+    return fail();
+  }
+
+  char *buffer = allocate((std::size_t)(raw_end - first));
+  char *out_pos = buffer;
+  const std::size_t plain = (std::size_t)(pos - first);
+  std::memcpy(out_pos, first, plain);
+  out_pos += plain;
+
+  while (pos < raw_end) {
+    const char c = *pos++;
+    if (c != '\\') {
+      *out_pos++ = c;
+      continue;
+    }
+    const char esc = *pos++;
+    switch (esc) {
+    case '"':
+    case '\\':
+    case '/':
+      *out_pos++ = esc;
+      break;
+    case 'b':
+      *out_pos++ = '\b';
+      break;
+    case 'f':
+      *out_pos++ = '\f';
+      break;
+    case 'n':
+      *out_pos++ = '\n';
+      break;
+    case 'r':
+      *out_pos++ = '\r';
+      break;
+    case 't':
+      *out_pos++ = '\t';
+      break;
+    case 'u': {
+      unsigned int codepoint = 0;
+      if (!read_hex4(pos, raw_end, codepoint)) {
+        return fail();
+      }
+      if (codepoint >= 0xD800 && codepoint <= 0xDBFF && raw_end - pos >= 6 &&
+          pos[0] == '\\' && pos[1] == 'u') {
+        const char *low_pos = pos + 2;
+        unsigned int low = 0;
+        if (read_hex4(low_pos, raw_end, low) && low >= 0xDC00 &&
+            low <= 0xDFFF) {
+          codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          pos = low_pos;
+        }
+      }
+      out_pos = put_utf8(out_pos, codepoint);
+      break;
+    }
+    default:
+      return fail();
+    }
+  }
+  pos = raw_end + 1;
+  out = std::string_view(buffer, (std::size_t)(out_pos - buffer));
+  return true;
+}
+
+char *JsonReader::allocate(std::size_t size) {
+  if (size > kArenaBlock / 4) {
+    // Large strings get a block of their own so the shared one is kept.
+    arena.emplace_back(new char[size]);
+    char *block = arena.back().get();
+    if (arena.size() > 1) {
+      std::swap(arena[arena.size() - 1], arena[arena.size() - 2]);
+    }
+    return block;
+  }
+  if (arena.empty() || arena_capacity - arena_used < size) {
+    arena.emplace_back(new char[kArenaBlock]);
+    arena_used = 0;
+    arena_capacity = kArenaBlock;
+  }
+  char *out = arena.back().get() + arena_used;
+  arena_used += size;
+  return out;
+}
+
+bool JsonReader::read_int(long long &out) {
+  if (peek() != Number) {
+    return fail();
+  }
+  const bool negative = *pos == '-';
+  if (negative) {
+    pos++;
+  }
+  if (pos >= end || *pos < '0' || *pos > '9') {
+    return fail();
+  }
+  // Accumulated unsigned so the most negative value fits too.
+  const unsigned long long limit =
+      negative ? (unsigned long long)LLONG_MAX + 1 : LLONG_MAX;
+  unsigned long long value = 0;
+  while (pos < end && *pos >= '0' && *pos <= '9') {
+    const unsigned digit = (unsigned)(*pos++ - '0');
+    if (value > (limit - digit) / 10) {
+      return fail();
+    }
+    value = value * 10 + digit;
+  }
+  while (pos < end && ((*pos >= '0' && *pos <= '9') || *pos == '.' ||
+                       *pos == 'e' || *pos == 'E' || *pos == '+' ||
+                       *pos == '-')) {
+    pos++;
+  }
+  out = negative ? (long long)(0 - value) : (long long)value;
+  return true;
+}
+
+bool JsonReader::read_bool(bool &out) {
+  if (peek() != Bool) {
+    return fail();
+  }
+  if (end - pos >= 4 && std::memcmp(pos, "true", 4) == 0) {
+    out = true;
+    pos += 4;
+    return true;
+  }
+  if (end - pos >= 5 && std::memcmp(pos, "false", 5) == 0) {
+    out = false;
+    pos += 5;
+    return true;
+  }
+  return fail();
+}
+
+bool JsonReader::skip_string() {
+  pos++;
+  while (pos < end) {
+    const char c = *pos++;
+    if (c == '"') {
+      return true;
+    }
+    if (c == '\\') {
+      pos++;
+    }
+  }
+  return fail();
+}
+
+bool JsonReader::skip() {
+  switch (peek()) {
+  case String:
+    return skip_string();
+  case Object:
+  case Array: {
+    // Only brackets and string boundaries matter when skipping a
+    // container; its contents are not checked.
+    int depth = 0;
+    while (pos < end) {
+      const char c = *pos;
+      if (c == '"') {
+        if (!skip_string()) {
+          return false;
+        }
+        continue;
+      }
+      pos++;
+      if (c == '{' || c == '[') {
+        depth++;
+      } else if (c == '}' || c == ']') {
+        if (--depth == 0) {
+          return true;
+        }
+      }
+    }
+    return fail();
+  }
+  case Number: {
+    long long ignored = 0;
+    return read_int(ignored);
+  }
+  case Bool: {
+    bool ignored = false;
+    return read_bool(ignored);
+  }
+  case Null:
+    if (end - pos >= 4 && std::memcmp(pos, "null", 4) == 0) {
+      pos += 4;
+      return true;
+    }
+    return fail();
+  default:
+    return fail();
+  }
+}
+
+bool JsonReader::skip(std::string_view &raw) {
+  skip_ws();
+  const char *first = pos;
+  if (!skip()) {
+    return false;
+  }
+  raw = std::string_view(first, (std::size_t)(pos - first));
+  return true;
+}
@@ -0,0 +1,66 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Pull reader over one JSON text, for messages where only a few fields
+// matter. Nothing is built up front: the caller walks objects and arrays
+// with next_key()/next_element(), reads the values it wants and skip()s
+// the rest, which scans past nested containers without decoding them.
+//
+// Strings come back as views into the input. A string containing escapes
+// is decoded into the reader's arena instead, so every view stays valid
+// for as long as both the input and the reader live.
+//
+// Errors are sticky: after malformed input every call returns false, so
+// loops over next_key()/next_element() simply end and failed() reports it.
+class JsonReader {
+public:
+  enum Type { Invalid, Null, Bool, Number, String, Array, Object };
+
+  explicit JsonReader(std::string_view text);
+
+  // Type of the next value, without consuming it.
+  Type peek();
+
+  // Objects: begin_object(), then `while (next_key(key))` read or skip one
+  // value per key. next_key() returns false once the object is closed.
+  bool begin_object();
+  bool next_key(std::string_view &key);
+  // Arrays: begin_array(), then `while (next_element())` read or skip one
+  // value per element.
+  bool begin_array();
+  bool next_element();
+
+  bool read_string(std::string_view &out);
+  // Integral part of a number; fractions and exponents are skipped. Fails
+  // when it does not fit.
+  bool read_int(long long &out);
+  bool read_bool(bool &out);
+  bool skip();
+  // Skips one value and returns its raw text, to be read again later with
+  // another reader.
+  bool skip(std::string_view &raw);
+
+  bool failed() const { return error; }
+
+private:
+  const char *pos;
+  const char *end;
+  bool error = false;
+  // Decoded escaped strings, in blocks that never move.
+  std::vector<std::unique_ptr<char[]>> arena;
+  std::size_t arena_used = 0;
+  std::size_t arena_capacity = 0;
+
+  void skip_ws();
+  bool fail();
+  bool skip_string();
+  bool decode_string(const char *first, std::string_view &out);
+  char *allocate(std::size_t size);
+};
+
+#endif
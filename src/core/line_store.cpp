@@ -0,0 +1,497 @@
+#include "line_store.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+// Blocks split when they grow past kMaxBlockLines and merge with a
+// neighbour when they shrink below kMinBlockLines, so every edit touches a
+// bounded number of strings.
+constexpr std::size_t kMaxBlockLines = 1024;
+constexpr std::size_t kMinBlockLines = kMaxBlockLines / 8;
+// Edits kept for journal readers; a reader further behind starts over.
+constexpr std::size_t kJournalLimit = 256;
+
+std::size_t lowbit(std::size_t i) { return i & (~i + 1); }
+} // namespace
+
+LineStore::LineStore(std::initializer_list<std::string> lines)
+    : LineStore(std::vector<std::string>(lines)) {}
+
+LineStore::LineStore(std::vector<std::string> lines) {
+  *this = std::move(lines);
+}
+
+// Copies share the blocks and get a journal of their own: an id shared
+// between two stores would let a cache built for one replay the other's
+// edits.
+LineStore::LineStore(const LineStore &other)
+    : blocks(other.blocks), tree(other.tree), total(other.total) {}
+
+LineStore::LineStore(LineStore &&other) noexcept
+    : blocks(std::move(other.blocks)), tree(std::move(other.tree)),
+      total(other.total), journal_id_(other.journal_id_),
+      journal_version_(other.journal_version_), revision_(other.revision_),
+      journal(std::move(other.journal)), touch_count_(other.touch_count_),
+      touches(std::move(other.touches)) {
+  other.clear();
+}
+
+LineStore &LineStore::operator=(const LineStore &other) {
+  if (this != &other) {
+    blocks = other.blocks;
+    tree = other.tree;
+    total = other.total;
+    cached_block = kNoBlock;
+    reset_journal();
+  }
+  return *this;
+}
+
+LineStore &LineStore::operator=(LineStore &&other) noexcept {
+  if (this != &other) {
+    blocks = std::move(other.blocks);
+    tree = std::move(other.tree);
+    total = other.total;
+    cached_block = kNoBlock;
+    reset_journal();
+    other.clear();
+  }
+  return *this;
+}
+
+LineStore &LineStore::operator=(std::vector<std::string> lines) {
+  clear();
+  insert_lines(0, std::move(lines));
+  return *this;
+}
+
+std::uint64_t LineStore::next_journal_id() {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LineStore::record(std::size_t index, long long count) {
+  if (journal.size() >= kJournalLimit) {
+    journal.erase(journal.begin(), journal.begin() + kJournalLimit / 2);
+  }
+  journal.push_back({index, count});
+  ++journal_version_;
+  ++revision_;
+}
+
+void LineStore::reset_journal() {
+  journal_id_ = next_journal_id();
+  journal_version_ = 0;
+  journal.clear();
+  touch_count_ = 0;
+  touches.clear();
+  ++revision_;
+}
+
+void LineStore::add_touch(std::size_t index) {
+  if (touches.size() >= kJournalLimit) {
+    touches.erase(touches.begin(), touches.begin() + kJournalLimit / 2);
+  }
+  touches.push_back({journal_version_, index, index + 1, revision_});
+  ++touch_count_;
+}
+
+bool LineStore::touches_since(std::uint64_t count,
+                              std::vector<Touch> &out) const {
+  const std::uint64_t from = count > 0 ? count - 1 : 0;
+  if (from > touch_count_ || touch_count_ - from > touches.size()) {
+    return false;
+  }
+  out.insert(out.end(), touches.end() - (touch_count_ - from), touches.end());
+  return true;
+}
+
+bool LineStore::edits_since(std::uint64_t version,
+                            std::vector<Edit> &out) const {
+  if (version > journal_version_ ||
+      journal_version_ - version > journal.size()) {
+    return false;
+  }
+  out.insert(out.end(), journal.end() - (journal_version_ - version),
+             journal.end());
+  return true;
+}
+
+LineStore::Block &LineStore::own(std::size_t block) {
+  std::shared_ptr<Block> &shared = blocks[block];
+  if (shared.use_count() > 1) {
+    shared = std::make_shared<Block>(*shared);
+  } else {
+    // Pairs with the release in another store's reference drop, so its
+    // reads of the block are done before this writes it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return *shared;
+}
+
+std::string &LineStore::mut(std::size_t index) {
+  touch(index);
+  const auto where = locate(index);
+  return own(where.first)[where.second];
+}
+
+void LineStore::set(std::size_t index, std::string line) {
+  if ((*this)[index] != line) {
+    mut(index) = std::move(line);
+  }
+}
+
+const std::string &LineStore::operator[](std::size_t index) const {
+  const auto where = locate(index);
+  return (*blocks[where.first])[where.second];
+}
+
+std::pair<std::size_t, std::size_t>
+LineStore::locate(std::size_t index) const {
+  // Most lookups walk lines in order (rendering, search, save), so try the
+  // block of the previous lookup and its successor before descending.
+  if (cached_block < blocks.size() && index >= cached_start) {
+    const std::size_t offset = index - cached_start;
+    const std::size_t size = blocks[cached_block]->size();
+    if (offset < size) {
+      return {cached_block, offset};
+    }
+    if (cached_block + 1 < blocks.size() &&
+        offset - size < blocks[cached_block + 1]->size()) {
+      cached_block++;
+      cached_start += size;
+      return {cached_block, offset - size};
+    }
+  }
+
+  // Fenwick descent: find the last block whose prefix sum is <= index.
+  const std::size_t original_index = index;
+  std::size_t block = 0;
+  std::size_t step = 1;
+  while (step * 2 <= blocks.size()) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    const std::size_t next = block + step;
+    if (next < tree.size() && tree[next] <= index) {
+      block = next;
+      index -= tree[next];
+    }
+  }
+  cached_block = block;
+  cached_start = original_index - index;
+  return {block, index};
+}
+
+void LineStore::tree_add(std::size_t block, long long delta) {
+  cached_block = kNoBlock;
+  for (std::size_t i = block + 1; i < tree.size(); i += lowbit(i)) {
+    tree[i] = (std::size_t)((long long)tree[i] + delta);
+  }
+}
+
+void LineStore::tree_append(std::size_t size) {
+  cached_block = kNoBlock;
+  if (tree.empty()) {
+    tree.push_back(0);
+  }
+  // Node n covers blocks (n - lowbit(n), n]; the covered nodes below n are
+  // exactly the chain n-1, n-1 - lowbit(n-1), ... down to n - lowbit(n).
+  const std::size_t n = tree.size();
+  std::size_t sum = size;
+  for (std::size_t i = n - 1; i > n - lowbit(n); i -= lowbit(i)) {
+    sum += tree[i];
+  }
+  tree.push_back(sum);
+}
+
+void LineStore::rebuild_tree() {
+  cached_block = kNoBlock;
+  tree.assign(blocks.size() + 1, 0);
+  for (std::size_t i = 1; i < tree.size(); ++i) {
+    tree[i] += blocks[i - 1]->size();
+    const std::size_t parent = i + lowbit(i);
+    if (parent < tree.size()) {
+      tree[parent] += tree[i];
+    }
+  }
+}
+
+// Splits, drops or merges `block` when it is outside the size bounds.
+// Returns true if the block layout changed and the index was rebuilt.
+bool LineStore::rebalance(std::size_t block) {
+  const std::size_t size = blocks[block]->size();
+  if (size > kMaxBlockLines) {
+    Block &lines = own(block);
+    std::vector<std::shared_ptr<Block>> pieces;
+    const std::size_t half = kMaxBlockLines / 2;
+    for (std::size_t start = 0; start < lines.size(); start += half) {
+      const std::size_t end = std::min(lines.size(), start + half);
+      pieces.push_back(std::make_shared<Block>(
+          std::make_move_iterator(lines.begin() + start),
+          std::make_move_iterator(lines.begin() + end)));
+    }
+    blocks.erase(blocks.begin() + block);
+    blocks.insert(blocks.begin() + block,
+                  std::make_move_iterator(pieces.begin()),
+                  std::make_move_iterator(pieces.end()));
+    rebuild_tree();
+    return true;
+  }
+
+  if (size == 0) {
+    blocks.erase(blocks.begin() + block);
+    rebuild_tree();
+    return true;
+  }
+
+  if (size < kMinBlockLines && blocks.size() > 1) {
+    const std::size_t other = block + 1 < blocks.size() ? block + 1 : block - 1;
+    const std::size_t first = std::min(block, other);
+    if (blocks[first]->size() + blocks[first + 1]->size() <= kMaxBlockLines) {
+      Block &left = own(first);
+      if (blocks[first + 1].use_count() > 1) {
+        const Block &right = *blocks[first + 1];
+        left.insert(left.end(), right.begin(), right.end());
+      } else {
+        Block &right = own(first + 1);
+        left.insert(left.end(), std::make_move_iterator(right.begin()),
+                    std::make_move_iterator(right.end()));
+      }
+      blocks.erase(blocks.begin() + first + 1);
+      rebuild_tree();
+      return true;
+    }
+  }
+  return false;
+}
+
+void LineStore::push_back(std::string line) {
+  record(total, 1);
+  if (blocks.empty() || blocks.back()->size() >= kMaxBlockLines) {
+    blocks.push_back(std::make_shared<Block>());
+    blocks.back()->reserve(kMaxBlockLines);
+    blocks.back()->push_back(std::move(line));
+    tree_append(1);
+  } else {
+    own(blocks.size() - 1).push_back(std::move(line));
+    tree_add(blocks.size() - 1, 1);
+  }
+  ++total;
+}
+
+void LineStore::append(std::vector<std::string> lines) {
+  if (lines.empty()) {
+    return;
+  }
+  record(total, (long long)lines.size());
+  auto next = std::make_move_iterator(lines.begin());
+  const auto end = std::make_move_iterator(lines.end());
+  if (!blocks.empty() && blocks.back()->size() < kMaxBlockLines) {
+    Block &last = own(blocks.size() - 1);
+    const std::size_t take =
+        std::min(lines.size(), kMaxBlockLines - last.size());
+    last.insert(last.end(), next, next + take);
+    tree_add(blocks.size() - 1, (long long)take);
+    next += take;
+  }
+  while (next != end) {
+    const std::size_t take =
+        std::min((std::size_t)(end - next), kMaxBlockLines);
+    blocks.push_back(std::make_shared<Block>());
+    blocks.back()->reserve(kMaxBlockLines);
+    blocks.back()->insert(blocks.back()->end(), next, next + take);
+    tree_append(take);
+    next += take;
+  }
+  total += lines.size();
+}
+
+void LineStore::pop_back() {
+  record(total - 1, -1);
+  own(blocks.size() - 1).pop_back();
+  --total;
+  if (blocks.back()->empty()) {
+    blocks.pop_back();
+    tree.pop_back();
+    cached_block = kNoBlock;
+  } else {
+    tree_add(blocks.size() - 1, -1);
+  }
+}
+
+void LineStore::clear() {
+  reset_journal();
+  cached_block = kNoBlock;
+  blocks.clear();
+  tree.clear();
+  total = 0;
+}
+
+void LineStore::swap(LineStore &other) {
+  blocks.swap(other.blocks);
+  tree.swap(other.tree);
+  std::swap(total, other.total);
+  cached_block = kNoBlock;
+  other.cached_block = kNoBlock;
+  reset_journal();
+  other.reset_journal();
+}
+
+LineStore::iterator LineStore::insert(const_iterator pos, std::string line) {
+  const std::size_t index = pos.index();
+  if (index >= total) {
+    push_back(std::move(line));
+    return iterator(this, index);
+  }
+
+  record(index, 1);
+  const auto where = locate(index);
+  Block &lines = own(where.first);
+  lines.insert(lines.begin() + where.second, std::move(line));
+  ++total;
+  if (!rebalance(where.first)) {
+    tree_add(where.first, 1);
+  }
+  return iterator(this, index);
+}
+
+LineStore::iterator LineStore::insert_lines(std::size_t index,
+                                            std::vector<std::string> lines) {
+  if (lines.empty()) {
+    return iterator(this, index);
+  }
+  if (index >= total) {
+    append(std::move(lines));
+    return iterator(this, index);
+  }
+
+  record(index, (long long)lines.size());
+  const auto where = locate(index);
+  Block &block = own(where.first);
+  total += lines.size();
+  block.insert(block.begin() + where.second,
+               std::make_move_iterator(lines.begin()),
+               std::make_move_iterator(lines.end()));
+  if (!rebalance(where.first)) {
+    tree_add(where.first, (long long)lines.size());
+  }
+  return iterator(this, index);
+}
+
+LineStore::iterator LineStore::erase(const_iterator pos) {
+  return erase(pos, pos + 1);
+}
+
+LineStore::iterator LineStore::erase(const_iterator first,
+                                     const_iterator last) {
+  const std::size_t begin_index = first.index();
+  std::size_t remaining = last.index() - begin_index;
+  if (remaining == 0) {
+    return iterator(this, begin_index);
+  }
+  record(begin_index, -(long long)remaining);
+
+  auto where = locate(begin_index);
+  const std::size_t first_block = where.first;
+  if (where.second + remaining <= blocks[first_block]->size()) {
+    Block &lines = own(first_block);
+    lines.erase(lines.begin() + where.second,
+                lines.begin() + where.second + remaining);
+    total -= remaining;
+    if (!rebalance(first_block)) {
+      tree_add(first_block, -(long long)remaining);
+    }
+    return iterator(this, begin_index);
+  }
+
+  // The range spans blocks: trim the first, drop whole blocks in the middle,
+  // trim the last, then rebuild the index once.
+  std::size_t block = first_block;
+  std::size_t offset = where.second;
+  total -= remaining;
+  while (remaining > 0) {
+    const std::size_t take =
+        std::min(remaining, blocks[block]->size() - offset);
+    if (offset == 0 && take == blocks[block]->size()) {
+      // Dropped whole below; a shared block need not be copied first.
+      blocks[block] = std::make_shared<Block>();
+    } else {
+      Block &lines = own(block);
+      lines.erase(lines.begin() + offset, lines.begin() + offset + take);
+    }
+    remaining -= take;
+    offset = 0;
+    ++block;
+  }
+  blocks.erase(std::remove_if(blocks.begin() + first_block,
+                              blocks.begin() + block,
+                              [](const std::shared_ptr<Block> &lines) {
+                                return lines->empty();
+                              }),
+               blocks.begin() + block);
+  rebuild_tree();
+  if (first_block < blocks.size()) {
+    rebalance(first_block);
+  }
+  return iterator(this, begin_index);
+}
+
+std::size_t LineStore::byte_size() const {
+  std::size_t bytes = 0;
+  for (const auto &lines : blocks) {
+    for (const auto &line : *lines) {
+      bytes += line.size();
+    }
+  }
+  return bytes;
+}
+
+std::string LineStore::join(char separator) const {
+  std::string text;
+  text.reserve(byte_size() + (total > 0 ? total - 1 : 0));
+  bool first = true;
+  for (const auto &lines : blocks) {
+    for (const auto &line : *lines) {
+      if (!first) {
+        text.push_back(separator);
+      }
+      text.append(line);
+      first = false;
+    }
+  }
+  return text;
+}
+
+std::vector<std::string> LineStore::to_vector() const {
+  std::vector<std::string> lines;
+  lines.reserve(total);
+  for (const auto &block : blocks) {
+    lines.insert(lines.end(), block->begin(), block->end());
+  }
+  return lines;
+}
+
+bool LineStore::operator==(const LineStore &other) const {
+  if (total != other.total) {
+    return false;
+  }
+  // Blocks still shared with a copy are equal without reading them.
+  const bool same_layout =
+      blocks.size() == other.blocks.size() &&
+      std::equal(blocks.begin(), blocks.end(), other.blocks.begin(),
+                 [](const std::shared_ptr<Block> &a,
+                    const std::shared_ptr<Block> &b) {
+                   return a->size() == b->size();
+                 });
+  if (!same_layout) {
+    return std::equal(begin(), end(), other.begin());
+  }
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    if (blocks[i] != other.blocks[i] && *blocks[i] != *other.blocks[i]) {
+      return false;
+    }
+  }
+  return true;
+}
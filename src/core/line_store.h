@@ -0,0 +1,313 @@
+#ifndef LINE_STORE_H
+#define LINE_STORE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Text storage behind FileBuffer::lines. Lines live in bounded blocks (a
+// one-level rope) and a Fenwick tree over block sizes maps a line number to
+// its block in O(log N), so inserting or erasing a line only shifts the
+// lines of one block instead of the rest of the file.
+//
+// The interface mirrors the parts of std::vector<std::string> the editor
+// uses, except that reads and writes are told apart: operator[], front(),
+// back() and begin()/end() only read, and a line is changed through set()
+// or mut(), or through mut_begin()/mut_end() for the <algorithm> calls made
+// by sort/reverse/rotate commands. Like vector, any insert or erase
+// invalidates iterators.
+//
+// Inserts and erases are also recorded in a short journal so caches indexed
+// by line number (SyntaxCache) can shift their entries instead of starting
+// over. Writes to a line change content only and are not journaled; they
+// go to a separate touch log instead, for caches that need to know which
+// lines may have changed (MatchIndex).
+//
+// Blocks are shared between copies and copied on their first write, so a
+// copy costs O(blocks): cheap enough to hand another thread a snapshot to
+// read (SavePipeline) while the editor goes on changing the original.
+class LineStore {
+public:
+  template <bool Const> class basic_iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::string;
+    using difference_type = std::ptrdiff_t;
+    using store_type = typename std::conditional<Const, const LineStore,
+                                                 LineStore>::type;
+    using reference =
+        typename std::conditional<Const, const std::string &,
+                                  std::string &>::type;
+    using pointer = typename std::conditional<Const, const std::string *,
+                                              std::string *>::type;
+
+    basic_iterator() = default;
+    basic_iterator(store_type *store, std::size_t pos)
+        : store(store), pos(pos) {
+      seek();
+    }
+    template <bool C = Const, typename = typename std::enable_if<C>::type>
+    basic_iterator(const basic_iterator<false> &other)
+        : store(other.store), pos(other.pos), block(other.block),
+          offset(other.offset) {}
+
+    reference operator*() const { return line(store, pos, block, offset); }
+    pointer operator->() const { return &**this; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    basic_iterator &operator++() {
+      ++pos;
+      if (++offset >= store->blocks[block]->size()) {
+        ++block;
+        offset = 0;
+      }
+      return *this;
+    }
+    basic_iterator operator++(int) {
+      basic_iterator copy = *this;
+      ++*this;
+      return copy;
+    }
+    basic_iterator &operator--() {
+      --pos;
+      if (offset == 0) {
+        --block;
+        offset = store->blocks[block]->size() - 1;
+      } else {
+        --offset;
+      }
+      return *this;
+    }
+    basic_iterator operator--(int) {
+      basic_iterator copy = *this;
+      --*this;
+      return copy;
+    }
+    basic_iterator &operator+=(difference_type n) {
+      const difference_type target = (difference_type)offset + n;
+      pos += n;
+      if (block < store->blocks.size() && target >= 0 &&
+          target < (difference_type)store->blocks[block]->size()) {
+        offset = (std::size_t)target;
+      } else {
+        seek();
+      }
+      return *this;
+    }
+    basic_iterator &operator-=(difference_type n) { return *this += -n; }
+    friend basic_iterator operator+(basic_iterator it, difference_type n) {
+      return it += n;
+    }
+    friend basic_iterator operator+(difference_type n, basic_iterator it) {
+      return it += n;
+    }
+    friend basic_iterator operator-(basic_iterator it, difference_type n) {
+      return it -= n;
+    }
+    friend difference_type operator-(const basic_iterator &a,
+                                     const basic_iterator &b) {
+      return (difference_type)a.pos - (difference_type)b.pos;
+    }
+    friend bool operator==(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos == b.pos;
+    }
+    friend bool operator!=(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos != b.pos;
+    }
+    friend bool operator<(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos < b.pos;
+    }
+    friend bool operator>(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos > b.pos;
+    }
+    friend bool operator<=(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos <= b.pos;
+    }
+    friend bool operator>=(const basic_iterator &a, const basic_iterator &b) {
+      return a.pos >= b.pos;
+    }
+
+    std::size_t index() const { return pos; }
+
+  private:
+    friend class LineStore;
+    friend class basic_iterator<true>;
+
+    store_type *store = nullptr;
+    std::size_t pos = 0;
+    std::size_t block = 0;
+    std::size_t offset = 0;
+
+    static std::string &line(LineStore *store, std::size_t pos,
+                             std::size_t block, std::size_t offset) {
+      store->touch(pos);
+      return store->own(block)[offset];
+    }
+    static const std::string &line(const LineStore *store, std::size_t,
+                                   std::size_t block, std::size_t offset) {
+      return (*store->blocks[block])[offset];
+    }
+
+    void seek() {
+      if (pos >= store->total) {
+        block = store->blocks.size();
+        offset = 0;
+        return;
+      }
+      const auto where = store->locate(pos);
+      block = where.first;
+      offset = where.second;
+    }
+  };
+
+  using value_type = std::string;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = std::string &;
+  using const_reference = const std::string &;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  // A structural edit: `count` lines inserted at `index` when positive,
+  // erased from `index` when negative.
+  struct Edit {
+    std::size_t index;
+    long long count;
+  };
+
+  // Lines [first, last), numbered as after the edits up to journal version
+  // `version`, were handed out for writing and may have changed, last when
+  // revision() was `revision`.
+  struct Touch {
+    std::uint64_t version;
+    std::size_t first;
+    std::size_t last;
+    std::uint64_t revision;
+  };
+
+  LineStore() = default;
+  LineStore(std::initializer_list<std::string> lines);
+  explicit LineStore(std::vector<std::string> lines);
+  LineStore(const LineStore &other);
+  LineStore(LineStore &&other) noexcept;
+  LineStore &operator=(const LineStore &other);
+  LineStore &operator=(LineStore &&other) noexcept;
+  LineStore &operator=(std::vector<std::string> lines);
+
+  std::size_t size() const { return total; }
+  bool empty() const { return total == 0; }
+
+  const std::string &operator[](std::size_t index) const;
+  const std::string &front() const { return blocks.front()->front(); }
+  const std::string &back() const { return blocks.back()->back(); }
+  // Line `index` for writing, logged as touched.
+  std::string &mut(std::size_t index);
+  // Replaces line `index`; touches it only if the text differs.
+  void set(std::size_t index, std::string line);
+
+  // Iterators whose lines are touched as they are dereferenced.
+  iterator mut_begin() { return iterator(this, 0); }
+  iterator mut_end() { return iterator(this, total); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, total); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  void push_back(std::string line);
+  // Moves `lines` onto the end, filling blocks in bulk; one journal entry.
+  void append(std::vector<std::string> lines);
+  void pop_back();
+  void clear();
+  void swap(LineStore &other);
+  void reserve(std::size_t) {}
+
+  iterator insert(const_iterator pos, std::string line);
+  template <typename InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    return insert_lines(pos.index(), std::vector<std::string>(first, last));
+  }
+  iterator erase(const_iterator pos);
+  iterator erase(const_iterator first, const_iterator last);
+
+  // Total bytes of line content, excluding separators.
+  std::size_t byte_size() const;
+  // Concatenates all lines with `separator` between them.
+  std::string join(char separator = '\n') const;
+  std::vector<std::string> to_vector() const;
+
+  bool operator==(const LineStore &other) const;
+  bool operator!=(const LineStore &other) const { return !(*this == other); }
+
+  // The journal id changes whenever the contents are replaced wholesale
+  // (assignment, clear, swap); the version counts edits within one id.
+  std::uint64_t journal_id() const { return journal_id_; }
+  std::uint64_t journal_version() const { return journal_version_; }
+  // Appends the edits made after `version` to `out`. Returns false when
+  // they are no longer retained and the caller has to start over.
+  bool edits_since(std::uint64_t version, std::vector<Edit> &out) const;
+  // Touches logged so far. Neighbouring touches between two edits share one
+  // entry, so the last one read may since have grown or been touched again;
+  // revision() tells whether it may have.
+  std::uint64_t touch_count() const { return touch_count_; }
+  // Appends touches from number `count` on to `out`, and the one before it
+  // again. Returns false when they are no longer retained.
+  bool touches_since(std::uint64_t count, std::vector<Touch> &out) const;
+  // Changes on every edit and whenever a line is handed out for writing, so
+  // an unchanged revision means unchanged contents (for one journal id).
+  // Reads leave it alone.
+  std::uint64_t revision() const { return revision_; }
+
+private:
+  using Block = std::vector<std::string>;
+  std::vector<std::shared_ptr<Block>> blocks;
+  std::vector<std::size_t> tree; // Fenwick tree of block sizes, 1-based
+  std::size_t total = 0;
+  // Block of the most recent lookup. Makes const lookups non-reentrant, so
+  // a LineStore must not be read from several threads at once.
+  static constexpr std::size_t kNoBlock = (std::size_t)-1;
+  mutable std::size_t cached_block = kNoBlock;
+  mutable std::size_t cached_start = 0;
+
+  std::uint64_t journal_id_ = next_journal_id();
+  std::uint64_t journal_version_ = 0;
+  std::uint64_t revision_ = 0;
+  std::vector<Edit> journal; // the last journal.size() edits
+  std::uint64_t touch_count_ = 0;
+  std::vector<Touch> touches; // the last touches.size() touches
+
+  static std::uint64_t next_journal_id();
+  void record(std::size_t index, long long count);
+  void touch(std::size_t index) {
+    ++revision_;
+    if (!touches.empty()) {
+      Touch &last = touches.back();
+      if (last.version == journal_version_ && index + 1 >= last.first &&
+          index <= last.last) {
+        last.first = std::min(last.first, index);
+        last.last = std::max(last.last, index + 1);
+        last.revision = revision_;
+        return;
+      }
+    }
+    add_touch(index);
+  }
+  void add_touch(std::size_t index);
+  void reset_journal();
+  // `block`, copied first if another store shares it.
+  Block &own(std::size_t block);
+
+  std::pair<std::size_t, std::size_t> locate(std::size_t index) const;
+  void tree_add(std::size_t block, long long delta);
+  void tree_append(std::size_t size);
+  void rebuild_tree();
+  bool rebalance(std::size_t block);
+  iterator insert_lines(std::size_t index, std::vector<std::string> lines);
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "editor.h"
+#include "fuzzy_match.h"
 #include "python_api.h"
 #include <algorithm>
 #include <cctype>
@@ -181,27 +182,13 @@ std::string current_completion_prefix(const FileBuffer &buf) {
   return line.substr((size_t)start, (size_t)(cursor - start));
 }
 
-bool is_subsequence_case_insensitive(const std::string &needle,
-                                     const std::string &haystack) {
-  if (needle.empty()) {
-    return true;
-  }
-  size_t j = 0;
-  for (size_t i = 0; i < haystack.size() && j < needle.size(); i++) {
-    if (std::tolower((unsigned char)haystack[i]) ==
-        std::tolower((unsigned char)needle[j])) {
-      j++;
-    }
-  }
-  return j == needle.size();
-}
-
-int completion_match_score(const std::string &query, const LSPCompletionItem &item) {
-  if (query.empty()) {
+int completion_match_score(const FuzzyPattern &pattern,
+                           const LSPCompletionItem &item) {
+  if (pattern.empty()) {
     return 1;
   }
 
-  const std::string q = to_lower_copy(query);
+  const std::string &q = pattern.text();
   const std::string label = to_lower_copy(item.label);
   const std::string filter = to_lower_copy(item.filter_text.empty()
                                                ? item.label
@@ -218,8 +205,7 @@ int completion_match_score(const std::string &query, const LSPCompletionItem &it
       insert.find(q) != std::string::npos) {
     return 4000 - (int)label.find(q);
   }
-  if (is_subsequence_case_insensitive(q, label) ||
-      is_subsequence_case_insensitive(q, filter)) {
+  if (pattern.matches(label) || pattern.matches(filter)) {
     return 1500;
   }
   return 0;
@@ -383,7 +369,7 @@ void Editor::poll_lsp_clients() {
 
     for (const auto &buf : buffers) {
       if (buf.filepath == filepath) {
-        client->did_change(filepath, get_buffer_text(buf));
+        client->did_change(filepath, buf.lines);
         break;
       }
     }
@@ -419,34 +405,34 @@ void Editor::poll_lsp_clients() {
         continue;
       }
 
-      std::string query = current_completion_prefix(buf);
-      std::vector<std::pair<int, LSPCompletionItem>> ranked;
-      ranked.reserve(entry.second.size());
-      for (auto &item : entry.second) {
-        int score = completion_match_score(query, item);
-        if (query.empty() || score > 0) {
-          ranked.push_back({score, std::move(item)});
-        }
-      }
-
-      std::stable_sort(ranked.begin(), ranked.end(),
-                       [](const auto &a, const auto &b) {
-                         if (a.first != b.first) {
-                           return a.first > b.first;
-                         }
-                         const std::string &as =
-                             a.second.sort_text.empty() ? a.second.label
-                                                        : a.second.sort_text;
-                         const std::string &bs =
-                             b.second.sort_text.empty() ? b.second.label
-                                                        : b.second.sort_text;
-                         return as < bs;
-                       });
+      const FuzzyPattern pattern(current_completion_prefix(buf));
+      auto &items = entry.second;
+      const int max_items = 200;
+      const auto ranked = fuzzy_rank(
+          items.size(), max_items, nullptr, 0,
+          [&](std::size_t i) {
+            const int score = completion_match_score(pattern, items[i]);
+            return pattern.empty() || score > 0 ? score : -1;
+          },
+          [&](const FuzzyHit &a, const FuzzyHit &b) {
+            if (a.score != b.score) {
+              return a.score > b.score;
+            }
+            const LSPCompletionItem &ai = items[a.index];
+            const LSPCompletionItem &bi = items[b.index];
+            const std::string &as =
+                ai.sort_text.empty() ? ai.label : ai.sort_text;
+            const std::string &bs =
+                bi.sort_text.empty() ? bi.label : bi.sort_text;
+            if (as != bs) {
+              return as < bs;
+            }
+            return a.index < b.index;
+          });
 
       lsp_completion_items.clear();
-      const int max_items = 200;
-      for (int i = 0; i < (int)ranked.size() && i < max_items; i++) {
-        lsp_completion_items.push_back(std::move(ranked[i].second));
+      for (const FuzzyHit &hit : ranked) {
+        lsp_completion_items.push_back(std::move(items[hit.index]));
       }
       lsp_completion_filepath = entry.first;
       lsp_completion_selected = 0;
@@ -495,6 +481,7 @@ LSPClient *Editor::ensure_lsp_for_file(const std::string &filepath) {
   }
 
   auto client = std::make_unique<LSPClient>(language, root, command);
+  client->set_ready_callback([this] { terminal.wake(); });
   if (!client->start()) {
     set_message("LSP start failed for " + language + ": " + client->get_last_error());
     return nullptr;
@@ -505,20 +492,7 @@ LSPClient *Editor::ensure_lsp_for_file(const std::string &filepath) {
 }
 
 std::string Editor::get_buffer_text(const FileBuffer &buf) const {
-  size_t total_size = buf.lines.empty() ? 0 : buf.lines.size() - 1;
-  for (const auto &line : buf.lines) {
-    total_size += line.size();
-  }
-
-  std::string text;
-  text.reserve(total_size);
-  for (size_t i = 0; i < buf.lines.size(); i++) {
-    if (i > 0) {
-      text.push_back('\n');
-    }
-    text.append(buf.lines[i]);
-  }
-  return text;
+  return buf.lines.join('\n');
 }
 
 void Editor::notify_lsp_open(const std::string &filepath) {
@@ -534,7 +508,7 @@ void Editor::notify_lsp_open(const std::string &filepath) {
   for (const auto &buf : buffers) {
     if (buf.filepath == filepath) {
       client->did_open(filepath, language_id_for(client->get_language(), filepath),
-                       get_buffer_text(buf));
+                       buf.lines);
       break;
     }
   }
@@ -559,7 +533,7 @@ void Editor::notify_lsp_save(const std::string &filepath) {
 
   for (const auto &buf : buffers) {
     if (buf.filepath == filepath) {
-      client->did_save(filepath, get_buffer_text(buf));
+      client->did_save(filepath, buf.lines);
       break;
     }
   }
@@ -775,7 +749,7 @@ void Editor::request_lsp_completion(bool manual, char trigger_character) {
 
   // Completion must use current text state, not debounced change state.
   lsp_pending_changes.erase(buf.filepath);
-  client->did_change(buf.filepath, get_buffer_text(buf));
+  client->did_change(buf.filepath, buf.lines);
 
   char trigger = '\0';
   if (trigger_character == '.' || trigger_character == ':' ||
@@ -823,9 +797,11 @@ bool Editor::apply_selected_lsp_completion() {
     return false;
   }
 
-  save_state();
+  if (!save_state(buf.cursor.y, buf.cursor.y)) {
+    return false;
+  }
 
-  std::string &line = buf.lines[buf.cursor.y];
+  std::string &line = buf.lines.mut(buf.cursor.y);
   int cursor = std::clamp(buf.cursor.x, 0, (int)line.size());
   int start = cursor;
   int end = cursor;
@@ -0,0 +1,321 @@
+#include "lsp_protocol.h"
+#include "json_reader.h"
+#include <cctype>
+
+namespace {
+bool key_is(std::string_view key, const char *name) { return key == name; }
+
+int read_int_or(JsonReader &reader, int fallback) {
+  long long value = 0;
+  if (reader.peek() == JsonReader::Number) {
+    return reader.read_int(value) ? (int)value : fallback;
+  }
+  reader.skip();
+  return fallback;
+}
+
+void read_string_into(JsonReader &reader, std::string &out) {
+  std::string_view value;
+  if (reader.peek() == JsonReader::String && reader.read_string(value)) {
+    out.assign(value.data(), value.size());
+  } else {
+    reader.skip();
+  }
+}
+
+// Position {line, character}. Returns false when it is not an object.
+bool read_position(JsonReader &reader, int &line, int &character) {
+  if (reader.peek() != JsonReader::Object) {
+    reader.skip();
+    return false;
+  }
+  reader.begin_object();
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "line")) {
+      line = read_int_or(reader, line);
+    } else if (key_is(key, "character")) {
+      character = read_int_or(reader, character);
+    } else {
+      reader.skip();
+    }
+  }
+  return true;
+}
+
+struct Range {
+  bool has_start = false;
+  bool has_end = false;
+  int start_line = 0;
+  int start_char = 0;
+  int end_line = 0;
+  int end_char = 0;
+};
+
+void read_range(JsonReader &reader, Range &range) {
+  if (reader.peek() != JsonReader::Object) {
+    reader.skip();
+    return;
+  }
+  reader.begin_object();
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "start")) {
+      range.has_start =
+          read_position(reader, range.start_line, range.start_char);
+    } else if (key_is(key, "end")) {
+      range.has_end = read_position(reader, range.end_line, range.end_char);
+    } else {
+      reader.skip();
+    }
+  }
+}
+
+void read_diagnostic(JsonReader &reader, std::vector<Diagnostic> &out) {
+  if (reader.peek() != JsonReader::Object) {
+    reader.skip();
+    return;
+  }
+  Range range;
+  Diagnostic diag;
+  diag.severity = 1;
+  reader.begin_object();
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "range")) {
+      read_range(reader, range);
+    } else if (key_is(key, "message")) {
+      read_string_into(reader, diag.message);
+    } else if (key_is(key, "severity")) {
+      diag.severity = read_int_or(reader, 1);
+    } else {
+      reader.skip();
+    }
+  }
+  diag.line = range.start_line;
+  diag.col = range.start_char;
+  diag.end_line = range.has_end ? range.end_line : diag.line;
+  diag.end_col = range.has_end ? range.end_char : diag.col;
+  out.push_back(std::move(diag));
+}
+
+void read_completion_item(JsonReader &reader,
+                          std::vector<LSPCompletionItem> &out) {
+  if (reader.peek() != JsonReader::Object) {
+    reader.skip();
+    return;
+  }
+  LSPCompletionItem completion;
+  std::string edit_text;
+  Range edit_range;
+  reader.begin_object();
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "label")) {
+      read_string_into(reader, completion.label);
+    } else if (key_is(key, "insertText")) {
+      read_string_into(reader, completion.insert_text);
+    } else if (key_is(key, "detail")) {
+      read_string_into(reader, completion.detail);
+    } else if (key_is(key, "filterText")) {
+      read_string_into(reader, completion.filter_text);
+    } else if (key_is(key, "sortText")) {
+      read_string_into(reader, completion.sort_text);
+    } else if (key_is(key, "kind")) {
+      completion.kind = read_int_or(reader, 0);
+    } else if (key_is(key, "insertTextFormat")) {
+      completion.insert_text_format = read_int_or(reader, 1);
+    } else if (key_is(key, "textEdit") &&
+               reader.peek() == JsonReader::Object) {
+      reader.begin_object();
+      std::string_view edit_key;
+      while (reader.next_key(edit_key)) {
+        if (key_is(edit_key, "newText")) {
+          read_string_into(reader, edit_text);
+        } else if (key_is(edit_key, "range")) {
+          read_range(reader, edit_range);
+        } else {
+          reader.skip();
+        }
+      }
+    } else {
+      reader.skip();
+    }
+  }
+
+  if (completion.insert_text.empty()) {
+    completion.insert_text = std::move(edit_text);
+    if (edit_range.has_start && edit_range.has_end) {
+      completion.has_text_edit_range = true;
+      completion.edit_start_line = edit_range.start_line;
+      completion.edit_start_char = edit_range.start_char;
+      completion.edit_end_line = edit_range.end_line;
+      completion.edit_end_char = edit_range.end_char;
+    }
+  }
+  if (completion.insert_text.empty()) {
+    completion.insert_text = completion.label;
+  }
+  if (completion.label.empty()) {
+    completion.label = completion.insert_text;
+  }
+  if (!completion.label.empty()) {
+    out.push_back(std::move(completion));
+  }
+}
+
+void read_completion_array(JsonReader &reader,
+                           std::vector<LSPCompletionItem> &out) {
+  reader.begin_array();
+  while (reader.next_element()) {
+    read_completion_item(reader, out);
+  }
+}
+} // namespace
+
+bool read_lsp_envelope(std::string_view message, LSPEnvelope &out) {
+  JsonReader reader(message);
+  out = LSPEnvelope();
+  if (!reader.begin_object()) {
+    return false;
+  }
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "method")) {
+      read_string_into(reader, out.method);
+    } else if (key_is(key, "id")) {
+      if (reader.peek() == JsonReader::Number) {
+        out.has_id = reader.read_int(out.id);
+      } else {
+        reader.skip();
+      }
+    } else if (key_is(key, "params")) {
+      reader.skip(out.params);
+    } else if (key_is(key, "result")) {
+      reader.skip(out.result);
+    } else if (key_is(key, "error")) {
+      reader.skip(out.error);
+    } else {
+      reader.skip();
+    }
+  }
+  return !reader.failed();
+}
+
+bool read_lsp_diagnostics(std::string_view params, std::string &uri,
+                          std::vector<Diagnostic> &out) {
+  JsonReader reader(params);
+  if (!reader.begin_object()) {
+    return false;
+  }
+  bool has_uri = false;
+  bool has_diagnostics = false;
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (key_is(key, "uri")) {
+      read_string_into(reader, uri);
+      has_uri = true;
+    } else if (key_is(key, "diagnostics") &&
+               reader.peek() == JsonReader::Array) {
+      reader.begin_array();
+      while (reader.next_element()) {
+        read_diagnostic(reader, out);
+      }
+      has_diagnostics = true;
+    } else {
+      reader.skip();
+    }
+  }
+  return has_uri && has_diagnostics && !reader.failed();
+}
+
+bool read_lsp_completion_items(std::string_view result,
+                               std::vector<LSPCompletionItem> &out) {
+  JsonReader reader(result);
+  if (reader.peek() == JsonReader::Array) {
+    read_completion_array(reader, out);
+  } else if (reader.peek() == JsonReader::Object) {
+    reader.begin_object();
+    std::string_view key;
+    while (reader.next_key(key)) {
+      if (key_is(key, "items") && reader.peek() == JsonReader::Array) {
+        read_completion_array(reader, out);
+      } else {
+        reader.skip();
+      }
+    }
+  }
+  return !reader.failed();
+}
+
+LSPTextSyncKind read_lsp_text_sync_kind(std::string_view result) {
+  int kind = LSP_SYNC_FULL;
+  JsonReader reader(result);
+  if (!reader.begin_object()) {
+    return LSP_SYNC_FULL;
+  }
+  std::string_view key;
+  while (reader.next_key(key)) {
+    if (!key_is(key, "capabilities") ||
+        reader.peek() != JsonReader::Object) {
+      reader.skip();
+      continue;
+    }
+    reader.begin_object();
+    std::string_view cap_key;
+    while (reader.next_key(cap_key)) {
+      if (!key_is(cap_key, "textDocumentSync")) {
+        reader.skip();
+      } else if (reader.peek() == JsonReader::Object) {
+        reader.begin_object();
+        std::string_view sync_key;
+        while (reader.next_key(sync_key)) {
+          if (key_is(sync_key, "change")) {
+            kind = read_int_or(reader, LSP_SYNC_FULL);
+          } else {
+            reader.skip();
+          }
+        }
+      } else {
+        kind = read_int_or(reader, LSP_SYNC_FULL);
+      }
+    }
+  }
+  if (kind < LSP_SYNC_NONE || kind > LSP_SYNC_INCREMENTAL) {
+    return LSP_SYNC_FULL;
+  }
+  return (LSPTextSyncKind)kind;
+}
+
+bool read_lsp_content_length(std::string_view headers, std::size_t &length) {
+  static constexpr std::string_view kName = "Content-Length:";
+  std::size_t line_start = 0;
+  while (line_start < headers.size()) {
+    std::size_t line_end = headers.find('\n', line_start);
+    if (line_end == std::string_view::npos) {
+      line_end = headers.size();
+    }
+    const std::string_view line =
+        headers.substr(line_start, line_end - line_start);
+    if (line.substr(0, kName.size()) == kName) {
+      std::size_t pos = kName.size();
+      while (pos < line.size() &&
+             std::isspace(static_cast<unsigned char>(line[pos]))) {
+        pos++;
+      }
+      if (pos >= line.size() ||
+          !std::isdigit(static_cast<unsigned char>(line[pos]))) {
+        return false;
+      }
+      length = 0;
+      while (pos < line.size() &&
+             std::isdigit(static_cast<unsigned char>(line[pos]))) {
+        length = length * 10 + (std::size_t)(line[pos] - '0');
+        pos++;
+      }
+      return true;
+    }
+    line_start = line_end + 1;
+  }
+  return false;
+}
@@ -0,0 +1,57 @@
+#ifndef LSP_PROTOCOL_H
+#define LSP_PROTOCOL_H
+
+#include "text_features.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LSPCompletionItem {
+  std::string label;
+  std::string insert_text;
+  std::string detail;
+  std::string filter_text;
+  std::string sort_text;
+  int kind = 0;
+  int insert_text_format = 1; // 1=plain text, 2=snippet
+  bool has_text_edit_range = false;
+  int edit_start_line = 0;
+  int edit_start_char = 0;
+  int edit_end_line = 0;
+  int edit_end_char = 0;
+};
+
+// Decoding of the server messages LSPClient consumes. Each reader walks
+// the raw JSON with a JsonReader, keeps the fields listed here and skips
+// everything else without building it.
+
+// Top-level fields of one JSON-RPC message. `params`, `result` and `error`
+// are raw JSON views into the message, empty when absent.
+struct LSPEnvelope {
+  std::string method;
+  bool has_id = false;
+  long long id = 0;
+  std::string_view params;
+  std::string_view result;
+  std::string_view error;
+};
+
+bool read_lsp_envelope(std::string_view message, LSPEnvelope &out);
+// params of textDocument/publishDiagnostics.
+bool read_lsp_diagnostics(std::string_view params, std::string &uri,
+                          std::vector<Diagnostic> &out);
+// result of textDocument/completion: CompletionItem[] or CompletionList.
+bool read_lsp_completion_items(std::string_view result,
+                               std::vector<LSPCompletionItem> &out);
+enum LSPTextSyncKind { LSP_SYNC_NONE, LSP_SYNC_FULL, LSP_SYNC_INCREMENTAL };
+
+// ServerCapabilities.textDocumentSync from the result of initialize,
+// either a bare kind or options with a `change` kind. Servers that leave
+// it out get full sync.
+LSPTextSyncKind read_lsp_text_sync_kind(std::string_view result);
+
+// Length of the body announced by a header block ("Content-Length: N").
+bool read_lsp_content_length(std::string_view headers, std::size_t &length);
+
+#endif
@@ -0,0 +1,297 @@
+#include "match_index.h"
+#include "content_search.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+
+namespace {
+bool is_word_char(unsigned char c) { return std::isalnum(c) || c == '_'; }
+
+bool is_whole_word(const std::string &line, std::size_t pos,
+                   std::size_t len) {
+  const bool prev_word = pos > 0 && is_word_char((unsigned char)line[pos - 1]);
+  const bool next_word = pos + len < line.size() &&
+                         is_word_char((unsigned char)line[pos + len]);
+  return !prev_word && !next_word;
+}
+
+MatchIndex::Match line_start(std::size_t line) {
+  return {(int)line, INT_MIN};
+}
+} // namespace
+
+void MatchIndex::set_query(const LineStore &lines, const std::string &query,
+                           bool case_sensitive, bool whole_word) {
+  if (is_for(query, case_sensitive, whole_word)) {
+    return;
+  }
+  sync(lines);
+  // Rechecking every old match is done in one go, so with very many it is
+  // quicker to the first match to scan again from the cursor.
+  const bool narrows = !query_.empty() && !whole_word && !whole_word_ &&
+                       case_sensitive == case_sensitive_ &&
+                       query.size() > query_.size() &&
+                       query.compare(0, query_.size(), query_) == 0 &&
+                       found.size() <= line_count / 4;
+  query_ = query;
+  case_sensitive_ = case_sensitive;
+  whole_word_ = whole_word;
+  if (!narrows) {
+    restart(lines);
+    return;
+  }
+
+  // Every match of the longer query starts where one of the shorter did.
+  const LiteralFinder finder(query_, case_sensitive_);
+  const std::size_t n = query_.size();
+  std::size_t kept = 0;
+  for (const Match &match : found) {
+    const std::string &line = lines[(std::size_t)match.first];
+    const char *at = line.data() + match.second;
+    if ((std::size_t)match.second + n <= line.size() &&
+        finder.find(at, at + n) == at) {
+      found[kept++] = match;
+    }
+  }
+  found.resize(kept);
+  ++revision_;
+}
+
+void MatchIndex::clear() {
+  query_.clear();
+  found.clear();
+  pending.clear();
+  line_count = 0;
+  synced_journal = 0;
+  ++revision_;
+}
+
+bool MatchIndex::is_for(const std::string &query, bool case_sensitive,
+                        bool whole_word) const {
+  return query == query_ && case_sensitive == case_sensitive_ &&
+         whole_word == whole_word_ && !query_.empty();
+}
+
+bool MatchIndex::sync(const LineStore &lines) {
+  if (query_.empty()) {
+    return false;
+  }
+  if (lines.journal_id() != synced_journal) {
+    restart(lines);
+    return true;
+  }
+  if (lines.revision() == synced_revision) {
+    return false;
+  }
+
+  edits.clear();
+  touches.clear();
+  if (!lines.edits_since(synced_version, edits) ||
+      !lines.touches_since(synced_touches, touches)) {
+    restart(lines);
+    return true;
+  }
+
+  // Touches are numbered as after the edits up to their version, so they
+  // are replayed in between. One from before the last sync's version
+  // cannot have been touched again and was already applied.
+  std::size_t next_touch = 0;
+  auto apply_touches = [&](std::uint64_t version) {
+    for (; next_touch < touches.size() &&
+           touches[next_touch].version <= version;
+         next_touch++) {
+      const LineStore::Touch &touch = touches[next_touch];
+      if (touch.version >= synced_version) {
+        add_pending(std::min(touch.first, line_count),
+                    std::min(touch.last, line_count));
+      }
+    }
+  };
+  std::uint64_t version = synced_version;
+  apply_touches(version);
+  for (const LineStore::Edit &edit : edits) {
+    if (edit.count > 0) {
+      if (edit.index > line_count) {
+        restart(lines);
+        return true;
+      }
+      insert_lines(edit.index, (std::size_t)edit.count);
+    } else {
+      if (edit.index + (std::size_t)-edit.count > line_count) {
+        restart(lines);
+        return true;
+      }
+      erase_lines(edit.index, (std::size_t)-edit.count);
+    }
+    apply_touches(++version);
+  }
+  if (line_count != lines.size()) {
+    restart(lines);
+    return true;
+  }
+  synced_version = lines.journal_version();
+  synced_touches = lines.touch_count();
+  synced_revision = lines.revision();
+  if (edits.empty()) {
+    return false;
+  }
+  ++revision_;
+  return true;
+}
+
+bool MatchIndex::scan(const LineStore &lines, std::size_t line,
+                      std::size_t max_lines) {
+  bool changed = false;
+  while (max_lines > 0 && !pending.empty()) {
+    auto it = std::find_if(pending.begin(), pending.end(),
+                           [&](const Range &r) { return r.last > line; });
+    if (it == pending.end()) {
+      it = pending.begin();
+      line = 0;
+    }
+    const std::size_t first = std::max(it->first, line);
+    const std::size_t last = std::min(it->last, first + max_lines);
+    changed = scan_lines(lines, first, last) || changed;
+    remove_pending(first, last);
+    max_lines -= last - first;
+    line = last;
+  }
+  return changed;
+}
+
+bool MatchIndex::scanned(std::size_t first, std::size_t last) const {
+  for (const Range &r : pending) {
+    if (r.first < last && r.last > first) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MatchIndex::restart(const LineStore &lines) {
+  found.clear();
+  pending.clear();
+  line_count = lines.size();
+  if (line_count > 0) {
+    pending.push_back({0, line_count});
+  }
+  synced_journal = lines.journal_id();
+  synced_version = lines.journal_version();
+  synced_touches = lines.touch_count();
+  synced_revision = lines.revision();
+  ++revision_;
+}
+
+void MatchIndex::add_pending(std::size_t first, std::size_t last) {
+  if (first >= last) {
+    return;
+  }
+  auto it = std::lower_bound(
+      pending.begin(), pending.end(), first,
+      [](const Range &r, std::size_t line) { return r.last < line; });
+  auto end = it;
+  while (end != pending.end() && end->first <= last) {
+    first = std::min(first, end->first);
+    last = std::max(last, end->last);
+    ++end;
+  }
+  it = pending.erase(it, end);
+  pending.insert(it, {first, last});
+}
+
+void MatchIndex::remove_pending(std::size_t first, std::size_t last) {
+  std::vector<Range> kept;
+  kept.reserve(pending.size() + 1);
+  for (const Range &r : pending) {
+    if (r.last <= first || r.first >= last) {
+      kept.push_back(r);
+      continue;
+    }
+    if (r.first < first) {
+      kept.push_back({r.first, first});
+    }
+    if (r.last > last) {
+      kept.push_back({last, r.last});
+    }
+  }
+  pending.swap(kept);
+}
+
+void MatchIndex::insert_lines(std::size_t line, std::size_t count) {
+  for (auto it = std::lower_bound(found.begin(), found.end(), line_start(line));
+       it != found.end(); ++it) {
+    it->first += (int)count;
+  }
+  for (Range &r : pending) {
+    if (r.first >= line) {
+      r.first += count;
+      r.last += count;
+    } else if (r.last > line) {
+      r.last += count;
+    }
+  }
+  line_count += count;
+  add_pending(line, line + count);
+}
+
+void MatchIndex::erase_lines(std::size_t line, std::size_t count) {
+  const auto from =
+      std::lower_bound(found.begin(), found.end(), line_start(line));
+  const auto to =
+      std::lower_bound(from, found.end(), line_start(line + count));
+  for (auto it = to; it != found.end(); ++it) {
+    it->first -= (int)count;
+  }
+  found.erase(from, to);
+
+  auto map = [&](std::size_t at) {
+    return at < line ? at : at < line + count ? line : at - count;
+  };
+  std::vector<Range> kept;
+  kept.reserve(pending.size());
+  for (const Range &r : pending) {
+    const Range moved{map(r.first), map(r.last)};
+    if (moved.first >= moved.last) {
+      continue;
+    }
+    if (!kept.empty() && kept.back().last >= moved.first) {
+      kept.back().last = std::max(kept.back().last, moved.last);
+    } else {
+      kept.push_back(moved);
+    }
+  }
+  pending.swap(kept);
+  line_count -= count;
+}
+
+// Replaces the matches on lines [first, last) with a fresh scan of them.
+bool MatchIndex::scan_lines(const LineStore &lines, std::size_t first,
+                            std::size_t last) {
+  const LiteralFinder finder(query_, case_sensitive_);
+  const std::size_t n = query_.size();
+  std::vector<Match> fresh;
+  for (std::size_t i = first; i < last; i++) {
+    const std::string &line = lines[i];
+    const char *end = line.data() + line.size();
+    for (const char *at = finder.find(line.data(), end); at;
+         at = finder.find(at + 1, end)) {
+      const std::size_t pos = (std::size_t)(at - line.data());
+      if (!whole_word_ || is_whole_word(line, pos, n)) {
+        fresh.push_back({(int)i, (int)pos});
+      }
+    }
+  }
+
+  const auto from =
+      std::lower_bound(found.begin(), found.end(), line_start(first));
+  const auto to =
+      std::lower_bound(from, found.end(), line_start(last));
+  if ((std::size_t)(to - from) == fresh.size() &&
+      std::equal(from, to, fresh.begin())) {
+    return false;
+  }
+  const auto at = found.erase(from, to);
+  found.insert(at, fresh.begin(), fresh.end());
+  ++revision_;
+  return true;
+}
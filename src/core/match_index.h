@@ -0,0 +1,77 @@
+#ifndef MATCH_INDEX_H
+#define MATCH_INDEX_H
+
+#include "line_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The matches of one literal in a buffer, for in-buffer find. Lines are
+// scanned in slices, so a long buffer can show the matches near the cursor
+// first and count the rest later; the lines not scanned yet are kept as
+// pending ranges.
+//
+// The index follows its LineStore: sync() shifts matches along with the
+// store's journal, and lines inserted or handed out for writing (the touch
+// log) become pending again, so an edit rescans only the lines it touched.
+class MatchIndex {
+public:
+  using Match = std::pair<int, int>; // line, byte column
+
+  // Searches for `query` from now on. When it extends the current query
+  // with the same options, whole words are not required and the current
+  // matches are not too many, only they are checked again; otherwise every
+  // line is pending.
+  void set_query(const LineStore &lines, const std::string &query,
+                 bool case_sensitive, bool whole_word);
+  void clear();
+  bool is_for(const std::string &query, bool case_sensitive,
+              bool whole_word) const;
+
+  // Catches up with the store's edits. Returns true when matches moved.
+  bool sync(const LineStore &lines);
+  // Scans up to `max_lines` pending lines, the ones from `line` on first,
+  // then from the top. Returns true when the matches changed.
+  bool scan(const LineStore &lines, std::size_t line, std::size_t max_lines);
+  bool complete() const { return pending.empty(); }
+  // Whether lines [first, last) have all been scanned.
+  bool scanned(std::size_t first, std::size_t last) const;
+
+  // By line, then column. A line pending again keeps its old matches until
+  // it is scanned.
+  const std::vector<Match> &matches() const { return found; }
+  // Changes whenever the matches or the pending lines do.
+  std::uint64_t revision() const { return revision_; }
+
+private:
+  struct Range {
+    std::size_t first;
+    std::size_t last;
+  };
+
+  std::string query_;
+  bool case_sensitive_ = false;
+  bool whole_word_ = false;
+  std::vector<Match> found;
+  std::vector<Range> pending; // sorted, disjoint, not adjacent
+  std::size_t line_count = 0;
+  std::uint64_t synced_journal = 0;
+  std::uint64_t synced_version = 0;
+  std::uint64_t synced_touches = 0;
+  std::uint64_t synced_revision = 0;
+  std::uint64_t revision_ = 0;
+  std::vector<LineStore::Edit> edits;
+  std::vector<LineStore::Touch> touches;
+
+  void restart(const LineStore &lines);
+  void add_pending(std::size_t first, std::size_t last);
+  void remove_pending(std::size_t first, std::size_t last);
+  void insert_lines(std::size_t line, std::size_t count);
+  void erase_lines(std::size_t line, std::size_t count);
+  bool scan_lines(const LineStore &lines, std::size_t first,
+                  std::size_t last);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer, single-consumer FIFO without locks, for handing
+// results from worker threads to the UI thread. push() may be called from
+// any thread; pop() only from the one consumer.
+//
+// Producers link a new node in with one atomic exchange on the head; the
+// consumer walks from the tail. A push that has exchanged the head but not
+// linked its node yet is invisible to pop() until it does.
+template <typename T> class MpscQueue {
+public:
+  MpscQueue() : head(&stub), tail(&stub) {}
+  ~MpscQueue() {
+    T ignored;
+    while (pop(ignored)) {
+    }
+  }
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  void push(T value) { link(new Node(std::move(value))); }
+
+  bool pop(T &out) {
+    Node *first = tail;
+    Node *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+      if (!next) {
+        return false;
+      }
+      // Step over the stub; it is re-linked below once the queue drains.
+      tail = next;
+      first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (!next) {
+      if (first != head.load(std::memory_order_acquire)) {
+        return false; // a producer is between its exchange and its link
+      }
+      stub.next.store(nullptr, std::memory_order_relaxed);
+      link(&stub);
+      next = first->next.load(std::memory_order_acquire);
+      if (!next) {
+        return false;
+      }
+    }
+    tail = next;
+    out = std::move(first->value);
+    delete first;
+    return true;
+  }
+
+private:
+  struct Node {
+    Node() = default;
+    explicit Node(T item) : value(std::move(item)) {}
+    std::atomic<Node *> next{nullptr};
+    T value;
+  };
+
+  std::atomic<Node *> head; // last linked, written by producers
+  Node *tail;               // next to pop, consumer only
+  Node stub;
+
+  void link(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "pane_rows.h"
+#include <limits>
+
+void PaneRows::begin(const LineStore &lines, std::size_t top, int count,
+                     bool all) {
+  first_line = top;
+  damaged_count = 0;
+  dirty_first = 0;
+  dirty_last = 0;
+  all_rows = all || keys.size() != (std::size_t)count;
+  if (!all_rows) {
+    switch (changed_lines(synced, lines, dirty_first, dirty_last)) {
+    case TEXT_DELTA_NONE:
+      break;
+    case TEXT_DELTA_RANGE:
+      if (lines.size() != synced.line_count) {
+        dirty_last = std::numeric_limits<std::size_t>::max();
+      }
+      break;
+    case TEXT_DELTA_FULL:
+      all_rows = true;
+      break;
+    }
+  }
+  keys.resize((std::size_t)count);
+  synced = text_sync_point(lines);
+}
+
+bool PaneRows::damaged(int row, std::uint64_t key) {
+  const std::size_t line = first_line + (std::size_t)row;
+  const bool damaged = all_rows || keys[row] != key ||
+                       (line >= dirty_first && line < dirty_last);
+  keys[row] = key;
+  damaged_count += damaged ? 1 : 0;
+  return damaged;
+}
@@ -0,0 +1,36 @@
+#ifndef PANE_ROWS_H
+#define PANE_ROWS_H
+
+#include "line_store.h"
+#include "text_delta.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What each row of a pane was last drawn from, so a frame draws only the
+// rows whose inputs changed. A row's key covers everything it shows but the
+// text of its line, which is followed through the LineStore journal
+// instead: an edit damages the rows of the lines it wrote, and every row
+// from the first line it inserted or erased on, since those all moved.
+class PaneRows {
+public:
+  // Starts a frame of `count` rows showing the lines from `top` on. Every
+  // row is damaged when `all` is set or the journal no longer reaches back
+  // to the last frame.
+  void begin(const LineStore &lines, std::size_t top, int count, bool all);
+  // Whether `row` must be drawn again; records `key` as what it shows now.
+  bool damaged(int row, std::uint64_t key);
+  // Rows found damaged since begin().
+  int damaged_rows() const { return damaged_count; }
+
+private:
+  std::vector<std::uint64_t> keys;
+  TextSyncPoint synced; // the lines as last drawn
+  std::size_t first_line = 0;
+  std::size_t dirty_first = 0; // lines changed since the last frame
+  std::size_t dirty_last = 0;
+  bool all_rows = true;
+  int damaged_count = 0;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "reactor.h"
+#include <algorithm>
+#include <thread>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <cerrno>
+#include <poll.h>
+#endif
+
+void Reactor::reset() {
+  fds.clear();
+  readable.clear();
+}
+
+int Reactor::watch(int fd) {
+  if (fd < 0) {
+    return -1;
+  }
+  fds.push_back(fd);
+  readable.push_back(false);
+  return (int)fds.size() - 1;
+}
+
+void Reactor::wait(int timeout_ms) {
+  std::fill(readable.begin(), readable.end(), false);
+#if defined(JOT_PLATFORM_POSIX)
+  std::vector<struct pollfd> pfds(fds.size());
+  for (std::size_t i = 0; i < fds.size(); i++) {
+    pfds[i].fd = fds[i];
+    pfds[i].events = POLLIN;
+    pfds[i].revents = 0;
+  }
+  // A signal (SIGWINCH) interrupts the wait; its pipe is readable then.
+  int ready_count =
+      poll(pfds.data(), pfds.size(), timeout_ms < 0 ? -1 : timeout_ms);
+  if (ready_count < 0 && errno == EINTR) {
+    ready_count = poll(pfds.data(), pfds.size(), 0);
+  }
+  for (std::size_t i = 0; i < fds.size() && ready_count > 0; i++) {
+    readable[i] = pfds[i].revents & (POLLIN | POLLHUP | POLLERR);
+  }
+#else
+  if (timeout_ms > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+  }
+#endif
+}
+
+bool Reactor::ready(int slot) const {
+  return slot >= 0 && slot < (int)readable.size() && readable[slot];
+}
+
+void LoopStats::woke(Clock::time_point now, bool input) {
+  if (window_start == Clock::time_point{}) {
+    window_start = now;
+  }
+  wakeups++;
+  wake_pending = true;
+  if (input && !input_pending) {
+    input_pending = true;
+    input_at = now;
+  }
+}
+
+void LoopStats::frame_done(Clock::time_point now, bool painted) {
+  if (!wake_pending) {
+    return;
+  }
+  wake_pending = false;
+  if (painted && input_pending) {
+    const double ms =
+        std::chrono::duration<double, std::milli>(now - input_at).count();
+    last_input_to_paint_ms = ms;
+    max_input_to_paint_ms = std::max(max_input_to_paint_ms, ms);
+    total_input_to_paint_ms += ms;
+    painted_inputs++;
+  }
+  input_pending = false;
+  if (!painted) {
+    idle_wakeups++;
+    window_idle++;
+  }
+  if (now - window_start >= std::chrono::seconds(1)) {
+    idle_wakeups_per_second =
+        window_idle / std::chrono::duration<double>(now - window_start).count();
+    window_start = now;
+    window_idle = 0;
+  }
+}
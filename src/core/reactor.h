@@ -0,0 +1,56 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Waits for the main loop's event sources in one poll(): terminal input,
+// the wake pipe background threads write to, the SIGWINCH pipe and PTY
+// masters, bounded by the nearest timer. Sources come and go between
+// iterations, so they are registered anew for every wait. Without poll()
+// it only sleeps out the timeout.
+class Reactor {
+public:
+  // Forgets the sources of the previous wait.
+  void reset();
+  // Adds fd to the next wait. Returns its slot for ready(), or -1 when fd
+  // is negative.
+  int watch(int fd);
+  // Blocks until a watched fd is readable or hung up, or for timeout_ms;
+  // a negative timeout waits for the fds only.
+  void wait(int timeout_ms);
+  bool ready(int slot) const;
+
+private:
+  std::vector<int> fds;
+  std::vector<bool> readable;
+};
+
+// What the main loop records about itself: how often it wakes up without
+// having anything to draw, and how long input takes to reach the screen.
+struct LoopStats {
+  using Clock = std::chrono::steady_clock;
+
+  std::uint64_t wakeups = 0;
+  std::uint64_t idle_wakeups = 0;     // woke up, then drew nothing
+  double idle_wakeups_per_second = 0; // over windows of at least 1 s
+  double last_input_to_paint_ms = 0;
+  double max_input_to_paint_ms = 0;
+  double total_input_to_paint_ms = 0;
+  std::uint64_t painted_inputs = 0;
+
+  // After a wait returns; `input` when it delivered a key or mouse event.
+  void woke(Clock::time_point now, bool input);
+  // After the frame that follows a wakeup; `painted` when it wrote output.
+  void frame_done(Clock::time_point now, bool painted);
+
+private:
+  Clock::time_point window_start{};
+  std::uint64_t window_idle = 0;
+  Clock::time_point input_at{};
+  bool input_pending = false;
+  bool wake_pending = false;
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "save_pipeline.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+namespace fs = std::filesystem;
+
+// Bytes per write() call.
+constexpr std::size_t kWriteChunk = 1 << 20;
+
+#if defined(JOT_PLATFORM_POSIX)
+// Mode for files that do not exist yet, as open() would give them. The
+// umask can only be read by setting it, so that happens once, on the UI
+// thread, before the worker starts.
+mode_t new_file_mode = 0644;
+
+void read_umask() {
+  static bool done = false;
+  if (!done) {
+    const mode_t mask = umask(022);
+    umask(mask);
+    new_file_mode = 0666 & ~mask;
+    done = true;
+  }
+}
+
+bool write_fd(int fd, const std::string &text) {
+  std::size_t at = 0;
+  while (at < text.size()) {
+    const ssize_t n =
+        write(fd, text.data() + at, std::min(kWriteChunk, text.size() - at));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    at += (std::size_t)n;
+  }
+  return true;
+}
+#endif
+} // namespace
+
+SavePipeline::SavePipeline() {
+#if defined(JOT_PLATFORM_POSIX)
+  read_umask();
+#endif
+}
+
+SavePipeline::~SavePipeline() {
+  // Queued jobs are still written; only their formatters are skipped.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+bool SavePipeline::write_atomic(const std::string &path,
+                                const std::string &text, std::string &error) {
+  std::error_code ec;
+  fs::path target(path);
+  if (fs::is_symlink(target, ec)) {
+    const fs::path resolved = fs::canonical(target, ec);
+    if (!ec) {
+      target = resolved;
+    }
+  }
+  fs::path dir = target.parent_path();
+  if (dir.empty()) {
+    dir = ".";
+  }
+  const std::string temp_name =
+      (dir / ("." + target.filename().string() + ".jot-save-XXXXXX")).string();
+
+#if defined(JOT_PLATFORM_POSIX)
+  std::vector<char> temp(temp_name.begin(), temp_name.end());
+  temp.push_back('\0');
+  const int fd = mkstemp(temp.data());
+  if (fd < 0) {
+    error = "cannot create file in " + dir.string() + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (stat(target.c_str(), &st) == 0) {
+    fchmod(fd, st.st_mode & 07777);
+    // Keeps the owner when saving someone else's file as root; harmless to
+    // fail otherwise.
+    (void)!fchown(fd, st.st_uid, st.st_gid);
+  } else {
+    fchmod(fd, new_file_mode);
+  }
+
+  bool ok = write_fd(fd, text);
+  if (!ok) {
+    error = std::string("write error: ") + strerror(errno);
+  } else if (fsync(fd) != 0) {
+    error = std::string("fsync failed: ") + strerror(errno);
+    ok = false;
+  }
+  if (close(fd) != 0 && ok) {
+    error = std::string("write error: ") + strerror(errno);
+    ok = false;
+  }
+  if (ok && rename(temp.data(), target.c_str()) != 0) {
+    error = "cannot replace " + target.string() + ": " + strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp.data());
+    return false;
+  }
+
+  // Makes the rename itself durable.
+  const int dir_fd = open(dir.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  return true;
+#else
+  const std::string temp = temp_name.substr(0, temp_name.size() - 6) + "tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      error = "cannot create file in " + dir.string();
+      return false;
+    }
+    out.write(text.data(), (std::streamsize)text.size());
+    out.flush();
+    if (!out.good()) {
+      out.close();
+      fs::remove(temp, ec);
+      error = "write error";
+      return false;
+    }
+  }
+  fs::rename(temp, target, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+    error = "cannot replace " + target.string();
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool SavePipeline::run_formatter(const std::string &command,
+                                 std::string &out) {
+  out.clear();
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe) {
+    return false;
+  }
+  char buf[64 * 1024];
+  std::size_t n = 0;
+  while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+    out.append(buf, n);
+  }
+  const int status = pclose(pipe);
+#if defined(JOT_PLATFORM_POSIX)
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+  return status == 0;
+#endif
+}
+
+void SavePipeline::set_ready_callback(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ready_callback = std::move(callback);
+}
+
+void SavePipeline::submit(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto same = std::find_if(queue.begin(), queue.end(), [&](const Job &j) {
+      return j.path == job.path;
+    });
+    if (same != queue.end()) {
+      job.announce = job.announce || same->announce;
+      *same = std::move(job);
+    } else {
+      queue.push_back(std::move(job));
+    }
+    if (!worker.joinable()) {
+      worker = std::thread(&SavePipeline::run, this);
+    }
+  }
+  wake.notify_one();
+}
+
+bool SavePipeline::busy() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return !queue.empty() || running || !finished.empty();
+}
+
+bool SavePipeline::take(std::vector<Result> &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (finished.empty()) {
+    return false;
+  }
+  for (auto &result : finished) {
+    out.push_back(std::move(result));
+  }
+  finished.clear();
+  return true;
+}
+
+void SavePipeline::wait_idle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return queue.empty() && !running; });
+}
+
+void SavePipeline::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty()) {
+      return;
+    }
+    Job job = std::move(queue.front());
+    queue.pop_front();
+    running = true;
+    const bool format = !stopping;
+    lock.unlock();
+    Result result = process(job, format);
+    lock.lock();
+    running = false;
+    finished.push_back(std::move(result));
+    if (queue.empty()) {
+      idle.notify_all();
+    }
+    if (ready_callback) {
+      ready_callback();
+    }
+  }
+}
+
+SavePipeline::Result SavePipeline::process(Job &job, bool format) {
+  Result result;
+  result.path = job.path;
+  result.announce = job.announce;
+  result.journal_id = job.journal_id;
+  result.revision = job.revision;
+  std::string text = job.lines.join('\n');
+  text.push_back('\n');
+  result.ok = write_atomic(job.path, text, result.error);
+  if (result.ok && format && !job.formatter.empty()) {
+    std::string out;
+    if (run_formatter(job.formatter, out)) {
+      result.formatted = true;
+      result.formatter_name = job.formatter_name;
+      result.formatted_text = std::move(out);
+    }
+  }
+  return result;
+}
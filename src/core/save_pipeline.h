@@ -0,0 +1,93 @@
+#ifndef SAVE_PIPELINE_H
+#define SAVE_PIPELINE_H
+
+#include "line_store.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes buffers to disk on a worker thread, so saving never blocks typing.
+//
+// A job carries a snapshot of a buffer's lines, a LineStore copy sharing
+// its blocks, so taking one costs O(blocks) on the UI thread. The worker
+// serializes it and writes it to a temporary file beside the target in
+// large writes, fsyncs it, renames it over the target and fsyncs the
+// directory: after a crash the target holds either the old or the new
+// text, never a torn mix.
+// The target keeps its permissions, and a symlink is written through.
+//
+// A job may name a formatter command, which runs once the text is on disk
+// and prints the formatted file. Its output comes back with the result;
+// the UI merges it into the buffer only if the buffer's revision is still
+// the one saved, and then saves that.
+//
+// A queued job is superseded by a newer one for the same path.
+class SavePipeline {
+public:
+  struct Job {
+    std::string path;
+    LineStore lines; // written joined by '\n', with a final newline
+    std::string formatter;      // shell command printing the formatted file
+    std::string formatter_name; // for messages
+    bool announce = false;
+    // LineStore identity at the snapshot.
+    std::uint64_t journal_id = 0;
+    std::uint64_t revision = 0;
+  };
+
+  struct Result {
+    std::string path;
+    bool ok = false;
+    std::string error;
+    bool announce = false;
+    std::uint64_t journal_id = 0;
+    std::uint64_t revision = 0;
+    // Set when the formatter ran and exited cleanly.
+    bool formatted = false;
+    std::string formatter_name;
+    std::string formatted_text;
+  };
+
+  SavePipeline();
+  ~SavePipeline();
+  SavePipeline(const SavePipeline &) = delete;
+  SavePipeline &operator=(const SavePipeline &) = delete;
+
+  // Replaces `path` with `text` as described above. On failure the target
+  // is untouched and `error` says why.
+  static bool write_atomic(const std::string &path, const std::string &text,
+                           std::string &error);
+  // Output of `command` when it exits with status 0.
+  static bool run_formatter(const std::string &command, std::string &out);
+
+  // Runs on the worker after each finished job.
+  void set_ready_callback(std::function<void()> callback);
+  void submit(Job job);
+  // True while a job is queued or running, or results wait to be taken.
+  bool busy() const;
+  // Moves the finished results into `out`. Returns false if none.
+  bool take(std::vector<Result> &out);
+  // Blocks until every submitted job is on disk.
+  void wait_idle();
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::thread worker;
+  std::function<void()> ready_callback;
+  bool stopping = false;
+  bool running = false;
+  std::deque<Job> queue;
+  std::vector<Result> finished;
+
+  void run();
+  Result process(Job &job, bool format);
+};
+
+#endif
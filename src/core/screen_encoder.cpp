@@ -0,0 +1,256 @@
+#include "screen_encoder.h"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+// Re-printing cells is only worth it for short gaps; any move costs less.
+constexpr std::size_t kMaxReprintBytes = 8;
+
+int digit_count(int value) {
+  int digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+void append_int(std::string &out, int value) {
+  char digits[12];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  out.append(digits, result.ptr);
+}
+
+// CSI n <final>; a count of 1 is the default and left out.
+void append_csi_count(std::string &out, int count, char final) {
+  out += "\x1b[";
+  if (count != 1) {
+    append_int(out, count);
+  }
+  out += final;
+}
+
+int csi_count_cost(int count) {
+  return 3 + (count == 1 ? 0 : digit_count(count));
+}
+
+void append_param(std::string &params, int value) {
+  if (!params.empty()) {
+    params += ';';
+  }
+  append_int(params, value);
+}
+
+void append_color_params(std::string &params, int selector, int color) {
+  append_param(params, selector);
+  append_param(params, 5);
+  append_param(params, color);
+}
+} // namespace
+
+void ScreenEncoder::set_columns(int columns) {
+  cols = columns;
+  forget_cursor();
+}
+
+void ScreenEncoder::cursor_moved_to(int x, int y) {
+  cursor_known = true;
+  cursor_x = x;
+  cursor_y = y;
+}
+
+void ScreenEncoder::style_was_reset() {
+  pen = Pen();
+  pen_known = true;
+}
+
+void ScreenEncoder::append_motion(std::string &out, int x, int y) const {
+  // CUP with defaulted parameters: ESC[H, ESC[5H, ESC[;5H, ESC[3;5H.
+  std::string absolute = "\x1b[";
+  if (y > 0) {
+    append_int(absolute, y + 1);
+  }
+  if (x > 0) {
+    absolute += ';';
+    append_int(absolute, x + 1);
+  }
+  absolute += 'H';
+  if (!cursor_known) {
+    out += absolute;
+    return;
+  }
+
+  // Relative: vertical by LF/CUU/CUD, horizontal by CR/CUF/CUB. After the
+  // last column the terminal has a pending wrap, which only CR clears in a
+  // well-defined way, so the column then always comes from CR.
+  const bool pending_wrap = cursor_x >= cols;
+  const int dx = x - cursor_x;
+  const bool use_cr =
+      pending_wrap || x == 0 ||
+      (dx < 0 && 1 + (x > 0 ? csi_count_cost(x) : 0) < csi_count_cost(-dx));
+  std::string relative;
+  if (use_cr) {
+    relative += '\r';
+  }
+  const int dy = y - cursor_y;
+  if (dy == 1) {
+    relative += '\n';
+  } else if (dy > 1) {
+    append_csi_count(relative, dy, 'B');
+  } else if (dy < 0) {
+    append_csi_count(relative, -dy, 'A');
+  }
+  const int from_x = use_cr ? 0 : cursor_x;
+  if (x > from_x) {
+    append_csi_count(relative, x - from_x, 'C');
+  } else if (x < from_x) {
+    append_csi_count(relative, from_x - x, 'D');
+  }
+  out += relative.size() < absolute.size() ? relative : absolute;
+}
+
+void ScreenEncoder::move_to(std::string &out, int x, int y) {
+  if (cursor_known && cursor_x == x && cursor_y == y) {
+    return;
+  }
+  const std::size_t start = out.size();
+  append_motion(out, x, y);
+  counters.motion_bytes += out.size() - start;
+  cursor_moved_to(x, y);
+}
+
+void ScreenEncoder::move_within_row(std::string &out, const GlyphTable &glyphs,
+                                    const Cell *row, const Cell *shown, int x,
+                                    int y) {
+  if (cursor_known && cursor_y == y && cursor_x < x) {
+    // Writing the unchanged cells again also moves the cursor forward, and
+    // for a gap of a few plain cells it is shorter than any escape.
+    scratch.clear();
+    bool reprint = true;
+    for (int k = cursor_x; k < x && reprint; k++) {
+      const std::string_view text = glyphs.text(row[k].glyph);
+      scratch.append(text.data(), text.size());
+      reprint = row[k] == shown[k] && pen_matches(row[k]) &&
+                scratch.size() <= kMaxReprintBytes;
+    }
+    if (reprint) {
+      std::string motion;
+      append_motion(motion, x, y);
+      if (scratch.size() < motion.size()) {
+        out += scratch;
+        counters.motion_bytes += scratch.size();
+        cursor_x = x;
+        return;
+      }
+    }
+  }
+  move_to(out, x, y);
+}
+
+void ScreenEncoder::set_style(std::string &out, const Cell &cell) {
+  if (pen_matches(cell)) {
+    return;
+  }
+  static constexpr struct {
+    std::uint8_t flag;
+    int on, off;
+  } kAttrs[] = {{CELL_BOLD, 1, 22}, {CELL_ITALIC, 3, 23}, {CELL_REVERSE, 7, 27}};
+
+  // Either reset and set everything, or change only what differs.
+  std::string full = "0";
+  for (const auto &attr : kAttrs) {
+    if (cell.attrs & attr.flag) {
+      append_param(full, attr.on);
+    }
+  }
+  append_color_params(full, 38, cell.fg);
+  append_color_params(full, 48, cell.bg);
+
+  std::string params = full;
+  if (pen_known) {
+    std::string delta;
+    for (const auto &attr : kAttrs) {
+      const bool want = cell.attrs & attr.flag;
+      if (want != bool(pen.attrs & attr.flag)) {
+        append_param(delta, want ? attr.on : attr.off);
+      }
+    }
+    if (pen.fg != cell.fg) {
+      append_color_params(delta, 38, cell.fg);
+    }
+    if (pen.bg != cell.bg) {
+      append_color_params(delta, 48, cell.bg);
+    }
+    if (delta.size() < full.size()) {
+      params = std::move(delta);
+    }
+  }
+
+  const std::size_t start = out.size();
+  out += "\x1b[";
+  out += params;
+  out += 'm';
+  counters.style_bytes += out.size() - start;
+  pen.fg = cell.fg;
+  pen.bg = cell.bg;
+  pen.attrs = cell.attrs;
+  pen_known = true;
+}
+
+void ScreenEncoder::advance(int columns) {
+  cursor_x = std::min(cols, cursor_x + columns);
+}
+
+void ScreenEncoder::encode_span(std::string &out, const GlyphTable &glyphs,
+                                const Cell *row, const Cell *shown, int y,
+                                int x0, int x1) {
+  int x = first_cell_difference(row, shown, x0, x1);
+  while (x < x1) {
+    move_within_row(out, glyphs, row, shown, x, y);
+    const Cell style = row[x];
+    set_style(out, style);
+
+    const std::size_t start = out.size();
+    while (x < x1 && row[x] != shown[x] && row[x].same_style(style)) {
+      const Cell &cell = row[x];
+      int run = 1;
+      while (x + run < x1 && row[x + run] == cell) {
+        run++;
+      }
+
+      // Erased cells take the current background; reverse video would
+      // not apply to them, so those blanks are written out.
+      if (cell.glyph == ' ' && caps.erase_chars &&
+          !(cell.attrs & CELL_REVERSE)) {
+        bool to_eol = x + run == x1;
+        for (int k = x1; k < cols && to_eol; k++) {
+          to_eol = row[k] == cell;
+        }
+        if (to_eol && run > 3) {
+          out += "\x1b[K";
+          x = x1;
+          break;
+        }
+        // ECH leaves the cursor in place; count the move past the blanks.
+        if (2 * csi_count_cost(run) < run) {
+          append_csi_count(out, run, 'X');
+          x += run;
+          break;
+        }
+      }
+
+      const std::string_view text = glyphs.text(cell.glyph);
+      out.append(text.data(), text.size());
+      if (caps.repeat_char && run > 1 &&
+          csi_count_cost(run - 1) < (int)text.size() * (run - 1)) {
+        append_csi_count(out, run - 1, 'b');
+      } else {
+        run = 1;
+      }
+      advance(run);
+      x += run;
+    }
+    counters.text_bytes += out.size() - start;
+    x = first_cell_difference(row, shown, x, x1);
+  }
+}
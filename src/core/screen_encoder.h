@@ -0,0 +1,75 @@
+#ifndef SCREEN_ENCODER_H
+#define SCREEN_ENCODER_H
+
+#include "cell_grid.h"
+#include <cstdint>
+#include <string>
+
+// Turns cell changes into terminal output using as few bytes as it can. It
+// tracks the terminal's cursor and SGR state, so a style change sends only
+// the parameters that differ, and a cursor move picks the shortest of CUP,
+// relative moves, CR/LF and re-printing the unchanged cells in between.
+// Runs of blanks become ECH/EL and runs of one glyph become REP when that is
+// shorter. Every glyph is assumed to take one column, as in the UI grid.
+class ScreenEncoder {
+public:
+  struct Caps {
+    bool erase_chars = true; // ECH/EL, filling with the current background
+    bool repeat_char = true; // REP
+  };
+  struct Stats {
+    std::uint64_t motion_bytes = 0;
+    std::uint64_t style_bytes = 0;
+    std::uint64_t text_bytes = 0;
+    std::uint64_t total() const {
+      return motion_bytes + style_bytes + text_bytes;
+    }
+  };
+
+  void set_caps(const Caps &new_caps) { caps = new_caps; }
+  void set_columns(int columns);
+
+  // Keep the tracked state honest when output bypasses the encoder.
+  void forget_cursor() { cursor_known = false; }
+  void forget_style() { pen_known = false; }
+  void cursor_moved_to(int x, int y);
+  void style_was_reset();
+
+  void move_to(std::string &out, int x, int y);
+  void set_style(std::string &out, const Cell &cell);
+  // Sends the cells in [x0, x1) of row y where `row` differs from `shown`.
+  // Cells outside the span must already match what the terminal shows.
+  void encode_span(std::string &out, const GlyphTable &glyphs, const Cell *row,
+                   const Cell *shown, int y, int x0, int x1);
+
+  const Stats &stats() const { return counters; }
+
+private:
+  // SGR state; fg/bg of -1 is the terminal default after SGR 0.
+  struct Pen {
+    int fg = -1;
+    int bg = -1;
+    std::uint8_t attrs = 0;
+  };
+
+  void move_within_row(std::string &out, const GlyphTable &glyphs,
+                       const Cell *row, const Cell *shown, int x, int y);
+  void append_motion(std::string &out, int x, int y) const;
+  bool pen_matches(const Cell &cell) const {
+    return pen_known && pen.fg == cell.fg && pen.bg == cell.bg &&
+           pen.attrs == cell.attrs;
+  }
+  void advance(int columns);
+
+  Caps caps;
+  Stats counters;
+  Pen pen;
+  bool pen_known = false;
+  bool cursor_known = false;
+  int cursor_x = 0; // == cols after writing the last column (pending wrap)
+  int cursor_y = 0;
+  int cols = 0;
+  std::string scratch;
+};
+
+#endif
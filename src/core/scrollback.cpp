@@ -0,0 +1,116 @@
+#include "scrollback.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr std::size_t kMinCells = 4096;
+constexpr std::size_t kMinExtents = 64;
+// Positions are 32-bit, so the cell ring stays well below 2^32.
+constexpr std::size_t kMaxLines = (std::size_t)1 << 23;
+
+std::size_t round_up_pow2(std::size_t n) {
+  std::size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+} // namespace
+
+Scrollback::Scrollback(std::size_t max_lines)
+    : limit(std::min(max_lines, kMaxLines)),
+      max_cells(round_up_pow2(std::max(kMinCells, limit * kCellsPerLine))) {}
+
+void Scrollback::push(const Cell *row, int width) {
+  if (limit == 0) {
+    return;
+  }
+  const std::uint32_t w =
+      (std::uint32_t)std::min((std::size_t)std::max(width, 0), max_cells);
+  if (count == limit) {
+    drop_oldest();
+  }
+  if (count == extents.size()) {
+    grow_extents();
+  }
+  if (cells.size() < std::max<std::size_t>(w, 1)) {
+    grow_cells(w);
+  }
+
+  // Skip the ring's tail when the row would wrap, then make room by
+  // growing or, at the cap, by dropping the oldest rows.
+  std::uint32_t at = 0;
+  while (true) {
+    const std::uint32_t cap = (std::uint32_t)cells.size();
+    at = head;
+    const std::uint32_t offset = at & (cap - 1);
+    if (offset + w > cap) {
+      at += cap - offset;
+    }
+    const std::uint32_t tail = count > 0 ? extents[first].start : at;
+    if (at + w - tail <= cap) {
+      break;
+    }
+    if (cap < max_cells) {
+      grow_cells(0);
+    } else {
+      drop_oldest();
+    }
+  }
+
+  if (w > 0) {
+    std::memcpy(cells.data() + (at & (cells.size() - 1)), row,
+                w * sizeof(Cell));
+  }
+  extents[(first + count) & (extents.size() - 1)] = {at, w};
+  count++;
+  head = at + w;
+}
+
+void Scrollback::clear() {
+  std::vector<Cell>().swap(cells);
+  std::vector<Extent>().swap(extents);
+  first = 0;
+  count = 0;
+  head = 0;
+}
+
+std::size_t Scrollback::memory_bytes() const {
+  return cells.capacity() * sizeof(Cell) + extents.capacity() * sizeof(Extent);
+}
+
+void Scrollback::drop_oldest() {
+  first = (first + 1) & (extents.size() - 1);
+  count--;
+}
+
+// Doubles the cell ring, at least to at_least, packing the rows kept from
+// its start.
+void Scrollback::grow_cells(std::size_t at_least) {
+  std::size_t cap = std::max(kMinCells, cells.size() * 2);
+  while (cap < at_least) {
+    cap <<= 1;
+  }
+  cap = std::min(cap, max_cells);
+
+  std::vector<Cell> packed(cap);
+  std::uint32_t pos = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    Extent &e = extents[(first + i) & (extents.size() - 1)];
+    std::memcpy(packed.data() + pos, cells.data() + (e.start & (cells.size() - 1)),
+                e.width * sizeof(Cell));
+    e.start = pos;
+    pos += e.width;
+  }
+  cells.swap(packed);
+  head = pos;
+}
+
+void Scrollback::grow_extents() {
+  std::vector<Extent> grown(std::max(kMinExtents, extents.size() * 2));
+  for (std::size_t i = 0; i < count; i++) {
+    grown[i] = extents[(first + i) & (extents.size() - 1)];
+  }
+  extents.swap(grown);
+  first = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include "cell_grid.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A row of cells read in place; valid until its owner changes.
+struct CellSpan {
+  const Cell *cells = nullptr;
+  int width = 0;
+};
+
+// Rows scrolled off a terminal screen, oldest first. Cells of all rows are
+// packed into one ring, a row never wrapping around its end, with an
+// 8-byte extent per row in a second ring; pushing a row copies its cells
+// once and allocates nothing once the rings have grown. Both rings grow
+// on demand: up to max_lines rows, and up to an average of kCellsPerLine
+// cells per row, past which the oldest rows are dropped.
+class Scrollback {
+public:
+  static constexpr std::size_t kCellsPerLine = 256;
+
+  explicit Scrollback(std::size_t max_lines = 0);
+
+  void push(const Cell *cells, int width);
+  void clear();
+
+  std::size_t size() const { return count; }
+  std::size_t max_lines() const { return limit; }
+  CellSpan line(std::size_t i) const {
+    const Extent &e = extents[(first + i) & (extents.size() - 1)];
+    return {cells.data() + (e.start & (cells.size() - 1)), (int)e.width};
+  }
+  // Heap bytes held by both rings.
+  std::size_t memory_bytes() const;
+
+private:
+  struct Extent {
+    std::uint32_t start; // position in an endless run of cells
+    std::uint32_t width;
+  };
+
+  std::size_t limit;
+  std::size_t max_cells;
+  std::vector<Cell> cells;      // power-of-two ring
+  std::vector<Extent> extents;  // power-of-two ring
+  std::size_t first = 0;
+  std::size_t count = 0;
+  std::uint32_t head = 0; // where the next row's cells go
+
+  void drop_oldest();
+  void grow_cells(std::size_t at_least);
+  void grow_extents();
+};
+
+#endif
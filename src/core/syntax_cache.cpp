@@ -0,0 +1,185 @@
+#include "syntax_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace {
+// Spare room added whenever the gap has to grow.
+constexpr std::size_t kMinGap = 64;
+} // namespace
+
+const std::vector<std::pair<int, int>> &
+SyntaxCache::line_colors(const LineStore &lines, int line_idx,
+                         const SyntaxHighlighter &highlighter) {
+  sync(lines);
+  const std::size_t target = (std::size_t)line_idx;
+
+  const std::size_t first = std::min(valid_lines, target);
+  SyntaxState state = first > 0 ? at(first - 1).end_state : 0;
+  for (std::size_t i = first; i < target; i++) {
+    SyntaxLineCache &above = at(i);
+    refresh(above, lines[i], state, highlighter);
+    state = above.end_state;
+  }
+
+  SyntaxLineCache &cache = at(target);
+  if (refresh(cache, lines[target], state, highlighter)) {
+    if (valid_lines > target + 1) {
+      generation_ = next_generation();
+    }
+    valid_lines = target + 1;
+  } else {
+    valid_lines = std::max(valid_lines, target + 1);
+  }
+  return cache.colors;
+}
+
+void SyntaxCache::invalidate_from(int line_idx) {
+  valid_lines = std::min(valid_lines, (std::size_t)std::max(0, line_idx));
+  generation_ = next_generation();
+  ++revision_;
+}
+
+void SyntaxCache::clear() {
+  slots.clear();
+  slots.shrink_to_fit();
+  gap_begin = gap_end = 0;
+  valid_lines = 0;
+  synced_journal = 0;
+  synced_version = 0;
+  generation_ = next_generation();
+  ++revision_;
+}
+
+void SyntaxCache::store(std::size_t line, SyntaxLineCache cache) {
+  if (line < size()) {
+    at(line) = std::move(cache);
+    ++revision_;
+  }
+}
+
+void SyntaxCache::settle(std::size_t count) {
+  ++revision_;
+  valid_lines = std::max(valid_lines, std::min(count, size()));
+}
+
+std::uint64_t SyntaxCache::next_generation() {
+  static std::atomic<std::uint64_t> counter{0};
+  return ++counter;
+}
+
+void SyntaxCache::sync(const LineStore &lines) {
+  if (lines.journal_id() != synced_journal) {
+    reset(lines.size());
+    synced_journal = lines.journal_id();
+    synced_version = lines.journal_version();
+    return;
+  }
+  if (lines.journal_version() == synced_version) {
+    return;
+  }
+
+  pending_edits.clear();
+  bool in_step = lines.edits_since(synced_version, pending_edits);
+  for (const auto &edit : pending_edits) {
+    if (!in_step) {
+      break;
+    }
+    if (edit.count > 0) {
+      in_step = edit.index <= size();
+      if (in_step) {
+        insert_lines(edit.index, (std::size_t)edit.count);
+      }
+    } else {
+      in_step = edit.index + (std::size_t)-edit.count <= size();
+      if (in_step) {
+        erase_lines(edit.index, (std::size_t)-edit.count);
+      }
+    }
+    valid_lines = std::min(valid_lines, edit.index);
+  }
+  synced_version = lines.journal_version();
+  generation_ = next_generation();
+  if (!in_step || size() != lines.size()) {
+    reset(lines.size());
+  }
+}
+
+void SyntaxCache::reset(std::size_t line_count) {
+  slots.clear();
+  slots.resize(line_count + kMinGap);
+  gap_begin = line_count;
+  gap_end = slots.size();
+  valid_lines = 0;
+  generation_ = next_generation();
+  ++revision_;
+}
+
+void SyntaxCache::move_gap(std::size_t line) {
+  if (line < gap_begin) {
+    std::move_backward(slots.begin() + line, slots.begin() + gap_begin,
+                       slots.begin() + gap_end);
+    gap_end -= gap_begin - line;
+    gap_begin = line;
+  } else if (line > gap_begin) {
+    const std::size_t count = line - gap_begin;
+    std::move(slots.begin() + gap_end, slots.begin() + gap_end + count,
+              slots.begin() + gap_begin);
+    gap_begin += count;
+    gap_end += count;
+  }
+}
+
+void SyntaxCache::insert_lines(std::size_t line, std::size_t count) {
+  if (gap_size() < count) {
+    // Regrow with the gap already at `line`.
+    std::vector<SyntaxLineCache> grown;
+    const std::size_t lines = size();
+    const std::size_t gap = count + std::max(kMinGap, lines / 8);
+    grown.resize(lines + gap);
+    for (std::size_t i = 0; i < lines; i++) {
+      grown[i < line ? i : i + gap] = std::move(at(i));
+    }
+    slots.swap(grown);
+    gap_begin = line;
+    gap_end = line + gap;
+  } else {
+    move_gap(line);
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    slots[gap_begin++] = SyntaxLineCache();
+  }
+}
+
+void SyntaxCache::erase_lines(std::size_t line, std::size_t count) {
+  move_gap(line);
+  for (std::size_t i = 0; i < count; i++) {
+    slots[gap_end++] = SyntaxLineCache();
+  }
+}
+
+// Re-lexes `line` unless the cache already holds it lexed from `entry`.
+// Returns true when the line's end state changed, i.e. the lines below may
+// now be lexed from the wrong state.
+bool SyntaxCache::refresh(SyntaxLineCache &cache, const std::string &line,
+                          SyntaxState entry,
+                          const SyntaxHighlighter &highlighter) {
+  const std::size_t line_hash = std::hash<std::string>{}(line);
+  if (cache.valid && cache.line_hash == line_hash &&
+      cache.line_length == line.length() && cache.start_state == entry) {
+    ++counters.hits;
+    return false;
+  }
+
+  ++counters.misses;
+  const bool was_valid = cache.valid;
+  const SyntaxState previous_end = cache.end_state;
+  SyntaxState state = entry;
+  cache.colors = highlighter.get_colors(line, state);
+  cache.line_hash = line_hash;
+  cache.line_length = line.length();
+  cache.start_state = entry;
+  cache.end_state = state;
+  cache.valid = true;
+  return !was_valid || previous_end != state;
+}
@@ -0,0 +1,93 @@
+#ifndef SYNTAX_CACHE_H
+#define SYNTAX_CACHE_H
+
+#include "line_store.h"
+#include "syntax.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SyntaxLineCache {
+  bool valid = false;
+  std::size_t line_hash = 0;
+  std::size_t line_length = 0;
+  SyntaxState start_state = 0; // state the line was lexed from
+  SyntaxState end_state = 0;   // state left open at the end of the line
+  std::vector<std::pair<int, int>> colors;
+};
+
+// Per-buffer highlight cache indexed by line number. Entries live in a gap
+// vector kept parallel to the buffer's LineStore: inserts and erases read
+// from the store's journal shift the entries after them, so only the lines
+// actually touched are highlighted again.
+//
+// Lines [0, valid_lines) were lexed from the state their previous line
+// ends in. Lookups walk forward from there and reuse every unchanged line
+// entered in its cached state, so after an edit re-lexing stops as soon as
+// the carried state converges with the cached one.
+class SyntaxCache {
+public:
+  struct Stats {
+    std::uint64_t hits = 0;   // lines served without lexing
+    std::uint64_t misses = 0; // lines lexed
+  };
+
+  const std::vector<std::pair<int, int>> &
+  line_colors(const LineStore &lines, int line_idx,
+              const SyntaxHighlighter &highlighter);
+
+  // Lines from `line_idx` on must re-check the state they are entered in.
+  void invalidate_from(int line_idx);
+  void clear();
+
+  // Entry points for lexing done elsewhere (HighlightScheduler). sync()
+  // shifts the entries along with the store's journal; entry() then reads
+  // one without lexing it, so it may be invalid or lexed from old content.
+  void sync(const LineStore &lines);
+  const SyntaxLineCache &entry(std::size_t line) const {
+    return slots[line < gap_begin ? line : line + gap_size()];
+  }
+  // Replaces one entry, and marks lines [0, count) as lexed from the state
+  // their previous line ends in.
+  void store(std::size_t line, SyntaxLineCache cache);
+  void settle(std::size_t count);
+  std::size_t settled_lines() const { return valid_lines; }
+  // Changes whenever entries are invalidated or shifted, so work started
+  // from an older snapshot can be told apart and dropped.
+  std::uint64_t generation() const { return generation_; }
+  // Changes whenever an entry is stored or dropped.
+  std::uint64_t revision() const { return revision_; }
+
+  std::size_t size() const { return slots.size() - gap_size(); }
+  const Stats &stats() const { return counters; }
+  void reset_stats() { counters = Stats(); }
+
+private:
+  std::vector<SyntaxLineCache> slots;
+  std::size_t gap_begin = 0;
+  std::size_t gap_end = 0;
+  std::size_t valid_lines = 0;
+  std::uint64_t synced_journal = 0;
+  std::uint64_t synced_version = 0;
+  std::vector<LineStore::Edit> pending_edits;
+  Stats counters;
+  std::uint64_t generation_ = next_generation();
+  std::uint64_t revision_ = 0;
+
+  static std::uint64_t next_generation();
+
+  std::size_t gap_size() const { return gap_end - gap_begin; }
+  SyntaxLineCache &at(std::size_t line) {
+    return slots[line < gap_begin ? line : line + gap_size()];
+  }
+  void reset(std::size_t line_count);
+  void move_gap(std::size_t line);
+  void insert_lines(std::size_t line, std::size_t count);
+  void erase_lines(std::size_t line, std::size_t count);
+  bool refresh(SyntaxLineCache &cache, const std::string &line,
+               SyntaxState entry, const SyntaxHighlighter &highlighter);
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "text_delta.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+// Lines [lo, hi) of the current version that may differ from the version
+// sent, all others being the same lines shifted. An empty range marks
+// where lines were erased.
+struct DirtyRange {
+  bool dirty = false;
+  std::size_t lo = 0;
+  std::size_t hi = 0;
+
+  void mark(std::size_t first, std::size_t last) {
+    if (!dirty) {
+      dirty = true;
+      lo = first;
+      hi = last;
+      return;
+    }
+    lo = std::min(lo, first);
+    hi = std::max(hi, last);
+  }
+
+  void insert(std::size_t index, std::size_t count) {
+    if (dirty && hi > index) {
+      hi += count;
+    }
+    mark(index, index + count);
+  }
+
+  void erase(std::size_t index, std::size_t count) {
+    if (dirty) {
+      auto shift = [&](std::size_t pos) {
+        return pos <= index ? pos : pos < index + count ? index : pos - count;
+      };
+      lo = shift(lo);
+      hi = shift(hi);
+    }
+    mark(index, index);
+  }
+};
+} // namespace
+
+TextSyncPoint text_sync_point(const LineStore &lines) {
+  TextSyncPoint point;
+  point.journal_id = lines.journal_id();
+  point.journal_version = lines.journal_version();
+  point.touch_count = lines.touch_count();
+  point.revision = lines.revision();
+  point.line_count = lines.size();
+  if (!lines.empty()) {
+    const std::string &last = lines.back();
+    point.last_line_units = utf16_length(last, last.size());
+  }
+  return point;
+}
+
+TextDeltaResult changed_lines(const TextSyncPoint &since,
+                              const LineStore &lines, std::size_t &first,
+                              std::size_t &last) {
+  if (lines.journal_id() != since.journal_id) {
+    return TEXT_DELTA_FULL;
+  }
+  if (lines.revision() == since.revision) {
+    return TEXT_DELTA_NONE;
+  }
+
+  std::vector<LineStore::Edit> edits;
+  std::vector<LineStore::Touch> touches;
+  if (!lines.edits_since(since.journal_version, edits) ||
+      !lines.touches_since(since.touch_count, touches)) {
+    return TEXT_DELTA_FULL;
+  }
+
+  // Replayed in order: touches are numbered as after the edits up to their
+  // version. One not touched again since the version sent was sent then.
+  DirtyRange range;
+  std::size_t line_count = since.line_count;
+  std::size_t next_touch = 0;
+  auto apply_touches = [&](std::uint64_t version) {
+    for (; next_touch < touches.size() &&
+           touches[next_touch].version <= version;
+         next_touch++) {
+      const LineStore::Touch &touch = touches[next_touch];
+      const std::size_t first = std::min(touch.first, line_count);
+      const std::size_t last = std::min(touch.last, line_count);
+      if (touch.revision > since.revision && first < last) {
+        range.mark(first, last);
+      }
+    }
+  };
+  std::uint64_t version = since.journal_version;
+  apply_touches(version);
+  for (const LineStore::Edit &edit : edits) {
+    if (edit.count > 0) {
+      if (edit.index > line_count) {
+        return TEXT_DELTA_FULL;
+      }
+      range.insert(edit.index, (std::size_t)edit.count);
+      line_count += (std::size_t)edit.count;
+    } else {
+      const std::size_t count = (std::size_t)-edit.count;
+      if (edit.index + count > line_count) {
+        return TEXT_DELTA_FULL;
+      }
+      range.erase(edit.index, count);
+      line_count -= count;
+    }
+    apply_touches(++version);
+  }
+  if (line_count != lines.size()) {
+    return TEXT_DELTA_FULL;
+  }
+  if (!range.dirty) {
+    return TEXT_DELTA_NONE;
+  }
+  first = range.lo;
+  last = range.hi;
+  return TEXT_DELTA_RANGE;
+}
+
+TextDeltaResult compute_text_delta(const TextSyncPoint &since,
+                                   const LineStore &lines, TextDelta &out) {
+  if (since.line_count == 0 || lines.empty()) {
+    return TEXT_DELTA_FULL;
+  }
+  std::size_t lo = 0;
+  std::size_t hi = 0;
+  const TextDeltaResult result = changed_lines(since, lines, lo, hi);
+  if (result != TEXT_DELTA_RANGE) {
+    return result;
+  }
+
+  // Lines past the range are the same on both sides, so the old range ends
+  // as far from the old end as the new one does from the new end.
+  const std::size_t after = lines.size() - hi;
+  const std::size_t old_hi = since.line_count - after;
+  out.text.clear();
+  if (after > 0) {
+    // From the start of the first line to the start of the next unchanged
+    // one.
+    out.start_line = (int)lo;
+    out.start_character = 0;
+    out.end_line = (int)old_hi;
+    out.end_character = 0;
+    for (std::size_t i = lo; i < hi; ++i) {
+      out.text += lines[i];
+      out.text.push_back('\n');
+    }
+  } else if (lo > 0) {
+    // Runs to the end of the document: from the end of the unchanged line
+    // before it, so lines appended or erased there take their newline
+    // along.
+    const std::string &before = lines[lo - 1];
+    out.start_line = (int)lo - 1;
+    out.start_character = utf16_length(before, before.size());
+    out.end_line = (int)since.line_count - 1;
+    out.end_character = since.last_line_units;
+    for (std::size_t i = lo; i < hi; ++i) {
+      out.text.push_back('\n');
+      out.text += lines[i];
+    }
+  } else {
+    out.start_line = 0;
+    out.start_character = 0;
+    out.end_line = (int)since.line_count - 1;
+    out.end_character = since.last_line_units;
+    out.text = lines.join('\n');
+  }
+  return TEXT_DELTA_RANGE;
+}
+
+int utf16_length(const std::string &text, std::size_t bytes) {
+  bytes = std::min(bytes, text.size());
+  int units = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    const unsigned char c = (unsigned char)text[i];
+    if ((c & 0xC0) != 0x80) {
+      units += c >= 0xF0 ? 2 : 1;
+    }
+  }
+  return units;
+}
@@ -0,0 +1,58 @@
+#ifndef TEXT_DELTA_H
+#define TEXT_DELTA_H
+
+#include "line_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One ranged replacement that turns an old version of a document into a
+// new one, in the shape of an LSP TextDocumentContentChangeEvent. Columns
+// count UTF-16 code units, the LSP default position encoding.
+struct TextDelta {
+  int start_line = 0;
+  int start_character = 0;
+  int end_line = 0;
+  int end_character = 0;
+  std::string text;
+};
+
+// A version of a document as last sent: where its LineStore journal and
+// touch log stood, plus the two facts about the old text that a range
+// reaching the end of it needs and the journal does not keep.
+struct TextSyncPoint {
+  std::uint64_t journal_id = 0;
+  std::uint64_t journal_version = 0;
+  std::uint64_t touch_count = 0;
+  std::uint64_t revision = 0;
+  std::size_t line_count = 0;
+  int last_line_units = 0; // UTF-16 length of the last line
+};
+
+enum TextDeltaResult { TEXT_DELTA_NONE, TEXT_DELTA_RANGE, TEXT_DELTA_FULL };
+
+// Records `lines` as the version sent.
+TextSyncPoint text_sync_point(const LineStore &lines);
+
+// Lines [first, last) of `lines` that may differ from the version `since`
+// was taken at, read from the journal and the touch log; all others are the
+// same lines, shifted by what was inserted or erased. A line touched but
+// left unchanged counts as changed. Returns NONE when nothing changed, and
+// FULL when the journal no longer reaches back to `since`.
+TextDeltaResult changed_lines(const TextSyncPoint &since,
+                              const LineStore &lines, std::size_t &first,
+                              std::size_t &last);
+
+// Builds the change from the version `since` was taken at to `lines` out of
+// the journal of inserts and erases and the touch log of lines handed out
+// for writing, so no copy of the old text is kept. The range covers whole
+// lines; one touched but left unchanged is resent as is. Returns NONE when
+// nothing changed, and FULL when the journal no longer reaches back to
+// `since` or the contents were replaced: the whole text must be sent.
+TextDeltaResult compute_text_delta(const TextSyncPoint &since,
+                                   const LineStore &lines, TextDelta &out);
+
+// UTF-16 code units in the first `bytes` bytes of UTF-8 `text`.
+int utf16_length(const std::string &text, std::size_t bytes);
+
+#endif
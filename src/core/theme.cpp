@@ -71,6 +71,7 @@ void Editor::apply_theme(const std::string &name, bool persist, bool announce) {
 
   // Start from defaults, then let Python colorscheme override highlight groups.
   theme = Theme();
+  theme_revision++;
   if (!python_api->py_apply_colorscheme(resolved)) {
     theme = previous_theme;
     current_theme_name = previous_theme_name;
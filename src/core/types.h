@@ -1,11 +1,13 @@
 #ifndef EDITOR_TYPES_H
 #define EDITOR_TYPES_H
 
+#include "line_store.h"
+#include "match_index.h"
+#include "syntax_cache.h"
 #include "text_features.h"
 #include <cstddef>
-#include <regex>
+#include <deque>
 #include <set>
-#include <stack>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -117,7 +119,6 @@ struct Selection {
 };
 
 struct State {
-  std::vector<std::string> lines;
   Cursor cursor;
   int preferred_x;
   Selection selection;
@@ -126,15 +127,51 @@ struct State {
   bool modified;
 };
 
-struct SyntaxLineCache {
-  bool valid = false;
-  std::size_t line_hash = 0;
-  std::size_t line_length = 0;
-  std::vector<std::pair<int, int>> colors;
+// One undoable step: applying it puts `lines` back in place of the
+// `line_count` lines currently starting at `first_line`, and restores
+// `state`. Applying a step turns it into its own inverse.
+struct UndoEntry {
+  int first_line = 0;
+  int line_count = 0;
+  std::vector<std::string> lines;
+  State state;
+};
+
+// Operation log behind undo/redo. Steps only hold the lines an edit
+// touched, so memory follows the edits instead of file size x depth.
+class UndoHistory {
+public:
+  // Opens a step for an edit about to rewrite lines [first, last]. The
+  // step is sealed by the next record/undo/redo call, once the edit's
+  // effect on the line count is known. `coalesce` lets consecutive typed
+  // characters on one line share a step.
+  void record(const LineStore &lines, int first, int last,
+              const State &state, bool coalesce = false, long long now_ms = 0);
+  // On success `first_line`, if given, receives the first line rewritten.
+  bool undo(LineStore &lines, State &state, int *first_line = nullptr);
+  bool redo(LineStore &lines, State &state, int *first_line = nullptr);
+  void clear();
+  // Closes the open step, taking its line count from the edit made since.
+  // Lines added past the end afterwards stay outside it.
+  void seal(const LineStore &lines);
+
+  std::size_t undo_depth() const { return undo_steps.size(); }
+  std::size_t redo_depth() const { return redo_steps.size(); }
+  std::size_t memory_usage() const;
+
+private:
+  std::deque<UndoEntry> undo_steps;
+  std::deque<UndoEntry> redo_steps;
+  bool pending = false;
+  std::size_t pending_total_lines = 0;
+  int pending_base_count = 0;
+  int group_line = -1;
+  int group_next_x = -1;
+  long long group_last_ms = 0;
 };
 
 struct FileBuffer {
-  std::vector<std::string> lines;
+  LineStore lines;
   Cursor cursor;
   int preferred_x; // desired column for vertical movement
   Selection selection;
@@ -143,13 +180,13 @@ struct FileBuffer {
   std::string filepath;
   bool modified;
   bool is_preview = false;
-  std::stack<State> undo_stack;
-  std::stack<State> redo_stack;
+  bool loading = false; // read-only while a BackgroundFileLoad fills it
+  UndoHistory undo;
   std::set<int> bookmarks;
   std::vector<Diagnostic> diagnostics;
   std::string syntax_cache_extension;
-  std::size_t syntax_cache_line_count = 0;
-  std::unordered_map<int, SyntaxLineCache> syntax_cache;
+  SyntaxCache syntax_cache;
+  MatchIndex search_index; // in-buffer find
 };
 
 struct Popup {
@@ -182,9 +219,4 @@ enum PaneLayoutMode {
   PANE_LAYOUT_HORIZONTAL
 };
 
-struct SyntaxRule {
-  std::regex pattern;
-  int color;
-};
-
 #endif
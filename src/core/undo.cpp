@@ -1,12 +1,10 @@
 #include "editor.h"
 #include <algorithm>
+#include <chrono>
 
 namespace {
-constexpr std::size_t kMaxUndoHistory = 500;
-
 State capture_state(const FileBuffer &buf) {
   State s;
-  s.lines = buf.lines;
   s.cursor = buf.cursor;
   s.preferred_x = buf.preferred_x;
   s.selection = buf.selection;
@@ -16,37 +14,29 @@ State capture_state(const FileBuffer &buf) {
   return s;
 }
 
-bool same_state(const State &a, const State &b) {
-  return a.lines == b.lines && a.cursor == b.cursor &&
-         a.preferred_x == b.preferred_x &&
-         a.selection.start == b.selection.start &&
-         a.selection.end == b.selection.end &&
-         a.selection.active == b.selection.active &&
-         a.scroll_offset == b.scroll_offset && a.scroll_x == b.scroll_x &&
-         a.modified == b.modified;
+void restore_state(FileBuffer &buf, const State &s) {
+  buf.cursor = s.cursor;
+  buf.preferred_x = s.preferred_x;
+  buf.selection = s.selection;
+  buf.scroll_offset = std::max(0, s.scroll_offset);
+  buf.scroll_x = std::max(0, s.scroll_x);
+  buf.modified = s.modified;
 }
+} // namespace
 
-void trim_stack(std::stack<State> &stack, std::size_t max_items) {
-  if (stack.size() <= max_items) {
-    return;
+bool Editor::ensure_editable(const FileBuffer &buf) {
+  if (!buf.loading) {
+    return true;
   }
-  std::vector<State> items;
-  items.reserve(stack.size());
-  while (!stack.empty()) {
-    items.push_back(std::move(stack.top()));
-    stack.pop();
-  }
-  std::stack<State> rebuilt;
-  const std::size_t kept = std::min(max_items, items.size());
-  for (std::size_t i = kept; i > 0; --i) {
-    rebuilt.push(std::move(items[i - 1]));
-  }
-  stack = std::move(rebuilt);
+  set_message(get_filename(buf.filepath) + " is read-only until it loads");
+  return false;
 }
-} // namespace
 
-void Editor::save_state() {
+bool Editor::save_state(int first_line, int last_line, bool coalesce) {
   auto &buf = get_buffer();
+  if (!ensure_editable(buf)) {
+    return false;
+  }
   if (buf.is_preview) {
     buf.is_preview = false;
     if (preview_buffer_index == current_buffer) {
@@ -54,38 +44,47 @@ void Editor::save_state() {
     }
   }
 
-  const State s = capture_state(buf);
-  if (!buf.undo_stack.empty() && same_state(buf.undo_stack.top(), s)) {
-    return;
+  if (first_line < 0) {
+    first_line = 0;
+    last_line = (int)buf.lines.size() - 1;
   }
+  invalidate_syntax_from(buf, first_line);
 
-  buf.undo_stack.push(s);
-  trim_stack(buf.undo_stack, kMaxUndoHistory);
-  while (!buf.redo_stack.empty()) {
-    buf.redo_stack.pop();
+  const long long now_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  buf.undo.record(buf.lines, first_line, last_line, capture_state(buf),
+                  coalesce, now_ms);
+  return true;
+}
+
+bool Editor::save_cursor_state(int above, int below, bool coalesce) {
+  auto &buf = get_buffer();
+  if (buf.selection.active) {
+    return save_state(std::min(buf.selection.start.y, buf.selection.end.y),
+                      std::max(buf.selection.start.y, buf.selection.end.y));
   }
+  return save_state(std::max(0, buf.cursor.y - above), buf.cursor.y + below,
+                    coalesce);
 }
 
 void Editor::undo() {
   auto &buf = get_buffer();
-  if (buf.undo_stack.empty()) {
+  if (!ensure_editable(buf)) {
     return;
   }
+  State state = capture_state(buf);
+  int first_line = 0;
+  if (!buf.undo.undo(buf.lines, state, &first_line)) {
+    return;
+  }
+  if (buf.lines.empty()) {
+    buf.lines.push_back("");
+  }
+  restore_state(buf, state);
 
-  buf.redo_stack.push(capture_state(buf));
-  trim_stack(buf.redo_stack, kMaxUndoHistory);
-
-  State prev = std::move(buf.undo_stack.top());
-  buf.undo_stack.pop();
-  buf.lines = std::move(prev.lines);
-  buf.cursor = prev.cursor;
-  buf.preferred_x = prev.preferred_x;
-  buf.selection = prev.selection;
-  buf.scroll_offset = std::max(0, prev.scroll_offset);
-  buf.scroll_x = std::max(0, prev.scroll_x);
-  buf.modified = prev.modified;
-
-  invalidate_syntax_cache(buf);
+  invalidate_syntax_from(buf, first_line);
   clamp_cursor(get_pane().buffer_id);
   ensure_cursor_visible();
   needs_redraw = true;
@@ -93,24 +92,20 @@ void Editor::undo() {
 
 void Editor::redo() {
   auto &buf = get_buffer();
-  if (buf.redo_stack.empty()) {
+  if (!ensure_editable(buf)) {
     return;
   }
+  State state = capture_state(buf);
+  int first_line = 0;
+  if (!buf.undo.redo(buf.lines, state, &first_line)) {
+    return;
+  }
+  if (buf.lines.empty()) {
+    buf.lines.push_back("");
+  }
+  restore_state(buf, state);
 
-  buf.undo_stack.push(capture_state(buf));
-  trim_stack(buf.undo_stack, kMaxUndoHistory);
-
-  State next = std::move(buf.redo_stack.top());
-  buf.redo_stack.pop();
-  buf.lines = std::move(next.lines);
-  buf.cursor = next.cursor;
-  buf.preferred_x = next.preferred_x;
-  buf.selection = next.selection;
-  buf.scroll_offset = std::max(0, next.scroll_offset);
-  buf.scroll_x = std::max(0, next.scroll_x);
-  buf.modified = next.modified;
-
-  invalidate_syntax_cache(buf);
+  invalidate_syntax_from(buf, first_line);
   clamp_cursor(get_pane().buffer_id);
   ensure_cursor_visible();
   needs_redraw = true;
@@ -0,0 +1,179 @@
+#include "types.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+constexpr std::size_t kMaxUndoHistory = 500;
+constexpr long long kTypingGroupWindowMs = 1000;
+
+void push_step(std::deque<UndoEntry> &steps, UndoEntry step) {
+  steps.push_back(std::move(step));
+  while (steps.size() > kMaxUndoHistory) {
+    steps.pop_front();
+  }
+}
+
+// Swaps the step's saved lines with the range they replace. Lines common to
+// both sides are swapped in place, so only a change in line count shifts the
+// tail of the buffer, and it only shifts once.
+bool apply_step(LineStore &lines, UndoEntry &step,
+                State &state) {
+  if (step.first_line < 0 || step.line_count < 0 ||
+      (std::size_t)step.first_line + (std::size_t)step.line_count >
+          lines.size()) {
+    return false;
+  }
+
+  const std::size_t first = (std::size_t)step.first_line;
+  const std::size_t current = (std::size_t)step.line_count;
+  const std::size_t saved = step.lines.size();
+  const std::size_t common = std::min(current, saved);
+  for (std::size_t i = 0; i < common; ++i) {
+    lines.mut(first + i).swap(step.lines[i]);
+  }
+
+  if (saved > current) {
+    lines.insert(lines.begin() + first + common,
+                 std::make_move_iterator(step.lines.begin() + common),
+                 std::make_move_iterator(step.lines.end()));
+    step.lines.resize(common);
+  } else if (current > saved) {
+    auto begin = lines.begin() + first + common;
+    auto end = lines.begin() + first + current;
+    step.lines.insert(step.lines.end(), std::make_move_iterator(begin),
+                      std::make_move_iterator(end));
+    lines.erase(begin, end);
+  }
+
+  step.line_count = (int)saved;
+  std::swap(step.state, state);
+  return true;
+}
+} // namespace
+
+void UndoHistory::seal(const LineStore &lines) {
+  if (!pending) {
+    return;
+  }
+  pending = false;
+  if (undo_steps.empty()) {
+    return;
+  }
+
+  UndoEntry &top = undo_steps.back();
+  const long long delta =
+      (long long)lines.size() - (long long)pending_total_lines;
+  top.line_count = std::max(0, (int)(pending_base_count + delta));
+
+  // Drop steps whose edit turned out to be a no-op (e.g. skipping over an
+  // auto-closed bracket), mirroring the old identical-snapshot check.
+  if (top.line_count == (int)top.lines.size() &&
+      (std::size_t)top.first_line + top.lines.size() <= lines.size() &&
+      std::equal(top.lines.begin(), top.lines.end(),
+                 lines.begin() + top.first_line)) {
+    undo_steps.pop_back();
+    group_line = -1;
+  }
+}
+
+void UndoHistory::record(const LineStore &lines, int first,
+                         int last, const State &state, bool coalesce,
+                         long long now_ms) {
+  seal(lines);
+  redo_steps.clear();
+
+  first = std::max(0, std::min(first, (int)lines.size()));
+  last = std::max(first - 1, std::min(last, (int)lines.size() - 1));
+
+  const bool extends_group =
+      coalesce && !undo_steps.empty() && first == last &&
+      first == group_line && state.cursor.y == group_line &&
+      state.cursor.x == group_next_x && !state.selection.active &&
+      now_ms - group_last_ms <= kTypingGroupWindowMs;
+
+  pending = true;
+  pending_total_lines = lines.size();
+  if (extends_group) {
+    pending_base_count = undo_steps.back().line_count;
+  } else {
+    UndoEntry step;
+    step.first_line = first;
+    step.line_count = last - first + 1;
+    step.lines.assign(lines.begin() + first, lines.begin() + last + 1);
+    step.state = state;
+    pending_base_count = step.line_count;
+    push_step(undo_steps, std::move(step));
+  }
+
+  if (coalesce && first == last) {
+    group_line = first;
+    group_next_x = state.cursor.x + 1;
+    group_last_ms = now_ms;
+  } else {
+    group_line = -1;
+  }
+}
+
+bool UndoHistory::undo(LineStore &lines, State &state, int *first_line) {
+  seal(lines);
+  group_line = -1;
+  if (undo_steps.empty()) {
+    return false;
+  }
+
+  UndoEntry step = std::move(undo_steps.back());
+  undo_steps.pop_back();
+  if (!apply_step(lines, step, state)) {
+    // The buffer was changed behind the log's back; its ranges no longer
+    // line up, so replaying anything else would corrupt the text.
+    clear();
+    return false;
+  }
+  if (first_line) {
+    *first_line = step.first_line;
+  }
+  push_step(redo_steps, std::move(step));
+  return true;
+}
+
+bool UndoHistory::redo(LineStore &lines, State &state, int *first_line) {
+  seal(lines);
+  group_line = -1;
+  if (redo_steps.empty()) {
+    return false;
+  }
+
+  UndoEntry step = std::move(redo_steps.back());
+  redo_steps.pop_back();
+  if (!apply_step(lines, step, state)) {
+    clear();
+    return false;
+  }
+  if (first_line) {
+    *first_line = step.first_line;
+  }
+  push_step(undo_steps, std::move(step));
+  return true;
+}
+
+void UndoHistory::clear() {
+  undo_steps.clear();
+  redo_steps.clear();
+  pending = false;
+  group_line = -1;
+}
+
+std::size_t UndoHistory::memory_usage() const {
+  std::size_t total = 0;
+  for (const auto *steps : {&undo_steps, &redo_steps}) {
+    for (const auto &step : *steps) {
+      total += sizeof(UndoEntry) + step.lines.capacity() * sizeof(std::string);
+      for (const auto &line : step.lines) {
+        if (line.capacity() > 15) {
+          total += line.capacity() + 1;
+        }
+      }
+    }
+  }
+  return total;
+}
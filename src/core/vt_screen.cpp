@@ -0,0 +1,858 @@
+#include "vt_screen.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+namespace {
+// DEC special graphics for '_' through '~', as used by ESC ( 0.
+constexpr std::uint32_t kDecGraphics[32] = {
+    0x0020, 0x25C6, 0x2592, 0x2409, 0x240C, 0x240D, 0x240A, 0x00B0,
+    0x00B1, 0x2424, 0x240B, 0x2518, 0x2510, 0x250C, 0x2514, 0x253C,
+    0x23BA, 0x23BB, 0x2500, 0x23BC, 0x23BD, 0x251C, 0x2524, 0x2534,
+    0x252C, 0x2502, 0x2264, 0x2265, 0x03C0, 0x2260, 0x00A3, 0x00B7,
+};
+
+std::uint32_t dec_graphic(std::uint32_t c) {
+  return c >= 0x5F && c <= 0x7E ? kDecGraphics[c - 0x5F] : c;
+}
+
+// Nearest entry of the 6x6x6 colour cube for a 24-bit colour.
+int cube_color(int r, int g, int b) {
+  auto level = [](int v) { return (std::clamp(v, 0, 255) * 5 + 127) / 255; };
+  return 16 + 36 * level(r) + 6 * level(g) + level(b);
+}
+
+constexpr std::uint32_t kReplacement = 0xFFFD;
+} // namespace
+
+VtScreen::VtScreen(int cols, int rows, std::size_t history_limit)
+    : cols_(std::max(1, cols)), rows_(std::max(1, rows)),
+      history(history_limit) {
+  reset();
+}
+
+void VtScreen::reset() {
+  reset_grid(primary);
+  reset_grid(alternate);
+  on_alternate = false;
+  history.clear();
+  cursor = Cursor();
+  saved_primary = Cursor();
+  saved_alternate = Cursor();
+  pending_wrap = false;
+  shift_out = false;
+  autowrap = true;
+  insert_mode = false;
+  show_cursor = true;
+  app_cursor_keys = false;
+  top = 0;
+  bottom = rows_ - 1;
+  reset_tab_stops();
+  last_glyph = ' ';
+  replies.clear();
+  state = GROUND;
+  param_count = 0;
+  private_marker = 0;
+  intermediate = 0;
+  utf8_code = 0;
+  utf8_remaining = 0;
+}
+
+void VtScreen::reset_grid(Grid &grid) {
+  grid.cols = cols_;
+  grid.cells.assign((std::size_t)cols_ * rows_, blank_cell());
+  grid.lines.resize(rows_);
+  std::iota(grid.lines.begin(), grid.lines.end(), 0);
+}
+
+void VtScreen::resize_grid(Grid &grid, int cols, int rows, int drop_top) {
+  std::vector<Cell> cells((std::size_t)cols * rows, blank_cell());
+  const int keep_cols = std::min(cols, cols_);
+  for (int y = 0; y < rows && y + drop_top < rows_; y++) {
+    std::memcpy(cells.data() + (std::size_t)y * cols, grid.row(y + drop_top),
+                (std::size_t)keep_cols * sizeof(Cell));
+  }
+  grid.cells.swap(cells);
+  grid.cols = cols;
+  grid.lines.resize(rows);
+  std::iota(grid.lines.begin(), grid.lines.end(), 0);
+}
+
+void VtScreen::resize(int cols, int rows) {
+  cols = std::max(1, cols);
+  rows = std::max(1, rows);
+  if (cols == cols_ && rows == rows_) {
+    return;
+  }
+
+  // Rows above a cursor that would fall off the bottom scroll out the top.
+  const int drop = std::max(0, cursor.y - (rows - 1));
+  if (!on_alternate) {
+    for (int y = 0; y < drop; y++) {
+      push_history(primary.row(y));
+    }
+  }
+  resize_grid(primary, cols, rows, on_alternate ? 0 : drop);
+  resize_grid(alternate, cols, rows, on_alternate ? drop : 0);
+  cursor.y -= drop;
+  cols_ = cols;
+  rows_ = rows;
+
+  for (Cursor *c : {&cursor, &saved_primary, &saved_alternate}) {
+    c->x = std::min(c->x, cols_ - 1);
+    c->y = std::min(c->y, rows_ - 1);
+  }
+  pending_wrap = false;
+  top = 0;
+  bottom = rows_ - 1;
+  reset_tab_stops();
+}
+
+void VtScreen::reset_tab_stops() {
+  tab_stops.assign(cols_, 0);
+  for (int x = 8; x < cols_; x += 8) {
+    tab_stops[x] = 1;
+  }
+}
+
+Cell VtScreen::erased_cell() const {
+  Cell cell = blank_cell();
+  cell.fg = cursor.pen.fg;
+  cell.bg = cursor.pen.bg;
+  return cell;
+}
+
+std::string VtScreen::take_replies() {
+  std::string out;
+  out.swap(replies);
+  return out;
+}
+
+std::string VtScreen::row_text(int y) const {
+  const Cell *cells = row(y);
+  int len = cols_;
+  while (len > 0 && cells[len - 1].glyph == ' ') {
+    len--;
+  }
+  std::string out;
+  for (int x = 0; x < len; x++) {
+    append_utf8(out, cells[x].glyph);
+  }
+  return out;
+}
+
+void VtScreen::feed(const char *data, std::size_t size) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  std::size_t i = 0;
+  while (i < size) {
+    const unsigned char c = bytes[i];
+    if (state == GROUND && utf8_remaining == 0 && c >= 0x20 && c < 0x7F) {
+      i += print_ascii(bytes + i, size - i);
+      continue;
+    }
+    i++;
+
+    switch (state) {
+    case GROUND:
+      if (utf8_remaining > 0) {
+        if ((c & 0xC0) == 0x80) {
+          utf8_code = (utf8_code << 6) | (c & 0x3F);
+          if (--utf8_remaining == 0) {
+            print(utf8_code);
+          }
+          break;
+        }
+        utf8_remaining = 0;
+        print(kReplacement);
+      }
+      if (c < 0x20 || c == 0x7F) {
+        execute(c);
+      } else if (c < 0x80) {
+        print(c);
+      } else if (c >= 0xC2 && c <= 0xDF) {
+        utf8_code = c & 0x1F;
+        utf8_remaining = 1;
+      } else if (c >= 0xE0 && c <= 0xEF) {
+        utf8_code = c & 0x0F;
+        utf8_remaining = 2;
+      } else if (c >= 0xF0 && c <= 0xF4) {
+        utf8_code = c & 0x07;
+        utf8_remaining = 3;
+      } else {
+        print(kReplacement);
+      }
+      break;
+
+    case ESCAPE:
+      if (c < 0x20) {
+        execute(c);
+      } else if (c <= 0x2F) {
+        intermediate = (char)c;
+        state = ESCAPE_INTERMEDIATE;
+      } else if (c == '[') {
+        state = CSI_PARAM;
+      } else if (c == ']') {
+        state = OSC_STRING;
+      } else if (c == 'P' || c == 'X' || c == '^' || c == '_') {
+        state = CONTROL_STRING;
+      } else if (c < 0x7F) {
+        state = GROUND;
+        esc_dispatch(c);
+      }
+      break;
+
+    case ESCAPE_INTERMEDIATE:
+      if (c < 0x20) {
+        execute(c);
+      } else if (c <= 0x2F) {
+        intermediate = (char)c;
+      } else if (c < 0x7F) {
+        state = GROUND;
+        esc_dispatch(c);
+      }
+      break;
+
+    case CSI_PARAM:
+      if (c < 0x20) {
+        execute(c);
+      } else if (c >= '0' && c <= '9') {
+        if (param_count == 0) {
+          params[param_count++] = 0;
+        }
+        int &value = params[param_count - 1];
+        value = std::min(value * 10 + (c - '0'), 65535);
+      } else if (c == ';' || c == ':') {
+        if (param_count == 0) {
+          params[param_count++] = 0;
+        }
+        if (param_count < kMaxParams) {
+          params[param_count++] = 0;
+        }
+      } else if (c >= '<' && c <= '?') {
+        if (param_count == 0 && private_marker == 0) {
+          private_marker = (char)c;
+        } else {
+          state = CSI_IGNORE;
+        }
+      } else if (c <= 0x2F) {
+        intermediate = (char)c;
+      } else if (c >= 0x40 && c < 0x7F) {
+        state = GROUND;
+        csi_dispatch(c);
+      }
+      break;
+
+    case CSI_IGNORE:
+      if (c < 0x20) {
+        execute(c);
+      } else if (c >= 0x40 && c < 0x7F) {
+        state = GROUND;
+      }
+      break;
+
+    case OSC_STRING:
+    case CONTROL_STRING:
+      if (c == 0x1B) {
+        state = STRING_ESCAPE;
+      } else if (c == 0x18 || c == 0x1A || (c == 0x07 && state == OSC_STRING)) {
+        state = GROUND;
+      }
+      break;
+
+    case STRING_ESCAPE:
+      // ST ends the string; any other escape starts over with this byte.
+      state = GROUND;
+      if (c != '\\') {
+        execute(0x1B);
+        i--;
+      }
+      break;
+    }
+  }
+}
+
+std::size_t VtScreen::print_ascii(const unsigned char *data, std::size_t size) {
+  std::size_t run = 0;
+  while (run < size && data[run] >= 0x20 && data[run] < 0x7F) {
+    run++;
+  }
+  if (insert_mode || (shift_out ? cursor.g1_graphics : cursor.g0_graphics)) {
+    for (std::size_t i = 0; i < run; i++) {
+      print(data[i]);
+    }
+    return run;
+  }
+
+  // Fill whole stretches of a row at a time; only wrapping is per row.
+  Cell cell = cursor.pen;
+  std::size_t i = 0;
+  while (i < run) {
+    wrap_if_pending();
+    Cell *cells = screen().row(cursor.y) + cursor.x;
+    const std::size_t take = std::min(run - i, (std::size_t)(cols_ - cursor.x));
+    for (std::size_t k = 0; k < take; k++) {
+      cell.glyph = data[i + k];
+      cells[k] = cell;
+    }
+    i += take;
+    cursor.x += (int)take;
+    if (cursor.x >= cols_) {
+      cursor.x = cols_ - 1;
+      pending_wrap = true;
+    }
+  }
+  last_glyph = data[run - 1];
+  return run;
+}
+
+void VtScreen::print(std::uint32_t code_point) {
+  if (shift_out ? cursor.g1_graphics : cursor.g0_graphics) {
+    code_point = dec_graphic(code_point);
+  }
+  wrap_if_pending();
+  Cell *cells = screen().row(cursor.y);
+  if (insert_mode) {
+    std::memmove(cells + cursor.x + 1, cells + cursor.x,
+                 (std::size_t)(cols_ - cursor.x - 1) * sizeof(Cell));
+  }
+  Cell cell = cursor.pen;
+  cell.glyph = code_point;
+  cells[cursor.x] = cell;
+  last_glyph = code_point;
+  if (cursor.x + 1 >= cols_) {
+    pending_wrap = true;
+  } else {
+    cursor.x++;
+  }
+}
+
+void VtScreen::execute(unsigned char c) {
+  switch (c) {
+  case 0x08: // BS
+    if (cursor.x > 0) {
+      cursor.x--;
+    }
+    pending_wrap = false;
+    break;
+  case 0x09: // HT
+    tab_forward(1);
+    break;
+  case 0x0A: // LF, VT and FF all index; the tty adds the CR
+  case 0x0B:
+  case 0x0C:
+    line_feed();
+    break;
+  case 0x0D:
+    cursor.x = 0;
+    pending_wrap = false;
+    break;
+  case 0x0E:
+    shift_out = true;
+    break;
+  case 0x0F:
+    shift_out = false;
+    break;
+  case 0x18: // CAN and SUB abort a sequence
+  case 0x1A:
+    state = GROUND;
+    break;
+  case 0x1B:
+    state = ESCAPE;
+    param_count = 0;
+    private_marker = 0;
+    intermediate = 0;
+    break;
+  default:
+    break;
+  }
+}
+
+void VtScreen::esc_dispatch(unsigned char final_byte) {
+  if (intermediate == '(' || intermediate == ')') {
+    const bool graphics = final_byte == '0';
+    (intermediate == '(' ? cursor.g0_graphics : cursor.g1_graphics) = graphics;
+    return;
+  }
+  if (intermediate != 0) {
+    return;
+  }
+
+  switch (final_byte) {
+  case '7':
+    save_cursor();
+    break;
+  case '8':
+    restore_cursor();
+    break;
+  case 'D': // IND
+    line_feed();
+    break;
+  case 'E': // NEL
+    cursor.x = 0;
+    line_feed();
+    break;
+  case 'M': // RI
+    reverse_index();
+    break;
+  case 'H': // HTS
+    tab_stops[cursor.x] = 1;
+    break;
+  case 'c': { // RIS keeps what has scrolled away
+    Scrollback kept = std::move(history);
+    reset();
+    history = std::move(kept);
+    break;
+  }
+  default: // keypad modes and the like change nothing on screen
+    break;
+  }
+}
+
+int VtScreen::param(int i, int fallback) const {
+  return i < param_count && params[i] > 0 ? params[i] : fallback;
+}
+
+void VtScreen::csi_dispatch(unsigned char final_byte) {
+  if (intermediate != 0) {
+    // Only DECSTR (CSI ! p); cursor styles and the like are not drawn.
+    if (intermediate == '!' && final_byte == 'p') {
+      cursor.pen = blank_cell();
+      cursor.origin_mode = false;
+      autowrap = true;
+      insert_mode = false;
+      show_cursor = true;
+      app_cursor_keys = false;
+      top = 0;
+      bottom = rows_ - 1;
+    }
+    return;
+  }
+  if (private_marker == '>' && final_byte == 'c') {
+    replies += "\x1b[>1;10;0c";
+    return;
+  }
+  if (private_marker != 0 && private_marker != '?') {
+    return;
+  }
+  if (private_marker == '?' && final_byte != 'h' && final_byte != 'l' &&
+      final_byte != 'J' && final_byte != 'K') {
+    return;
+  }
+
+  const int n = param(0, 1);
+  const int mode = param_count > 0 ? params[0] : 0;
+  Cell *cells = screen().row(cursor.y);
+  switch (final_byte) {
+  case '@': { // ICH
+    const int count = std::min(n, cols_ - cursor.x);
+    std::memmove(cells + cursor.x + count, cells + cursor.x,
+                 (std::size_t)(cols_ - cursor.x - count) * sizeof(Cell));
+    clear_row(cursor.y, cursor.x, cursor.x + count);
+    pending_wrap = false;
+    break;
+  }
+  case 'A': // CUU
+    move_to(cursor.x, std::max(cursor.y - n, cursor.y >= top ? top : 0));
+    break;
+  case 'B': // CUD
+  case 'e': // VPR
+    move_to(cursor.x,
+            std::min(cursor.y + n, cursor.y <= bottom ? bottom : rows_ - 1));
+    break;
+  case 'C': // CUF
+  case 'a': // HPR
+    move_to(cursor.x + n, cursor.y);
+    break;
+  case 'D': // CUB
+    move_to(cursor.x - n, cursor.y);
+    break;
+  case 'E': // CNL
+    move_to(0, std::min(cursor.y + n, cursor.y <= bottom ? bottom : rows_ - 1));
+    break;
+  case 'F': // CPL
+    move_to(0, std::max(cursor.y - n, cursor.y >= top ? top : 0));
+    break;
+  case 'G': // CHA
+  case '`': // HPA
+    move_to(n - 1, cursor.y);
+    break;
+  case 'H': // CUP
+  case 'f': {
+    int y = param(0, 1) - 1;
+    if (cursor.origin_mode) {
+      y = std::min(y + top, bottom);
+    }
+    move_to(param(1, 1) - 1, y);
+    break;
+  }
+  case 'I': // CHT
+    tab_forward(n);
+    break;
+  case 'Z': // CBT
+    tab_backward(n);
+    break;
+  case 'J': // ED
+    if (mode == 0) {
+      clear_row(cursor.y, cursor.x, cols_);
+      for (int y = cursor.y + 1; y < rows_; y++) {
+        clear_row(y, 0, cols_);
+      }
+    } else if (mode == 1) {
+      for (int y = 0; y < cursor.y; y++) {
+        clear_row(y, 0, cols_);
+      }
+      clear_row(cursor.y, 0, cursor.x + 1);
+    } else if (mode == 2) {
+      for (int y = 0; y < rows_; y++) {
+        clear_row(y, 0, cols_);
+      }
+    } else if (mode == 3) {
+      history.clear();
+    }
+    pending_wrap = false;
+    break;
+  case 'K': // EL
+    if (mode == 0) {
+      clear_row(cursor.y, cursor.x, cols_);
+    } else if (mode == 1) {
+      clear_row(cursor.y, 0, cursor.x + 1);
+    } else if (mode == 2) {
+      clear_row(cursor.y, 0, cols_);
+    }
+    pending_wrap = false;
+    break;
+  case 'L': // IL
+    if (cursor.y >= top && cursor.y <= bottom) {
+      scroll_down(cursor.y, bottom, n);
+      move_to(0, cursor.y);
+    }
+    break;
+  case 'M': // DL
+    if (cursor.y >= top && cursor.y <= bottom) {
+      scroll_up(cursor.y, bottom, n);
+      move_to(0, cursor.y);
+    }
+    break;
+  case 'P': { // DCH
+    const int count = std::min(n, cols_ - cursor.x);
+    std::memmove(cells + cursor.x, cells + cursor.x + count,
+                 (std::size_t)(cols_ - cursor.x - count) * sizeof(Cell));
+    clear_row(cursor.y, cols_ - count, cols_);
+    pending_wrap = false;
+    break;
+  }
+  case 'S': // SU
+    scroll_region_up(n);
+    break;
+  case 'T': // SD; with more parameters it is mouse tracking
+    if (param_count <= 1) {
+      scroll_down(top, bottom, n);
+    }
+    break;
+  case 'X': // ECH
+    clear_row(cursor.y, cursor.x, std::min(cols_, cursor.x + n));
+    pending_wrap = false;
+    break;
+  case 'b': { // REP, at most a screenful
+    const int count = std::min(n, cols_ * rows_);
+    for (int i = 0; i < count; i++) {
+      print(last_glyph);
+    }
+    break;
+  }
+  case 'c': // DA
+    if (mode == 0) {
+      replies += "\x1b[?62;22c";
+    }
+    break;
+  case 'd': { // VPA
+    int y = n - 1;
+    if (cursor.origin_mode) {
+      y = std::min(y + top, bottom);
+    }
+    move_to(cursor.x, y);
+    break;
+  }
+  case 'g': // TBC
+    if (mode == 0) {
+      tab_stops[cursor.x] = 0;
+    } else if (mode == 3) {
+      std::fill(tab_stops.begin(), tab_stops.end(), 0);
+    }
+    break;
+  case 'h':
+  case 'l':
+    set_mode(final_byte == 'h');
+    break;
+  case 'm':
+    select_graphic_rendition();
+    break;
+  case 'n': // DSR
+    if (mode == 5) {
+      replies += "\x1b[0n";
+    } else if (mode == 6) {
+      const int y = cursor.y - (cursor.origin_mode ? top : 0);
+      char report[32];
+      std::snprintf(report, sizeof(report), "\x1b[%d;%dR", y + 1,
+                    cursor.x + 1);
+      replies += report;
+    }
+    break;
+  case 'r': { // DECSTBM
+    const int first = param(0, 1) - 1;
+    const int last = std::min(param(1, rows_), rows_) - 1;
+    if (first < last) {
+      top = first;
+      bottom = last;
+      move_to(0, cursor.origin_mode ? top : 0);
+    }
+    break;
+  }
+  case 's':
+    save_cursor();
+    break;
+  case 'u':
+    restore_cursor();
+    break;
+  default:
+    break;
+  }
+}
+
+void VtScreen::set_mode(bool enable) {
+  const int count = std::max(param_count, 1);
+  for (int i = 0; i < count; i++) {
+    const int mode = i < param_count ? params[i] : 0;
+    if (private_marker != '?') {
+      if (mode == 4) {
+        insert_mode = enable;
+      }
+      continue;
+    }
+    switch (mode) {
+    case 1:
+      app_cursor_keys = enable;
+      break;
+    case 6:
+      cursor.origin_mode = enable;
+      move_to(0, enable ? top : 0);
+      break;
+    case 7:
+      autowrap = enable;
+      break;
+    case 25:
+      show_cursor = enable;
+      break;
+    case 47:
+    case 1047:
+      switch_screen(enable, false);
+      break;
+    case 1048:
+      if (enable) {
+        save_cursor();
+      } else {
+        restore_cursor();
+      }
+      break;
+    case 1049:
+      switch_screen(enable, true);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void VtScreen::select_graphic_rendition() {
+  Cell &pen = cursor.pen;
+  if (param_count == 0) {
+    pen = blank_cell();
+    return;
+  }
+  for (int i = 0; i < param_count; i++) {
+    const int p = params[i];
+    if (p == 0) {
+      pen = blank_cell();
+    } else if (p == 1) {
+      pen.attrs |= CELL_BOLD;
+    } else if (p == 3) {
+      pen.attrs |= CELL_ITALIC;
+    } else if (p == 7) {
+      pen.attrs |= CELL_REVERSE;
+    } else if (p == 22) {
+      pen.attrs &= (std::uint8_t)~CELL_BOLD;
+    } else if (p == 23) {
+      pen.attrs &= (std::uint8_t)~CELL_ITALIC;
+    } else if (p == 27) {
+      pen.attrs &= (std::uint8_t)~CELL_REVERSE;
+    } else if (p >= 30 && p <= 37) {
+      pen.fg = (std::uint8_t)(p - 30);
+    } else if (p == 39) {
+      pen.fg = blank_cell().fg;
+    } else if (p >= 40 && p <= 47) {
+      pen.bg = (std::uint8_t)(p - 40);
+    } else if (p == 49) {
+      pen.bg = blank_cell().bg;
+    } else if (p >= 90 && p <= 97) {
+      pen.fg = (std::uint8_t)(8 + p - 90);
+    } else if (p >= 100 && p <= 107) {
+      pen.bg = (std::uint8_t)(8 + p - 100);
+    } else if (p == 38 || p == 48) {
+      // 256 colours as 38;5;n, true colour as 38;2;r;g;b, mapped onto the
+      // palette the editor draws with.
+      int color = -1;
+      if (i + 2 < param_count && params[i + 1] == 5) {
+        color = params[i + 2];
+        i += 2;
+      } else if (i + 4 < param_count && params[i + 1] == 2) {
+        color = cube_color(params[i + 2], params[i + 3], params[i + 4]);
+        i += 4;
+      }
+      if (color >= 0) {
+        (p == 38 ? pen.fg : pen.bg) = Cell::palette_index(color);
+      }
+    }
+  }
+}
+
+void VtScreen::wrap_if_pending() {
+  if (!pending_wrap) {
+    return;
+  }
+  pending_wrap = false;
+  if (autowrap) {
+    cursor.x = 0;
+    line_feed();
+  }
+}
+
+void VtScreen::line_feed() {
+  pending_wrap = false;
+  if (cursor.y == bottom) {
+    scroll_region_up(1);
+  } else if (cursor.y < rows_ - 1) {
+    cursor.y++;
+  }
+}
+
+void VtScreen::reverse_index() {
+  pending_wrap = false;
+  if (cursor.y == top) {
+    scroll_down(top, bottom, 1);
+  } else if (cursor.y > 0) {
+    cursor.y--;
+  }
+}
+
+void VtScreen::scroll_region_up(int count) {
+  count = std::min(count, bottom - top + 1);
+  if (!on_alternate && top == 0) {
+    for (int y = 0; y < count; y++) {
+      push_history(primary.row(y));
+    }
+  }
+  scroll_up(top, bottom, count);
+}
+
+void VtScreen::scroll_up(int first, int last, int count) {
+  count = std::min(count, last - first + 1);
+  if (count <= 0) {
+    return;
+  }
+  std::vector<int> &lines = screen().lines;
+  std::rotate(lines.begin() + first, lines.begin() + first + count,
+              lines.begin() + last + 1);
+  for (int y = last - count + 1; y <= last; y++) {
+    clear_row(y, 0, cols_);
+  }
+}
+
+void VtScreen::scroll_down(int first, int last, int count) {
+  count = std::min(count, last - first + 1);
+  if (count <= 0) {
+    return;
+  }
+  std::vector<int> &lines = screen().lines;
+  std::rotate(lines.begin() + first, lines.begin() + last + 1 - count,
+              lines.begin() + last + 1);
+  for (int y = first; y < first + count; y++) {
+    clear_row(y, 0, cols_);
+  }
+}
+
+void VtScreen::clear_row(int y, int x0, int x1) {
+  x0 = std::max(0, x0);
+  x1 = std::min(cols_, x1);
+  if (x0 < x1) {
+    Cell *cells = screen().row(y);
+    std::fill(cells + x0, cells + x1, erased_cell());
+  }
+}
+
+void VtScreen::push_history(const Cell *cells) {
+  const Cell blank = blank_cell();
+  int len = cols_;
+  while (len > 0 && cells[len - 1] == blank) {
+    len--;
+  }
+  history.push(cells, len);
+}
+
+void VtScreen::move_to(int x, int y) {
+  cursor.x = std::clamp(x, 0, cols_ - 1);
+  cursor.y = std::clamp(y, 0, rows_ - 1);
+  pending_wrap = false;
+}
+
+void VtScreen::tab_forward(int count) {
+  for (; count > 0 && cursor.x < cols_ - 1; count--) {
+    cursor.x++;
+    while (cursor.x < cols_ - 1 && !tab_stops[cursor.x]) {
+      cursor.x++;
+    }
+  }
+  pending_wrap = false;
+}
+
+void VtScreen::tab_backward(int count) {
+  for (; count > 0 && cursor.x > 0; count--) {
+    cursor.x--;
+    while (cursor.x > 0 && !tab_stops[cursor.x]) {
+      cursor.x--;
+    }
+  }
+  pending_wrap = false;
+}
+
+void VtScreen::switch_screen(bool alternate_on, bool keep_cursor) {
+  if (alternate_on == on_alternate) {
+    return;
+  }
+  if (alternate_on) {
+    if (keep_cursor) {
+      save_cursor();
+    }
+    on_alternate = true;
+    for (int y = 0; y < rows_; y++) {
+      clear_row(y, 0, cols_);
+    }
+  } else {
+    on_alternate = false;
+    if (keep_cursor) {
+      restore_cursor();
+    }
+  }
+  pending_wrap = false;
+}
+
+void VtScreen::save_cursor() {
+  (on_alternate ? saved_alternate : saved_primary) = cursor;
+}
+
+void VtScreen::restore_cursor() {
+  cursor = on_alternate ? saved_alternate : saved_primary;
+  cursor.x = std::min(cursor.x, cols_ - 1);
+  cursor.y = std::min(cursor.y, rows_ - 1);
+  pending_wrap = false;
+}
@@ -0,0 +1,155 @@
+#ifndef VT_SCREEN_H
+#define VT_SCREEN_H
+
+#include "cell_grid.h"
+#include "scrollback.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The screen of a VT100/xterm-style terminal: a fixed cols x rows grid of
+// cells that a shell's output draws into, with the alternate screen, scroll
+// regions and cursor addressing full-screen programs rely on. Cells hold
+// Unicode code points in Cell::glyph; every code point takes one column.
+//
+// feed() does a bounded amount of work per byte: rows live in one block and
+// are reached through a row map, so scrolling rotates the map instead of
+// moving cells. Rows scrolled off the top of the main screen are kept in a
+// Scrollback, oldest first, up to history_limit rows.
+class VtScreen {
+public:
+  VtScreen(int cols = 80, int rows = 24, std::size_t history_limit = 2000);
+
+  // Keeps the top-left of both screens; rows that no longer fit above the
+  // cursor go to the history.
+  void resize(int cols, int rows);
+  // Back to the power-on state, history included.
+  void reset();
+  void feed(const char *data, std::size_t size);
+  void feed(std::string_view data) { feed(data.data(), data.size()); }
+
+  int cols() const { return cols_; }
+  int rows() const { return rows_; }
+  const Cell *row(int y) const { return screen().row(y); }
+  int cursor_x() const { return cursor.x; }
+  int cursor_y() const { return cursor.y; }
+  bool cursor_visible() const { return show_cursor; }
+  bool alternate_screen() const { return on_alternate; }
+  // DECCKM: cursor keys should be sent as ESC O x instead of ESC [ x.
+  bool application_cursor_keys() const { return app_cursor_keys; }
+
+  std::size_t history_size() const { return history.size(); }
+  // Trailing blanks are not kept, so a row may be shorter than cols().
+  CellSpan history_row(std::size_t i) const { return history.line(i); }
+  std::size_t history_bytes() const { return history.memory_bytes(); }
+  void clear_history() { history.clear(); }
+
+  // Answers to queries in the output (cursor position, device attributes),
+  // to be written back to the shell. Clears them.
+  std::string take_replies();
+
+  // UTF-8 text of a screen row without trailing blanks.
+  std::string row_text(int y) const;
+  // What erased cells hold when no colours are set.
+  static Cell blank_cell() { return Cell::make(' ', 7, 0, 0); }
+
+private:
+  static constexpr int kMaxParams = 16;
+
+  enum State {
+    GROUND,
+    ESCAPE,
+    ESCAPE_INTERMEDIATE,
+    CSI_PARAM,
+    CSI_IGNORE,
+    OSC_STRING,
+    CONTROL_STRING, // DCS, SOS, PM and APC bodies are skipped
+    STRING_ESCAPE,  // ESC inside a string, expecting the '\' of ST
+  };
+
+  struct Grid {
+    std::vector<Cell> cells;
+    std::vector<int> lines; // screen row -> row of cells
+    int cols = 0;
+
+    Cell *row(int y) { return cells.data() + (std::size_t)lines[y] * cols; }
+    const Cell *row(int y) const {
+      return cells.data() + (std::size_t)lines[y] * cols;
+    }
+  };
+
+  struct Cursor {
+    int x = 0;
+    int y = 0;
+    Cell pen = blank_cell(); // style of new text; glyph unused
+    bool origin_mode = false;
+    bool g0_graphics = false; // DEC special graphics (line drawing)
+    bool g1_graphics = false;
+  };
+
+  int cols_;
+  int rows_;
+  Grid primary;
+  Grid alternate;
+  bool on_alternate = false;
+  Scrollback history;
+
+  Cursor cursor;
+  Cursor saved_primary;
+  Cursor saved_alternate;
+  bool pending_wrap = false; // the last column was written
+  bool shift_out = false;    // SO: print from G1
+  bool autowrap = true;
+  bool insert_mode = false;
+  bool show_cursor = true;
+  bool app_cursor_keys = false;
+  int top = 0;    // scroll region, inclusive
+  int bottom = 0;
+  std::vector<std::uint8_t> tab_stops;
+  std::uint32_t last_glyph = ' ';
+  std::string replies;
+
+  State state = GROUND;
+  int params[kMaxParams];
+  int param_count = 0;
+  char private_marker = 0;
+  char intermediate = 0;
+  std::uint32_t utf8_code = 0;
+  int utf8_remaining = 0;
+
+  Grid &screen() { return on_alternate ? alternate : primary; }
+  const Grid &screen() const { return on_alternate ? alternate : primary; }
+  Cell erased_cell() const;
+
+  void reset_grid(Grid &grid);
+  void resize_grid(Grid &grid, int cols, int rows, int drop_top);
+  void reset_tab_stops();
+
+  std::size_t print_ascii(const unsigned char *data, std::size_t size);
+  void print(std::uint32_t code_point);
+  void execute(unsigned char c);
+  void esc_dispatch(unsigned char final_byte);
+  void csi_dispatch(unsigned char final_byte);
+  void set_mode(bool enable);
+  void select_graphic_rendition();
+  int param(int i, int fallback) const;
+
+  void wrap_if_pending();
+  void line_feed();
+  void reverse_index();
+  void scroll_region_up(int count);
+  void scroll_up(int first, int last, int count);
+  void scroll_down(int first, int last, int count);
+  void clear_row(int y, int x0, int x1);
+  void push_history(const Cell *row);
+  void move_to(int x, int y);
+  void tab_forward(int count);
+  void tab_backward(int count);
+  void switch_screen(bool alternate_on, bool keep_cursor);
+  void save_cursor();
+  void restore_cursor();
+};
+
+#endif
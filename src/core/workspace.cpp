@@ -847,10 +847,10 @@ void Editor::handle_sidebar_input(int ch) {
   }
 
   if (ch == 'g' || ch == 'G') {
-    refresh_git_status(true);
+    refresh_git_status_now();
     if (has_git_repo()) {
-      message = "Git: " + git_branch + " (" + std::to_string(git_dirty_count) +
-                " changes)";
+      message = "Git: " + git_status->branch + " (" +
+                std::to_string(git_status->dirty_count) + " changes)";
     } else {
       message = "Git: not a repository";
     }
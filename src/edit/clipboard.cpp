@@ -45,7 +45,9 @@ void Editor::cut() {
 void Editor::paste() {
   if (clipboard.empty())
     return;
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   if (buf.selection.active) {
     delete_selection();
@@ -59,7 +61,7 @@ void Editor::paste() {
       buf.lines.insert(buf.lines.begin() + buf.cursor.y, line);
       buf.cursor.y++;
     } else {
-      buf.lines[buf.cursor.y].insert(buf.cursor.x, line);
+      buf.lines.mut(buf.cursor.y).insert(buf.cursor.x, line);
       buf.cursor.x += line.length();
     }
     first = false;
@@ -74,7 +76,6 @@ void Editor::paste() {
 }
 
 void Editor::move_line_up() {
-  save_state();
   auto &buf = get_buffer();
   int start_y = buf.cursor.y;
   int end_y = buf.cursor.y;
@@ -85,10 +86,14 @@ void Editor::move_line_up() {
 
   if (start_y <= 0)
     return;
+  if (!save_state(start_y - 1, end_y)) {
+    return;
+  }
 
   // Move the whole selected line block up by one row.
-  std::rotate(buf.lines.begin() + start_y - 1, buf.lines.begin() + start_y,
-              buf.lines.begin() + end_y + 1);
+  std::rotate(buf.lines.mut_begin() + start_y - 1,
+              buf.lines.mut_begin() + start_y,
+              buf.lines.mut_begin() + end_y + 1);
 
   buf.cursor.y = std::max(0, buf.cursor.y - 1);
   if (buf.selection.active) {
@@ -106,7 +111,6 @@ void Editor::move_line_up() {
 }
 
 void Editor::move_line_down() {
-  save_state();
   auto &buf = get_buffer();
   int start_y = buf.cursor.y;
   int end_y = buf.cursor.y;
@@ -117,10 +121,14 @@ void Editor::move_line_down() {
 
   if (end_y >= (int)buf.lines.size() - 1)
     return;
+  if (!save_state(start_y, end_y + 1)) {
+    return;
+  }
 
   // Move the whole selected line block down by one row.
-  std::rotate(buf.lines.begin() + start_y, buf.lines.begin() + end_y + 1,
-              buf.lines.begin() + end_y + 2);
+  std::rotate(buf.lines.mut_begin() + start_y,
+              buf.lines.mut_begin() + end_y + 1,
+              buf.lines.mut_begin() + end_y + 2);
 
   buf.cursor.y = std::min((int)buf.lines.size() - 1, buf.cursor.y + 1);
   if (buf.selection.active) {
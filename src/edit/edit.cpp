@@ -5,7 +5,9 @@
 #include <cctype>
 
 void Editor::insert_char(char c) {
-  save_state();
+  if (!save_cursor_state(0, 0, c != '\t')) {
+    return;
+  }
   auto &buf = get_buffer();
 
   if (buf.selection.active && AutoClose::should_auto_close(c)) {
@@ -20,14 +22,14 @@ void Editor::insert_char(char c) {
       char closing = AutoClose::get_closing_bracket(c);
       if (closing != '\0') {
         if (s.y == e.y) {
-          auto &line = buf.lines[s.y];
+          auto &line = buf.lines.mut(s.y);
           s.x = std::max(0, std::min(s.x, (int)line.length()));
           e.x = std::max(0, std::min(e.x, (int)line.length()));
           line.insert(e.x, 1, closing);
           line.insert(s.x, 1, c);
         } else {
-          auto &end_line = buf.lines[e.y];
-          auto &start_line = buf.lines[s.y];
+          auto &end_line = buf.lines.mut(e.y);
+          auto &start_line = buf.lines.mut(s.y);
           e.x = std::max(0, std::min(e.x, (int)end_line.length()));
           s.x = std::max(0, std::min(s.x, (int)start_line.length()));
           end_line.insert(e.x, 1, closing);
@@ -57,7 +59,7 @@ void Editor::insert_char(char c) {
 
   if (c == '\t') {
     std::string spaces(tab_size, ' ');
-    buf.lines[buf.cursor.y].insert(buf.cursor.x, spaces);
+    buf.lines.mut(buf.cursor.y).insert(buf.cursor.x, spaces);
     buf.cursor.x += tab_size;
   } else {
     // Check if we should skip closing bracket
@@ -69,7 +71,7 @@ void Editor::insert_char(char c) {
       return;
     }
 
-    buf.lines[buf.cursor.y].insert(buf.cursor.x, 1, c);
+    buf.lines.mut(buf.cursor.y).insert(buf.cursor.x, 1, c);
     buf.cursor.x++;
 
     if (auto_indent && (c == '}' || c == ']' || c == ')')) {
@@ -83,9 +85,10 @@ void Editor::insert_char(char c) {
           size_t start = trimmed.find_first_not_of(" \t");
           if (start != std::string::npos) {
             trimmed.erase(0, start);
-            buf.lines[buf.cursor.y] =
-                EditorFeatures::get_indent_string(new_indent, tab_size) +
-                trimmed;
+            buf.lines.set(buf.cursor.y,
+                          EditorFeatures::get_indent_string(new_indent,
+                                                            tab_size) +
+                              trimmed);
             buf.cursor.x = std::max(0, buf.cursor.x - tab_size);
           }
         }
@@ -95,7 +98,7 @@ void Editor::insert_char(char c) {
     if (AutoClose::should_auto_close(c)) {
       char closing = AutoClose::get_closing_bracket(c);
       if (closing != '\0') {
-        buf.lines[buf.cursor.y].insert(buf.cursor.x, 1, closing);
+        buf.lines.mut(buf.cursor.y).insert(buf.cursor.x, 1, closing);
       }
     }
   }
@@ -109,12 +112,14 @@ void Editor::insert_char(char c) {
 }
 
 void Editor::insert_string(const std::string &str) {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   if (buf.selection.active) {
     delete_selection();
   }
-  buf.lines[buf.cursor.y].insert(buf.cursor.x, str);
+  buf.lines.mut(buf.cursor.y).insert(buf.cursor.x, str);
   buf.cursor.x += str.length();
   buf.modified = true;
   if (python_api)
@@ -124,7 +129,9 @@ void Editor::insert_string(const std::string &str) {
 }
 
 void Editor::delete_char(bool forward) {
-  save_state();
+  if (!save_cursor_state(1, 1)) {
+    return;
+  }
   auto &buf = get_buffer();
   if (buf.selection.active) {
     delete_selection();
@@ -134,16 +141,16 @@ void Editor::delete_char(bool forward) {
 
   if (forward) {
     if (buf.cursor.x < (int)buf.lines[buf.cursor.y].length()) {
-      buf.lines[buf.cursor.y].erase(buf.cursor.x, 1);
+      buf.lines.mut(buf.cursor.y).erase(buf.cursor.x, 1);
       buf.modified = true;
     } else if (buf.cursor.y < (int)buf.lines.size() - 1) {
-      buf.lines[buf.cursor.y] += buf.lines[buf.cursor.y + 1];
+      buf.lines.mut(buf.cursor.y) += buf.lines[buf.cursor.y + 1];
       buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
       buf.modified = true;
     }
   } else {
     if (buf.cursor.x > 0) {
-      auto &line = buf.lines[buf.cursor.y];
+      auto &line = buf.lines.mut(buf.cursor.y);
       if (buf.cursor.x < (int)line.length()) {
         char left = line[buf.cursor.x - 1];
         char right = line[buf.cursor.x];
@@ -166,7 +173,7 @@ void Editor::delete_char(bool forward) {
     } else if (buf.cursor.y > 0) {
       buf.cursor.y--;
       buf.cursor.x = buf.lines[buf.cursor.y].length();
-      buf.lines[buf.cursor.y] += buf.lines[buf.cursor.y + 1];
+      buf.lines.mut(buf.cursor.y) += buf.lines[buf.cursor.y + 1];
       buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
       buf.modified = true;
     }
@@ -190,16 +197,18 @@ void Editor::delete_word_backward() {
   if (buf.cursor.x == 0 && buf.cursor.y == 0)
     return;
 
-  save_state();
+  if (!save_cursor_state(1, 0)) {
+    return;
+  }
 
   if (buf.cursor.x == 0 && buf.cursor.y > 0) {
     buf.cursor.y--;
     buf.cursor.x = (int)buf.lines[buf.cursor.y].length();
-    buf.lines[buf.cursor.y] += buf.lines[buf.cursor.y + 1];
+    buf.lines.mut(buf.cursor.y) += buf.lines[buf.cursor.y + 1];
     buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
     buf.modified = true;
   } else {
-    auto &line = buf.lines[buf.cursor.y];
+    auto &line = buf.lines.mut(buf.cursor.y);
     int start = buf.cursor.x;
 
     while (start > 0 &&
@@ -240,12 +249,14 @@ void Editor::delete_word_forward() {
       buf.cursor.x == (int)buf.lines[buf.cursor.y].length())
     return;
 
-  save_state();
+  if (!save_cursor_state(0, 1)) {
+    return;
+  }
 
-  auto &line = buf.lines[buf.cursor.y];
+  auto &line = buf.lines.mut(buf.cursor.y);
   if (buf.cursor.x >= (int)line.length() &&
       buf.cursor.y < (int)buf.lines.size() - 1) {
-    buf.lines[buf.cursor.y] += buf.lines[buf.cursor.y + 1];
+    buf.lines.mut(buf.cursor.y) += buf.lines[buf.cursor.y + 1];
     buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
     buf.modified = true;
   } else {
@@ -278,7 +289,9 @@ void Editor::delete_word_forward() {
 }
 
 void Editor::delete_selection() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   if (!buf.selection.active)
     return;
@@ -298,12 +311,12 @@ void Editor::delete_selection() {
                          : buf.selection.start.x);
 
   if (start_y == end_y) {
-    buf.lines[start_y].erase(start_x, end_x - start_x);
+    buf.lines.mut(start_y).erase(start_x, end_x - start_x);
     buf.cursor.y = start_y;
     buf.cursor.x = start_x;
   } else {
-    buf.lines[start_y] =
-        buf.lines[start_y].substr(0, start_x) + buf.lines[end_y].substr(end_x);
+    buf.lines.set(start_y, buf.lines[start_y].substr(0, start_x) +
+                               buf.lines[end_y].substr(end_x));
     buf.lines.erase(buf.lines.begin() + start_y + 1,
                     buf.lines.begin() + end_y + 1);
     buf.cursor.y = start_y;
@@ -322,11 +335,13 @@ void Editor::delete_selection() {
 }
 
 void Editor::delete_line() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   if (buf.lines.size() == 1) {
     clipboard = buf.lines[0];
-    buf.lines[0] = "";
+    buf.lines.set(0, "");
   } else {
     clipboard = buf.lines[buf.cursor.y];
     buf.lines.erase(buf.lines.begin() + buf.cursor.y);
@@ -344,11 +359,13 @@ void Editor::delete_line() {
 }
 
 void Editor::new_line() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   std::string current_line = buf.lines[buf.cursor.y];
   std::string remaining = current_line.substr(buf.cursor.x);
-  buf.lines[buf.cursor.y] = current_line.substr(0, buf.cursor.x);
+  buf.lines.set(buf.cursor.y, current_line.substr(0, buf.cursor.x));
 
   std::string new_line_str = "";
   bool split_closing_bracket_line = false;
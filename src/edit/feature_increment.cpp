@@ -10,7 +10,7 @@ void Editor::increment_number_at_cursor(int delta) {
     return;
   }
 
-  std::string &line = buf.lines[buf.cursor.y];
+  std::string &line = buf.lines.mut(buf.cursor.y);
   if (line.empty()) {
     set_message("No number at cursor");
     return;
@@ -51,7 +51,9 @@ void Editor::increment_number_at_cursor(int delta) {
     return;
   }
 
-  save_state();
+  if (!save_state(buf.cursor.y, buf.cursor.y)) {
+    return;
+  }
   long long next = value + delta;
   std::string next_num = std::to_string(next);
   line.replace((size_t)start, (size_t)(end - start), next_num);
@@ -34,7 +34,9 @@ void Editor::join_lines_selection_or_current() {
     return;
   }
 
-  save_state();
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
   int joins = 0;
   for (int y = start_y; y < end_y && y + 1 < (int)buf.lines.size();) {
     std::string left = buf.lines[y];
@@ -43,7 +45,7 @@ void Editor::join_lines_selection_or_current() {
         !std::isspace((unsigned char)left.back())) {
       left.push_back(' ');
     }
-    buf.lines[y] = left + right;
+    buf.lines.set(y, left + right);
     buf.lines.erase(buf.lines.begin() + y + 1);
     end_y--;
     joins++;
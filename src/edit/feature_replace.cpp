@@ -65,10 +65,18 @@ void Editor::replace_all_text(const std::string &needle,
   }
 
   auto &buf = get_buffer();
-  save_state();
+  if (!save_state()) {
+    return;
+  }
   int total = 0;
-  for (auto &line : buf.lines) {
-    total += replace_in_line(line, needle, replacement, case_sensitive, whole_word);
+  for (std::size_t y = 0; y < buf.lines.size(); y++) {
+    std::string line = buf.lines[y];
+    const int replaced =
+        replace_in_line(line, needle, replacement, case_sensitive, whole_word);
+    if (replaced > 0) {
+      buf.lines.set(y, std::move(line));
+      total += replaced;
+    }
   }
 
   if (total <= 0) {
@@ -105,13 +113,15 @@ void Editor::replace_all_regex(const std::string &pattern,
   }
 
   auto &buf = get_buffer();
-  save_state();
+  if (!save_state()) {
+    return;
+  }
   int changed_lines = 0;
-  for (auto &line : buf.lines) {
-    if (!std::regex_search(line, re)) {
+  for (std::size_t y = 0; y < buf.lines.size(); y++) {
+    if (!std::regex_search(buf.lines[y], re)) {
       continue;
     }
-    line = std::regex_replace(line, re, replacement);
+    buf.lines.set(y, std::regex_replace(buf.lines[y], re, replacement));
     changed_lines++;
   }
 
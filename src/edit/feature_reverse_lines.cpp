@@ -18,8 +18,11 @@ void Editor::reverse_selected_lines() {
     return;
   }
 
-  save_state();
-  std::reverse(buf.lines.begin() + start_y, buf.lines.begin() + end_y + 1);
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
+  std::reverse(buf.lines.mut_begin() + start_y,
+               buf.lines.mut_begin() + end_y + 1);
   buf.modified = true;
   buf.cursor.y = start_y;
   buf.cursor.x = std::clamp(buf.cursor.x, 0, (int)buf.lines[start_y].size());
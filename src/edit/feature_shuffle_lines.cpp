@@ -19,10 +19,13 @@ void Editor::shuffle_selected_lines() {
     return;
   }
 
-  save_state();
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
   std::random_device rd;
   std::mt19937 gen(rd());
-  std::shuffle(buf.lines.begin() + start_y, buf.lines.begin() + end_y + 1, gen);
+  std::shuffle(buf.lines.mut_begin() + start_y,
+               buf.lines.mut_begin() + end_y + 1, gen);
 
   buf.modified = true;
   buf.cursor.y = start_y;
@@ -19,8 +19,11 @@ void Editor::sort_selected_lines_desc() {
     return;
   }
 
-  save_state();
-  std::stable_sort(buf.lines.begin() + start_y, buf.lines.begin() + end_y + 1,
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
+  std::stable_sort(buf.lines.mut_begin() + start_y,
+                   buf.lines.mut_begin() + end_y + 1,
                    [](const std::string &a, const std::string &b) {
                      std::string la = a;
                      std::string lb = b;
@@ -1,6 +1,7 @@
 #include "editor.h"
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 
 void Editor::show_buffer_stats() {
   auto &buf = get_buffer();
@@ -52,3 +53,34 @@ void Editor::show_buffer_stats() {
               " words, selection: " + sel_text);
   needs_redraw = true;
 }
+
+void Editor::show_output_stats() {
+  const Terminal::OutputStats &out = terminal.output_stats();
+  const ScreenEncoder::Stats &enc = terminal.encoder_stats();
+  const std::uint64_t encoded = std::max<std::uint64_t>(1, enc.total());
+  auto percent = [&](std::uint64_t part) {
+    return std::to_string(part * 100 / encoded) + "%";
+  };
+  set_message("Output: " + std::to_string(out.writes) + " writes, avg " +
+              std::to_string(out.bytes / std::max<std::uint64_t>(1, out.writes)) +
+              " B, last " + std::to_string(out.last_write_bytes) + " B, peak " +
+              std::to_string(out.peak_write_bytes) + " B; cells: motion " +
+              percent(enc.motion_bytes) + ", style " + percent(enc.style_bytes) +
+              ", text " + percent(enc.text_bytes));
+  needs_redraw = true;
+}
+
+void Editor::show_loop_stats() {
+  const LoopStats &loop = loop_stats;
+  char rate[32];
+  std::snprintf(rate, sizeof(rate), "%.1f", loop.idle_wakeups_per_second);
+  auto ms = [](double value) { return std::to_string((int)(value + 0.5)); };
+  const double avg = loop.total_input_to_paint_ms /
+                     std::max<std::uint64_t>(1, loop.painted_inputs);
+  set_message("Loop: " + std::to_string(loop.wakeups) + " wakeups, " +
+              std::to_string(loop.idle_wakeups) + " idle (" + rate +
+              "/s); input to paint: last " + ms(loop.last_input_to_paint_ms) +
+              " ms, avg " + ms(avg) + " ms, max " +
+              ms(loop.max_input_to_paint_ms) + " ms");
+  needs_redraw = true;
+}
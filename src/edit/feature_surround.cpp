@@ -24,7 +24,9 @@ bool Editor::surround_selection_or_word(const std::string &left,
   }
 
   auto &buf = get_buffer();
-  save_state();
+  if (!save_cursor_state()) {
+    return false;
+  }
 
   if (buf.selection.active) {
     Cursor s = buf.selection.start;
@@ -38,14 +40,14 @@ bool Editor::surround_selection_or_word(const std::string &left,
     s.x = std::clamp(s.x, 0, (int)buf.lines[s.y].size());
     e.x = std::clamp(e.x, 0, (int)buf.lines[e.y].size());
 
-    buf.lines[e.y].insert((size_t)e.x, right);
-    buf.lines[s.y].insert((size_t)s.x, left);
+    buf.lines.mut(e.y).insert((size_t)e.x, right);
+    buf.lines.mut(s.y).insert((size_t)s.x, left);
     buf.selection.start = {s.x + (int)left.size(), s.y};
     buf.selection.end = {e.x + (int)left.size(), e.y};
     buf.cursor = buf.selection.end;
   } else {
     int y = std::clamp(buf.cursor.y, 0, (int)buf.lines.size() - 1);
-    std::string &line = buf.lines[y];
+    std::string &line = buf.lines.mut(y);
     int x = std::clamp(buf.cursor.x, 0, (int)line.size());
     int start = x;
     int end = x;
@@ -86,9 +88,11 @@ bool Editor::unsurround_selection_or_cursor() {
     return false;
   }
 
-  save_state();
   int y = std::clamp(buf.cursor.y, 0, (int)buf.lines.size() - 1);
-  std::string &line = buf.lines[y];
+  if (!save_state(y, y)) {
+    return false;
+  }
+  std::string &line = buf.lines.mut(y);
   if (line.size() < 2) {
     set_message("Nothing to unsurround");
     return false;
@@ -30,7 +30,9 @@ void Editor::trim_blank_lines_in_selection() {
   start_y = std::clamp(start_y, 0, (int)buf.lines.size() - 1);
   end_y = std::clamp(end_y, 0, (int)buf.lines.size() - 1);
 
-  save_state();
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
   int removed = 0;
   for (int y = end_y; y >= start_y && y < (int)buf.lines.size(); y--) {
     if (!is_blank_line(buf.lines[y])) {
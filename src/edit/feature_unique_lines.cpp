@@ -18,7 +18,9 @@ void Editor::unique_selected_lines() {
     return;
   }
 
-  save_state();
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
   std::unordered_set<std::string> seen;
   int removed = 0;
   for (int y = start_y; y <= end_y && y < (int)buf.lines.size();) {
@@ -26,7 +26,9 @@ int remove_one_indent_level(std::string &line, int tab_size) {
 } // namespace
 
 void Editor::duplicate_line() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   buf.lines.insert(buf.lines.begin() + buf.cursor.y + 1,
                    buf.lines[buf.cursor.y]);
@@ -38,7 +40,9 @@ void Editor::duplicate_line() {
 }
 
 void Editor::insert_line_below() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   // Compute indent from current line
   std::string indent_str = "";
@@ -59,7 +63,9 @@ void Editor::insert_line_below() {
 }
 
 void Editor::insert_line_above() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   std::string indent_str = "";
   if (auto_indent) {
@@ -80,14 +86,16 @@ void Editor::indent_selection() {
   if (!buf.selection.active)
     return;
 
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
 
   const int start_y = std::min(buf.selection.start.y, buf.selection.end.y);
   const int end_y = std::max(buf.selection.start.y, buf.selection.end.y);
   const std::string indent(tab_size, ' ');
 
   for (int y = start_y; y <= end_y; y++) {
-    buf.lines[y].insert(0, indent);
+    buf.lines.mut(y).insert(0, indent);
   }
 
   buf.selection.start.x += tab_size;
@@ -109,7 +117,9 @@ void Editor::outdent_selection() {
   if (!buf.selection.active)
     return;
 
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
 
   const int start_y = std::min(buf.selection.start.y, buf.selection.end.y);
   const int end_y = std::max(buf.selection.start.y, buf.selection.end.y);
@@ -119,7 +129,7 @@ void Editor::outdent_selection() {
   int removed_cursor = 0;
 
   for (int y = start_y; y <= end_y; y++) {
-    int removed = remove_one_indent_level(buf.lines[y], tab_size);
+    int removed = remove_one_indent_level(buf.lines.mut(y), tab_size);
     if (y == buf.selection.start.y)
       removed_start = removed;
     if (y == buf.selection.end.y)
@@ -145,7 +155,9 @@ void Editor::outdent_selection() {
 
 
 void Editor::toggle_comment() {
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
   auto &buf = get_buffer();
   std::string ext = get_file_extension(buf.filepath);
   std::string comment = "//";
@@ -172,10 +184,10 @@ void Editor::toggle_comment() {
   for (int i = start_y; i <= end_y; i++) {
     if (all_commented) {
       if (buf.lines[i].substr(0, comment.length()) == comment) {
-        buf.lines[i] = buf.lines[i].substr(comment.length());
+        buf.lines.set(i, buf.lines[i].substr(comment.length()));
       }
     } else {
-      buf.lines[i] = comment + buf.lines[i];
+      buf.lines.set(i, comment + buf.lines[i]);
     }
   }
 
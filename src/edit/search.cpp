@@ -1,30 +1,16 @@
 #include "editor.h"
 #include <algorithm>
-#include <cctype>
+#include <chrono>
 
 namespace {
-std::string to_lower_ascii(std::string text) {
-  std::transform(text.begin(), text.end(), text.begin(),
-                 [](unsigned char c) { return (char)std::tolower(c); });
-  return text;
-}
+using Clock = std::chrono::steady_clock;
 
-bool is_word_char(unsigned char c) {
-  return std::isalnum(c) || c == '_';
-}
-
-bool is_whole_word_match(const std::string &line, size_t pos, size_t len) {
-  if (len == 0) {
-    return false;
-  }
-  const bool has_prev = pos > 0;
-  const bool has_next = (pos + len) < line.size();
-  const bool prev_word =
-      has_prev && is_word_char((unsigned char)line[pos - 1]);
-  const bool next_word =
-      has_next && is_word_char((unsigned char)line[pos + len]);
-  return !prev_word && !next_word;
-}
+// Lines scanned between looks at the clock.
+constexpr std::size_t kScanSlice = 4096;
+// A keystroke scans from the cursor for this long before showing what it
+// has; the rest of the buffer is counted between frames.
+constexpr auto kKeystrokeBudget = std::chrono::milliseconds(8);
+constexpr auto kFrameBudget = std::chrono::milliseconds(4);
 
 std::string search_flags(bool case_sensitive, bool whole_word) {
   return std::string(case_sensitive ? "Aa" : "aa") +
@@ -58,118 +44,222 @@ void Editor::toggle_search() {
   if (!search_query.empty()) {
     perform_search();
   } else {
-    search_results.clear();
     search_result_index = -1;
   }
 }
 
 void Editor::perform_search() {
   auto &buf = get_buffer();
-  const int cursor_y = buf.cursor.y;
-  const int cursor_x = buf.cursor.x;
-
-  search_results.clear();
+  MatchIndex &index = buf.search_index;
   search_result_index = -1;
+  search_jump_pending = false;
 
   if (search_query.empty()) {
+    index.clear();
     set_message("Search cleared [" +
                 search_flags(search_case_sensitive, search_whole_word) + "]");
     return;
   }
 
-  std::string query_cmp = search_case_sensitive ? search_query
-                                                : to_lower_ascii(search_query);
-  const size_t query_len = search_query.size();
-
-  for (size_t i = 0; i < buf.lines.size(); i++) {
-    const std::string &original_line = buf.lines[i];
-    std::string line_cmp =
-        search_case_sensitive ? original_line : to_lower_ascii(original_line);
-
-    size_t pos = 0;
-    while ((pos = line_cmp.find(query_cmp, pos)) != std::string::npos) {
-      if (search_whole_word &&
-          !is_whole_word_match(original_line, pos, query_len)) {
-        pos++;
-        continue;
-      }
-      search_results.push_back({(int)i, (int)pos});
-      pos++;
-    }
+  // Only the lines from the cursor to the next match, and the ones on
+  // screen, are needed before the keystroke is done.
+  const LineStore &lines = buf.lines;
+  index.set_query(lines, search_query, search_case_sensitive,
+                  search_whole_word);
+  index.sync(lines);
+  search_anchor = {buf.cursor.y, buf.cursor.x};
+  search_jump_pending = true;
+  const Clock::time_point deadline = Clock::now() + kKeystrokeBudget;
+  while (!settle_search_jump() && Clock::now() < deadline) {
+    index.scan(lines, (std::size_t)std::max(0, search_anchor.first),
+               kScanSlice);
   }
-
-  if (search_results.empty()) {
-    set_message("No matches [" +
-                search_flags(search_case_sensitive, search_whole_word) + "]");
-    needs_redraw = true;
-    return;
+  const std::size_t top = (std::size_t)std::max(0, buf.scroll_offset);
+  const std::size_t rows = (std::size_t)std::max(1, get_pane().h);
+  if (!index.scanned(top, top + rows)) {
+    index.scan(lines, top, rows);
   }
+  report_search_count();
+  needs_redraw = true;
+}
 
-  auto it = std::lower_bound(search_results.begin(), search_results.end(),
-                             std::make_pair(cursor_y, cursor_x));
-  search_result_index =
-      (it == search_results.end()) ? 0 : (int)(it - search_results.begin());
+// Moves the cursor to the first match at or after search_anchor, or the
+// first match of all when there is none after it, as soon as the lines
+// that decide it are scanned. Returns false while they are not.
+bool Editor::settle_search_jump() {
+  if (!search_jump_pending) {
+    return true;
+  }
+  auto &buf = get_buffer();
+  const MatchIndex &index = buf.search_index;
+  const auto &matches = index.matches();
+  const std::size_t from = (std::size_t)std::max(0, search_anchor.first);
+  auto it = std::lower_bound(matches.begin(), matches.end(), search_anchor);
+  if (it != matches.end() &&
+      index.scanned(from, (std::size_t)it->first + 1)) {
+    // found after the anchor
+  } else if (index.scanned(from, buf.lines.size()) && !matches.empty() &&
+             index.scanned(0, (std::size_t)matches.front().first + 1)) {
+    it = matches.begin();
+  } else if (index.complete()) {
+    search_jump_pending = false;
+    return true; // no match anywhere
+  } else {
+    return false;
+  }
 
-  buf.cursor.y = search_results[search_result_index].first;
-  buf.cursor.x = search_results[search_result_index].second;
+  search_jump_pending = false;
+  search_result_index = (int)(it - matches.begin());
+  buf.cursor.y = it->first;
+  buf.cursor.x = it->second;
   clamp_cursor(get_pane().buffer_id);
   ensure_cursor_visible();
+  return true;
+}
 
-  set_message(std::to_string(search_results.size()) + " match(es) [" +
-              search_flags(search_case_sensitive, search_whole_word) +
-              "]  Tab:case Ctrl+W:word");
+void Editor::report_search_count() {
+  const MatchIndex &index = get_buffer().search_index;
+  const std::string flags =
+      "[" + search_flags(search_case_sensitive, search_whole_word) + "]";
+  if (!index.complete()) {
+    set_message(std::to_string(index.matches().size()) +
+                "+ match(es), counting... " + flags);
+  } else if (index.matches().empty()) {
+    set_message("No matches " + flags);
+  } else {
+    set_message(std::to_string(index.matches().size()) + " match(es) " +
+                flags + "  Tab:case Ctrl+W:word");
+  }
+}
+
+bool Editor::has_search_work() const {
+  if (search_query.empty() || current_buffer < 0 ||
+      current_buffer >= (int)buffers.size()) {
+    return false;
+  }
+  const MatchIndex &index = buffers[current_buffer].search_index;
+  return index.is_for(search_query, search_case_sensitive,
+                      search_whole_word) &&
+         !index.complete();
+}
+
+// Follows edits to the current buffer and counts its remaining matches a
+// slice at a time. Returns true when anything shown changed.
+bool Editor::update_search_index() {
+  if (search_query.empty() || buffers.empty()) {
+    return false;
+  }
+  auto &buf = get_buffer();
+  MatchIndex &index = buf.search_index;
+  if (!index.is_for(search_query, search_case_sensitive, search_whole_word)) {
+    return false;
+  }
+  const std::uint64_t revision = index.revision();
+  const bool was_complete = index.complete();
+  const LineStore &lines = buf.lines;
+  index.sync(lines);
+  const std::size_t top = (std::size_t)std::max(0, buf.scroll_offset);
+  const Clock::time_point deadline = Clock::now() + kFrameBudget;
+  while (!index.complete() && Clock::now() < deadline) {
+    index.scan(lines, top, kScanSlice);
+  }
+  const bool jumped = search_jump_pending && settle_search_jump();
+  if (index.revision() == revision && !jumped &&
+      index.complete() == was_complete) {
+    return false;
+  }
+
+  // The matches moved or changed: keep pointing at the one under the
+  // cursor, if any.
+  const auto &matches = index.matches();
+  const std::pair<int, int> at(buf.cursor.y, buf.cursor.x);
+  const auto it = std::lower_bound(matches.begin(), matches.end(), at);
+  search_result_index =
+      it != matches.end() && *it == at ? (int)(it - matches.begin()) : -1;
+  if (show_search && index.complete() && !was_complete) {
+    report_search_count();
+  }
+  return true;
 }
 
 void Editor::find_next() {
-  if (search_results.empty()) {
+  auto &buf = get_buffer();
+  MatchIndex &index = buf.search_index;
+  if (!index.is_for(search_query, search_case_sensitive, search_whole_word)) {
+    perform_search();
+    return;
+  }
+  index.sync(buf.lines);
+  while (!index.complete()) {
+    index.scan(buf.lines, 0, kScanSlice);
+  }
+  const auto &matches = index.matches();
+  if (matches.empty()) {
     perform_search();
     return;
   }
 
   const int prev_index = search_result_index;
-  const int count = (int)search_results.size();
-  if (search_result_index < 0) {
-    search_result_index = 0;
+  const int count = (int)matches.size();
+  if (search_result_index < 0 || search_result_index >= count) {
+    // From the cursor, when it is not on a match.
+    const auto it = std::upper_bound(
+        matches.begin(), matches.end(),
+        std::make_pair(buf.cursor.y, buf.cursor.x));
+    search_result_index = it == matches.end() ? 0 : (int)(it - matches.begin());
   } else {
     search_result_index = (search_result_index + 1) % count;
   }
 
-  auto &buf = get_buffer();
-  buf.cursor.y = search_results[search_result_index].first;
-  buf.cursor.x = search_results[search_result_index].second;
+  buf.cursor.y = matches[search_result_index].first;
+  buf.cursor.x = matches[search_result_index].second;
   clamp_cursor(get_pane().buffer_id);
   ensure_cursor_visible();
 
   const bool wrapped = prev_index >= 0 && search_result_index <= prev_index;
   set_message(std::to_string(search_result_index + 1) + "/" +
-              std::to_string(search_results.size()) +
-              (wrapped ? " (wrapped)" : ""));
+              std::to_string(count) + (wrapped ? " (wrapped)" : ""));
 }
 
 void Editor::find_prev() {
-  if (search_results.empty()) {
+  auto &buf = get_buffer();
+  MatchIndex &index = buf.search_index;
+  if (!index.is_for(search_query, search_case_sensitive, search_whole_word)) {
+    perform_search();
+    return;
+  }
+  index.sync(buf.lines);
+  while (!index.complete()) {
+    index.scan(buf.lines, 0, kScanSlice);
+  }
+  const auto &matches = index.matches();
+  if (matches.empty()) {
     perform_search();
     return;
   }
 
   const int prev_index = search_result_index;
-  const int count = (int)search_results.size();
-  if (search_result_index <= 0) {
+  const int count = (int)matches.size();
+  if (search_result_index < 0 || search_result_index >= count) {
+    const auto it = std::lower_bound(
+        matches.begin(), matches.end(),
+        std::make_pair(buf.cursor.y, buf.cursor.x));
+    search_result_index =
+        it == matches.begin() ? count - 1 : (int)(it - matches.begin()) - 1;
+  } else if (search_result_index == 0) {
     search_result_index = count - 1;
   } else {
     search_result_index--;
   }
 
-  auto &buf = get_buffer();
-  buf.cursor.y = search_results[search_result_index].first;
-  buf.cursor.x = search_results[search_result_index].second;
+  buf.cursor.y = matches[search_result_index].first;
+  buf.cursor.x = matches[search_result_index].second;
   clamp_cursor(get_pane().buffer_id);
   ensure_cursor_visible();
 
   const bool wrapped = prev_index >= 0 && search_result_index >= prev_index;
   set_message(std::to_string(search_result_index + 1) + "/" +
-              std::to_string(search_results.size()) +
-              (wrapped ? " (wrapped)" : ""));
+              std::to_string(count) + (wrapped ? " (wrapped)" : ""));
 }
 
 void Editor::handle_search_panel(int ch, bool is_ctrl, bool is_shift,
@@ -196,7 +286,7 @@ void Editor::handle_search_panel(int ch, bool is_ctrl, bool is_shift,
 
   if (is_ctrl && (ch == 'l' || ch == 'L')) {
     search_query.clear();
-    search_results.clear();
+    get_buffer().search_index.clear();
     search_result_index = -1;
     set_message("Search cleared [" +
                 search_flags(search_case_sensitive, search_whole_word) + "]");
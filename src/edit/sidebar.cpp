@@ -1,4 +1,5 @@
 #include "editor.h"
+#include "render_key.h"
 #include <algorithm>
 #include <cctype>
 #include <filesystem>
@@ -247,6 +248,7 @@ void Editor::render_sidebar() {
     return is_dir ? theme.fg_sidebar_directory : theme.fg_sidebar;
   };
 
+  const auto &git_file_status = git_status->file_status;
   std::unordered_map<std::string, std::string> node_git_status;
   node_git_status.reserve(flat.size());
   for (const FileNode *node : flat) {
@@ -326,3 +328,39 @@ void Editor::render_sidebar() {
   }
   ui->draw_text(x + 1, y + h - 1, footer, theme.fg_comment, theme.bg_sidebar);
 }
+
+// Inputs of render_sidebar() besides the layout and theme, which the scene
+// key covers.
+std::uint64_t Editor::render_sidebar_key() const {
+  RenderKey key;
+  key.add(root_dir);
+  key.add(file_tree_selected);
+  key.add(file_tree_scroll);
+  key.add(git_status->root);
+  key.add(git_status->sequence);
+
+  std::vector<const FileNode *> flat;
+  flatten_nodes_render(file_tree, flat);
+  key.add(flat.size());
+  for (const FileNode *node : flat) {
+    key.add(node->path);
+    key.add(node->name);
+    key.add(node->is_dir);
+    key.add(node->expanded);
+    key.add(node->depth);
+  }
+
+  key.add(workspace_diagnostic_severity.size());
+  for (const auto &it : workspace_diagnostic_severity) {
+    key.add(it.first);
+    key.add(it.second);
+  }
+  for (const auto &buf : buffers) {
+    key.add(buf.filepath);
+    key.add(buf.diagnostics.size());
+    for (const auto &d : buf.diagnostics) {
+      key.add(d.severity);
+    }
+  }
+  return key.value();
+}
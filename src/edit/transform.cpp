@@ -42,7 +42,9 @@ char apply_case_char(char c, bool upper) {
 
 void Editor::transform_selection_uppercase() {
   auto &buf = get_buffer();
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
 
   bool changed = false;
   if (buf.selection.active) {
@@ -51,7 +53,7 @@ void Editor::transform_selection_uppercase() {
       if (y < 0 || y >= (int)buf.lines.size()) {
         continue;
       }
-      std::string &line = buf.lines[y];
+      std::string &line = buf.lines.mut(y);
       int from = 0;
       int to = (int)line.size();
       if (y == r.start_y) {
@@ -72,7 +74,7 @@ void Editor::transform_selection_uppercase() {
       }
     }
   } else if (buf.cursor.y >= 0 && buf.cursor.y < (int)buf.lines.size()) {
-    std::string &line = buf.lines[buf.cursor.y];
+    std::string &line = buf.lines.mut(buf.cursor.y);
     if (!line.empty()) {
       int cursor = std::clamp(buf.cursor.x, 0, (int)line.size());
       int start = cursor;
@@ -115,7 +117,9 @@ void Editor::transform_selection_uppercase() {
 
 void Editor::transform_selection_lowercase() {
   auto &buf = get_buffer();
-  save_state();
+  if (!save_cursor_state()) {
+    return;
+  }
 
   bool changed = false;
   if (buf.selection.active) {
@@ -124,7 +128,7 @@ void Editor::transform_selection_lowercase() {
       if (y < 0 || y >= (int)buf.lines.size()) {
         continue;
       }
-      std::string &line = buf.lines[y];
+      std::string &line = buf.lines.mut(y);
       int from = 0;
       int to = (int)line.size();
       if (y == r.start_y) {
@@ -145,7 +149,7 @@ void Editor::transform_selection_lowercase() {
       }
     }
   } else if (buf.cursor.y >= 0 && buf.cursor.y < (int)buf.lines.size()) {
-    std::string &line = buf.lines[buf.cursor.y];
+    std::string &line = buf.lines.mut(buf.cursor.y);
     if (!line.empty()) {
       int cursor = std::clamp(buf.cursor.x, 0, (int)line.size());
       int start = cursor;
@@ -213,8 +217,11 @@ void Editor::sort_selected_lines() {
     return;
   }
 
-  save_state();
-  std::stable_sort(buf.lines.begin() + start_y, buf.lines.begin() + end_y + 1,
+  if (!save_state(start_y, end_y)) {
+    return;
+  }
+  std::stable_sort(buf.lines.mut_begin() + start_y,
+                   buf.lines.mut_begin() + end_y + 1,
                    [](const std::string &a, const std::string &b) {
                      std::string la = a;
                      std::string lb = b;
@@ -0,0 +1,36 @@
+#ifndef SYNTAX_H
+#define SYNTAX_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SyntaxLanguage;
+
+// Lexer state at a line boundary: 0 outside any construct, otherwise an
+// opaque value for the block comment, string, raw string, heredoc or code
+// fence still open at the end of the previous line.
+using SyntaxState = int;
+
+// Table-driven syntax highlighter. Each language is a small spec (keyword
+// tables, comment/string delimiters, number and sigil forms) and
+// get_colors() walks a line once, returning {bold, color} per byte.
+class SyntaxHighlighter {
+private:
+  const SyntaxLanguage *language = nullptr;
+  std::string file_extension;
+
+public:
+  void set_language(const std::string &ext);
+  bool has_language() const { return language != nullptr; }
+
+  // Lexes `line` starting in `state` and leaves the end-of-line state there.
+  std::vector<std::pair<int, int>> get_colors(const std::string &line,
+                                              SyntaxState &state) const;
+  std::vector<std::pair<int, int>> get_colors(const std::string &line) const {
+    SyntaxState state = 0;
+    return get_colors(line, state);
+  }
+};
+
+#endif
@@ -0,0 +1,1324 @@
+#include "syntax.h"
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+using Colors = std::vector<std::pair<int, int>>;
+constexpr size_t npos = std::string::npos;
+
+bool is_word(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+bool is_ident_start(char c) { return is_word(c) && !is_digit(c); }
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+char fold(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+
+bool at(const std::string &line, size_t pos, const std::string &token) {
+  return !token.empty() && line.compare(pos, token.size(), token) == 0;
+}
+
+void paint(Colors &colors, size_t begin, size_t end, int color) {
+  for (size_t i = begin; i < end && i < colors.size(); i++)
+    colors[i] = {1, color};
+}
+
+// Open-addressed keyword set. Words are hashed once while scanning and
+// compared only on a hash hit; case-insensitive tables fold while hashing.
+class KeywordTable {
+public:
+  bool case_insensitive = false;
+
+  void add(const char *words, int color) {
+    const char *p = words;
+    while (*p) {
+      while (*p == ' ')
+        p++;
+      const char *start = p;
+      while (*p && *p != ' ')
+        p++;
+      if (p > start)
+        insert(std::string(start, p - start), color);
+    }
+  }
+
+  int find(const char *word, size_t length) const {
+    if (slots.empty() || length > 63 || !(length_mask >> length & 1))
+      return 0;
+    const uint32_t h = hash(word, length);
+    for (size_t i = h & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1)) {
+      const Slot &slot = slots[i];
+      if (slot.color == 0)
+        return 0;
+      if (slot.hash == h && slot.word.size() == length && equal(slot.word, word))
+        return slot.color;
+    }
+  }
+
+private:
+  struct Slot {
+    uint32_t hash = 0;
+    int color = 0;
+    std::string word;
+  };
+  std::vector<Slot> slots;
+  size_t count = 0;
+  uint64_t length_mask = 0;
+
+  uint32_t hash(const char *word, size_t length) const {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+      h ^= static_cast<unsigned char>(case_insensitive ? fold(word[i]) : word[i]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  bool equal(const std::string &keyword, const char *word) const {
+    if (!case_insensitive)
+      return std::memcmp(keyword.data(), word, keyword.size()) == 0;
+    for (size_t i = 0; i < keyword.size(); i++)
+      if (keyword[i] != fold(word[i]))
+        return false;
+    return true;
+  }
+
+  void insert(std::string word, int color) {
+    if (case_insensitive)
+      for (char &c : word)
+        c = fold(c);
+    if ((count + 1) * 2 > slots.size()) {
+      std::vector<Slot> old = std::move(slots);
+      slots.assign(old.empty() ? 64 : old.size() * 2, Slot{});
+      count = 0;
+      for (Slot &slot : old)
+        if (slot.color)
+          insert(std::move(slot.word), slot.color);
+    }
+    const size_t length = word.size();
+    const uint32_t h = hash(word.data(), length);
+    for (size_t i = h & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1)) {
+      Slot &slot = slots[i];
+      if (slot.color == 0) {
+        slot = {h, color, std::move(word)};
+        count++;
+        break;
+      }
+      if (slot.hash == h && slot.word == word) {
+        slot.color = color; // later groups win, as later rules did
+        break;
+      }
+    }
+    if (length < 64)
+      length_mask |= uint64_t(1) << length;
+  }
+};
+
+enum NumberForms : unsigned {
+  NUM_INT = 1,
+  NUM_HEX = 2,
+  NUM_BINARY = 4,
+  NUM_FRACTION = 8,
+  NUM_FRACTION_EXPONENT = 16,
+  NUM_EXPONENT = 32,
+  NUM_SIGNED = 64, // `-1` after a word character, as `\b-?\d` matched
+};
+
+enum SigilForm {
+  SIGIL_WORD,           // @word
+  SIGIL_IDENT,          // @ident (no leading digit)
+  SIGIL_BRACE_OPTIONAL, // $word, ${word}
+  SIGIL_BRACE,          // ${word}
+  SIGIL_PAREN_OR_BRACE, // $(word), ${word}
+};
+
+struct Sigil {
+  char lead;
+  SigilForm form;
+  int color;
+};
+
+enum LineRule { LINE_NONE, LINE_YAML_KEY, LINE_INI, LINE_MAKE_TARGET };
+
+enum Scanner { SCAN_CODE, SCAN_CSS, SCAN_HTML, SCAN_MARKDOWN };
+
+// End-of-line states. The low byte names the construct left open; the rest
+// holds its quote character or an interned closing delimiter.
+enum LexKind : int {
+  LEX_NONE = 0,
+  LEX_BLOCK_COMMENT = 1,
+  LEX_TRIPLE_QUOTE = 2, // payload: quote character
+  LEX_STRING = 3,       // payload: quote character
+  LEX_RAW_STRING = 4,   // payload: closing delimiter id
+  LEX_HEREDOC = 5,      // payload: terminator id, "-" prefixed for <<-
+  LEX_FENCE = 6,        // Markdown ``` block
+};
+
+SyntaxState make_state(LexKind kind, int payload = 0) {
+  return kind | payload << 8;
+}
+LexKind state_kind(SyntaxState state) { return LexKind(state & 0xff); }
+int state_payload(SyntaxState state) { return state >> 8; }
+
+// Raw-string and heredoc delimiters are interned so a line state stays a
+// plain int. Entries are never removed; there is one per distinct delimiter.
+class DelimiterTable {
+public:
+  int intern(const std::string &delimiter) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = ids.find(delimiter);
+    if (it != ids.end())
+      return it->second;
+    values.push_back(delimiter);
+    ids.emplace(delimiter, (int)values.size());
+    return (int)values.size();
+  }
+
+  std::string get(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return id > 0 && id <= (int)values.size() ? values[id - 1] : std::string();
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<std::string> values;
+  std::unordered_map<std::string, int> ids;
+};
+
+DelimiterTable &delimiters() {
+  static DelimiterTable table;
+  return table;
+}
+} // namespace
+
+struct SyntaxLanguage {
+  Scanner scanner = SCAN_CODE;
+  KeywordTable keywords;
+  bool keywords_at_line_start = false;
+  bool calls = false;
+  bool dollar_calls = false; // JS: `$` is an identifier character in calls
+  bool c_preprocessor = false;
+  bool string_key_colon = false;
+  bool triple_quotes = false;
+  unsigned numbers = 0;
+  std::string quotes;     // strings with backslash escapes
+  std::string raw_quotes; // strings without escapes
+  std::string multiline_quotes; // quotes whose strings may span lines
+  bool cpp_raw_strings = false;  // R"delim(...)delim"
+  bool rust_raw_strings = false; // r#"..."#
+  bool heredocs = false;         // <<EOF ... EOF
+  std::vector<std::string> line_comments;
+  std::string block_open, block_close;
+  std::vector<Sigil> sigils;
+  LineRule line_rule = LINE_NONE;
+};
+
+namespace {
+// ---------------------------------------------------------------------------
+// Code scanner
+// ---------------------------------------------------------------------------
+
+size_t digits_end(const std::string &line, size_t pos) {
+  while (pos < line.size() && is_digit(line[pos]))
+    pos++;
+  return pos;
+}
+
+bool word_boundary(const std::string &line, size_t pos) {
+  return pos >= line.size() || !is_word(line[pos]);
+}
+
+size_t exponent_end(const std::string &line, size_t pos) {
+  if (pos >= line.size() || (line[pos] != 'e' && line[pos] != 'E'))
+    return npos;
+  pos++;
+  if (pos < line.size() && (line[pos] == '+' || line[pos] == '-'))
+    pos++;
+  const size_t end = digits_end(line, pos);
+  return end > pos ? end : npos;
+}
+
+// Returns the end of a numeric literal starting at a word boundary, or npos.
+size_t number_end(const std::string &line, size_t pos, unsigned forms) {
+  const size_t n = line.size();
+  if ((forms & NUM_HEX) && line[pos] == '0' && pos + 1 < n &&
+      line[pos + 1] == 'x') {
+    size_t p = pos + 2;
+    while (p < n && std::isxdigit(static_cast<unsigned char>(line[p])))
+      p++;
+    if (p > pos + 2 && word_boundary(line, p))
+      return p;
+  }
+  if ((forms & NUM_BINARY) && line[pos] == '0' && pos + 1 < n &&
+      line[pos + 1] == 'b') {
+    size_t p = pos + 2;
+    while (p < n && (line[p] == '0' || line[p] == '1'))
+      p++;
+    if (p > pos + 2 && word_boundary(line, p))
+      return p;
+  }
+
+  const size_t int_end = digits_end(line, pos);
+  if ((forms & NUM_FRACTION) && int_end + 1 < n && line[int_end] == '.' &&
+      is_digit(line[int_end + 1])) {
+    const size_t frac_end = digits_end(line, int_end + 1);
+    if (forms & NUM_FRACTION_EXPONENT) {
+      const size_t exp_end = exponent_end(line, frac_end);
+      if (exp_end != npos && word_boundary(line, exp_end))
+        return exp_end;
+    }
+    if (word_boundary(line, frac_end))
+      return frac_end;
+  }
+  if (forms & NUM_EXPONENT) {
+    const size_t exp_end = exponent_end(line, int_end);
+    if (exp_end != npos && word_boundary(line, exp_end))
+      return exp_end;
+  }
+  return word_boundary(line, int_end) ? int_end : npos;
+}
+
+constexpr size_t kContinued = npos - 1;
+
+// Scans string contents from `pos` for the closing `quote`. Returns the
+// position after it, kContinued when a trailing backslash carries the
+// string onto the next line, or npos if the line ends first.
+size_t string_close(const std::string &line, size_t pos, char quote,
+                    bool escapes) {
+  for (size_t i = pos; i < line.size(); i++) {
+    if (escapes && line[i] == '\\') {
+      if (++i >= line.size())
+        return kContinued;
+    } else if (line[i] == quote) {
+      return i + 1;
+    }
+  }
+  return npos;
+}
+
+// Returns the position after the closing quote, or npos if unterminated.
+size_t string_end(const std::string &line, size_t pos, bool escapes) {
+  const size_t end = string_close(line, pos + 1, line[pos], escapes);
+  return end == kContinued ? npos : end;
+}
+
+size_t triple_quote_close(const std::string &line, size_t pos, char quote) {
+  for (size_t i = pos; i + 2 < line.size(); i++) {
+    if (line[i] == '\\')
+      i++;
+    else if (line[i] == quote && line[i + 1] == quote && line[i + 2] == quote)
+      return i + 3;
+  }
+  return npos;
+}
+
+bool followed_by_call(const std::string &line, size_t pos) {
+  while (pos < line.size() && is_space(line[pos]))
+    pos++;
+  return pos < line.size() && line[pos] == '(';
+}
+
+size_t word_run_end(const std::string &line, size_t pos) {
+  while (pos < line.size() && is_word(line[pos]))
+    pos++;
+  return pos;
+}
+
+size_t sigil_end(const std::string &line, size_t pos, SigilForm form) {
+  const size_t n = line.size();
+  size_t p = pos + 1;
+  auto closed = [&](char open, char close) -> size_t {
+    if (p >= n || line[p] != open)
+      return npos;
+    const size_t end = word_run_end(line, p + 1);
+    return end > p + 1 && end < n && line[end] == close ? end + 1 : npos;
+  };
+
+  switch (form) {
+  case SIGIL_WORD: {
+    const size_t end = word_run_end(line, p);
+    return end > p ? end : npos;
+  }
+  case SIGIL_IDENT: {
+    if (p >= n || !is_ident_start(line[p]))
+      return npos;
+    return word_run_end(line, p);
+  }
+  case SIGIL_BRACE_OPTIONAL: {
+    if (p < n && line[p] == '{')
+      p++;
+    const size_t end = word_run_end(line, p);
+    if (end == p)
+      return npos;
+    return end < n && line[end] == '}' ? end + 1 : end;
+  }
+  case SIGIL_BRACE:
+    return closed('{', '}');
+  case SIGIL_PAREN_OR_BRACE: {
+    const size_t end = closed('(', ')');
+    return end != npos ? end : closed('{', '}');
+  }
+  }
+  return npos;
+}
+
+// `#include <x>`, `#define`, ... Returns the position scanning resumes at.
+size_t scan_preprocessor(const std::string &line, size_t pos, bool calls,
+                         Colors &colors) {
+  const size_t n = line.size();
+  size_t p = pos + 1;
+  while (p < n && is_space(line[p]))
+    p++;
+  const size_t word = p;
+  while (p < n && (std::isalpha(static_cast<unsigned char>(line[p])) ||
+                   line[p] == '_'))
+    p++;
+  if (p == word)
+    return pos + 1;
+  paint(colors, pos, p, 5);
+  const size_t ident_end = word_run_end(line, p);
+  if (calls && followed_by_call(line, ident_end)) {
+    paint(colors, word, ident_end, 6);
+    return ident_end;
+  }
+  if (ident_end > p)
+    return ident_end;
+  if (p - word != 7 || line.compare(word, 7, "include") != 0)
+    return p;
+
+  size_t q = p;
+  while (q < n && is_space(line[q]))
+    q++;
+  if (q >= n || (line[q] != '<' && line[q] != '"'))
+    return p;
+  const size_t close = line.find_first_of(">\"", q + 1);
+  if (close == npos || close == q + 1)
+    return p;
+  paint(colors, p, q, 6);
+  if (line[q] == '"')
+    return q; // the string itself is lexed as a string
+  paint(colors, q, close + 1, 6);
+  return close + 1;
+}
+
+void apply_line_rule(const SyntaxLanguage &lang, const std::string &line,
+                     Colors &colors) {
+  const size_t n = line.size();
+  switch (lang.line_rule) {
+  case LINE_NONE:
+    return;
+  case LINE_YAML_KEY:
+  case LINE_MAKE_TARGET: {
+    const bool yaml = lang.line_rule == LINE_YAML_KEY;
+    size_t p = 0;
+    if (yaml)
+      while (p < n && (line[p] == ' ' || line[p] == '\t'))
+        p++;
+    const size_t start = p;
+    while (p < n && (is_word(line[p]) || line[p] == '.' || line[p] == '-' ||
+                     (!yaml && line[p] == '/')))
+      p++;
+    if (p == start)
+      return;
+    while (p < n && is_space(line[p]))
+      p++;
+    if (p < n && line[p] == ':')
+      paint(colors, 0, p + 1, 5);
+    return;
+  }
+  case LINE_INI: {
+    size_t p = 0;
+    while (p < n && is_space(line[p]))
+      p++;
+    if (p < n && line[p] == '[') {
+      const size_t close = line.find(']', p + 1);
+      if (close != npos && close > p + 1)
+        paint(colors, 0, close + 1, 1);
+    }
+    if (n == 0 || std::strchr("=:#", line[0]) || is_space(line[0]))
+      return;
+    const size_t sep = line.find_first_of("=:#", 1);
+    if (sep != npos && line[sep] != '#')
+      paint(colors, 0, sep + 1, 5);
+    return;
+  }
+  }
+}
+
+// C++ R"d(...)d" and Rust r#"..."# literals, where [start, prefix_end) is
+// the identifier that may introduce one. Returns npos if it does not.
+size_t raw_string(const SyntaxLanguage &lang, const std::string &line,
+                  size_t start, size_t prefix_end, Colors &colors,
+                  SyntaxState &state) {
+  const size_t n = line.size();
+  auto prefix_is = [&](const char *prefix) {
+    return line.compare(start, prefix_end - start, prefix) == 0;
+  };
+
+  std::string close;
+  size_t body = npos;
+  if (lang.cpp_raw_strings && prefix_end < n && line[prefix_end] == '"' &&
+      (prefix_is("R") || prefix_is("LR") || prefix_is("uR") ||
+       prefix_is("UR") || prefix_is("u8R"))) {
+    const size_t paren = line.find('(', prefix_end + 1);
+    if (paren == npos || paren - prefix_end - 1 > 16)
+      return npos;
+    const std::string delimiter =
+        line.substr(prefix_end + 1, paren - prefix_end - 1);
+    if (delimiter.find_first_of(" \t\\)\"") != npos)
+      return npos;
+    close = ")" + delimiter + "\"";
+    body = paren + 1;
+  } else if (lang.rust_raw_strings && (prefix_is("r") || prefix_is("br"))) {
+    size_t p = prefix_end;
+    while (p < n && line[p] == '#')
+      p++;
+    if (p >= n || line[p] != '"')
+      return npos;
+    close = "\"" + std::string(p - prefix_end, '#');
+    body = p + 1;
+  } else {
+    return npos;
+  }
+
+  const size_t found = line.find(close, body);
+  if (found == npos) {
+    paint(colors, start, n, 2);
+    state = make_state(LEX_RAW_STRING, delimiters().intern(close));
+    return n;
+  }
+  paint(colors, start, found + close.size(), 2);
+  return found + close.size();
+}
+
+// `<<EOF`, `<<-EOF`, `<<'EOF'`. Returns the end of the operator and sets
+// `pending` to the heredoc state the next line starts in, or npos.
+size_t heredoc_start(const std::string &line, size_t pos, Colors &colors,
+                     SyntaxState &pending) {
+  const size_t n = line.size();
+  if (!at(line, pos, "<<") || (pos + 2 < n && line[pos + 2] == '<'))
+    return npos;
+  size_t p = pos + 2;
+  const bool strip_tabs = p < n && line[p] == '-';
+  if (strip_tabs)
+    p++;
+  while (p < n && (line[p] == ' ' || line[p] == '\t'))
+    p++;
+  const char quote = p < n && (line[p] == '\'' || line[p] == '"') ? line[p] : 0;
+  if (quote)
+    p++;
+  const size_t word_end = word_run_end(line, p);
+  if (word_end == p)
+    return npos;
+  size_t end = word_end;
+  if (quote) {
+    if (end >= n || line[end] != quote)
+      return npos;
+    end++;
+  }
+  paint(colors, pos, end, 5);
+  const std::string terminator =
+      (strip_tabs ? "-" : "") + line.substr(p, word_end - p);
+  pending = make_state(LEX_HEREDOC, delimiters().intern(terminator));
+  return end;
+}
+
+// Finishes a construct left open by the previous line. Returns the column
+// scanning resumes at, or npos when the whole line stays inside it.
+size_t resume(const SyntaxLanguage &lang, const std::string &line,
+              Colors &colors, SyntaxState &state) {
+  const size_t n = line.size();
+  size_t end = npos;
+  switch (state_kind(state)) {
+  case LEX_NONE:
+    return 0;
+  case LEX_BLOCK_COMMENT: {
+    const size_t close = line.find(lang.block_close);
+    end = close == npos ? npos : close + lang.block_close.size();
+    paint(colors, 0, end == npos ? n : end, 3);
+    break;
+  }
+  case LEX_TRIPLE_QUOTE:
+    end = triple_quote_close(line, 0, char(state_payload(state)));
+    paint(colors, 0, end == npos ? n : end, 2);
+    break;
+  case LEX_STRING: {
+    const char quote = char(state_payload(state));
+    end = string_close(line, 0, quote, lang.quotes.find(quote) != npos);
+    if (end == kContinued)
+      end = npos;
+    paint(colors, 0, end == npos ? n : end, 2);
+    break;
+  }
+  case LEX_RAW_STRING: {
+    const std::string close = delimiters().get(state_payload(state));
+    const size_t found = close.empty() ? npos : line.find(close);
+    end = found == npos ? npos : found + close.size();
+    paint(colors, 0, end == npos ? n : end, 2);
+    break;
+  }
+  case LEX_HEREDOC: {
+    const std::string terminator = delimiters().get(state_payload(state));
+    size_t p = 0;
+    size_t word = 0;
+    if (!terminator.empty() && terminator[0] == '-') {
+      word = 1;
+      while (p < n && line[p] == '\t')
+        p++;
+    }
+    paint(colors, 0, n, 2);
+    if (line.compare(p, npos, terminator, word, npos) == 0)
+      state = LEX_NONE;
+    return npos;
+  }
+  case LEX_FENCE:
+    state = LEX_NONE;
+    return 0;
+  }
+  if (end == npos)
+    return npos;
+  state = LEX_NONE;
+  return end;
+}
+
+void scan_code(const SyntaxLanguage &lang, const std::string &line,
+               Colors &colors, SyntaxState &state) {
+  const size_t n = line.size();
+  if (state == LEX_NONE)
+    apply_line_rule(lang, line, colors);
+
+  size_t i = resume(lang, line, colors, state);
+  if (i == npos)
+    return;
+  SyntaxState heredoc = LEX_NONE;
+  while (i < n) {
+    const char c = line[i];
+
+    if (at(line, i, lang.block_open)) {
+      const size_t from = i + lang.block_open.size();
+      const size_t close = line.find(lang.block_close, from);
+      if (close == npos) {
+        paint(colors, i, n, 3);
+        state = LEX_BLOCK_COMMENT;
+        return;
+      }
+      const size_t end = close + lang.block_close.size();
+      paint(colors, i, end, 3);
+      i = end;
+      continue;
+    }
+    bool line_comment = false;
+    for (const std::string &marker : lang.line_comments)
+      if (at(line, i, marker)) {
+        line_comment = true;
+        break;
+      }
+    if (line_comment) {
+      paint(colors, i, n, 3);
+      break;
+    }
+
+    if (lang.triple_quotes && (c == '"' || c == '\'') && i + 2 < n &&
+        line[i + 1] == c && line[i + 2] == c) {
+      const size_t end = triple_quote_close(line, i + 3, c);
+      if (end == npos) {
+        paint(colors, i, n, 2);
+        state = make_state(LEX_TRIPLE_QUOTE, c);
+        return;
+      }
+      paint(colors, i, end, 2);
+      i = end;
+      continue;
+    }
+    const bool escaped = lang.quotes.find(c) != npos;
+    const bool multiline = lang.multiline_quotes.find(c) != npos;
+    if (escaped || multiline || lang.raw_quotes.find(c) != npos) {
+      const size_t end = string_close(line, i + 1, c, escaped);
+      if (end == kContinued || (end == npos && multiline)) {
+        paint(colors, i, n, 2);
+        state = make_state(LEX_STRING, c);
+        return;
+      }
+      if (end == npos) {
+        i++;
+        continue;
+      }
+      paint(colors, i, end, 2);
+      if (lang.string_key_colon && end < n && line[end] == ':')
+        paint(colors, end, end + 1, 5);
+      i = end;
+      continue;
+    }
+
+    if (lang.c_preprocessor && c == '#') {
+      i = scan_preprocessor(line, i, lang.calls, colors);
+      continue;
+    }
+
+    if (lang.heredocs && c == '<') {
+      const size_t end = heredoc_start(line, i, colors, heredoc);
+      if (end != npos) {
+        i = end;
+        continue;
+      }
+    }
+
+    const Sigil *sigil = nullptr;
+    for (const Sigil &s : lang.sigils)
+      if (s.lead == c) {
+        sigil = &s;
+        break;
+      }
+    if (sigil) {
+      const size_t end = sigil_end(line, i, sigil->form);
+      if (end == npos) {
+        i++;
+        continue;
+      }
+      paint(colors, i, end, sigil->color);
+      if (lang.calls && is_ident_start(line[i + 1]) && followed_by_call(line, end))
+        paint(colors, i + 1, end, 6);
+      // `@2.5`: the fraction outlives the sigil word and stays a number.
+      if (lang.numbers && is_digit(line[i + 1])) {
+        const size_t number = number_end(line, i + 1, lang.numbers);
+        if (number != npos && number > end) {
+          paint(colors, end, number, 4);
+          i = number;
+          continue;
+        }
+      }
+      i = end;
+      continue;
+    }
+
+    if (lang.dollar_calls && (c == '$' ? i > 0 && is_word(line[i - 1])
+                                       : is_ident_start(c))) {
+      size_t end = i;
+      while (end < n && (is_word(line[end]) || line[end] == '$'))
+        end++;
+      while (end > i && line[end - 1] == '$')
+        end--;
+      if (end > i && followed_by_call(line, end)) {
+        paint(colors, i, end, 6);
+        i = end;
+        continue;
+      }
+      if (c == '$') {
+        i++;
+        continue;
+      }
+    }
+
+    if (is_word(c)) {
+      const size_t end = word_run_end(line, i);
+      if (end < n && (line[end] == '"' || line[end] == '#') &&
+          (lang.cpp_raw_strings || lang.rust_raw_strings)) {
+        const size_t raw = raw_string(lang, line, i, end, colors, state);
+        if (raw != npos) {
+          if (state != LEX_NONE)
+            return;
+          i = raw;
+          continue;
+        }
+      }
+      if (is_digit(c)) {
+        const size_t number = lang.numbers ? number_end(line, i, lang.numbers)
+                                           : npos;
+        if (number != npos) {
+          const bool sign = (lang.numbers & NUM_SIGNED) && i >= 2 &&
+                            line[i - 1] == '-' && is_word(line[i - 2]);
+          paint(colors, sign ? i - 1 : i, number, 4);
+          i = number;
+        } else {
+          i = end;
+        }
+        continue;
+      }
+      if (lang.calls && followed_by_call(line, end)) {
+        paint(colors, i, end, 6);
+      } else if (!lang.keywords_at_line_start || i == 0) {
+        const int color = lang.keywords.find(line.data() + i, end - i);
+        if (color)
+          paint(colors, i, end, color);
+      }
+      i = end;
+      continue;
+    }
+    i++;
+  }
+  if (heredoc != LEX_NONE)
+    state = heredoc;
+}
+
+// ---------------------------------------------------------------------------
+// Markup scanners
+// ---------------------------------------------------------------------------
+// CSS, HTML and Markdown keep the two-pass model of the old rule lists:
+// strings and comments are painted first and protected, then token rules
+// paint in order around them. Each matcher returns the end of a match
+// starting at `pos` (or npos) and matches are taken leftmost-first.
+
+template <typename Match>
+void apply_rule(const std::string &line, size_t start, Colors &colors,
+                std::vector<char> &protect, bool protecting, int color,
+                Match match) {
+  size_t pos = start;
+  while (pos < line.size()) {
+    const size_t end = match(line, pos);
+    if (end == npos || end <= pos) {
+      pos++;
+      continue;
+    }
+    for (size_t i = pos; i < end; i++) {
+      if (protecting)
+        protect[i] = 1;
+      else if (protect[i])
+        continue;
+      colors[i] = {1, color};
+    }
+    pos = end;
+  }
+}
+
+bool regex_boundary(const std::string &line, size_t pos) {
+  const bool before = pos > 0 && is_word(line[pos - 1]);
+  const bool after = pos < line.size() && is_word(line[pos]);
+  return before != after;
+}
+
+size_t delimited(const std::string &line, size_t pos, const char *open,
+                 const char *close) {
+  const size_t open_len = std::strlen(open);
+  if (line.compare(pos, open_len, open) != 0)
+    return npos;
+  const size_t end = line.find(close, pos + open_len);
+  return end == npos ? npos : end + std::strlen(close);
+}
+
+// Comment rule for the markup scanners. An opener without a closer runs to
+// the end of the line and leaves the line state inside the comment.
+struct BlockComment {
+  const char *open;
+  const char *close;
+  SyntaxState *state;
+
+  size_t operator()(const std::string &line, size_t pos) const {
+    const size_t open_len = std::strlen(open);
+    if (line.compare(pos, open_len, open) != 0)
+      return npos;
+    const size_t end = line.find(close, pos + open_len);
+    if (end != npos)
+      return end + std::strlen(close);
+    *state = LEX_BLOCK_COMMENT;
+    return line.size();
+  }
+};
+
+// Paints the tail of a comment left open above. Returns the column the
+// line's own rules start at, or npos if the comment covers the line.
+size_t resume_comment(const std::string &line, const char *close,
+                      Colors &colors, std::vector<char> &protect,
+                      SyntaxState &state) {
+  if (state_kind(state) != LEX_BLOCK_COMMENT)
+    return 0;
+  const size_t found = line.find(close);
+  const size_t end = found == npos ? line.size() : found + std::strlen(close);
+  for (size_t i = 0; i < end; i++) {
+    colors[i] = {1, 3};
+    protect[i] = 1;
+  }
+  if (found == npos)
+    return npos;
+  state = LEX_NONE;
+  return end;
+}
+
+size_t quoted_string(const std::string &line, size_t pos) {
+  if (line[pos] != '"' && line[pos] != '\'')
+    return npos;
+  return string_end(line, pos, true);
+}
+
+void scan_html(const std::string &line, Colors &colors, SyntaxState &state) {
+  std::vector<char> protect(line.size(), 0);
+  const size_t start = resume_comment(line, "-->", colors, protect, state);
+  if (start == npos)
+    return;
+  apply_rule(line, start, colors, protect, true, 2, quoted_string);
+  apply_rule(line, start, colors, protect, true, 3,
+             BlockComment{"<!--", "-->", &state});
+  apply_rule(line, start, colors, protect, false, 1,
+             [](const std::string &l, size_t pos) {
+               return delimited(l, pos, "<", ">");
+             });
+}
+
+void scan_css(const SyntaxLanguage &lang, const std::string &line,
+              Colors &colors, SyntaxState &state) {
+  auto in_name = [](char c) { return is_word(c) || c == '-'; };
+  auto name_end = [&](const std::string &l, size_t pos) {
+    while (pos < l.size() && in_name(l[pos]))
+      pos++;
+    return pos;
+  };
+
+  std::vector<char> protect(line.size(), 0);
+  const size_t start = resume_comment(line, "*/", colors, protect, state);
+  if (start == npos)
+    return;
+  apply_rule(line, start, colors, protect, true, 3,
+             BlockComment{"/*", "*/", &state});
+  apply_rule(line, start, colors, protect, false, 1,
+             [&](const std::string &l, size_t pos) -> size_t {
+               if (!is_word(l[pos]) || (pos > 0 && is_word(l[pos - 1])))
+                 return npos;
+               const size_t end = word_run_end(l, pos);
+               return lang.keywords.find(l.data() + pos, end - pos) ? end : npos;
+             });
+  // Properties: `name:`. A run that failed at its start fails everywhere.
+  auto in_property = [](char c) { return c != '_' && (is_word(c) || c == '-'); };
+  apply_rule(line, start, colors, protect, false, 5,
+             [&](const std::string &l, size_t pos) -> size_t {
+               if (!in_property(l[pos]) || (pos > 0 && in_property(l[pos - 1])))
+                 return npos;
+               size_t end = pos;
+               while (end < l.size() && in_property(l[end]))
+                 end++;
+               while (end < l.size() && is_space(l[end]))
+                 end++;
+               return end < l.size() && l[end] == ':' ? end + 1 : npos;
+             });
+  apply_rule(line, start, colors, protect, false, 5,
+             [&](const std::string &l, size_t pos) -> size_t {
+               const size_t end = l[pos] == '.' ? name_end(l, pos + 1) : npos;
+               return end != npos && end > pos + 1 ? end : npos;
+             });
+  apply_rule(line, start, colors, protect, false, 4,
+             [&](const std::string &l, size_t pos) -> size_t {
+               const size_t end = l[pos] == '#' ? name_end(l, pos + 1) : npos;
+               return end != npos && end > pos + 1 ? end : npos;
+             });
+  apply_rule(line, start, colors, protect, false, 4,
+             [](const std::string &l, size_t pos) -> size_t {
+               if (!is_digit(l[pos]) || !regex_boundary(l, pos))
+                 return npos;
+               const size_t end = digits_end(l, pos);
+               static const char *const units[] = {"px", "em", "rem", "%",
+                                                   "vh", "vw", "s",   "ms"};
+               for (const char *unit : units) {
+                 const size_t len = std::strlen(unit);
+                 if (l.compare(end, len, unit) == 0 &&
+                     regex_boundary(l, end + len))
+                   return end + len;
+               }
+               return regex_boundary(l, end) ? end : npos;
+             });
+}
+
+void scan_markdown(const std::string &line, Colors &colors,
+                   SyntaxState &state) {
+  const size_t n = line.size();
+  // Fenced code blocks are painted as code up to the closing fence.
+  size_t fence = 0;
+  while (fence < 3 && fence < n && line[fence] == ' ')
+    fence++;
+  const bool fence_line = line.compare(fence, 3, "```") == 0;
+  if (state_kind(state) == LEX_FENCE || (state == LEX_NONE && fence_line)) {
+    paint(colors, 0, n, 2);
+    state = state == LEX_NONE ? make_state(LEX_FENCE)
+                              : (fence_line ? LEX_NONE : state);
+    return;
+  }
+
+  std::vector<char> protect(n, 0);
+  const size_t start = resume_comment(line, "-->", colors, protect, state);
+  if (start == npos)
+    return;
+  apply_rule(line, start, colors, protect, true, 2,
+             [](const std::string &l, size_t pos) {
+               return delimited(l, pos, "`", "`");
+             });
+  apply_rule(line, start, colors, protect, true, 3,
+             BlockComment{"<!--", "-->", &state});
+
+  // Headers
+  size_t hashes = 0;
+  while (hashes < n && line[hashes] == '#')
+    hashes++;
+  if (hashes > 0 && hashes < n && line[hashes] == ' ')
+    apply_rule(line, start, colors, protect, false, 5,
+               [](const std::string &l, size_t pos) {
+                 return pos == 0 ? l.size() : npos;
+               });
+  // Bold, then italic (which repaints the delimiters, as before)
+  apply_rule(line, start, colors, protect, false, 1,
+             [](const std::string &l, size_t pos) {
+               const size_t end = delimited(l, pos, "**", "**");
+               return end != npos ? end : delimited(l, pos, "__", "__");
+             });
+  apply_rule(line, start, colors, protect, false, 6,
+             [](const std::string &l, size_t pos) {
+               const size_t end = delimited(l, pos, "*", "*");
+               return end != npos ? end : delimited(l, pos, "_", "_");
+             });
+  // Links
+  apply_rule(line, start, colors, protect, false, 4,
+             [](const std::string &l, size_t pos) -> size_t {
+               if (l[pos] != '[')
+                 return npos;
+               const size_t mid = l.find("](", pos + 1);
+               const size_t close = mid == npos ? npos : l.find(')', mid + 2);
+               return close == npos ? npos : close + 1;
+             });
+  // List markers
+  size_t indent = 0;
+  while (indent < n && is_space(line[indent]))
+    indent++;
+  size_t marker = npos;
+  if (indent + 1 < n && std::strchr("-*+", line[indent]) &&
+      line[indent + 1] == ' ') {
+    marker = indent + 2;
+  } else {
+    const size_t digits = digits_end(line, indent);
+    if (digits > indent && digits + 1 < n && line[digits] == '.' &&
+        line[digits + 1] == ' ')
+      marker = digits + 2;
+  }
+  if (marker != npos)
+    apply_rule(line, start, colors, protect, false, 1,
+               [marker](const std::string &, size_t pos) {
+                 return pos == 0 ? marker : npos;
+               });
+}
+
+// ---------------------------------------------------------------------------
+// Language table
+// ---------------------------------------------------------------------------
+
+struct LanguageRegistry {
+  std::vector<std::unique_ptr<SyntaxLanguage>> languages;
+  std::unordered_map<std::string, const SyntaxLanguage *> by_extension;
+
+  SyntaxLanguage &add(std::initializer_list<const char *> extensions) {
+    languages.push_back(std::make_unique<SyntaxLanguage>());
+    for (const char *ext : extensions)
+      by_extension[ext] = languages.back().get();
+    return *languages.back();
+  }
+};
+
+constexpr unsigned kCommonNumbers =
+    NUM_INT | NUM_HEX | NUM_FRACTION | NUM_FRACTION_EXPONENT;
+
+void c_like(SyntaxLanguage &lang) {
+  lang.line_comments = {"//"};
+  lang.block_open = "/*";
+  lang.block_close = "*/";
+  lang.calls = true;
+}
+
+LanguageRegistry build_languages() {
+  LanguageRegistry r;
+
+  {
+    SyntaxLanguage &cpp =
+        r.add({".cpp", ".h", ".c", ".hpp", ".cc", ".cxx", ".hh", ".hxx"});
+    cpp.keywords.add(
+        "int char void float double bool long short unsigned signed const "
+        "static struct class namespace public private protected virtual "
+        "override final return if else for while do switch case break "
+        "continue sizeof typedef using template typename auto nullptr new "
+        "delete try catch throw enum union friend explicit operator this "
+        "constexpr consteval constinit noexcept concept requires co_await "
+        "co_return co_yield",
+        1);
+    c_like(cpp);
+    cpp.c_preprocessor = true;
+    cpp.quotes = "\"'";
+    cpp.cpp_raw_strings = true;
+    cpp.numbers = kCommonNumbers | NUM_BINARY | NUM_EXPONENT;
+  }
+  {
+    SyntaxLanguage &py = r.add({".py"});
+    py.keywords.add("import from as", 5);
+    py.keywords.add("def class if elif else for while return try except "
+                    "finally with lambda yield assert break continue pass "
+                    "raise global nonlocal True False None and or not in is "
+                    "self",
+                    1);
+    py.line_comments = {"#"};
+    py.triple_quotes = true;
+    py.quotes = "\"'";
+    py.numbers = kCommonNumbers;
+    py.sigils = {{'@', SIGIL_WORD, 6}};
+    py.calls = true;
+  }
+  {
+    SyntaxLanguage &js = r.add({".js", ".ts", ".jsx", ".tsx", ".mjs", ".cjs"});
+    js.keywords.add("import from export require", 5);
+    js.keywords.add(
+        "var let const function return if else for while do switch case "
+        "break continue class extends async await try catch finally throw "
+        "new typeof instanceof this super static get set yield void null "
+        "undefined true false interface type implements enum readonly keyof "
+        "infer satisfies",
+        1);
+    c_like(js);
+    js.quotes = "`\"'";
+    js.numbers = kCommonNumbers;
+    js.multiline_quotes = "`";
+    js.dollar_calls = true;
+  }
+  r.add({".html", ".xml"}).scanner = SCAN_HTML;
+  {
+    SyntaxLanguage &rs = r.add({".rs"});
+    rs.keywords.add("use mod crate extern", 5);
+    rs.keywords.add("fn let mut const static struct enum impl trait type pub "
+                    "self super if else match for while loop return break "
+                    "continue async await move ref where unsafe as dyn",
+                    1);
+    c_like(rs);
+    rs.quotes = "\"";
+    rs.multiline_quotes = "\"";
+    rs.rust_raw_strings = true;
+    rs.numbers = kCommonNumbers;
+  }
+  {
+    SyntaxLanguage &css = r.add({".css"});
+    css.scanner = SCAN_CSS;
+    css.keywords.add("body div span h1 h2 h3 h4 h5 h6 p a ul ol li table tr "
+                     "td th form input button img header footer nav section "
+                     "article aside",
+                     1);
+  }
+  {
+    SyntaxLanguage &java = r.add({".java", ".kt"});
+    java.keywords.add("import package", 5);
+    java.keywords.add(
+        "public private protected class interface enum extends implements "
+        "static final void int double float boolean char byte short long if "
+        "else for while do switch case break continue return try catch "
+        "finally throw throws new this super synchronized volatile transient "
+        "native abstract default",
+        1);
+    c_like(java);
+    java.quotes = "\"'";
+    java.numbers = kCommonNumbers;
+    java.sigils = {{'@', SIGIL_WORD, 6}};
+  }
+  {
+    SyntaxLanguage &go = r.add({".go"});
+    go.keywords.add("package import", 5);
+    go.keywords.add("func type struct interface map chan go defer if else "
+                    "for range return break continue switch case default "
+                    "select var const fallthrough goto",
+                    1);
+    go.keywords.add("true false nil iota", 6);
+    go.line_comments = {"//"};
+    go.raw_quotes = "\"`";
+    go.multiline_quotes = "`";
+    go.numbers = NUM_INT;
+  }
+  r.add({".md"}).scanner = SCAN_MARKDOWN;
+  {
+    SyntaxLanguage &json = r.add({".json", ".jsonc"});
+    json.keywords.add("true false null", 1);
+    json.line_comments = {"//"};
+    json.quotes = "\"";
+    json.string_key_colon = true;
+    json.numbers = NUM_INT | NUM_FRACTION | NUM_SIGNED;
+  }
+  {
+    SyntaxLanguage &sh = r.add({".sh", ".bash", ".zsh"});
+    sh.keywords.add("if then else elif fi case esac for while until do done "
+                    "in function return exit export local echo read source",
+                    1);
+    sh.line_comments = {"#"};
+    sh.raw_quotes = "\"'";
+    sh.multiline_quotes = "\"'";
+    sh.heredocs = true;
+    sh.sigils = {{'$', SIGIL_BRACE_OPTIONAL, 5}};
+  }
+  {
+    SyntaxLanguage &rb = r.add({".rb"});
+    rb.keywords.add("require include extend", 5);
+    rb.keywords.add("def end class module if else elsif unless while until "
+                    "for in do yield return break next redo retry ensure "
+                    "rescue case when then begin super alias self true false "
+                    "nil",
+                    1);
+    rb.line_comments = {"#"};
+    rb.quotes = "\"'";
+    rb.multiline_quotes = "\"'";
+    rb.sigils = {{':', SIGIL_WORD, 5}, {'@', SIGIL_WORD, 6}};
+  }
+  {
+    SyntaxLanguage &php = r.add({".php"});
+    php.keywords.add("use namespace require include", 5);
+    php.keywords.add(
+        "php echo function class public private protected static if else "
+        "elseif for foreach while do switch case break continue return try "
+        "catch finally throw new extends implements interface trait null "
+        "true false",
+        1);
+    php.line_comments = {"//", "#"};
+    php.block_open = "/*";
+    php.block_close = "*/";
+    php.quotes = "\"'";
+    php.multiline_quotes = "\"'";
+    php.sigils = {{'$', SIGIL_WORD, 5}};
+  }
+  {
+    SyntaxLanguage &lua = r.add({".lua"});
+    lua.keywords.add("local function end if then elseif else for while "
+                     "repeat until do return break goto and or not nil true "
+                     "false in",
+                     1);
+    lua.block_open = "--[[";
+    lua.block_close = "]]";
+    lua.line_comments = {"--"};
+    lua.quotes = "\"'";
+    lua.numbers = NUM_INT | NUM_HEX | NUM_FRACTION;
+    lua.calls = true;
+  }
+  {
+    SyntaxLanguage &swift = r.add({".swift"});
+    swift.keywords.add(
+        "import class struct enum protocol extension func let var if else "
+        "guard for while repeat switch case default break continue return "
+        "throw throws try catch defer where in as is nil true false self "
+        "super init deinit",
+        1);
+    c_like(swift);
+    swift.quotes = "\"";
+    swift.numbers = NUM_INT | NUM_HEX | NUM_FRACTION;
+    swift.sigils = {{'@', SIGIL_IDENT, 5}};
+  }
+  {
+    SyntaxLanguage &cs = r.add({".cs"});
+    cs.keywords.add("using namespace", 5);
+    cs.keywords.add(
+        "public private protected internal class struct interface enum "
+        "record static readonly const void int float double decimal bool "
+        "string char byte short long if else for foreach while do switch "
+        "case break continue return new this base try catch finally throw "
+        "async await var null true false",
+        1);
+    c_like(cs);
+    cs.quotes = "\"'";
+    cs.numbers = NUM_INT | NUM_HEX | NUM_FRACTION;
+    cs.sigils = {{'@', SIGIL_WORD, 6}};
+  }
+  {
+    SyntaxLanguage &sql = r.add({".sql"});
+    sql.keywords.case_insensitive = true;
+    sql.keywords.add(
+        "select insert update delete from where join left right inner outer "
+        "on group by order having limit offset into values create alter "
+        "drop table view index primary key foreign constraint distinct "
+        "union all as and or not null is in exists between like",
+        1);
+    sql.line_comments = {"--"};
+    sql.block_open = "/*";
+    sql.block_close = "*/";
+    sql.quotes = "'";
+    sql.numbers = NUM_INT | NUM_FRACTION | NUM_SIGNED;
+  }
+  {
+    SyntaxLanguage &cmake = r.add({".cmake"});
+    cmake.keywords.case_insensitive = true;
+    cmake.keywords.add(
+        "if else elseif endif foreach endforeach while endwhile function "
+        "endfunction macro endmacro set unset option include project "
+        "add_executable add_library target_link_libraries "
+        "target_include_directories message find_package install",
+        1);
+    cmake.line_comments = {"#"};
+    cmake.quotes = "\"";
+    cmake.sigils = {{'$', SIGIL_BRACE, 5}};
+  }
+  {
+    SyntaxLanguage &docker = r.add({".dockerfile"});
+    docker.keywords.case_insensitive = true;
+    docker.keywords.add("from run cmd entrypoint env arg workdir copy add "
+                        "expose user volume label shell stopsignal "
+                        "healthcheck onbuild",
+                        1);
+    docker.keywords_at_line_start = true;
+    docker.line_comments = {"#"};
+    docker.quotes = "\"'";
+    docker.sigils = {{'$', SIGIL_BRACE_OPTIONAL, 5}};
+  }
+  {
+    SyntaxLanguage &make = r.add({".make", ".mk"});
+    make.line_rule = LINE_MAKE_TARGET;
+    make.keywords.add("ifdef ifndef ifeq ifneq else endif include define "
+                      "endef override export unexport vpath",
+                      1);
+    make.line_comments = {"#"};
+    make.sigils = {{'$', SIGIL_PAREN_OR_BRACE, 6}};
+  }
+  {
+    SyntaxLanguage &ini = r.add({".ini", ".cfg", ".conf", ".properties"});
+    ini.line_rule = LINE_INI;
+    ini.line_comments = {"#", ";"};
+    ini.quotes = "\"";
+  }
+  {
+    SyntaxLanguage &yaml = r.add({".yml", ".yaml", ".toml"});
+    yaml.line_rule = LINE_YAML_KEY;
+    yaml.keywords.add("true false null on off yes no", 1);
+    yaml.line_comments = {"#"};
+    yaml.quotes = "\"'";
+    yaml.numbers = NUM_INT | NUM_FRACTION | NUM_SIGNED;
+  }
+  return r;
+}
+
+const LanguageRegistry &languages() {
+  static const LanguageRegistry registry = build_languages();
+  return registry;
+}
+} // namespace
+
+void SyntaxHighlighter::set_language(const std::string &ext) {
+  if (file_extension == ext)
+    return;
+  file_extension = ext;
+  const auto &table = languages().by_extension;
+  const auto it = table.find(ext);
+  language = it == table.end() ? nullptr : it->second;
+}
+
+std::vector<std::pair<int, int>>
+SyntaxHighlighter::get_colors(const std::string &line,
+                              SyntaxState &state) const {
+  Colors colors(line.size(), {0, 0});
+  if (!language) {
+    state = 0;
+    return colors;
+  }
+
+  switch (language->scanner) {
+  case SCAN_CODE:
+    scan_code(*language, line, colors, state);
+    break;
+  case SCAN_CSS:
+    scan_css(*language, line, colors, state);
+    break;
+  case SCAN_HTML:
+    scan_html(line, colors, state);
+    break;
+  case SCAN_MARKDOWN:
+    scan_markdown(line, colors, state);
+    break;
+  }
+  return colors;
+}
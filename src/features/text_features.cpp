@@ -111,51 +111,6 @@ bool EditorFeatures::should_dedent(const std::string &line) {
   return false;
 }
 
-int EditorFeatures::find_matching_bracket(const std::vector<std::string> &lines,
-                                          int line, int col, char open,
-                                          char close) {
-  if (line < 0 || line >= (int)lines.size())
-    return -1;
-  if (col < 0 || col >= (int)lines[line].length())
-    return -1;
-
-  if (lines[line][col] != open && lines[line][col] != close)
-    return -1;
-
-  // char target = lines[line][col] == open ? close : open; // Unused
-  int dir = lines[line][col] == open ? 1 : -1;
-  int depth = 1;
-
-  int cur_line = line;
-  int cur_col = col;
-
-  while (cur_line >= 0 && cur_line < (int)lines.size()) {
-    while (cur_col >= 0 && cur_col < (int)lines[cur_line].length()) {
-      if (lines[cur_line][cur_col] == open)
-        depth += dir;
-      if (lines[cur_line][cur_col] == close)
-        depth -= dir;
-
-      if (depth == 0) {
-        return cur_line * 10000 + cur_col;
-      }
-
-      cur_col += dir;
-    }
-
-    if (dir > 0) {
-      cur_line++;
-      cur_col = 0;
-    } else {
-      cur_line--;
-      if (cur_line >= 0)
-        cur_col = lines[cur_line].length() - 1;
-    }
-  }
-
-  return -1;
-}
-
 void EditorFeatures::format_line(std::string &line, int tab_size) {
   size_t pos = 0;
   while ((pos = line.find('\t', pos)) != std::string::npos) {
@@ -19,11 +19,59 @@ public:
   static std::string get_indent_string(int level, int tab_size);
   static bool should_auto_indent(const std::string &line);
   static bool should_dedent(const std::string &line);
-  static int find_matching_bracket(const std::vector<std::string> &lines,
-                                   int line, int col, char open, char close);
+  // Works on any line container with size() and operator[] (std::vector or
+  // the editor's LineStore).
+  template <typename Lines>
+  static int find_matching_bracket(const Lines &lines, int line, int col,
+                                   char open, char close);
   static void format_line(std::string &line, int tab_size);
   static std::string trim_right(const std::string &s);
   static bool is_whitespace(const std::string &s);
 };
 
+template <typename Lines>
+int EditorFeatures::find_matching_bracket(const Lines &lines, int line, int col,
+                                          char open, char close) {
+  if (line < 0 || line >= (int)lines.size())
+    return -1;
+  if (col < 0 || col >= (int)lines[line].length())
+    return -1;
+
+  if (lines[line][col] != open && lines[line][col] != close)
+    return -1;
+
+  // char target = lines[line][col] == open ? close : open; // Unused
+  int dir = lines[line][col] == open ? 1 : -1;
+  int depth = 1;
+
+  int cur_line = line;
+  int cur_col = col;
+
+  while (cur_line >= 0 && cur_line < (int)lines.size()) {
+    while (cur_col >= 0 && cur_col < (int)lines[cur_line].length()) {
+      if (lines[cur_line][cur_col] == open)
+        depth += dir;
+      if (lines[cur_line][cur_col] == close)
+        depth -= dir;
+
+      if (depth == 0) {
+        return cur_line * 10000 + cur_col;
+      }
+
+      cur_col += dir;
+    }
+
+    if (dir > 0) {
+      cur_line++;
+      cur_col = 0;
+    } else {
+      cur_line--;
+      if (cur_line >= 0)
+        cur_col = lines[cur_line].length() - 1;
+    }
+  }
+
+  return -1;
+}
+
 #endif // EDITOR_FEATURES_H
@@ -4,9 +4,24 @@
 
 void Editor::format_document() {
   auto &buf = get_buffer();
-  save_state();
-  for (auto &line : buf.lines) {
+  if (!ensure_editable(buf)) {
+    return;
+  }
+  // Formatted first, so only the lines it changes are saved for undo.
+  std::vector<std::pair<int, std::string>> changed;
+  for (std::size_t y = 0; y < buf.lines.size(); y++) {
+    std::string line = buf.lines[y];
     EditorFeatures::format_line(line, tab_size);
+    if (line != buf.lines[y]) {
+      changed.emplace_back((int)y, std::move(line));
+    }
+  }
+  if (!changed.empty() &&
+      !save_state(changed.front().first, changed.back().first)) {
+    return;
+  }
+  for (auto &[y, line] : changed) {
+    buf.lines.set(y, std::move(line));
   }
   buf.modified = true;
   needs_redraw = true;
@@ -17,16 +32,26 @@ void Editor::format_document() {
 
 void Editor::trim_trailing_whitespace() {
   auto &buf = get_buffer();
-  save_state();
-
-  int changed = 0;
-  for (auto &line : buf.lines) {
-    std::string trimmed = EditorFeatures::trim_right(line);
-    if (trimmed != line) {
-      line = trimmed;
-      changed++;
+  if (!ensure_editable(buf)) {
+    return;
+  }
+  // Trimmed first, so only the lines it changes are saved for undo.
+  std::vector<std::pair<int, std::string>> trimmed_lines;
+  for (std::size_t y = 0; y < buf.lines.size(); y++) {
+    std::string trimmed = EditorFeatures::trim_right(buf.lines[y]);
+    if (trimmed != buf.lines[y]) {
+      trimmed_lines.emplace_back((int)y, std::move(trimmed));
     }
   }
+  if (!trimmed_lines.empty() && !save_state(trimmed_lines.front().first,
+                                            trimmed_lines.back().first)) {
+    return;
+  }
+
+  const int changed = (int)trimmed_lines.size();
+  for (auto &[y, trimmed] : trimmed_lines) {
+    buf.lines.set(y, std::move(trimmed));
+  }
 
   if (changed > 0) {
     buf.modified = true;
@@ -46,6 +46,15 @@ void Editor::handle_telescope(int ch) {
       image_viewer.open(path);
     } else {
       open_file(path);
+      const int line = telescope.get_selected_line();
+      auto &buf = get_buffer();
+      if (line >= 0 && !buf.lines.empty()) {
+        buf.cursor.y = std::clamp(line, 0, (int)buf.lines.size() - 1);
+        buf.cursor.x = std::clamp(telescope.get_selected_column(), 0,
+                                  (int)buf.lines[buf.cursor.y].length());
+        clear_selection();
+        ensure_cursor_visible();
+      }
     }
     telescope.close();
     waiting_for_space_f = false;
@@ -53,12 +62,14 @@ void Editor::handle_telescope(int ch) {
     return;
   }
 
-  if (ch == 1008 || ch == 'k' || ch == 16) { // Up or Ctrl+P
+  // j and k move too, except in live grep where they are likely typed.
+  const bool vi_keys = !telescope.is_content_search();
+  if (ch == 1008 || (vi_keys && ch == 'k') || ch == 16) { // Up or Ctrl+P
     telescope.move_up();
     needs_redraw = true;
     return;
   }
-  if (ch == 1009 || ch == 'j' || ch == 14) { // Down or Ctrl+N
+  if (ch == 1009 || (vi_keys && ch == 'j') || ch == 14) { // Down or Ctrl+N
     telescope.move_down();
     needs_redraw = true;
     return;
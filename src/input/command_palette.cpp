@@ -79,22 +79,24 @@ void Editor::refresh_command_palette() {
 
   if (completing_command) {
     for (const auto &c : ex_commands()) {
-      if (starts_with_icase(c, cmd)) {
+      if (fuzzy_matches_icase(c, cmd)) {
         command_palette_results.push_back(c);
       }
     }
     for (const auto &custom : custom_commands) {
-      if (starts_with_icase(custom.name, cmd)) {
+      if (fuzzy_matches_icase(custom.name, cmd)) {
         command_palette_results.push_back(custom.name);
       }
     }
+    rank_completions(command_palette_results, cmd);
     return;
   }
 
   const std::string lcmd = to_lower_copy(cmd);
+  std::string typed = arg; // what the candidates complete
   if (lcmd == "theme" || lcmd == "colorscheme" || lcmd == "colo") {
     for (const auto &theme : list_available_themes()) {
-      if (arg.empty() || starts_with_icase(theme, arg)) {
+      if (fuzzy_matches_icase(theme, arg)) {
         command_palette_results.push_back(theme);
       }
     }
@@ -107,7 +109,7 @@ void Editor::refresh_command_palette() {
 
       std::string recent_name = get_filename(recent_files[i]);
       if (!recent_name.empty() &&
-          (arg.empty() || starts_with_icase(recent_name, arg))) {
+          fuzzy_matches_icase(recent_name, arg)) {
         command_palette_results.push_back(recent_name);
       }
     }
@@ -155,6 +157,7 @@ void Editor::refresh_command_palette() {
                                      paths.begin(), paths.end());
     } else {
       std::string right = trim_copy(arg.substr(split + 1));
+      typed = right;
       auto paths = complete_path_argument(right);
       command_palette_results.insert(command_palette_results.end(),
                                      paths.begin(), paths.end());
@@ -177,12 +180,12 @@ void Editor::refresh_command_palette() {
     }
   } else if (lcmd == "help" || lcmd == "h") {
     for (const auto &c : ex_commands()) {
-      if (arg.empty() || starts_with_icase(c, arg)) {
+      if (fuzzy_matches_icase(c, arg)) {
         command_palette_results.push_back(c);
       }
     }
     for (const auto &custom : custom_commands) {
-      if (arg.empty() || starts_with_icase(custom.name, arg)) {
+      if (fuzzy_matches_icase(custom.name, arg)) {
         command_palette_results.push_back(custom.name);
       }
     }
@@ -193,13 +196,7 @@ void Editor::refresh_command_palette() {
                                    paths.end());
   }
 
-  std::sort(command_palette_results.begin(), command_palette_results.end(),
-            [](const std::string &a, const std::string &b) {
-              return to_lower_copy(a) < to_lower_copy(b);
-            });
-  command_palette_results.erase(std::unique(command_palette_results.begin(),
-                                            command_palette_results.end()),
-                                command_palette_results.end());
+  rank_completions(command_palette_results, typed);
 }
 
 void Editor::execute_command(const std::string &cmd) {
@@ -589,6 +586,15 @@ void Editor::handle_command_palette(int ch) {
       toggle_integrated_terminal();
     } else if (lcmd == "termnew" || lcmd == "terminalnew") {
       create_integrated_terminal();
+    } else if (lcmd == "grep" || lcmd == "livegrep") {
+      telescope.open_content_search(root_dir.empty() ? "." : root_dir,
+                                    trim_copy(arg));
+      waiting_for_space_f = false;
+      close_prompt = false;
+      show_command_palette = false;
+      command_palette_query.clear();
+      command_palette_results.clear();
+      reset_completion_state();
     } else if (lcmd == "find" || lcmd == "ff") {
       std::string target = trim_copy(arg);
       if (target.empty()) {
@@ -750,15 +756,15 @@ void Editor::handle_command_palette(int ch) {
         remove_lsp_server(arg);
       }
     } else if (lcmd == "gitrefresh") {
-      refresh_git_status(true);
+      refresh_git_status_now();
       if (has_git_repo()) {
-        set_message("Git refreshed: " + git_branch + " (" +
-                    std::to_string(git_dirty_count) + " changes)");
+        set_message("Git refreshed: " + git_status->branch + " (" +
+                    std::to_string(git_status->dirty_count) + " changes)");
       } else {
         set_message("Git: not a repository");
       }
     } else if (lcmd == "gitstatus") {
-      refresh_git_status(true);
+      refresh_git_status_now();
       if (!has_git_repo()) {
         set_message("Git: not a repository");
       } else {
@@ -770,7 +776,7 @@ void Editor::handle_command_palette(int ch) {
         }
       }
     } else if (lcmd == "gitdiff") {
-      refresh_git_status(true);
+      refresh_git_status_now();
       if (!has_git_repo()) {
         set_message("Git: not a repository");
       } else {
@@ -793,7 +799,7 @@ void Editor::handle_command_palette(int ch) {
         }
       }
     } else if (lcmd == "gitblame") {
-      refresh_git_status(true);
+      refresh_git_status_now();
       if (!has_git_repo()) {
         set_message("Git: not a repository");
       } else {
@@ -904,6 +910,10 @@ void Editor::handle_command_palette(int ch) {
       insert_current_datetime();
     } else if (lcmd == "stats") {
       show_buffer_stats();
+    } else if (lcmd == "outputstats") {
+      show_output_stats();
+    } else if (lcmd == "loopstats") {
+      show_loop_stats();
     } else if (lcmd == "replace" || lcmd == "replacei" ||
                lcmd == "replaceword" || lcmd == "replacere") {
       auto tokens = parse_quoted_tokens(arg);
@@ -1006,15 +1016,16 @@ void Editor::handle_command_palette(int ch) {
       const std::string topic = to_lower_copy(trim_copy(arg));
       if (topic == "commands" || topic == "cmd" || topic == "ex") {
         set_message(
-            "Commands: :w :q :wq :e <file> :find [dir] :mkfile <p> :mkdir <p> "
+            "Commands: :w :q :wq :e <file> :find [dir] :grep [text] :mkfile <p> "
+            ":mkdir <p> "
             ":rename <old> <new> :rm <p> :line N[:C] :bd :sp "
             "[left|right|up|down] :vsp [left|right] "
             ":splitleft/:splitright/:splitup/:splitdown :bn :bp :recent "
             ":openrecent [n] :reopen :autosave [on/off/ms] :format :trim "
             ":trimblank :upper :lower :sortlines :sortdesc :reverselines "
             ":uniquelines :shufflelines :joinlines :dupe :copypath :copyname "
-            ":datetime :stats :replace :replacei :replaceword :replacere "
-            ":surround :unsurround :incnum :decnum :lspstart :lspstatus "
+            ":datetime :stats :outputstats :loopstats :replace :replacei :replaceword "
+            ":replacere :surround :unsurround :incnum :decnum :lspstart :lspstatus "
             ":lspstop :lsprestart :gitstatus :gitdiff [file] :gitblame "
             ":gitrefresh :theme <name>");
       } else {
@@ -1028,6 +1039,7 @@ void Editor::handle_command_palette(int ch) {
             "  Ctrl+F           Search panel",
             "  Ctrl+B           Toggle file explorer",
             "  Ctrl+E           Telescope file finder",
+            "  Ctrl+Shift+F     Search file contents (live grep)",
             "  Ctrl+T           Theme chooser",
             "  Ctrl+M           Toggle minimap",
             "  Ctrl+X / Ctrl+`  Toggle integrated terminal",
@@ -1079,7 +1091,8 @@ void Editor::handle_command_palette(int ch) {
             "  :help              Show this keybind help",
             "  Extra commands: :sortdesc :reverselines :uniquelines",
             "                  :shufflelines :joinlines :dupe :trimblank",
-            "                  :copypath :copyname :datetime :stats",
+            "                  :copypath :copyname :datetime :stats :outputstats",
+            "                  :loopstats",
             "                  :replace :replacei :replaceword :replacere",
             "                  :surround :unsurround :incnum :decnum"};
 
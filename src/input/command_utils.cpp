@@ -1,4 +1,5 @@
 #include "command_utils.h"
+#include "fuzzy_match.h"
 #include <algorithm>
 #include <cctype>
 #include <filesystem>
@@ -65,10 +66,11 @@ const std::vector<std::string> &ex_commands() {
       "splitup", "splitdown", "spleft", "spright", "spup", "spdown",
       "bn",     "nextpane", "bp",       "prevpane", "theme", "colorscheme", "colo", "minimap",
       "term",   "terminal", "termnew",  "terminalnew", "search",
-      "find",   "ff",       "mkfile",   "mkdir",   "rename", "rm",
+      "find",   "ff",       "grep",     "livegrep", "mkfile",   "mkdir",   "rename", "rm",
       "format", "trim",     "upper",    "lower",  "sortlines", "sortdesc",
       "reverselines", "uniquelines", "shufflelines", "joinlines", "dupe",
-      "trimblank", "copypath", "copyname", "datetime", "stats", "replace",
+      "trimblank", "copypath", "copyname", "datetime", "stats", "outputstats", "loopstats",
+      "replace",
       "replacei", "replaceword", "replacere", "surround", "unsurround",
       "incnum", "decnum",
       "line", "goto",        "resizeleft",
@@ -93,6 +95,45 @@ bool starts_with_icase(const std::string &value, const std::string &prefix) {
   return true;
 }
 
+bool fuzzy_matches_icase(const std::string &value, const std::string &pattern) {
+  return FuzzyPattern(pattern).matches(to_lower_copy(value));
+}
+
+void rank_completions(std::vector<std::string> &candidates,
+                      const std::string &typed) {
+  const FuzzyPattern pattern(typed);
+  std::vector<std::string> lower;
+  lower.reserve(candidates.size());
+  for (const auto &candidate : candidates) {
+    lower.push_back(to_lower_copy(candidate));
+  }
+  const auto ranked = fuzzy_rank(
+      candidates.size(), candidates.size(), nullptr, 0,
+      [&](std::size_t i) {
+        const bool prefix = lower[i].compare(0, pattern.text().size(),
+                                             pattern.text()) == 0;
+        return (prefix ? 1 << 20 : 0) + pattern.score(lower[i]);
+      },
+      [&](const FuzzyHit &a, const FuzzyHit &b) {
+        if (a.score != b.score) {
+          return a.score > b.score;
+        }
+        if (lower[a.index] != lower[b.index]) {
+          return lower[a.index] < lower[b.index];
+        }
+        return a.index < b.index;
+      });
+
+  std::vector<std::string> out;
+  out.reserve(ranked.size());
+  for (const FuzzyHit &hit : ranked) {
+    if (out.empty() || out.back() != candidates[hit.index]) {
+      out.push_back(std::move(candidates[hit.index]));
+    }
+  }
+  candidates = std::move(out);
+}
+
 bool command_takes_argument(const std::string &cmd) {
   const std::string lc = to_lower_copy(cmd);
   return lc == "e" || lc == "edit" || lc == "open" || lc == "w" ||
@@ -101,6 +142,7 @@ bool command_takes_argument(const std::string &cmd) {
          lc == "colo" || lc == "line" || lc == "goto" ||
          lc == "openrecent" || lc == "autosave" || lc == "help" ||
          lc == "h" || lc == "gitdiff" || lc == "find" || lc == "ff" ||
+         lc == "grep" || lc == "livegrep" ||
          lc == "mkfile" || lc == "mkdir" || lc == "rename" || lc == "rm" ||
          lc == "lspinstall" || lc == "lspremove" || lc == "replace" ||
          lc == "replacei" || lc == "replaceword" || lc == "replacere" ||
@@ -180,11 +222,7 @@ std::vector<std::string> complete_path_argument(const std::string &arg) {
     out.push_back(suggestion);
   }
 
-  std::sort(out.begin(), out.end(),
-            [](const std::string &a, const std::string &b) {
-              return to_lower_copy(a) < to_lower_copy(b);
-            });
-
+  rank_completions(out, name_prefix);
   if (out.size() > 64) {
     out.resize(64);
   }
@@ -12,6 +12,12 @@ std::string first_line_copy(const std::string &text);
 std::string limit_lines(const std::string &text, int max_lines);
 const std::vector<std::string> &ex_commands();
 bool starts_with_icase(const std::string &value, const std::string &prefix);
+// Whether `pattern`'s characters appear in order in value, ignoring case.
+bool fuzzy_matches_icase(const std::string &value, const std::string &pattern);
+// Orders completions for what was typed: prefix matches first, then fuzzy
+// matches by score, ties alphabetically. Drops duplicates.
+void rank_completions(std::vector<std::string> &candidates,
+                      const std::string &typed);
 bool command_takes_argument(const std::string &cmd);
 bool parse_line_col(const std::string &s, int &line_out, int &col_out);
 std::string trim_copy(const std::string &s);
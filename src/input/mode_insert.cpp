@@ -90,6 +90,12 @@ void Editor::handle_insert_mode(int ch, bool is_ctrl, bool is_shift,
     needs_redraw = true;
     return;
   }
+  if (is_ctrl && is_shift && (ch == 'f' || ch == 'F')) {
+    telescope.open_content_search(root_dir.empty() ? "." : root_dir);
+    waiting_for_space_f = false;
+    needs_redraw = true;
+    return;
+  }
   if (is_ctrl && is_shift && (ch == 't' || ch == 'T')) {
     reopen_last_closed_buffer();
     return;
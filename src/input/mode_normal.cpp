@@ -119,8 +119,10 @@ void Editor::handle_normal_mode(int ch, bool is_ctrl, bool is_shift,
       return;
     } else if (first == 'c') {
       if (ch == 'c') {
-        save_state();
-        buf.lines[buf.cursor.y] = "";
+        if (!save_state(buf.cursor.y, buf.cursor.y)) {
+          return;
+        }
+        buf.lines.set(buf.cursor.y, "");
         buf.cursor.x = 0;
         buf.modified = true;
         enter_insert_mode();
@@ -129,10 +131,12 @@ void Editor::handle_normal_mode(int ch, bool is_ctrl, bool is_shift,
       return;
     } else if (first == 'r') {
       if (ch >= 32 && ch < 127) {
-        save_state();
+        if (!save_state(buf.cursor.y, buf.cursor.y)) {
+          return;
+        }
         int line_len = (int)buf.lines[buf.cursor.y].length();
         if (buf.cursor.x < line_len) {
-          buf.lines[buf.cursor.y][buf.cursor.x] = (char)ch;
+          buf.lines.mut(buf.cursor.y)[buf.cursor.x] = (char)ch;
           buf.modified = true;
         }
         needs_redraw = true;
@@ -238,9 +242,11 @@ void Editor::handle_normal_mode(int ch, bool is_ctrl, bool is_shift,
     return;
   case 'X':
     if (buf.cursor.x > 0) {
-      save_state();
+      if (!save_state(buf.cursor.y, buf.cursor.y)) {
+        return;
+      }
       buf.cursor.x--;
-      buf.lines[buf.cursor.y].erase(buf.cursor.x, 1);
+      buf.lines.mut(buf.cursor.y).erase(buf.cursor.x, 1);
       buf.modified = true;
       clamp_cursor(get_pane().buffer_id);
       needs_redraw = true;
@@ -251,9 +257,11 @@ void Editor::handle_normal_mode(int ch, bool is_ctrl, bool is_shift,
     pending_key = 'd';
     return;
   case 'D':
-    save_state();
+    if (!save_state(buf.cursor.y, buf.cursor.y)) {
+      return;
+    }
     if (buf.cursor.x < (int)buf.lines[buf.cursor.y].length()) {
-      buf.lines[buf.cursor.y].erase(buf.cursor.x);
+      buf.lines.mut(buf.cursor.y).erase(buf.cursor.x);
       buf.modified = true;
       clamp_cursor(get_pane().buffer_id);
       needs_redraw = true;
@@ -283,23 +291,29 @@ void Editor::handle_normal_mode(int ch, bool is_ctrl, bool is_shift,
     return;
   case 'J':
     if (buf.cursor.y < (int)buf.lines.size() - 1) {
-      save_state();
-      buf.lines[buf.cursor.y] += " " + buf.lines[buf.cursor.y + 1];
+      if (!save_state(buf.cursor.y, buf.cursor.y + 1)) {
+        return;
+      }
+      buf.lines.mut(buf.cursor.y) += " " + buf.lines[buf.cursor.y + 1];
       buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
       buf.modified = true;
       needs_redraw = true;
     }
     return;
   case '>': {
-    save_state();
-    buf.lines[buf.cursor.y].insert(0, "    ");
+    if (!save_state(buf.cursor.y, buf.cursor.y)) {
+      return;
+    }
+    buf.lines.mut(buf.cursor.y).insert(0, "    ");
     buf.modified = true;
     needs_redraw = true;
     return;
   }
   case '<': {
-    save_state();
-    auto &line = buf.lines[buf.cursor.y];
+    if (!save_state(buf.cursor.y, buf.cursor.y)) {
+      return;
+    }
+    auto &line = buf.lines.mut(buf.cursor.y);
     int count = 0;
     while (count < 4 && count < (int)line.size() && line[count] == ' ')
       count++;
@@ -32,7 +32,9 @@ void Editor::vim_delete_line() {
 
   clipboard = buf.lines[buf.cursor.y];
 
-  save_state();
+  if (!save_state(buf.cursor.y, buf.cursor.y)) {
+    return;
+  }
   buf.lines.erase(buf.lines.begin() + buf.cursor.y);
   if (buf.lines.empty()) {
     buf.lines.push_back("");
@@ -49,15 +51,19 @@ void Editor::vim_delete_line() {
 void Editor::vim_delete_char() {
   auto &buf = get_buffer();
   if (buf.cursor.x < (int)buf.lines[buf.cursor.y].length()) {
-    save_state();
-    buf.lines[buf.cursor.y].erase(buf.cursor.x, 1);
+    if (!save_state(buf.cursor.y, buf.cursor.y)) {
+      return;
+    }
+    buf.lines.mut(buf.cursor.y).erase(buf.cursor.x, 1);
     buf.modified = true;
     clamp_cursor(get_pane().buffer_id);
     needs_redraw = true;
   } else if (buf.cursor.y < (int)buf.lines.size() - 1) {
-    save_state();
+    if (!save_state(buf.cursor.y, buf.cursor.y + 1)) {
+      return;
+    }
     std::string next_line = buf.lines[buf.cursor.y + 1];
-    buf.lines[buf.cursor.y] += next_line;
+    buf.lines.mut(buf.cursor.y) += next_line;
     buf.lines.erase(buf.lines.begin() + buf.cursor.y + 1);
     buf.modified = true;
     needs_redraw = true;
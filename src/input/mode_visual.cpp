@@ -131,37 +131,45 @@ void Editor::handle_visual_mode(int ch, bool is_ctrl, bool is_shift,
   case 'd':
   case 'x':
     update_visual_selection(buf, visual_start, visual_line_mode);
-    save_state();
+    if (!save_cursor_state()) {
+      return;
+    }
     delete_selection();
     enter_normal_mode();
     return;
 
   case 'c':
     update_visual_selection(buf, visual_start, visual_line_mode);
-    save_state();
+    if (!save_cursor_state()) {
+      return;
+    }
     delete_selection();
     enter_insert_mode();
     return;
 
   case '>': {
-    save_state();
     Cursor s = buf.selection.start, e = buf.selection.end;
     if (s.y > e.y)
       std::swap(s, e);
+    if (!save_state(s.y, e.y)) {
+      return;
+    }
     for (int ly = s.y; ly <= e.y && ly < (int)buf.lines.size(); ly++)
-      buf.lines[ly].insert(0, "    ");
+      buf.lines.mut(ly).insert(0, "    ");
     buf.modified = true;
     update_visual_selection(buf, visual_start, visual_line_mode);
     needs_redraw = true;
     return;
   }
   case '<': {
-    save_state();
     Cursor s = buf.selection.start, e = buf.selection.end;
     if (s.y > e.y)
       std::swap(s, e);
+    if (!save_state(s.y, e.y)) {
+      return;
+    }
     for (int ly = s.y; ly <= e.y && ly < (int)buf.lines.size(); ly++) {
-      auto &line = buf.lines[ly];
+      auto &line = buf.lines.mut(ly);
       int count = 0;
       while (count < 4 && count < (int)line.size() && line[count] == ' ')
         count++;
@@ -174,12 +182,14 @@ void Editor::handle_visual_mode(int ch, bool is_ctrl, bool is_shift,
     return;
   }
   case '~': {
-    save_state();
     Cursor s = buf.selection.start, e = buf.selection.end;
     if (s.y > e.y || (s.y == e.y && s.x > e.x))
       std::swap(s, e);
+    if (!save_state(s.y, e.y)) {
+      return;
+    }
     for (int ly = s.y; ly <= e.y && ly < (int)buf.lines.size(); ly++) {
-      auto &line = buf.lines[ly];
+      auto &line = buf.lines.mut(ly);
       int x0 = (ly == s.y) ? s.x : 0;
       int x1 = (ly == e.y) ? e.x : (int)line.length();
       for (int xi = x0; xi < x1 && xi < (int)line.size(); xi++) {
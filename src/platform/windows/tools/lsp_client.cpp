@@ -13,11 +13,23 @@ LSPClient::~LSPClient() { stop(); }
 
 bool LSPClient::send_message(const std::string &) { return false; }
 
+bool LSPClient::send_request(int, const std::string &, const std::string &) {
+  return false;
+}
+
+void LSPClient::wake_io_thread() {}
+
+void LSPClient::io_loop() {}
+
+void LSPClient::apply_inbound(Inbound &) {}
+
 std::string LSPClient::json_escape(const std::string &value) const { return value; }
 
-void LSPClient::append_log_line(const std::string &, const std::string &) {}
+void LSPClient::append_log_line(const std::string &, std::string_view) {}
+
+bool LSPClient::handle_stdout_data(std::size_t) { return false; }
 
-void LSPClient::handle_stdout_data(const std::string &) {}
+bool LSPClient::handle_message(std::string_view) { return false; }
 
 void LSPClient::handle_stderr_data(const std::string &) {}
 
@@ -41,15 +53,15 @@ bool LSPClient::restart() {
 bool LSPClient::poll() { return false; }
 
 bool LSPClient::did_open(const std::string &, const std::string &,
-                         const std::string &) {
+                         const LineStore &) {
   return false;
 }
 
-bool LSPClient::did_change(const std::string &, const std::string &) {
+bool LSPClient::did_change(const std::string &, const LineStore &) {
   return false;
 }
 
-bool LSPClient::did_save(const std::string &, const std::string &) {
+bool LSPClient::did_save(const std::string &, const LineStore &) {
   return false;
 }
 
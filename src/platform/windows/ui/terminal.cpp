@@ -155,7 +155,13 @@ void restore_console_modes() {
 }
 } // namespace
 
-Terminal::Terminal() : width(80), height(24), poll_timeout_ms(8), raw_mode(false) {}
+Terminal::Terminal() : width(80), height(24), poll_timeout_ms(8), raw_mode(false) {
+  // Older conhost builds do not implement REP.
+  ScreenEncoder::Caps caps;
+  caps.repeat_char = false;
+  encoder.set_caps(caps);
+  encoder.set_columns(width);
+}
 
 Terminal::~Terminal() { cleanup(); }
 
@@ -191,6 +197,8 @@ void Terminal::init() {
 
   refresh_console_size(width, height);
   setup_terminal();
+  encoder.set_columns(width);
+  encoder.cursor_moved_to(0, 0);
 }
 
 void Terminal::cleanup() {
@@ -230,6 +238,7 @@ Event Terminal::poll_event() {
   int prev_h = height;
   refresh_console_size(width, height);
   if (width != prev_w || height != prev_h) {
+    encoder.set_columns(width);
     ev.type = EVENT_RESIZE;
     ev.resize.width = width;
     ev.resize.height = height;
@@ -261,41 +270,95 @@ Event Terminal::poll_event() {
   return ev;
 }
 
+Event Terminal::read_event() {
+  const int timeout_ms = poll_timeout_ms;
+  poll_timeout_ms = 0;
+  Event ev = poll_event();
+  poll_timeout_ms = timeout_ms;
+  return ev;
+}
+
+// Console input is not a pollable fd; the main loop keeps polling it.
+int Terminal::input_fd() const { return -1; }
+
 void Terminal::set_poll_timeout_ms(int timeout_ms) {
   poll_timeout_ms = std::max(0, timeout_ms);
 }
 
-void Terminal::flush() { std::cout << std::flush; }
+void Terminal::wake() {}
+
+void Terminal::flush() {
+  if (!buffer.empty()) {
+    stats.writes++;
+    stats.syscalls++;
+    stats.bytes += buffer.size();
+    stats.last_write_bytes = buffer.size();
+    stats.peak_write_bytes = std::max(stats.peak_write_bytes, buffer.size());
+    std::cout << buffer;
+    buffer.clear();
+  }
+  std::cout << std::flush;
+}
 
-void Terminal::clear() { write("\x1b[2J\x1b[H"); }
+void Terminal::draw_cells(const GlyphTable &glyphs, const Cell *row,
+                          const Cell *shown, int y, int x0, int x1) {
+  encoder.encode_span(buffer, glyphs, row, shown, y, x0, x1);
+}
 
-void Terminal::move_cursor(int x, int y) {
-  write("\x1b[" + std::to_string(std::max(1, y + 1)) + ";" +
-        std::to_string(std::max(1, x + 1)) + "H");
+void Terminal::clear() {
+  write("\x1b[2J\x1b[H");
+  encoder.cursor_moved_to(0, 0);
 }
 
+void Terminal::move_cursor(int x, int y) { encoder.move_to(buffer, x, y); }
+
 void Terminal::hide_cursor() { write("\x1b[?25l"); }
 
 void Terminal::show_cursor() { write("\x1b[?25h"); }
 
+void Terminal::set_cursor_style(int style) {
+  buffer += "\x1b[" + std::to_string(style) + " q";
+}
+
 void Terminal::set_color(int fg, int bg) {
   int safe_fg = std::clamp(fg, 0, 255);
   int safe_bg = std::clamp(bg, 0, 255);
   write("\x1b[38;5;" + std::to_string(safe_fg) + "m");
   write("\x1b[48;5;" + std::to_string(safe_bg) + "m");
+  encoder.forget_style();
 }
 
-void Terminal::reset_color() { write("\x1b[0m"); }
+void Terminal::reset_color() {
+  write("\x1b[0m");
+  encoder.style_was_reset();
+}
 
-void Terminal::set_bold(bool on) { write(on ? "\x1b[1m" : "\x1b[22m"); }
+void Terminal::set_bold(bool on) {
+  write(on ? "\x1b[1m" : "\x1b[22m");
+  encoder.forget_style();
+}
 
-void Terminal::set_italic(bool on) { write(on ? "\x1b[3m" : "\x1b[23m"); }
+void Terminal::set_italic(bool on) {
+  write(on ? "\x1b[3m" : "\x1b[23m");
+  encoder.forget_style();
+}
 
-void Terminal::set_reverse(bool on) { write(on ? "\x1b[7m" : "\x1b[27m"); }
+void Terminal::set_reverse(bool on) {
+  write(on ? "\x1b[7m" : "\x1b[27m");
+  encoder.forget_style();
+}
 
-void Terminal::write(const std::string &str) { std::cout << str; }
+// Output goes through the frame buffer so it stays in order with the
+// encoded cells.
+void Terminal::write(const std::string &str) {
+  buffer += str;
+  encoder.forget_cursor();
+}
 
-void Terminal::write_char(char c) { std::cout << c; }
+void Terminal::write_char(char c) {
+  buffer += c;
+  encoder.forget_cursor();
+}
 
 void Terminal::enable_mouse() {}
 
@@ -303,7 +366,10 @@ void Terminal::disable_mouse() {}
 
 void Terminal::save_cursor() { write("\x1b[s"); }
 
-void Terminal::restore_cursor() { write("\x1b[u"); }
+void Terminal::restore_cursor() {
+  write("\x1b[u");
+  encoder.forget_cursor();
+}
 
 void Terminal::clear_line() { write("\x1b[2K"); }
 
@@ -1,6 +1,6 @@
 #include "bracket.h"
 #include "editor.h"
-#include <cstdio>
+#include "render_key.h"
 #include <filesystem>
 #include <unordered_map>
 
@@ -85,6 +85,11 @@ void compute_code_cursor_screen_pos(const SplitPane &pane, const FileBuffer &buf
 } // namespace
 
 void Editor::render() {
+  draw_frame();
+  ui->present();
+}
+
+void Editor::draw_frame() {
   IntegratedTerminal *active_terminal = get_integrated_terminal();
 
   if (!needs_redraw) {
@@ -126,7 +131,7 @@ void Editor::render() {
     }
     if (!telescope.is_active() && !panes.empty()) {
       auto &pane = get_pane();
-      auto &buf = get_buffer(pane.buffer_id);
+      const FileBuffer &buf = get_buffer(pane.buffer_id);
       int display_x = 0;
       int display_y = 0;
       compute_code_cursor_screen_pos(pane, buf, show_minimap, minimap_width,
@@ -137,21 +142,43 @@ void Editor::render() {
     return;
   }
 
-  ui->clear();
   int w = ui->get_width();
 
   if (show_home_menu) {
+    ui->clear();
     render_home_menu();
     render_status_line();
     ui->render();
     ui->hide_cursor();
     needs_redraw = false;
+    last_frame_had_overlay = true;
     return;
   }
 
-  render_tabs();
   update_pane_layout();
 
+  // Panes whose inputs are unchanged keep last frame's cells, so a cursor
+  // move only redraws two rows of its pane and the status line. Anything
+  // that may have drawn over the panes, or moved them, forces a full frame.
+  const bool overlay = render_has_overlay();
+  const bool incremental = !overlay && !last_frame_had_overlay &&
+                           pane_renders.size() == panes.size() &&
+                           render_scene_key() == scene_render_key;
+  if (!incremental) {
+    ui->clear();
+  }
+  auto remember_frame = [this, overlay]() {
+    pane_renders.resize(panes.size());
+    for (size_t i = 0; i < panes.size(); i++) {
+      pane_renders[i].key = render_pane_key(panes[i]);
+    }
+    scene_render_key = render_scene_key();
+    sidebar_render_key = show_sidebar ? render_sidebar_key() : 0;
+    last_frame_had_overlay = overlay;
+  };
+
+  render_tabs();
+
   if (telescope.is_active()) {
     // Keep the editor visible and draw Telescope as an overlay instead of
     // replacing the whole scene.
@@ -165,6 +192,7 @@ void Editor::render() {
     render_status_line();
     ui->render();
     ui->hide_cursor();
+    remember_frame();
     needs_redraw = false;
     return;
   } else {
@@ -180,10 +208,11 @@ void Editor::render() {
     } else if (show_quit_prompt) {
       render_quit_prompt();
     } else {
-      if (show_sidebar) {
+      if (show_sidebar &&
+          (!incremental || render_sidebar_key() != sidebar_render_key)) {
         render_sidebar();
       }
-      render_panes();
+      render_panes(incremental);
       render_lsp_completion();
       render_integrated_terminal();
     }
@@ -204,8 +233,7 @@ void Editor::render() {
 
     int target_cursor_shape = 1;
     if (target_cursor_shape != last_cursor_shape) {
-      printf("\033[5 q");
-      fflush(stdout);
+      terminal.set_cursor_style(5);
       last_cursor_shape = target_cursor_shape;
     }
 
@@ -236,7 +264,7 @@ void Editor::render() {
     } else if (!telescope.is_active()) {
       if (!panes.empty()) {
         auto &pane = get_pane();
-        auto &buf = get_buffer(pane.buffer_id);
+        const FileBuffer &buf = get_buffer(pane.buffer_id);
         int display_x = 0;
         int display_y = 0;
         compute_code_cursor_screen_pos(pane, buf, show_minimap, minimap_width,
@@ -246,17 +274,158 @@ void Editor::render() {
       }
     }
 
+    remember_frame();
     needs_redraw = false;
   }
 }
 
-void Editor::render_panes() {
+// With `changed_only`, a pane whose frame key is unchanged has only its
+// damaged rows drawn over last frame's cells.
+void Editor::render_panes(bool changed_only) {
+  pane_renders.resize(panes.size());
+  for (size_t i = 0; i < panes.size(); i++) {
+    const SplitPane &pane = panes[i];
+    PaneRender &state = pane_renders[i];
+    const std::uint64_t frame_key = render_pane_frame_key(pane);
+    bool rows_only = false;
+    if (changed_only) {
+      if (state.key == render_pane_key(pane)) {
+        continue;
+      }
+      rows_only = state.frame_key == frame_key;
+      if (!rows_only) {
+        ui->clear_rect({pane.x, pane.y, pane.w, pane.h});
+      }
+    }
+    state.frame_key = frame_key;
+    render_pane(pane, state, rows_only);
+  }
+}
+
+// Overlays draw over the panes, so neither the frame that shows one nor
+// the frame after it can keep pane cells.
+bool Editor::render_has_overlay() const {
+  return show_home_menu || telescope.is_active() ||
+         image_viewer.is_active() || show_save_prompt || show_quit_prompt ||
+         show_command_palette || show_search || input_prompt_visible ||
+         popup.visible || lsp_completion_visible || show_context_menu ||
+         easter_egg_timer > 0;
+}
+
+// Everything pane drawing depends on besides the pane's own buffer.
+std::uint64_t Editor::render_scene_key() const {
+  RenderKey key;
+  key.add(ui->get_width());
+  key.add(ui->get_height());
+  key.add(show_sidebar);
+  key.add(sidebar_width);
+  key.add(show_integrated_terminal);
+  key.add(integrated_terminal_height);
+  key.add(status_height);
+  key.add(tab_height);
+  key.add(tab_size);
+  key.add(show_minimap);
+  key.add(minimap_width);
+  key.add(theme_revision);
+  key.add(mode);
+  key.add(focus_state);
+  key.add(current_pane);
+  key.add(buffers.size());
   for (const auto &pane : panes) {
-    render_pane(pane);
+    key.add(pane.x);
+    key.add(pane.y);
+    key.add(pane.w);
+    key.add(pane.h);
+    key.add(pane.active);
+    key.add(pane.buffer_id);
   }
+  key.add(search_query);
+  key.add(search_result_index);
+  key.add(search_case_sensitive);
+  key.add(search_whole_word);
+  return key.value();
 }
 
-void Editor::render_pane(const SplitPane &pane) {
+// The pane's buffer and tab strip. Line content is covered by the store's
+// revision; drawing reads lines through const references so it never
+// moves it.
+std::uint64_t Editor::render_pane_key(const SplitPane &pane) const {
+  RenderKey key;
+  key.add(render_pane_frame_key(pane));
+  if (pane.buffer_id < 0 || pane.buffer_id >= (int)buffers.size()) {
+    return key.value();
+  }
+  const FileBuffer &buf = buffers[pane.buffer_id];
+  key.add(buf.lines.revision());
+  key.add(buf.syntax_cache.generation());
+  key.add(buf.syntax_cache.revision());
+  key.add(buf.search_index.revision());
+  key.add(buf.cursor.x);
+  key.add(buf.cursor.y);
+  key.add(buf.selection.start.x);
+  key.add(buf.selection.start.y);
+  key.add(buf.selection.end.x);
+  key.add(buf.selection.end.y);
+  key.add(buf.selection.active);
+  key.add(buf.diagnostics.size());
+  for (const auto &diag : buf.diagnostics) {
+    key.add(diag.line);
+    key.add(diag.col);
+    key.add(diag.end_line);
+    key.add(diag.end_col);
+    key.add(diag.severity);
+    key.add(diag.message);
+  }
+  return key.value();
+}
+
+// What every row of the pane, its border and its tab strip depend on.
+// Anything else a row shows goes into the key render_buffer_content() gives
+// that row.
+std::uint64_t Editor::render_pane_frame_key(const SplitPane &pane) const {
+  RenderKey key;
+  key.add(pane.tab_buffer_ids.size());
+  for (int id : pane.tab_buffer_ids) {
+    key.add(id);
+    if (id >= 0 && id < (int)buffers.size()) {
+      key.add(buffers[id].filepath);
+      key.add(buffers[id].modified);
+      key.add(buffers[id].is_preview);
+    }
+  }
+  if (pane.buffer_id < 0 || pane.buffer_id >= (int)buffers.size()) {
+    return key.value();
+  }
+  const FileBuffer &buf = buffers[pane.buffer_id];
+  key.add(buf.filepath);
+  key.add(buf.modified);
+  key.add(buf.is_preview);
+  key.add(buf.lines.journal_id());
+  key.add(buf.scroll_offset);
+  key.add(buf.scroll_x);
+  return key.value();
+}
+
+// The minimap samples the whole buffer, so it follows the store's
+// revision rather than the rows drawn. Pane sizes are in the scene key.
+std::uint64_t Editor::render_minimap_key(const SplitPane &pane) const {
+  RenderKey key;
+  if (pane.buffer_id >= 0 && pane.buffer_id < (int)buffers.size()) {
+    const FileBuffer &buf = buffers[pane.buffer_id];
+    key.add(buf.lines.journal_id());
+    key.add(buf.lines.revision());
+    key.add(buf.syntax_cache.generation());
+    key.add(buf.syntax_cache.revision());
+    key.add(buf.scroll_offset);
+  }
+  return key.value();
+}
+
+// With `rows_only`, the pane's cells are last frame's and its frame key is
+// unchanged: only damaged rows, and the minimap and scroll bar when their
+// inputs moved, are drawn again.
+void Editor::render_pane(const SplitPane &pane, PaneRender &state,
+                         bool rows_only) {
   int draw_w = std::max(1, pane.w);
   if (pane.h <= 0)
     return;
@@ -265,12 +434,25 @@ void Editor::render_pane(const SplitPane &pane) {
     draw_w = std::max(1, draw_w - minimap_width);
   }
 
-  render_buffer_content(pane, pane.buffer_id);
+  render_buffer_content(pane, pane.buffer_id, state.rows, rows_only);
 
-  if (show_minimap && pane.w > 20) {
+  const std::uint64_t minimap_key = render_minimap_key(pane);
+  if (show_minimap && pane.w > 20 &&
+      (!rows_only || minimap_key != state.minimap_key)) {
     render_minimap(pane.x + draw_w, pane.y + 1, minimap_width, pane.h - 1,
                    pane.buffer_id);
   }
+  state.minimap_key = minimap_key;
+
+  const std::size_t line_count = get_buffer(pane.buffer_id).lines.size();
+  if (rows_only) {
+    if (line_count != state.line_count) {
+      render_scrollbar(pane, draw_w);
+    }
+    state.line_count = line_count;
+    return;
+  }
+  state.line_count = line_count;
 
   UIRect rect = {pane.x, pane.y, draw_w, pane.h};
   int border_fg = pane.active ? theme.fg_active_border : theme.fg_panel_border;
@@ -349,7 +531,7 @@ void Editor::render_scrollbar(const SplitPane &pane, int draw_w) {
     return;
   }
 
-  auto &buf = get_buffer(pane.buffer_id);
+  const FileBuffer &buf = get_buffer(pane.buffer_id);
 
   const int track_x = pane.x + draw_w - 1;
   const int track_y = pane.y + tab_height;
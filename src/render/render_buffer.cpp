@@ -1,4 +1,5 @@
 #include "editor.h"
+#include "render_key.h"
 #include <algorithm>
 #include <cstdio>
 #include <sstream>
@@ -147,8 +148,7 @@ bool bracket_chars(char c, char &open, char &close, bool &is_open) {
   }
 }
 
-BracketPairMatch find_pair_at(const std::vector<std::string> &lines, int line,
-                              int col) {
+BracketPairMatch find_pair_at(const LineStore &lines, int line, int col) {
   BracketPairMatch result;
   if (line < 0 || line >= (int)lines.size())
     return result;
@@ -327,7 +327,12 @@ ActiveBracketGuide build_active_bracket_guide(const FileBuffer &buf,
 }
 } // namespace
 
-void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
+// Every row is given a key of what it shows besides its line's text, and
+// with `rows_only` only the rows `rows` finds damaged are drawn over last
+// frame's cells. The last row lies under the pane's bottom border, which is
+// not drawn again then.
+void Editor::render_buffer_content(const SplitPane &pane, int buffer_id,
+                                   PaneRows &rows, bool rows_only) {
   auto &buf = get_buffer(buffer_id);
   int x = pane.x;
   int y = pane.y + tab_height;
@@ -336,8 +341,10 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
   if (h <= 0)
     return;
 
-  UIRect pane_rect = {x, y, w, h};
-  ui->fill_rect(pane_rect, " ", theme.fg_default, theme.bg_default);
+  if (!rows_only) {
+    UIRect pane_rect = {x, y, w, h};
+    ui->fill_rect(pane_rect, " ", theme.fg_default, theme.bg_default);
+  }
 
   if (show_minimap && w > 20)
     w = std::max(1, w - minimap_width);
@@ -356,7 +363,19 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
     }
   }
 
+  Cursor sel_start = buf.selection.start;
+  Cursor sel_end = buf.selection.end;
+  if (sel_start.y > sel_end.y ||
+      (sel_start.y == sel_end.y && sel_start.x > sel_end.x))
+    std::swap(sel_start, sel_end);
+  const Diagnostic *active_diag =
+      pane.active ? find_line_diagnostic(buf, buf.cursor.y, buf.cursor.x)
+                  : nullptr;
+  bool cursor_row_drawn = false;
+
   std::vector<int> visual_cols;
+  rows.begin(buf.lines, (std::size_t)std::max(0, buf.scroll_offset), h,
+             !rows_only);
 
   for (int i = 0; i < h; i++) {
     int line_idx = i + buf.scroll_offset;
@@ -364,26 +383,105 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
 
     if (line_idx < (int)buf.lines.size()) {
       int line_diag_severity = line_diagnostic_severity(buf, line_idx);
-      int diag_fg = line_diag_severity > 0
-                        ? diagnostic_severity_color(theme, line_diag_severity)
-                        : theme.fg_line_num;
-      if (line_diag_severity > 0) {
-        // VSCode-like gutter accent: a solid color block instead of W/E glyphs.
-        ui->draw_text(x + 1, draw_y, " ", diag_fg, diag_fg, true);
-      } else {
-        ui->draw_text(x + 1, draw_y, " ", theme.fg_line_num, theme.bg_default);
+      const auto &colors = get_line_syntax_colors(buf, line_idx);
+      std::vector<int> search_hit_columns;
+      int active_search_col = -1;
+      if (show_search &&
+          buf.search_index.is_for(search_query, search_case_sensitive,
+                                  search_whole_word)) {
+        const auto &matches = buf.search_index.matches();
+        auto it = std::lower_bound(matches.begin(), matches.end(),
+                                   std::make_pair(line_idx, 0));
+        while (it != matches.end() && it->first == line_idx) {
+          search_hit_columns.push_back(it->second);
+          ++it;
+        }
+        if (&buf == &get_buffer() && search_result_index >= 0 &&
+            search_result_index < (int)matches.size() &&
+            matches[search_result_index].first == line_idx) {
+          active_search_col = matches[search_result_index].second;
+        }
       }
-
-      char num_buf[16];
-      snprintf(num_buf, sizeof(num_buf), "%4d ", line_idx + 1);
-      int ln_bg = theme.bg_line_num;
-      int ln_fg = theme.fg_line_num;
+      const bool on_guide = bracket_guide.active &&
+                            line_idx > bracket_guide.start_line &&
+                            line_idx < bracket_guide.end_line;
+
+      RenderKey row_key;
+      row_key.add(line_idx);
+      row_key.add(line_diag_severity);
+      row_key.add(colors.size());
+      if (!colors.empty()) {
+        // The same text lexed from the same state has the same colors.
+        const SyntaxLineCache &entry = buf.syntax_cache.entry(line_idx);
+        row_key.add(entry.line_hash);
+        row_key.add(entry.start_state);
+      }
+      row_key.add(bracket_depth);
+      row_key.add(on_guide);
+      if (on_guide) {
+        row_key.add(bracket_guide.visual_column);
+      }
+      const bool in_selection = buf.selection.active &&
+                                line_idx >= sel_start.y &&
+                                line_idx <= sel_end.y;
+      row_key.add(in_selection);
+      if (in_selection) {
+        row_key.add(line_idx == sel_start.y ? sel_start.x : -1);
+        row_key.add(line_idx == sel_end.y ? sel_end.x : -1);
+      }
+      row_key.add(search_hit_columns.size());
+      for (int col : search_hit_columns) {
+        row_key.add(col);
+      }
+      row_key.add(active_search_col);
+      row_key.add(line_idx == buf.cursor.y);
       if (line_idx == buf.cursor.y) {
-        ln_fg = theme.fg_default;
-      } else if (line_diag_severity > 0) {
-        ln_fg = diag_fg;
+        // The inline diagnostic is anchored at the cursor.
+        row_key.add(buf.cursor.x);
+        row_key.add(active_diag != nullptr);
+        if (active_diag) {
+          row_key.add(active_diag->line);
+          row_key.add(active_diag->col);
+          row_key.add(active_diag->end_line);
+          row_key.add(active_diag->end_col);
+          row_key.add(active_diag->severity);
+          row_key.add(active_diag->message);
+        }
+      }
+      const bool draw_row =
+          rows.damaged(i, row_key.value()) && (!rows_only || i < h - 1);
+      if (line_idx == buf.cursor.y) {
+        cursor_row_drawn = draw_row;
+      }
+
+      if (draw_row) {
+        if (rows_only) {
+          ui->fill_rect({x + 1, draw_y, w - 2, 1}, " ", theme.fg_default,
+                        theme.bg_default);
+        }
+        int diag_fg = line_diag_severity > 0
+                          ? diagnostic_severity_color(theme, line_diag_severity)
+                          : theme.fg_line_num;
+        if (line_diag_severity > 0) {
+          // VSCode-like gutter accent: a solid color block instead of W/E
+          // glyphs.
+          ui->draw_text(x + 1, draw_y, " ", diag_fg, diag_fg, true);
+        } else {
+          ui->draw_text(x + 1, draw_y, " ", theme.fg_line_num,
+                        theme.bg_default);
+        }
+
+        char num_buf[16];
+        snprintf(num_buf, sizeof(num_buf), "%4d ", line_idx + 1);
+        int ln_bg = theme.bg_line_num;
+        int ln_fg = theme.fg_line_num;
+        if (line_idx == buf.cursor.y) {
+          ln_fg = theme.fg_default;
+        } else if (line_diag_severity > 0) {
+          ln_fg = diag_fg;
+        }
+        ui->draw_text(x + 2, draw_y, num_buf, ln_fg, ln_bg);
       }
-      ui->draw_text(x + 2, draw_y, num_buf, ln_fg, ln_bg);
 
       const std::string &line = buf.lines[line_idx];
       int scroll_x = buf.scroll_x;
@@ -427,23 +525,7 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
       };
 
       if (scroll_x < (int)line.length()) {
-        const auto &colors = get_line_syntax_colors(buf, line_idx);
         int line_bracket_depth = bracket_depth;
-        std::vector<int> search_hit_columns;
-        int active_search_col = -1;
-        if (show_search && !search_query.empty()) {
-          auto it = std::lower_bound(search_results.begin(), search_results.end(),
-                                     std::make_pair(line_idx, 0));
-          while (it != search_results.end() && it->first == line_idx) {
-            search_hit_columns.push_back(it->second);
-            ++it;
-          }
-          if (search_result_index >= 0 &&
-              search_result_index < (int)search_results.size() &&
-              search_results[search_result_index].first == line_idx) {
-            active_search_col = search_results[search_result_index].second;
-          }
-        }
         size_t next_search_hit = 0;
 
         auto draw_chunk = [&](int start_idx, int len, int color) {
@@ -476,6 +558,8 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
             int vis_idx = visual_cols[char_idx] - start_visual;
             if (vis_idx >= visible_len)
               break;
+            if (!draw_row)
+              continue; // only the bracket depth is carried on
             int char_w =
                 std::max(1, visual_cols[char_idx + 1] - visual_cols[char_idx]);
 
@@ -613,8 +697,7 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
         }
       }
 
-      if (bracket_guide.active && line_idx > bracket_guide.start_line &&
-          line_idx < bracket_guide.end_line) {
+      if (draw_row && on_guide) {
         int guide_vis_idx = bracket_guide.visual_column - start_visual;
         if (guide_vis_idx >= 0 && guide_vis_idx < visible_len) {
           ui->draw_text(current_x + guide_vis_idx, draw_y, "│",
@@ -623,13 +706,19 @@ void Editor::render_buffer_content(const SplitPane &pane, int buffer_id) {
       }
 
     } else {
-      ui->draw_text(x + 1, draw_y, "~", theme.fg_line_num, theme.bg_default);
+      RenderKey row_key;
+      row_key.add(line_idx);
+      if (rows.damaged(i, row_key.value()) && (!rows_only || i < h - 1)) {
+        if (rows_only) {
+          ui->fill_rect({x + 1, draw_y, w - 2, 1}, " ", theme.fg_default,
+                        theme.bg_default);
+        }
+        ui->draw_text(x + 1, draw_y, "~", theme.fg_line_num, theme.bg_default);
+      }
     }
   }
 
-  if (pane.active) {
-    const Diagnostic *active_diag =
-        find_line_diagnostic(buf, buf.cursor.y, buf.cursor.x);
+  if (pane.active && cursor_row_drawn) {
     if (active_diag && diagnostic_covers_line(*active_diag, buf.cursor.y) &&
         buf.cursor.y >= buf.scroll_offset &&
         buf.cursor.y < buf.scroll_offset + h) {
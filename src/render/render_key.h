@@ -0,0 +1,37 @@
+#ifndef RENDER_KEY_H
+#define RENDER_KEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// FNV-1a over the inputs of one part of the screen. Editor::render() skips
+// a part whose key matches the one it was last drawn with. Only scalars
+// are hashed by value; a struct goes in field by field, since its padding
+// bytes are unspecified.
+class RenderKey {
+public:
+  template <typename T> void add(const T &value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                  "add struct fields one by one");
+    add_bytes(&value, sizeof(value));
+  }
+  void add(const std::string &text) {
+    add(text.size());
+    add_bytes(text.data(), text.size());
+  }
+  std::uint64_t value() const { return hash; }
+
+private:
+  std::uint64_t hash = 1469598103934665603ull;
+
+  void add_bytes(const void *data, std::size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (std::size_t i = 0; i < size; i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+};
+
+#endif
@@ -90,7 +90,7 @@ void Editor::render_lsp_completion() {
   }
 
   auto &pane = get_pane();
-  auto &buf = get_buffer(pane.buffer_id);
+  const FileBuffer &buf = get_buffer(pane.buffer_id);
   if (!lsp_completion_filepath.empty() &&
       buf.filepath != lsp_completion_filepath) {
     hide_lsp_completion();
@@ -253,7 +253,8 @@ void Editor::render_telescope() {
   int bottom_bound = std::max(top_bound + 1, h - status_height - 1);
   int usable_h = std::max(1, bottom_bound - top_bound);
   int y = top_bound + std::max(0, (usable_h - modal_h) / 2);
-  int list_w = std::max(24, modal_w * 2 / 5);
+  int list_w = std::max(24, telescope.is_content_search() ? modal_w / 2
+                                                         : modal_w * 2 / 5);
   int preview_w = modal_w - list_w - 1;
   int list_h = modal_h - 5;
 
@@ -261,7 +262,13 @@ void Editor::render_telescope() {
   ui->fill_rect(rect, " ", theme.fg_telescope, theme.bg_telescope);
   ui->draw_border(rect, theme.fg_panel_border, theme.bg_telescope);
 
-  std::string title = " Find Files ";
+  std::string title =
+      telescope.is_content_search() ? " Live Grep " : " Find Files ";
+  if (telescope.indexing()) {
+    title += "(indexing " + std::to_string(telescope.indexed_count()) + ") ";
+  } else if (telescope.searching()) {
+    title += "(searching) ";
+  }
   std::string root = telescope.get_root_dir();
   if ((int)root.length() > modal_w - 18) {
     root = "..." + root.substr(root.length() - (modal_w - 21));
@@ -288,8 +295,13 @@ void Editor::render_telescope() {
   }
 
   if (results.empty()) {
-    ui->draw_text(x + 2, y + 4, "No files match the current query.",
-                  theme.fg_comment, theme.bg_telescope);
+    const char *empty_text =
+        !telescope.is_content_search()    ? "No files match the current query."
+        : telescope.get_query().empty() ? "Type to search file contents."
+        : telescope.searching()         ? "Searching..."
+                                        : "No lines match the current query.";
+    ui->draw_text(x + 2, y + 4, empty_text, theme.fg_comment,
+                  theme.bg_telescope);
   }
 
   for (int i = start_idx; i < end_idx; i++) {
@@ -301,7 +313,9 @@ void Editor::render_telescope() {
       bg = theme.bg_telescope_selected;
     }
 
-    std::string icon = results[i].is_directory ? "[D] " : "[F] ";
+    std::string icon = results[i].line >= 0      ? ""
+                       : results[i].is_directory ? "[D] "
+                                                 : "[F] ";
     std::string name = results[i].name;
     if ((int)name.length() > list_w - 10) {
       name = name.substr(0, list_w - 13) + "...";
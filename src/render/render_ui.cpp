@@ -2,6 +2,7 @@
 #include "python_api.h"
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 
 void Editor::render_status_line() {
@@ -27,7 +28,7 @@ void Editor::render_status_line() {
     l_text += name;
 
     // Add cursor pos
-    auto &buf = buffers[current_buffer];
+    const FileBuffer &buf = buffers[current_buffer];
     l_text += "  Ln " + std::to_string(buf.cursor.y + 1) + ", Col " +
               std::to_string(buf.cursor.x + 1);
   }
@@ -37,9 +38,9 @@ void Editor::render_status_line() {
   // Right side — encoding + quick status flags
   std::string enc_str = "  UTF-8";
   if (has_git_repo()) {
-    enc_str += "  git:" + git_branch;
-    if (git_dirty_count > 0) {
-      enc_str += " *" + std::to_string(git_dirty_count);
+    enc_str += "  git:" + git_status->branch;
+    if (git_status->dirty_count > 0) {
+      enc_str += " *" + std::to_string(git_status->dirty_count);
     }
   }
   if (auto_save_enabled) {
@@ -151,12 +152,17 @@ void Editor::render_search_panel() {
   }
   ui->draw_text(x + 1, y + 1, q, theme.fg_command, theme.bg_command);
 
+  const MatchIndex &index = get_buffer().search_index;
+  const std::size_t count = index.matches().size();
+  // "+" while the rest of the buffer is still being counted.
+  const char *more = index.complete() ? "" : "+";
   if (search_result_index >= 0) {
     char buf[32];
-    snprintf(buf, sizeof(buf), "%d/%lu", search_result_index + 1,
-             search_results.size());
-    ui->draw_text(x + w - 10, y + 1, buf, theme.fg_comment, theme.bg_command);
-  } else if (!search_query.empty() && search_results.empty()) {
+    snprintf(buf, sizeof(buf), "%d/%zu%s", search_result_index + 1, count,
+             more);
+    ui->draw_text(x + w - 2 - (int)std::strlen(buf), y + 1, buf,
+                  theme.fg_comment, theme.bg_command);
+  } else if (!search_query.empty() && count == 0 && index.complete()) {
     ui->draw_text(x + w - 12, y + 1, "0/0", theme.fg_comment,
                   theme.bg_command);
   }
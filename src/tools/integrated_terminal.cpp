@@ -1,14 +1,18 @@
 #include "integrated_terminal.h"
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <termios.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <vector>
 
 #if defined(__APPLE__)
 #include <util.h>
@@ -17,15 +21,22 @@
 #include <pty.h>
 #endif
 
-IntegratedTerminal::IntegratedTerminal()
+IntegratedTerminal::IntegratedTerminal(size_t scrollback_lines)
     : master_fd(-1), child_pid(-1), active(false), focused(false),
-      current_column(0), scroll_offset(0), current_fg(7), current_bg(0),
-      utf8_expected_bytes(0), escape_state(ESC_NONE),
-      osc_escape_pending(false) {}
+      screen(120, 40, scrollback_lines), scroll_offset(0) {}
 
 IntegratedTerminal::~IntegratedTerminal() { close_shell(); }
 
 namespace {
+// Output is read until this much is buffered or the PTY runs dry, then
+// parsed in one go: the PTY hands out at most a few KB per read().
+constexpr size_t kReadBatch = 256 * 1024;
+// Bytes parsed per hold of the screen lock, bounding how long the UI
+// thread can wait for it.
+constexpr size_t kParseSlice = 64 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
 void write_all(int fd, const char *data, size_t size) {
   size_t sent = 0;
   while (sent < size) {
@@ -37,21 +48,6 @@ void write_all(int fd, const char *data, size_t size) {
   }
 }
 
-int parse_csi_number(const std::string &value, int fallback) {
-  if (value.empty()) {
-    return fallback;
-  }
-
-  int result = 0;
-  for (char c : value) {
-    if (!std::isdigit((unsigned char)c)) {
-      return fallback;
-    }
-    result = result * 10 + (c - '0');
-  }
-  return result;
-}
-
 termios build_shell_termios() {
   termios tio {};
 
@@ -81,190 +77,6 @@ termios build_shell_termios() {
 }
 } // namespace
 
-void IntegratedTerminal::push_line(const std::string &line) {
-  sync_current_line();
-  lines.push_back(line);
-  styled_lines.push_back(current_styled_line);
-  while ((int)lines.size() > 2000) {
-    lines.pop_front();
-    styled_lines.pop_front();
-  }
-}
-
-void IntegratedTerminal::sync_current_line() {
-  current_line.clear();
-  for (const auto &cell : current_styled_line) {
-    current_line += cell.ch;
-  }
-}
-
-void IntegratedTerminal::put_glyph_at_cursor(const std::string &glyph) {
-  if (glyph.empty()) {
-    return;
-  }
-
-  while (current_column > current_styled_line.size()) {
-    current_styled_line.push_back({" ", current_fg, current_bg});
-  }
-  if (current_column < current_styled_line.size()) {
-    current_styled_line[current_column] = {glyph, current_fg, current_bg};
-  } else {
-    current_styled_line.push_back({glyph, current_fg, current_bg});
-  }
-  current_column++;
-}
-
-namespace {
-std::vector<int> parse_sgr_params(const std::string &params) {
-  std::vector<int> out;
-  if (params.empty()) {
-    out.push_back(0);
-    return out;
-  }
-
-  size_t start = 0;
-  while (start <= params.size()) {
-    size_t end = params.find(';', start);
-    std::string part = (end == std::string::npos)
-                           ? params.substr(start)
-                           : params.substr(start, end - start);
-    if (part.empty()) {
-      out.push_back(0);
-    } else {
-      out.push_back(parse_csi_number(part, 0));
-    }
-    if (end == std::string::npos) {
-      break;
-    }
-    start = end + 1;
-  }
-  return out;
-}
-} // namespace
-
-void IntegratedTerminal::handle_csi_sequence(char final_char) {
-  std::string params = csi_buffer;
-  csi_buffer.clear();
-
-  if (!params.empty() && (params[0] == '?' || params[0] == '>' ||
-                          params[0] == '!')) {
-    params.erase(params.begin());
-  }
-
-  int default_param = 1;
-  if (final_char == 'J' || final_char == 'K') {
-    // ANSI defaults for ED/EL are 0 (erase to end), not 1.
-    default_param = 0;
-  }
-
-  int first = default_param;
-  size_t sep = params.find(';');
-  if (sep == std::string::npos) {
-    first = parse_csi_number(params, default_param);
-  } else {
-    first = parse_csi_number(params.substr(0, sep), default_param);
-  }
-
-  switch (final_char) {
-  case 'A':
-  case 'B':
-    break;
-  case 'C':
-    current_column += (size_t)std::max(1, first);
-    while (current_column > current_styled_line.size()) {
-      current_styled_line.push_back({" ", current_fg, current_bg});
-    }
-    break;
-  case 'D': {
-    size_t amount = (size_t)std::max(1, first);
-    current_column = (amount > current_column) ? 0 : current_column - amount;
-    break;
-  }
-  case 'G':
-    current_column = (size_t)std::max(0, first - 1);
-    while (current_column > current_styled_line.size()) {
-      current_styled_line.push_back({" ", current_fg, current_bg});
-    }
-    break;
-  case 'H':
-  case 'f':
-    current_column = 0;
-    break;
-  case 'J':
-    // ED (Erase in Display):
-    // 0 = cursor -> end (common during prompt redraw; do NOT full-clear)
-    // 1 = start -> cursor
-    // 2/3 = full clear
-    // For this line-based view, only treat full clear modes as full reset.
-    if (first == 2 || first == 3) {
-      lines.clear();
-      styled_lines.clear();
-      current_line.clear();
-      current_styled_line.clear();
-      current_column = 0;
-    }
-    break;
-  case 'K':
-    if (first == 2) {
-      current_styled_line.clear();
-      current_line.clear();
-      current_column = 0;
-    } else if (first == 1) {
-      // Erase from start to cursor without shifting the remainder.
-      size_t erase_to = std::min(current_column, current_styled_line.size());
-      for (size_t i = 0; i < erase_to; i++) {
-        current_styled_line[i] = {" ", current_fg, current_bg};
-      }
-    } else {
-      if (current_column < current_styled_line.size()) {
-        current_styled_line.erase(current_styled_line.begin() + (long)current_column,
-                                  current_styled_line.end());
-      }
-    }
-    sync_current_line();
-    break;
-  case 'm': {
-    auto params_vec = parse_sgr_params(params);
-    for (size_t i = 0; i < params_vec.size(); i++) {
-      int p = params_vec[i];
-      if (p == 0) {
-        current_fg = 7;
-        current_bg = 0;
-      } else if (p == 39) {
-        current_fg = 7;
-      } else if (p == 49) {
-        current_bg = 0;
-      } else if (p >= 30 && p <= 37) {
-        current_fg = p - 30;
-      } else if (p >= 90 && p <= 97) {
-        current_fg = 8 + (p - 90);
-      } else if (p >= 40 && p <= 47) {
-        current_bg = p - 40;
-      } else if (p >= 100 && p <= 107) {
-        current_bg = 8 + (p - 100);
-      } else if (p == 38) {
-        if (i + 2 < params_vec.size() && params_vec[i + 1] == 5) {
-          current_fg = std::clamp(params_vec[i + 2], 0, 255);
-          i += 2;
-        } else if (i + 4 < params_vec.size() && params_vec[i + 1] == 2) {
-          i += 4; // RGB not directly supported in 256 UI; ignore for now.
-        }
-      } else if (p == 48) {
-        if (i + 2 < params_vec.size() && params_vec[i + 1] == 5) {
-          current_bg = std::clamp(params_vec[i + 2], 0, 255);
-          i += 2;
-        } else if (i + 4 < params_vec.size() && params_vec[i + 1] == 2) {
-          i += 4;
-        }
-      }
-    }
-    break;
-  }
-  default:
-    break;
-  }
-}
-
 bool IntegratedTerminal::open_shell() {
 #if defined(JOT_PLATFORM_WINDOWS)
   return false;
@@ -276,10 +88,8 @@ bool IntegratedTerminal::open_shell() {
 
   termios shell_termios = build_shell_termios();
   winsize shell_ws {};
-  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &shell_ws) != 0) {
-    shell_ws.ws_col = 120;
-    shell_ws.ws_row = 40;
-  }
+  shell_ws.ws_col = (unsigned short)screen.cols();
+  shell_ws.ws_row = (unsigned short)screen.rows();
 
   int fd = -1;
   pid_t pid = forkpty(&fd, nullptr, &shell_termios, &shell_ws);
@@ -302,24 +112,17 @@ bool IntegratedTerminal::open_shell() {
   child_pid = pid;
   active = true;
   focused = true;
-  escape_state = ESC_NONE;
-  osc_escape_pending = false;
-  csi_buffer.clear();
-  lines.clear();
-  styled_lines.clear();
-  current_line.clear();
-  current_styled_line.clear();
-  current_column = 0;
+  {
+    std::lock_guard<std::mutex> lock(screen_mutex);
+    screen.reset();
+  }
   scroll_offset = 0;
-  current_fg = 7;
-  current_bg = 0;
-  utf8_pending.clear();
-  utf8_expected_bytes = 0;
 
   int flags = fcntl(master_fd, F_GETFL, 0);
   if (flags >= 0) {
     fcntl(master_fd, F_SETFL, flags | O_NONBLOCK);
   }
+  start_reader();
   return true;
 #endif
 }
@@ -333,6 +136,7 @@ void IntegratedTerminal::close_shell() {
     kill(child_pid, SIGTERM);
     waitpid(child_pid, nullptr, WNOHANG);
   }
+  stop_reader();
   if (master_fd >= 0) {
     close(master_fd);
   }
@@ -340,15 +144,8 @@ void IntegratedTerminal::close_shell() {
   child_pid = -1;
   active = false;
   focused = false;
-  current_column = 0;
+  screen.reset();
   scroll_offset = 0;
-  escape_state = ESC_NONE;
-  osc_escape_pending = false;
-  csi_buffer.clear();
-  styled_lines.clear();
-  current_styled_line.clear();
-  utf8_pending.clear();
-  utf8_expected_bytes = 0;
 }
 
 bool IntegratedTerminal::poll_output() {
@@ -356,183 +153,138 @@ bool IntegratedTerminal::poll_output() {
     return false;
   }
 
-  bool changed = false;
-  char buf[4096];
+  bool changed = screen_changed.exchange(false);
 
-  while (true) {
-    ssize_t n = read(master_fd, buf, sizeof(buf));
-    if (n <= 0) {
-      break;
+  // The reader sees the PTY close once every process on it is gone; a
+  // shell that exits with background jobs still attached is caught by
+  // waitpid() and whatever it wrote last is read here.
+  bool exited = shell_exited;
+  if (child_pid > 0 && waitpid(child_pid, nullptr, WNOHANG) == child_pid) {
+    child_pid = -1;
+    exited = true;
+  }
+  if (exited) {
+    stop_reader();
+    char buf[4096];
+    ssize_t n = 0;
+    while ((n = read(master_fd, buf, sizeof(buf))) > 0) {
+      screen.feed(buf, (size_t)n);
     }
-
+    close(master_fd);
+    if (child_pid > 0) {
+      waitpid(child_pid, nullptr, WNOHANG);
+    }
+    active = false;
+    focused = false;
+    master_fd = -1;
+    child_pid = -1;
+    screen.feed("\r\n[terminal exited]");
     changed = true;
-    for (ssize_t i = 0; i < n; i++) {
-      unsigned char c = static_cast<unsigned char>(buf[i]);
-
-      if (escape_state == ESC_PENDING) {
-        if (c == '[') {
-          escape_state = ESC_CSI;
-          csi_buffer.clear();
-        } else if (c == ']') {
-          escape_state = ESC_OSC;
-          osc_escape_pending = false;
-        } else if (c >= 0x20 && c <= 0x2f) {
-          escape_state = ESC_OTHER;
-        } else {
-          escape_state = ESC_NONE;
-        }
-        continue;
-      }
+  }
 
-      if (escape_state == ESC_CSI) {
-        if (c >= 0x30 && c <= 0x3f) {
-          csi_buffer.push_back((char)c);
-          continue;
-        }
-        if (c >= 0x20 && c <= 0x2f) {
-          continue;
-        }
-        if (c >= '@' && c <= '~') {
-          handle_csi_sequence((char)c);
-          escape_state = ESC_NONE;
-        }
-        continue;
-      }
+  return changed;
+}
 
-      if (escape_state == ESC_OSC) {
-        if (osc_escape_pending) {
-          osc_escape_pending = false;
-          if (c == '\\') {
-            escape_state = ESC_NONE;
-            continue;
-          }
-        }
+void IntegratedTerminal::start_reader() {
+  if (pipe(stop_pipe) != 0) {
+    stop_pipe[0] = stop_pipe[1] = -1;
+  }
+  for (int fd : stop_pipe) {
+    if (fd >= 0) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+  screen_changed = false;
+  shell_exited = false;
+  reader = std::thread([this] { read_loop(); });
+}
 
-        if (c == '\a') {
-          escape_state = ESC_NONE;
-          continue;
-        }
+void IntegratedTerminal::stop_reader() {
+  if (reader.joinable()) {
+    if (stop_pipe[1] >= 0) {
+      const char byte = 1;
+      (void)!write(stop_pipe[1], &byte, 1);
+    }
+    reader.join();
+  }
+  for (int &fd : stop_pipe) {
+    if (fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+}
 
-        if (c == 27) {
-          osc_escape_pending = true;
-        }
-        continue;
-      }
+// Sleeps in poll() on the PTY and the stop pipe. Output is parsed in
+// batches; the ready callback is held back until a refresh interval after
+// the previous one, so a flood of output costs one redraw per frame.
+void IntegratedTerminal::read_loop() {
+  std::vector<char> batch(kReadBatch);
+  const Clock::duration interval =
+      std::chrono::milliseconds(std::max(1, refresh_interval_ms));
+  Clock::time_point next_notify = Clock::now();
+  bool notify_pending = false;
+  bool eof = false;
+
+  while (!eof) {
+    int timeout_ms = -1;
+    if (notify_pending) {
+      timeout_ms = (int)std::max<long long>(
+          0, std::chrono::ceil<std::chrono::milliseconds>(next_notify -
+                                                          Clock::now())
+                 .count());
+    }
+    pollfd fds[2] = {{master_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+    if (::poll(fds, stop_pipe[0] >= 0 ? 2 : 1, timeout_ms) < 0 &&
+        errno != EINTR) {
+      break;
+    }
+    if (fds[1].revents) {
+      break;
+    }
 
-      if (escape_state == ESC_OTHER) {
-        if (c >= 0x30 && c <= 0x7e) {
-          escape_state = ESC_NONE;
+    size_t filled = 0;
+    if (fds[0].revents) {
+      while (filled < batch.size()) {
+        ssize_t n = read(master_fd, batch.data() + filled, batch.size() - filled);
+        if (n > 0) {
+          filled += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+          continue;
+        } else {
+          // EAGAIN: drained for now; EIO or 0: the shell side closed.
+          eof = n == 0 || errno != EAGAIN;
+          break;
         }
-        continue;
-      }
-
-      if (c == 27) {
-        escape_state = ESC_PENDING;
-        continue;
       }
+    }
 
-      if (c == '\r') {
-        current_column = 0;
-      } else if (c == '\f') {
-        lines.clear();
-        styled_lines.clear();
-        current_line.clear();
-        current_styled_line.clear();
-        current_column = 0;
-        utf8_pending.clear();
-        utf8_expected_bytes = 0;
-      } else if (c == '\n') {
-        if (!utf8_pending.empty()) {
-          put_glyph_at_cursor("?");
-          utf8_pending.clear();
-          utf8_expected_bytes = 0;
-        }
-        push_line(current_line);
-        current_line.clear();
-        current_styled_line.clear();
-        current_column = 0;
-      } else if (c == '\b' || c == 127) {
-        if (current_column > 0) {
-          current_column--;
-          if (current_column < current_styled_line.size()) {
-            current_styled_line.erase(current_styled_line.begin() +
-                                      (long)current_column);
-          }
-          sync_current_line();
-        }
-      } else if (c == '\t') {
-        for (int j = 0; j < 2; j++) {
-          put_glyph_at_cursor(" ");
-        }
-        sync_current_line();
-      } else if (c >= 32) {
-        if (utf8_expected_bytes > 0) {
-          if ((c & 0xC0) == 0x80) {
-            utf8_pending.push_back((char)c);
-            if ((int)utf8_pending.size() >= utf8_expected_bytes) {
-              put_glyph_at_cursor(utf8_pending);
-              utf8_pending.clear();
-              utf8_expected_bytes = 0;
-              sync_current_line();
-            }
-          } else {
-            put_glyph_at_cursor("?");
-            utf8_pending.clear();
-            utf8_expected_bytes = 0;
-            if (c < 0x80) {
-              put_glyph_at_cursor(std::string(1, (char)c));
-              sync_current_line();
-            } else if ((c & 0xE0) == 0xC0) {
-              utf8_pending = std::string(1, (char)c);
-              utf8_expected_bytes = 2;
-            } else if ((c & 0xF0) == 0xE0) {
-              utf8_pending = std::string(1, (char)c);
-              utf8_expected_bytes = 3;
-            } else if ((c & 0xF8) == 0xF0) {
-              utf8_pending = std::string(1, (char)c);
-              utf8_expected_bytes = 4;
-            } else {
-              put_glyph_at_cursor("?");
-              sync_current_line();
-            }
-          }
-        } else if (c < 0x80) {
-          put_glyph_at_cursor(std::string(1, (char)c));
-          sync_current_line();
-        } else if ((c & 0xE0) == 0xC0) {
-          utf8_pending = std::string(1, (char)c);
-          utf8_expected_bytes = 2;
-        } else if ((c & 0xF0) == 0xE0) {
-          utf8_pending = std::string(1, (char)c);
-          utf8_expected_bytes = 3;
-        } else if ((c & 0xF8) == 0xF0) {
-          utf8_pending = std::string(1, (char)c);
-          utf8_expected_bytes = 4;
-        } else {
-          put_glyph_at_cursor("?");
-          sync_current_line();
-        }
+    std::string replies;
+    for (size_t at = 0; at < filled; at += kParseSlice) {
+      std::lock_guard<std::mutex> lock(screen_mutex);
+      screen.feed(batch.data() + at, std::min(kParseSlice, filled - at));
+      if (at + kParseSlice >= filled) {
+        replies = screen.take_replies();
       }
     }
-  }
+    // Cursor position reports and the like go back as if typed.
+    if (!replies.empty()) {
+      write_all(master_fd, replies.data(), replies.size());
+    }
 
-  int status = 0;
-  if (child_pid > 0) {
-    pid_t result = waitpid(child_pid, &status, WNOHANG);
-    if (result == child_pid) {
-      if (master_fd >= 0) {
-        close(master_fd);
+    notify_pending = notify_pending || filled > 0;
+    if (eof) {
+      shell_exited = true;
+    }
+    if ((notify_pending && Clock::now() >= next_notify) || eof) {
+      notify_pending = false;
+      next_notify = Clock::now() + interval;
+      screen_changed = true;
+      if (ready_callback) {
+        ready_callback();
       }
-      active = false;
-      focused = false;
-      master_fd = -1;
-      child_pid = -1;
-      push_line("[terminal exited]");
-      changed = true;
     }
   }
-
-  return changed;
 }
 
 bool IntegratedTerminal::send_key(int ch, bool is_ctrl, bool is_shift,
@@ -543,6 +295,11 @@ bool IntegratedTerminal::send_key(int ch, bool is_ctrl, bool is_shift,
   }
 
   reset_scroll();
+  bool app_keys = false;
+  {
+    std::lock_guard<std::mutex> lock(screen_mutex);
+    app_keys = screen.application_cursor_keys();
+  }
 
   auto send_bytes = [&](const char *s) {
     if (!s) {
@@ -551,28 +308,30 @@ bool IntegratedTerminal::send_key(int ch, bool is_ctrl, bool is_shift,
     write_all(master_fd, s, strlen(s));
   };
 
+  // Full-screen programs that ask for application cursor keys (DECCKM)
+  // expect SS3 instead of CSI.
   if (ch == 1008) {
-    send_bytes("\x1b[A");
+    send_bytes(app_keys ? "\x1bOA" : "\x1b[A");
     return true;
   }
   if (ch == 1009) {
-    send_bytes("\x1b[B");
+    send_bytes(app_keys ? "\x1bOB" : "\x1b[B");
     return true;
   }
   if (ch == 1010) {
-    send_bytes("\x1b[C");
+    send_bytes(app_keys ? "\x1bOC" : "\x1b[C");
     return true;
   }
   if (ch == 1011) {
-    send_bytes("\x1b[D");
+    send_bytes(app_keys ? "\x1bOD" : "\x1b[D");
     return true;
   }
   if (ch == 1012) {
-    send_bytes("\x1b[H");
+    send_bytes(app_keys ? "\x1bOH" : "\x1b[H");
     return true;
   }
   if (ch == 1013) {
-    send_bytes("\x1b[F");
+    send_bytes(app_keys ? "\x1bOF" : "\x1b[F");
     return true;
   }
   if (ch == '\n' || ch == '\r' || ch == 10 || ch == 13) {
@@ -632,7 +391,8 @@ bool IntegratedTerminal::send_key(int ch, bool is_ctrl, bool is_shift,
 }
 
 bool IntegratedTerminal::scroll_lines(int delta, int visible_rows) {
-  int total = (int)lines.size() + 1;
+  std::lock_guard<std::mutex> lock(screen_mutex);
+  int total = history_rows() + screen.rows();
   int view = std::max(1, visible_rows);
   int max_offset = std::max(0, total - view);
   int next = std::clamp(scroll_offset + delta, 0, max_offset);
@@ -643,58 +403,66 @@ bool IntegratedTerminal::scroll_lines(int delta, int visible_rows) {
 
 void IntegratedTerminal::reset_scroll() { scroll_offset = 0; }
 
-std::vector<std::string> IntegratedTerminal::get_recent_lines(
-    int max_lines) const {
-  std::vector<std::string> out;
-  if (max_lines <= 0) {
-    return out;
+void IntegratedTerminal::resize(int cols, int rows) {
+  std::lock_guard<std::mutex> lock(screen_mutex);
+  if (cols == screen.cols() && rows == screen.rows()) {
+    return;
+  }
+  screen.resize(cols, rows);
+  if (master_fd >= 0) {
+    // The kernel sends the shell SIGWINCH so it redraws at the new size.
+    winsize ws {};
+    ws.ws_col = (unsigned short)screen.cols();
+    ws.ws_row = (unsigned short)screen.rows();
+    ioctl(master_fd, TIOCSWINSZ, &ws);
   }
+}
+
+int IntegratedTerminal::history_rows() const {
+  return screen.alternate_screen() ? 0 : (int)screen.history_size();
+}
 
-  int total = (int)lines.size() + 1;
-  int take = std::min(max_lines, total);
-  int max_offset = std::max(0, total - take);
+int IntegratedTerminal::view_start(int max_lines, int &count) const {
+  int total = history_rows() + screen.rows();
+  count = std::clamp(max_lines, 0, total);
+  int max_offset = total - count;
   int offset = std::clamp(scroll_offset, 0, max_offset);
-  int end_exclusive = std::clamp(total - offset, 0, total);
-  int start = std::max(0, end_exclusive - take);
-
-  for (int idx = start; idx < end_exclusive; idx++) {
-    if (idx < (int)lines.size()) {
-      out.push_back(lines[idx]);
-    } else {
-      out.push_back(current_line);
-    }
-  }
-  return out;
+  return total - offset - count;
 }
 
-std::vector<std::vector<IntegratedTerminal::StyledCell>>
-IntegratedTerminal::get_recent_styled_lines(int max_lines) const {
-  std::vector<std::vector<StyledCell>> out;
-  if (max_lines <= 0) {
-    return out;
+CellSpan IntegratedTerminal::view_row(int index) const {
+  int history = history_rows();
+  if (index < history) {
+    return screen.history_row((size_t)index);
+  }
+  // Trailing blanks are left to the panel background.
+  const Cell *row = screen.row(index - history);
+  const Cell blank = VtScreen::blank_cell();
+  int width = screen.cols();
+  while (width > 0 && row[width - 1] == blank) {
+    width--;
   }
+  return {row, width};
+}
 
-  int total = (int)styled_lines.size() + 1;
-  int take = std::min(max_lines, total);
-  int max_offset = std::max(0, total - take);
-  int offset = std::clamp(scroll_offset, 0, max_offset);
-  int end_exclusive = std::clamp(total - offset, 0, total);
-  int start = std::max(0, end_exclusive - take);
-
-  for (int idx = start; idx < end_exclusive; idx++) {
-    std::vector<StyledCell> row;
-    if (idx < (int)styled_lines.size()) {
-      row.reserve(styled_lines[idx].size());
-      for (const auto &c : styled_lines[idx]) {
-        row.push_back({c.ch, c.fg, c.bg});
-      }
-    } else {
-      row.reserve(current_styled_line.size());
-      for (const auto &c : current_styled_line) {
-        row.push_back({c.ch, c.fg, c.bg});
-      }
-    }
-    out.push_back(std::move(row));
+size_t IntegratedTerminal::get_cursor_column() const {
+  std::lock_guard<std::mutex> lock(screen_mutex);
+  return (size_t)screen.cursor_x();
+}
+
+int IntegratedTerminal::get_cursor_row(int visible_rows) const {
+  std::lock_guard<std::mutex> lock(screen_mutex);
+  if (!screen.cursor_visible()) {
+    return -1;
   }
-  return out;
+  int count = 0;
+  int start = view_start(visible_rows, count);
+  int row = history_rows() + screen.cursor_y() - start;
+  return row >= 0 && row < count ? row : -1;
+}
+
+IntegratedTerminal::View IntegratedTerminal::view(int max_lines) const {
+  int count = 0;
+  int start = view_start(max_lines, count);
+  return View(this, start, count);
 }
@@ -1,68 +1,129 @@
 #ifndef INTEGRATED_TERMINAL_H
 #define INTEGRATED_TERMINAL_H
 
-#include <deque>
+#include "vt_screen.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
 #include <string>
-#include <vector>
+#include <thread>
 
+// A shell on a PTY and the screen it draws. On POSIX a reader thread
+// drains the PTY in large reads and parses the output into the screen
+// under screen_mutex, so a shell that floods output costs the UI thread
+// nothing but one redraw per refresh interval: the ready callback runs at
+// most that often, and only when the screen changed since poll_output().
 class IntegratedTerminal {
 private:
-  struct TerminalCell {
-    std::string ch;
-    int fg;
-    int bg;
-  };
-
-  enum EscapeState { ESC_NONE, ESC_PENDING, ESC_CSI, ESC_OSC, ESC_OTHER };
-
   int master_fd;
   int child_pid;
   bool active;
   bool focused;
-  std::deque<std::string> lines;
-  std::deque<std::vector<TerminalCell>> styled_lines;
-  std::string current_line;
-  std::vector<TerminalCell> current_styled_line;
-  size_t current_column;
+  // What the shell has drawn, sized to the panel; earlier output is its
+  // history.
+  VtScreen screen;
+  mutable std::mutex screen_mutex;
   int scroll_offset;
-  int current_fg;
-  int current_bg;
-  std::string utf8_pending;
-  int utf8_expected_bytes;
-  EscapeState escape_state;
-  bool osc_escape_pending;
-  std::string csi_buffer;
+#if defined(JOT_PLATFORM_WINDOWS)
+  std::string input_line; // command being typed, run on Enter
+#else
+  std::thread reader;
+  int stop_pipe[2] = {-1, -1};
+#endif
+  std::function<void()> ready_callback;
+  int refresh_interval_ms = 8;
+  std::atomic<bool> screen_changed{false}; // since the last poll_output()
+  std::atomic<bool> shell_exited{false};   // the reader saw the PTY close
 
-  void push_line(const std::string &line);
-  void handle_csi_sequence(char final_char);
-  void sync_current_line();
-  void put_glyph_at_cursor(const std::string &glyph);
+  // Rows of history above the screen; none while the alternate screen is up.
+  int history_rows() const;
+  // First row of the view of max_lines rows, counting history first, and
+  // how many rows it has.
+  int view_start(int max_lines, int &count) const;
+  CellSpan view_row(int index) const;
+  void start_reader();
+  void stop_reader();
+  void read_loop();
 
 public:
-  struct StyledCell {
-    std::string ch;
-    int fg;
-    int bg;
+  // The rows in view, oldest first, read in place from the screen and its
+  // history; nothing is copied. Valid while lock_screen() is held.
+  class View {
+  public:
+    class iterator {
+    public:
+      CellSpan operator*() const { return term->view_row(index); }
+      iterator &operator++() {
+        ++index;
+        return *this;
+      }
+      bool operator!=(const iterator &other) const {
+        return index != other.index;
+      }
+
+    private:
+      friend class View;
+      iterator(const IntegratedTerminal *term, int index)
+          : term(term), index(index) {}
+      const IntegratedTerminal *term;
+      int index;
+    };
+
+    int size() const { return count; }
+    CellSpan operator[](int i) const { return term->view_row(start + i); }
+    iterator begin() const { return iterator(term, start); }
+    iterator end() const { return iterator(term, start + count); }
+
+  private:
+    friend class IntegratedTerminal;
+    View(const IntegratedTerminal *term, int start, int count)
+        : term(term), start(start), count(count) {}
+    const IntegratedTerminal *term;
+    int start;
+    int count;
   };
 
-  IntegratedTerminal();
+  explicit IntegratedTerminal(size_t scrollback_lines = 10000);
   ~IntegratedTerminal();
 
+  IntegratedTerminal(const IntegratedTerminal &) = delete;
+  IntegratedTerminal &operator=(const IntegratedTerminal &) = delete;
+
+  // Runs on the reader thread when the screen has changed; set before
+  // open_shell().
+  void set_ready_callback(std::function<void()> callback) {
+    ready_callback = std::move(callback);
+  }
+  // Least time between two ready callbacks, normally one display frame.
+  void set_refresh_interval_ms(int ms) { refresh_interval_ms = ms; }
+
   bool open_shell();
   void close_shell();
+  // True when the screen changed since the last call; also notices the
+  // shell exiting.
   bool poll_output();
   bool send_key(int ch, bool is_ctrl, bool is_shift, bool is_alt);
   bool scroll_lines(int delta, int visible_rows);
   void reset_scroll();
+  // Sizes the screen, and the shell's tty, to the panel.
+  void resize(int cols, int rows);
 
   bool is_active() const { return active; }
   bool is_focused() const { return focused; }
   void set_focused(bool value) { focused = value; }
-  const std::string &get_current_line() const { return current_line; }
-  size_t get_cursor_column() const { return current_column; }
+  // Holds off the reader thread while the screen is read.
+  std::unique_lock<std::mutex> lock_screen() const {
+    return std::unique_lock<std::mutex>(screen_mutex);
+  }
+  size_t get_cursor_column() const;
+  // Row of the cursor in view(visible_rows), or -1 when it is scrolled out
+  // of view or hidden.
+  int get_cursor_row(int visible_rows) const;
 
-  std::vector<std::string> get_recent_lines(int max_lines) const;
-  std::vector<std::vector<StyledCell>> get_recent_styled_lines(int max_lines) const;
+  // The last max_lines rows of history and screen, scroll_offset rows up.
+  // Call with lock_screen() held.
+  View view(int max_lines) const;
 };
 
 #endif
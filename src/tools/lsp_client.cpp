@@ -7,6 +7,7 @@
 #include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <poll.h>
 #include <sstream>
 #include <string.h>
 #include <sys/types.h>
@@ -16,15 +17,6 @@
 namespace fs = std::filesystem;
 
 namespace {
-struct JsonValue {
-  enum Type { Null, Bool, Number, String, Array, Object } type = Null;
-  bool bool_value = false;
-  long long number_value = 0;
-  std::string string_value;
-  std::vector<JsonValue> array_value;
-  std::map<std::string, JsonValue> object_value;
-};
-
 bool set_non_blocking(int fd) {
   int flags = fcntl(fd, F_GETFL, 0);
   if (flags < 0) {
@@ -33,24 +25,6 @@ bool set_non_blocking(int fd) {
   return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
 }
 
-bool write_all_fd(int fd, const std::string &data) {
-  size_t sent = 0;
-  while (sent < data.size()) {
-    ssize_t written = write(fd, data.data() + sent, data.size() - sent);
-    if (written < 0) {
-      if (errno == EINTR) {
-        continue;
-      }
-      return false;
-    }
-    if (written == 0) {
-      return false;
-    }
-    sent += (size_t)written;
-  }
-  return true;
-}
-
 std::string get_lsp_log_path(const std::string &language) {
   const char *home = getenv("HOME");
   fs::path base = home ? fs::path(home) / ".config" / "jot" / "logs"
@@ -86,269 +60,6 @@ std::string language_id_for(const std::string &language,
   return language;
 }
 
-void skip_ws(const std::string &text, size_t &pos) {
-  while (pos < text.size() &&
-         std::isspace(static_cast<unsigned char>(text[pos]))) {
-    pos++;
-  }
-}
-
-bool parse_json_string(const std::string &text, size_t &pos, std::string &out) {
-  if (pos >= text.size() || text[pos] != '"') {
-    return false;
-  }
-  pos++;
-  out.clear();
-  while (pos < text.size()) {
-    char c = text[pos++];
-    if (c == '"') {
-      return true;
-    }
-    if (c == '\\') {
-      if (pos >= text.size()) {
-        return false;
-      }
-      char esc = text[pos++];
-      switch (esc) {
-      case '"':
-      case '\\':
-      case '/':
-        out.push_back(esc);
-        break;
-      case 'b':
-        out.push_back('\b');
-        break;
-      case 'f':
-        out.push_back('\f');
-        break;
-      case 'n':
-        out.push_back('\n');
-        break;
-      case 'r':
-        out.push_back('\r');
-        break;
-      case 't':
-        out.push_back('\t');
-        break;
-      case 'u': {
-        if (pos + 4 > text.size()) {
-          return false;
-        }
-        unsigned int codepoint = 0;
-        for (int i = 0; i < 4; i++) {
-          char h = text[pos++];
-          codepoint <<= 4;
-          if (h >= '0' && h <= '9') {
-            codepoint |= (unsigned int)(h - '0');
-          } else if (h >= 'a' && h <= 'f') {
-            codepoint |= (unsigned int)(10 + h - 'a');
-          } else if (h >= 'A' && h <= 'F') {
-            codepoint |= (unsigned int)(10 + h - 'A');
-          } else {
-            return false;
-          }
-        }
-        if (codepoint <= 0x7F) {
-          out.push_back((char)codepoint);
-        } else if (codepoint <= 0x7FF) {
-          out.push_back((char)(0xC0 | ((codepoint >> 6) & 0x1F)));
-          out.push_back((char)(0x80 | (codepoint & 0x3F)));
-        } else {
-          out.push_back((char)(0xE0 | ((codepoint >> 12) & 0x0F)));
-          out.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
-          out.push_back((char)(0x80 | (codepoint & 0x3F)));
-        }
-        break;
-      }
-      default:
-        return false;
-      }
-      continue;
-    }
-    out.push_back(c);
-  }
-  return false;
-}
-
-bool parse_json_value(const std::string &text, size_t &pos, JsonValue &out);
-
-bool parse_json_array(const std::string &text, size_t &pos, JsonValue &out) {
-  if (pos >= text.size() || text[pos] != '[') {
-    return false;
-  }
-  pos++;
-  out = JsonValue{};
-  out.type = JsonValue::Array;
-  skip_ws(text, pos);
-  if (pos < text.size() && text[pos] == ']') {
-    pos++;
-    return true;
-  }
-  while (pos < text.size()) {
-    JsonValue item;
-    if (!parse_json_value(text, pos, item)) {
-      return false;
-    }
-    out.array_value.push_back(std::move(item));
-    skip_ws(text, pos);
-    if (pos >= text.size()) {
-      return false;
-    }
-    if (text[pos] == ']') {
-      pos++;
-      return true;
-    }
-    if (text[pos] != ',') {
-      return false;
-    }
-    pos++;
-    skip_ws(text, pos);
-  }
-  return false;
-}
-
-bool parse_json_object(const std::string &text, size_t &pos, JsonValue &out) {
-  if (pos >= text.size() || text[pos] != '{') {
-    return false;
-  }
-  pos++;
-  out = JsonValue{};
-  out.type = JsonValue::Object;
-  skip_ws(text, pos);
-  if (pos < text.size() && text[pos] == '}') {
-    pos++;
-    return true;
-  }
-  while (pos < text.size()) {
-    std::string key;
-    if (!parse_json_string(text, pos, key)) {
-      return false;
-    }
-    skip_ws(text, pos);
-    if (pos >= text.size() || text[pos] != ':') {
-      return false;
-    }
-    pos++;
-    JsonValue value;
-    if (!parse_json_value(text, pos, value)) {
-      return false;
-    }
-    out.object_value[key] = std::move(value);
-    skip_ws(text, pos);
-    if (pos >= text.size()) {
-      return false;
-    }
-    if (text[pos] == '}') {
-      pos++;
-      return true;
-    }
-    if (text[pos] != ',') {
-      return false;
-    }
-    pos++;
-    skip_ws(text, pos);
-  }
-  return false;
-}
-
-bool parse_json_number(const std::string &text, size_t &pos, JsonValue &out) {
-  size_t start = pos;
-  if (pos < text.size() && text[pos] == '-') {
-    pos++;
-  }
-  while (pos < text.size() &&
-         std::isdigit(static_cast<unsigned char>(text[pos]))) {
-    pos++;
-  }
-  if (start == pos || (start + 1 == pos && text[start] == '-')) {
-    return false;
-  }
-  out = JsonValue{};
-  out.type = JsonValue::Number;
-  out.number_value = std::strtoll(text.substr(start, pos - start).c_str(),
-                                  nullptr, 10);
-  if (pos < text.size() && (text[pos] == '.' || text[pos] == 'e' ||
-                            text[pos] == 'E')) {
-    while (pos < text.size() &&
-           (std::isdigit(static_cast<unsigned char>(text[pos])) ||
-            text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E' ||
-            text[pos] == '+' || text[pos] == '-')) {
-      pos++;
-    }
-  }
-  return true;
-}
-
-bool parse_json_value(const std::string &text, size_t &pos, JsonValue &out) {
-  skip_ws(text, pos);
-  if (pos >= text.size()) {
-    return false;
-  }
-
-  char c = text[pos];
-  if (c == '"') {
-    out = JsonValue{};
-    out.type = JsonValue::String;
-    return parse_json_string(text, pos, out.string_value);
-  }
-  if (c == '{') {
-    return parse_json_object(text, pos, out);
-  }
-  if (c == '[') {
-    return parse_json_array(text, pos, out);
-  }
-  if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
-    return parse_json_number(text, pos, out);
-  }
-  if (text.compare(pos, 4, "null") == 0) {
-    out = JsonValue{};
-    out.type = JsonValue::Null;
-    pos += 4;
-    return true;
-  }
-  if (text.compare(pos, 4, "true") == 0) {
-    out = JsonValue{};
-    out.type = JsonValue::Bool;
-    out.bool_value = true;
-    pos += 4;
-    return true;
-  }
-  if (text.compare(pos, 5, "false") == 0) {
-    out = JsonValue{};
-    out.type = JsonValue::Bool;
-    out.bool_value = false;
-    pos += 5;
-    return true;
-  }
-  return false;
-}
-
-const JsonValue *json_object_get(const JsonValue &value,
-                                 const std::string &key) {
-  if (value.type != JsonValue::Object) {
-    return nullptr;
-  }
-  auto it = value.object_value.find(key);
-  if (it == value.object_value.end()) {
-    return nullptr;
-  }
-  return &it->second;
-}
-
-std::string json_string_or_empty(const JsonValue *value) {
-  if (!value || value->type != JsonValue::String) {
-    return "";
-  }
-  return value->string_value;
-}
-
-int json_int_or_default(const JsonValue *value, int fallback) {
-  if (!value || value->type != JsonValue::Number) {
-    return fallback;
-  }
-  return (int)value->number_value;
-}
-
 std::string from_file_uri(const std::string &uri) {
   const std::string prefix = "file://";
   if (uri.rfind(prefix, 0) != 0) {
@@ -381,135 +92,22 @@ std::string from_file_uri(const std::string &uri) {
   return decoded;
 }
 
-bool extract_content_length(const std::string &headers, size_t &length_out) {
-  std::istringstream stream(headers);
-  std::string line;
-  while (std::getline(stream, line)) {
-    if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
-    }
-    const std::string prefix = "Content-Length:";
-    if (line.rfind(prefix, 0) == 0) {
-      std::string number = line.substr(prefix.size());
-      size_t pos = 0;
-      while (pos < number.size() &&
-             std::isspace(static_cast<unsigned char>(number[pos]))) {
-        pos++;
-      }
-      if (pos >= number.size()) {
-        return false;
-      }
-      length_out = (size_t)std::strtoull(number.c_str() + pos, nullptr, 10);
-      return true;
-    }
-  }
-  return false;
-}
-
-std::vector<Diagnostic> diagnostics_from_json(const JsonValue &diagnostics) {
-  std::vector<Diagnostic> parsed;
-  if (diagnostics.type != JsonValue::Array) {
-    return parsed;
-  }
+constexpr std::size_t kReadChunk = 64 * 1024;
 
-  for (const auto &item : diagnostics.array_value) {
-    if (item.type != JsonValue::Object) {
-      continue;
-    }
-    const JsonValue *range = json_object_get(item, "range");
-    const JsonValue *start = range ? json_object_get(*range, "start") : nullptr;
-    const JsonValue *end = range ? json_object_get(*range, "end") : nullptr;
-
-    Diagnostic diag;
-    diag.line = json_int_or_default(start ? json_object_get(*start, "line")
-                                          : nullptr,
-                                    0);
-    diag.col = json_int_or_default(start ? json_object_get(*start, "character")
-                                         : nullptr,
-                                   0);
-    diag.end_line =
-        json_int_or_default(end ? json_object_get(*end, "line") : nullptr,
-                            diag.line);
-    diag.end_col =
-        json_int_or_default(end ? json_object_get(*end, "character") : nullptr,
-                            diag.col);
-    diag.message = json_string_or_empty(json_object_get(item, "message"));
-    diag.severity =
-        json_int_or_default(json_object_get(item, "severity"), 1);
-    parsed.push_back(std::move(diag));
-  }
-
-  return parsed;
+double elapsed_ms(std::chrono::steady_clock::time_point from,
+                  std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
 }
 
-std::vector<LSPCompletionItem> completion_items_from_json(
-    const JsonValue &result) {
-  const JsonValue *items = nullptr;
-  if (result.type == JsonValue::Array) {
-    items = &result;
-  } else if (result.type == JsonValue::Object) {
-    items = json_object_get(result, "items");
-  }
-
-  std::vector<LSPCompletionItem> parsed;
-  if (!items || items->type != JsonValue::Array) {
-    return parsed;
-  }
-
-  parsed.reserve(items->array_value.size());
-  for (const auto &item : items->array_value) {
-    if (item.type != JsonValue::Object) {
-      continue;
-    }
-
-    LSPCompletionItem completion;
-    completion.label = json_string_or_empty(json_object_get(item, "label"));
-    completion.insert_text =
-        json_string_or_empty(json_object_get(item, "insertText"));
-    completion.detail = json_string_or_empty(json_object_get(item, "detail"));
-    completion.filter_text =
-        json_string_or_empty(json_object_get(item, "filterText"));
-    completion.sort_text = json_string_or_empty(json_object_get(item, "sortText"));
-    completion.kind = json_int_or_default(json_object_get(item, "kind"), 0);
-    completion.insert_text_format =
-        json_int_or_default(json_object_get(item, "insertTextFormat"), 1);
-
-    if (completion.insert_text.empty()) {
-      const JsonValue *text_edit = json_object_get(item, "textEdit");
-      const JsonValue *new_text =
-          text_edit ? json_object_get(*text_edit, "newText") : nullptr;
-      completion.insert_text = json_string_or_empty(new_text);
-
-      const JsonValue *range =
-          text_edit ? json_object_get(*text_edit, "range") : nullptr;
-      const JsonValue *start = range ? json_object_get(*range, "start") : nullptr;
-      const JsonValue *end = range ? json_object_get(*range, "end") : nullptr;
-      if (start && end) {
-        completion.has_text_edit_range = true;
-        completion.edit_start_line =
-            json_int_or_default(json_object_get(*start, "line"), 0);
-        completion.edit_start_char =
-            json_int_or_default(json_object_get(*start, "character"), 0);
-        completion.edit_end_line =
-            json_int_or_default(json_object_get(*end, "line"), 0);
-        completion.edit_end_char =
-            json_int_or_default(json_object_get(*end, "character"), 0);
-      }
-    }
-    if (completion.insert_text.empty()) {
-      completion.insert_text = completion.label;
-    }
-    if (completion.label.empty()) {
-      completion.label = completion.insert_text;
-    }
-    if (completion.label.empty()) {
-      continue;
-    }
-
-    parsed.push_back(std::move(completion));
+const char *text_sync_kind_name(int kind) {
+  switch (kind) {
+  case LSP_SYNC_NONE:
+    return "no";
+  case LSP_SYNC_INCREMENTAL:
+    return "incremental";
+  default:
+    return "full";
   }
-
-  return parsed;
 }
 } // namespace
 
@@ -551,7 +149,7 @@ std::string LSPClient::json_escape(const std::string &value) const {
 }
 
 void LSPClient::append_log_line(const std::string &prefix,
-                                const std::string &line) {
+                                std::string_view line) {
   std::ofstream log(get_lsp_log_path(language), std::ios::app);
   if (!log.is_open()) {
     return;
@@ -566,18 +164,32 @@ bool LSPClient::send_message(const std::string &json) {
 
   std::ostringstream payload;
   payload << "Content-Length: " << json.size() << "\r\n\r\n" << json;
-  const std::string message = payload.str();
+  std::string message = payload.str();
+  bytes_sent += (long long)message.size();
+  outbox.push(std::move(message));
+  wake_io_thread();
 
-  if (!write_all_fd(stdin_fd, message)) {
-    last_error = strerror(errno);
-    append_log_line("SEND-ERR ", last_error);
+  append_log_line("SEND ", json);
+  return true;
+}
+
+bool LSPClient::send_request(int id, const std::string &method,
+                             const std::string &json) {
+  if (!send_message(json)) {
     return false;
   }
-
-  append_log_line("SEND ", json);
+  pending_requests[id] = {method, Clock::now()};
   return true;
 }
 
+void LSPClient::wake_io_thread() {
+  if (io_wake_pipe[1] >= 0) {
+    const char byte = 1;
+    // A full pipe already guarantees a wakeup.
+    (void)!write(io_wake_pipe[1], &byte, 1);
+  }
+}
+
 bool LSPClient::start() {
   if (running) {
     return true;
@@ -586,11 +198,13 @@ bool LSPClient::start() {
     last_error = "empty command";
     return false;
   }
+  stop();
 
   int stdin_pipe[2] = {-1, -1};
   int stdout_pipe[2] = {-1, -1};
   int stderr_pipe[2] = {-1, -1};
-  if (pipe(stdin_pipe) != 0 || pipe(stdout_pipe) != 0 || pipe(stderr_pipe) != 0) {
+  if (pipe(stdin_pipe) != 0 || pipe(stdout_pipe) != 0 || pipe(stderr_pipe) != 0 ||
+      pipe(io_wake_pipe) != 0) {
     last_error = strerror(errno);
     return false;
   }
@@ -636,20 +250,29 @@ bool LSPClient::start() {
   running = true;
   initialized = false;
   next_request_id = 1;
-  file_versions.clear();
+  documents.clear();
+  text_sync_kind = LSP_SYNC_FULL;
   pending_completion_requests.clear();
   pending_completions.clear();
+  pending_requests.clear();
   stdout_buffer.clear();
   stderr_buffer.clear();
   last_error.clear();
 
+  set_non_blocking(stdin_fd);
   set_non_blocking(stdout_fd);
   set_non_blocking(stderr_fd);
+  set_non_blocking(io_wake_pipe[0]);
+  set_non_blocking(io_wake_pipe[1]);
 
+  // The I/O thread recognizes the initialize response by this id.
+  initialize_request_id = next_request_id++;
+  io_stopping = false;
+  io_thread = std::thread([this] { io_loop(); });
   std::ostringstream init;
   init << "{"
        << "\"jsonrpc\":\"2.0\","
-       << "\"id\":" << next_request_id++ << ","
+       << "\"id\":" << initialize_request_id << ","
        << "\"method\":\"initialize\","
        << "\"params\":{"
        << "\"processId\":" << getpid() << ","
@@ -661,7 +284,7 @@ bool LSPClient::start() {
        << json_escape(fs::path(root_path).filename().string()) << "\"}]"
        << "}"
        << "}";
-  if (!send_message(init.str())) {
+  if (!send_request(initialize_request_id, "initialize", init.str())) {
     stop();
     return false;
   }
@@ -673,33 +296,43 @@ bool LSPClient::start() {
 }
 
 void LSPClient::stop() {
-  if (!running) {
+  // A server that exited on its own leaves its I/O thread to be reaped.
+  if (!running && !io_thread.joinable()) {
     return;
   }
 
   send_message("{\"jsonrpc\":\"2.0\",\"method\":\"exit\",\"params\":{}}");
 
+  // The I/O thread writes what is still queued, the exit above included,
+  // before it returns.
+  io_stopping = true;
+  wake_io_thread();
+  if (io_thread.joinable()) {
+    io_thread.join();
+  }
+
   if (child_pid > 0) {
     kill(child_pid, SIGTERM);
     waitpid(child_pid, nullptr, WNOHANG);
   }
 
-  if (stdin_fd >= 0)
-    close(stdin_fd);
-  if (stdout_fd >= 0)
-    close(stdout_fd);
-  if (stderr_fd >= 0)
-    close(stderr_fd);
-
-  stdin_fd = -1;
-  stdout_fd = -1;
-  stderr_fd = -1;
+  for (int *fd : {&stdin_fd, &stdout_fd, &stderr_fd, &io_wake_pipe[0],
+                  &io_wake_pipe[1]}) {
+    if (*fd >= 0) {
+      close(*fd);
+    }
+    *fd = -1;
+  }
   child_pid = -1;
   running = false;
   initialized = false;
-  file_versions.clear();
+  documents.clear();
   pending_completion_requests.clear();
   pending_completions.clear();
+  pending_requests.clear();
+  Inbound dropped;
+  while (inbox.pop(dropped)) {
+  }
 }
 
 bool LSPClient::restart() {
@@ -707,81 +340,241 @@ bool LSPClient::restart() {
   return start();
 }
 
-void LSPClient::handle_stdout_data(const std::string &data) {
-  stdout_buffer += data;
-  append_log_line("RECV ", data);
+bool LSPClient::handle_stdout_data(std::size_t received) {
+  append_log_line("RECV ", std::string_view(stdout_buffer).substr(
+                               stdout_buffer.size() - received));
 
+  // Frames are parsed in place; the consumed prefix is dropped once at the
+  // end rather than after every message.
+  const std::string_view buffer(stdout_buffer);
+  std::size_t offset = 0;
+  bool decoded = false;
   while (true) {
-    const size_t header_end = stdout_buffer.find("\r\n\r\n");
-    if (header_end == std::string::npos) {
-      return;
+    const size_t header_end = buffer.find("\r\n\r\n", offset);
+    if (header_end == std::string_view::npos) {
+      break;
     }
 
     size_t content_length = 0;
-    if (!extract_content_length(stdout_buffer.substr(0, header_end),
-                                content_length)) {
+    if (!read_lsp_content_length(buffer.substr(offset, header_end - offset),
+                                 content_length)) {
       append_log_line("PARSE-ERR ", "Missing Content-Length header");
-      stdout_buffer.erase(0, header_end + 4);
+      offset = header_end + 4;
       continue;
     }
 
     const size_t body_start = header_end + 4;
-    if (stdout_buffer.size() < body_start + content_length) {
-      return;
+    if (buffer.size() - body_start < content_length) {
+      break;
     }
+    decoded |= handle_message(buffer.substr(body_start, content_length));
+    offset = body_start + content_length;
+  }
+  stdout_buffer.erase(0, offset);
+  return decoded;
+}
 
-    std::string message = stdout_buffer.substr(body_start, content_length);
-    stdout_buffer.erase(0, body_start + content_length);
+bool LSPClient::handle_message(std::string_view message) {
+  const Clock::time_point received = Clock::now();
+  LSPEnvelope envelope;
+  if (!read_lsp_envelope(message, envelope)) {
+    append_log_line("PARSE-ERR ", "Invalid JSON payload");
+    return false;
+  }
 
-    size_t pos = 0;
-    JsonValue root;
-    if (!parse_json_value(message, pos, root)) {
-      append_log_line("PARSE-ERR ", "Invalid JSON payload");
-      continue;
+  Inbound inbound;
+  inbound.received = received;
+  if (envelope.method == "textDocument/publishDiagnostics") {
+    std::string uri;
+    if (!read_lsp_diagnostics(envelope.params, uri, inbound.diagnostics)) {
+      return false;
+    }
+    inbound.kind = Inbound::Diagnostics;
+    inbound.method = std::move(envelope.method);
+    inbound.text = from_file_uri(uri);
+  } else if (envelope.method.empty() && envelope.has_id) {
+    // Besides initialize, completion is the only request this client
+    // sends.
+    inbound.kind = Inbound::Response;
+    inbound.id = envelope.id;
+    if (envelope.id == initialize_request_id) {
+      inbound.sync_kind = read_lsp_text_sync_kind(envelope.result);
+    } else {
+      read_lsp_completion_items(envelope.result, inbound.items);
     }
+  } else {
+    // Other notifications and server requests are ignored.
+    return false;
+  }
+  inbound.decode_ms = elapsed_ms(received, Clock::now());
+  inbox.push(std::move(inbound));
+  return true;
+}
+
+void LSPClient::handle_stderr_data(const std::string &data) {
+  stderr_buffer += data;
+  append_log_line("STDERR ", data);
+}
 
-    const JsonValue *method = json_object_get(root, "method");
-    if (method && method->type == JsonValue::String &&
-        method->string_value == "textDocument/publishDiagnostics") {
-      const JsonValue *params = json_object_get(root, "params");
-      const JsonValue *uri = params ? json_object_get(*params, "uri") : nullptr;
-      const JsonValue *diagnostics =
-          params ? json_object_get(*params, "diagnostics") : nullptr;
-      if (!uri || !diagnostics) {
+void LSPClient::io_loop() {
+  std::string outgoing;
+  std::size_t written = 0;
+  bool stdout_open = true;
+  bool stderr_open = true;
+  char buf[4096];
+
+  while (true) {
+    std::string message;
+    while (outbox.pop(message)) {
+      outgoing += message;
+    }
+    if (io_stopping.load()) {
+      // Best effort: whatever the pipe takes without blocking.
+      while (written < outgoing.size()) {
+        ssize_t n = write(stdin_fd, outgoing.data() + written,
+                          outgoing.size() - written);
+        if (n <= 0) {
+          break;
+        }
+        written += (std::size_t)n;
+      }
+      return;
+    }
+
+    pollfd fds[4];
+    nfds_t count = 0;
+    fds[count++] = {io_wake_pipe[0], POLLIN, 0};
+    const nfds_t stdout_slot = stdout_open ? count++ : 0;
+    if (stdout_open) {
+      fds[stdout_slot] = {stdout_fd, POLLIN, 0};
+    }
+    const nfds_t stderr_slot = stderr_open ? count++ : 0;
+    if (stderr_open) {
+      fds[stderr_slot] = {stderr_fd, POLLIN, 0};
+    }
+    const bool has_outgoing = written < outgoing.size();
+    const nfds_t stdin_slot = has_outgoing ? count++ : 0;
+    if (has_outgoing) {
+      fds[stdin_slot] = {stdin_fd, POLLOUT, 0};
+    }
+    if (::poll(fds, count, -1) < 0) {
+      if (errno == EINTR) {
         continue;
       }
+      return;
+    }
 
-      pending_diagnostics.push_back(
-          {from_file_uri(json_string_or_empty(uri)),
-           diagnostics_from_json(*diagnostics)});
-      continue;
+    if (fds[0].revents) {
+      while (read(io_wake_pipe[0], buf, sizeof(buf)) > 0) {
+      }
     }
 
-    const JsonValue *id = json_object_get(root, "id");
-    if (!id || id->type != JsonValue::Number) {
-      continue;
+    bool decoded = false;
+    // Server output is read straight into the framing buffer; large
+    // responses arrive in a few reads instead of hundreds.
+    if (stdout_open && fds[stdout_slot].revents) {
+      while (true) {
+        const std::size_t used = stdout_buffer.size();
+        stdout_buffer.resize(used + kReadChunk);
+        ssize_t n = read(stdout_fd, &stdout_buffer[used], kReadChunk);
+        stdout_buffer.resize(used + (n > 0 ? (std::size_t)n : 0));
+        if (n <= 0) {
+          stdout_open = n < 0 && (errno == EAGAIN || errno == EINTR);
+          break;
+        }
+        decoded |= handle_stdout_data((std::size_t)n);
+      }
+    }
+    if (stderr_open && fds[stderr_slot].revents) {
+      while (true) {
+        ssize_t n = read(stderr_fd, buf, sizeof(buf));
+        if (n <= 0) {
+          stderr_open = n < 0 && (errno == EAGAIN || errno == EINTR);
+          break;
+        }
+        handle_stderr_data(std::string(buf, buf + n));
+      }
     }
 
-    int request_id = (int)id->number_value;
-    auto pending_it = pending_completion_requests.find(request_id);
-    if (pending_it == pending_completion_requests.end()) {
-      continue;
+    if (has_outgoing && fds[stdin_slot].revents) {
+      while (written < outgoing.size()) {
+        ssize_t n = write(stdin_fd, outgoing.data() + written,
+                          outgoing.size() - written);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          if (n < 0 && errno != EAGAIN) {
+            const std::string error = strerror(errno);
+            append_log_line("SEND-ERR ", error);
+            Inbound failure;
+            failure.kind = Inbound::WriteError;
+            failure.text = error;
+            inbox.push(std::move(failure));
+            decoded = true;
+            written = outgoing.size();
+          }
+          break;
+        }
+        written += (std::size_t)n;
+      }
+      if (written == outgoing.size()) {
+        outgoing.clear();
+        written = 0;
+      }
     }
 
-    const JsonValue *result = json_object_get(root, "result");
-    if (result) {
-      pending_completions.push_back(
-          {pending_it->second, completion_items_from_json(*result)});
-    } else {
-      pending_completions.push_back({pending_it->second, {}});
+    if (decoded && ready_callback) {
+      ready_callback();
     }
-    pending_completion_requests.erase(pending_it);
   }
 }
 
-void LSPClient::handle_stderr_data(const std::string &data) {
-  stderr_buffer += data;
-  append_log_line("STDERR ", data);
+void LSPClient::apply_inbound(Inbound &message) {
+  switch (message.kind) {
+  case Inbound::WriteError:
+    last_error = message.text;
+    return;
+  case Inbound::Diagnostics: {
+    LSPMethodTiming &timing = timings[message.method];
+    timing.count++;
+    timing.decode_ms += message.decode_ms;
+    pending_diagnostics.push_back(
+        {std::move(message.text), std::move(message.diagnostics)});
+    return;
+  }
+  case Inbound::Response:
+    break;
+  }
+
+  const int request_id = (int)message.id;
+  auto request_it = pending_requests.find(request_id);
+  if (request_it != pending_requests.end()) {
+    const double round_trip = elapsed_ms(request_it->second.sent,
+                                         message.received);
+    LSPMethodTiming &timing = timings[request_it->second.method];
+    timing.count++;
+    timing.total_ms += round_trip;
+    timing.max_ms = std::max(timing.max_ms, round_trip);
+    timing.decode_ms += message.decode_ms;
+    append_log_line("TIMING ", request_it->second.method + " " +
+                                   std::to_string(round_trip) + " ms");
+    pending_requests.erase(request_it);
+  }
+
+  if (request_id == initialize_request_id) {
+    text_sync_kind = message.sync_kind;
+    append_log_line("INFO ", std::string("Text sync: ") +
+                                 text_sync_kind_name(text_sync_kind));
+    return;
+  }
+  auto pending_it = pending_completion_requests.find(request_id);
+  if (pending_it == pending_completion_requests.end()) {
+    return;
+  }
+  pending_completions.push_back(
+      {pending_it->second, std::move(message.items)});
+  pending_completion_requests.erase(pending_it);
 }
 
 bool LSPClient::poll() {
@@ -790,21 +583,9 @@ bool LSPClient::poll() {
   }
 
   bool changed = false;
-  char buf[4096];
-  while (stdout_fd >= 0) {
-    ssize_t n = read(stdout_fd, buf, sizeof(buf));
-    if (n <= 0) {
-      break;
-    }
-    handle_stdout_data(std::string(buf, buf + n));
-    changed = true;
-  }
-  while (stderr_fd >= 0) {
-    ssize_t n = read(stderr_fd, buf, sizeof(buf));
-    if (n <= 0) {
-      break;
-    }
-    handle_stderr_data(std::string(buf, buf + n));
+  Inbound message;
+  while (inbox.pop(message)) {
+    apply_inbound(message);
     changed = true;
   }
 
@@ -829,13 +610,15 @@ bool LSPClient::poll() {
 
 bool LSPClient::did_open(const std::string &filepath,
                          const std::string &language_id,
-                         const std::string &text) {
+                         const LineStore &lines) {
   if (!running) {
     return false;
   }
 
   std::string abs_path = fs::absolute(filepath).string();
-  file_versions[abs_path] = 1;
+  OpenDocument &doc = documents[abs_path];
+  doc.version = 1;
+  doc.sent = text_sync_point(lines);
   std::ostringstream json;
   json << "{"
        << "\"jsonrpc\":\"2.0\","
@@ -845,24 +628,48 @@ bool LSPClient::did_open(const std::string &filepath,
        << "\"uri\":\"" << json_escape(to_file_uri(abs_path)) << "\","
        << "\"languageId\":\"" << json_escape(language_id) << "\","
        << "\"version\":1,"
-       << "\"text\":\"" << json_escape(text) << "\""
+       << "\"text\":\"" << json_escape(lines.join('\n')) << "\""
        << "}"
        << "}"
        << "}";
   return send_message(json.str());
 }
 
-bool LSPClient::did_change(const std::string &filepath, const std::string &text) {
+bool LSPClient::did_change(const std::string &filepath,
+                           const LineStore &lines) {
   if (!running) {
     return false;
   }
 
   std::string abs_path = fs::absolute(filepath).string();
-  if (!file_versions.count(abs_path)) {
-    return did_open(abs_path, language_id_for(language, abs_path), text);
+  auto it = documents.find(abs_path);
+  if (it == documents.end()) {
+    return did_open(abs_path, language_id_for(language, abs_path), lines);
+  }
+  if (text_sync_kind == LSP_SYNC_NONE) {
+    return true;
+  }
+
+  OpenDocument &doc = it->second;
+  TextDelta delta;
+  const TextDeltaResult result = compute_text_delta(doc.sent, lines, delta);
+  if (result == TEXT_DELTA_NONE) {
+    return true;
+  }
+  std::ostringstream change;
+  if (text_sync_kind == LSP_SYNC_INCREMENTAL && result == TEXT_DELTA_RANGE) {
+    change << "{\"range\":{"
+           << "\"start\":{\"line\":" << delta.start_line
+           << ",\"character\":" << delta.start_character << "},"
+           << "\"end\":{\"line\":" << delta.end_line
+           << ",\"character\":" << delta.end_character << "}},"
+           << "\"text\":\"" << json_escape(delta.text) << "\"}";
+  } else {
+    change << "{\"text\":\"" << json_escape(lines.join('\n')) << "\"}";
   }
+  doc.sent = text_sync_point(lines);
 
-  int version = ++file_versions[abs_path];
+  int version = ++doc.version;
   std::ostringstream json;
   json << "{"
        << "\"jsonrpc\":\"2.0\","
@@ -872,21 +679,27 @@ bool LSPClient::did_change(const std::string &filepath, const std::string &text)
        << "\"uri\":\"" << json_escape(to_file_uri(abs_path)) << "\","
        << "\"version\":" << version
        << "},"
-       << "\"contentChanges\":[{\"text\":\"" << json_escape(text) << "\"}]"
+       << "\"contentChanges\":[" << change.str() << "]"
        << "}"
        << "}";
-  return send_message(json.str());
+  const long long sent_before = bytes_sent;
+  if (!send_message(json.str())) {
+    return false;
+  }
+  change_messages++;
+  change_bytes += bytes_sent - sent_before;
+  return true;
 }
 
-bool LSPClient::did_save(const std::string &filepath, const std::string &text) {
+bool LSPClient::did_save(const std::string &filepath, const LineStore &lines) {
   if (!running) {
     return false;
   }
 
   std::string abs_path = fs::absolute(filepath).string();
-  if (!file_versions.count(abs_path)) {
-    did_open(abs_path, language_id_for(language, abs_path), text);
-  }
+  // Also brings an open document up to date: the save drops the pending
+  // debounced change.
+  did_change(abs_path, lines);
   std::ostringstream json;
   json << "{"
        << "\"jsonrpc\":\"2.0\","
@@ -894,7 +707,7 @@ bool LSPClient::did_save(const std::string &filepath, const std::string &text) {
        << "\"params\":{"
        << "\"textDocument\":{\"uri\":\"" << json_escape(to_file_uri(abs_path))
        << "\"},"
-       << "\"text\":\"" << json_escape(text) << "\""
+       << "\"text\":\"" << json_escape(lines.join('\n')) << "\""
        << "}"
        << "}";
   return send_message(json.str());
@@ -931,7 +744,7 @@ bool LSPClient::request_completion(const std::string &filepath, int line,
   json << "}"
        << "}";
 
-  if (!send_message(json.str())) {
+  if (!send_request(request_id, "textDocument/completion", json.str())) {
     pending_completion_requests.erase(request_id);
     return false;
   }
@@ -954,5 +767,21 @@ LSPClient::consume_completion_items() {
 }
 
 std::string LSPClient::describe() const {
-  return language + " @ " + root_path;
+  std::string out = language + " @ " + root_path + " [" +
+                    text_sync_kind_name(text_sync_kind) + " sync";
+  if (change_messages > 0) {
+    out += ", " + std::to_string(change_bytes / change_messages) + " B/edit";
+  }
+  // Average and worst round trip of each request method.
+  for (const auto &entry : timings) {
+    const LSPMethodTiming &timing = entry.second;
+    if (timing.total_ms <= 0 || entry.first == "initialize") {
+      continue;
+    }
+    const std::size_t slash = entry.first.rfind('/');
+    out += ", " + entry.first.substr(slash == std::string::npos ? 0 : slash + 1) +
+           " " + std::to_string((long long)(timing.total_ms / timing.count)) +
+           "/" + std::to_string((long long)timing.max_ms) + " ms";
+  }
+  return out + "]";
 }
@@ -1,29 +1,57 @@
 #ifndef LSP_CLIENT_H
 #define LSP_CLIENT_H
 
+#include "line_store.h"
+#include "lsp_protocol.h"
+#include "mpsc_queue.h"
+#include "text_delta.h"
 #include "text_features.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <map>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
-struct LSPCompletionItem {
-  std::string label;
-  std::string insert_text;
-  std::string detail;
-  std::string filter_text;
-  std::string sort_text;
-  int kind = 0;
-  int insert_text_format = 1; // 1=plain text, 2=snippet
-  bool has_text_edit_range = false;
-  int edit_start_line = 0;
-  int edit_start_char = 0;
-  int edit_end_line = 0;
-  int edit_end_char = 0;
+// Round trips of one request method, or decode times of one notification.
+struct LSPMethodTiming {
+  long long count = 0;
+  double total_ms = 0; // request sent to response read
+  double max_ms = 0;
+  double decode_ms = 0; // spent parsing on the I/O thread
 };
 
+// One language server process. Its pipes are serviced by an I/O thread,
+// which writes queued messages and frames, parses and decodes everything
+// the server sends. Decoded results reach the UI thread through a lock-free
+// queue that poll() drains, and the ready callback lets the main loop wake
+// up for them instead of polling.
 class LSPClient {
 private:
+  using Clock = std::chrono::steady_clock;
+
+  // A decoded server message, from the I/O thread to poll().
+  struct Inbound {
+    enum Kind { Diagnostics, Response, WriteError };
+    Kind kind = Diagnostics;
+    long long id = 0;
+    std::string method; // notifications
+    std::string text;   // file path for Diagnostics, error for WriteError
+    std::vector<Diagnostic> diagnostics;
+    std::vector<LSPCompletionItem> items;
+    LSPTextSyncKind sync_kind = LSP_SYNC_FULL;
+    Clock::time_point received;
+    double decode_ms = 0;
+  };
+
+  struct PendingRequest {
+    std::string method;
+    Clock::time_point sent;
+  };
+
   std::string language;
   std::string root_path;
   std::vector<std::string> command;
@@ -34,20 +62,50 @@ private:
   bool running;
   bool initialized;
   int next_request_id;
-  std::map<std::string, int> file_versions;
-  std::string stdout_buffer;
-  std::string stderr_buffer;
+  // Open documents by absolute path, with where the buffer's journal stood
+  // when the text was last sent, so later changes can be sent as ranges.
+  struct OpenDocument {
+    int version = 0;
+    TextSyncPoint sent;
+  };
+  std::map<std::string, OpenDocument> documents;
+  int initialize_request_id = 0;
+  LSPTextSyncKind text_sync_kind = LSP_SYNC_FULL;
+  long long bytes_sent = 0;
+  long long change_messages = 0;
+  long long change_bytes = 0;
   std::string last_error;
   std::vector<std::pair<std::string, std::vector<Diagnostic>>>
       pending_diagnostics;
   std::map<int, std::string> pending_completion_requests;
   std::vector<std::pair<std::string, std::vector<LSPCompletionItem>>>
       pending_completions;
+  std::map<int, PendingRequest> pending_requests;
+  std::map<std::string, LSPMethodTiming> timings;
+  std::function<void()> ready_callback;
+
+  // Shared with the I/O thread. The buffers below are its alone while it
+  // runs.
+  std::thread io_thread;
+  std::atomic<bool> io_stopping{false};
+  int io_wake_pipe[2] = {-1, -1};
+  MpscQueue<std::string> outbox;
+  MpscQueue<Inbound> inbox;
+  std::string stdout_buffer;
+  std::string stderr_buffer;
 
   bool send_message(const std::string &json);
+  bool send_request(int id, const std::string &method, const std::string &json);
+  void wake_io_thread();
+  void io_loop();
+  void apply_inbound(Inbound &message);
   std::string json_escape(const std::string &value) const;
-  void append_log_line(const std::string &prefix, const std::string &line);
-  void handle_stdout_data(const std::string &data);
+  void append_log_line(const std::string &prefix, std::string_view line);
+  // Frames and decodes complete messages in stdout_buffer, whose last
+  // `received` bytes just arrived. Returns true if any were queued.
+  bool handle_stdout_data(std::size_t received);
+  // Decodes one message into the inbox. Returns false if nothing was queued.
+  bool handle_message(std::string_view message);
   void handle_stderr_data(const std::string &data);
 
 public:
@@ -58,12 +116,20 @@ public:
   bool start();
   void stop();
   bool restart();
+  // Applies what the I/O thread decoded since the last call. Returns true
+  // when anything changed.
   bool poll();
+  // Called from the I/O thread whenever poll() has new work.
+  void set_ready_callback(std::function<void()> callback) {
+    ready_callback = std::move(callback);
+  }
 
   bool did_open(const std::string &filepath, const std::string &language_id,
-                const std::string &text);
-  bool did_change(const std::string &filepath, const std::string &text);
-  bool did_save(const std::string &filepath, const std::string &text);
+                const LineStore &lines);
+  // Sends what changed since the text last sent for `filepath`: one ranged
+  // change when the server syncs incrementally, the whole text otherwise.
+  bool did_change(const std::string &filepath, const LineStore &lines);
+  bool did_save(const std::string &filepath, const LineStore &lines);
   bool request_completion(const std::string &filepath, int line, int character,
                           char trigger_character = '\0');
   std::vector<std::pair<std::string, std::vector<Diagnostic>>>
@@ -76,6 +142,9 @@ public:
   const std::string &get_language() const { return language; }
   const std::string &get_root_path() const { return root_path; }
   const std::string &get_last_error() const { return last_error; }
+  const std::map<std::string, LSPMethodTiming> &get_timings() const {
+    return timings;
+  }
   std::string describe() const;
 };
 
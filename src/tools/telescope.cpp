@@ -1,12 +1,17 @@
 #include "telescope.h"
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <fstream>
-#include <unordered_set>
 
 namespace {
-constexpr int kMaxDepth = 4;
 constexpr int kMaxResults = 2000;
+// Subtrees up to this size are ranked on the spot, in well under a
+// millisecond, rather than streamed.
+constexpr std::size_t kInlineSearchEntries = 16384;
+constexpr std::size_t kMaxContentMatches = 5000;
+// Lines shown above a content match in its preview.
+constexpr int kPreviewContextLines = 8;
 constexpr int kMaxPreviewLines = 120;
 constexpr int kMaxPreviewLineLength = 240;
 constexpr std::uintmax_t kMaxPreviewFileBytes = 1024 * 1024; // 1MB
@@ -18,15 +23,36 @@ std::string lower_copy(const std::string &s) {
   return out;
 }
 
-bool should_skip_dir_name(const std::string &name) {
-  static const std::unordered_set<std::string> kSkipped = {
-      ".git",       ".svn",      ".hg",       "node_modules", "dist",
-      "build",      ".cache",    "__pycache__", ".venv",      "target"};
-  return kSkipped.find(name) != kSkipped.end();
+// Absolute, normalized and without a trailing separator.
+fs::path normalized_dir(const fs::path &dir) {
+  std::error_code ec;
+  fs::path out = fs::absolute(dir, ec);
+  if (ec) {
+    out = dir;
+  }
+  out = out.lexically_normal();
+  if (!out.has_filename() && out.has_relative_path()) {
+    out = out.parent_path();
+  }
+  return out;
 }
 
-bool should_skip_name(const std::string &name) {
-  return name.empty() || name[0] == '.';
+// `dir` relative to `root` ("" for root itself), when it is within root.
+bool relative_to(const std::string &root, const std::string &dir,
+                 std::string &rel) {
+  if (root.empty() || dir.compare(0, root.size(), root) != 0) {
+    return false;
+  }
+  if (dir.size() == root.size()) {
+    rel.clear();
+    return true;
+  }
+  const size_t skip = root.back() == '/' ? root.size() : root.size() + 1;
+  if (root.back() != '/' && dir[root.size()] != '/') {
+    return false;
+  }
+  rel = dir.substr(skip);
+  return true;
 }
 
 bool file_looks_binary(const std::string &path) {
@@ -53,21 +79,40 @@ Telescope::Telescope() {
 }
 
 void Telescope::open(const std::string &root) {
+  open_in_mode(root, false, "");
+}
+
+void Telescope::open_content_search(const std::string &root,
+                                    const std::string &q) {
+  open_in_mode(root, true, q);
+}
+
+void Telescope::open_in_mode(const std::string &root, bool content_search,
+                             const std::string &q) {
   active = true;
+  if (content_search != content_mode) {
+    search.cancel();
+    content.cancel();
+    search_running = false;
+    content_mode = content_search;
+  }
   std::error_code ec;
   if (!root.empty()) {
     fs::path candidate = fs::absolute(fs::path(root), ec);
     if (!ec && fs::exists(candidate, ec) && fs::is_directory(candidate, ec)) {
-      root_dir = candidate.lexically_normal();
+      root_dir = candidate;
     } else {
       root_dir = fs::current_path();
     }
   } else if (!fs::exists(root_dir, ec) || !fs::is_directory(root_dir, ec)) {
     root_dir = fs::current_path();
   }
-  query.clear();
+  root_dir = normalized_dir(root_dir);
+  query = q;
   selected_index = 0;
+  selection_moved = false;
   results.clear();
+  ensure_indexed();
   update_results();
 }
 
@@ -76,166 +121,210 @@ void Telescope::close() {
   query.clear();
   results.clear();
   selected_index = 0;
+  search.cancel();
+  content.cancel();
+  search_running = false;
 }
 
 void Telescope::set_query(const std::string &q) {
   query = q;
+  selected_index = 0;
+  selection_moved = false;
   update_results();
 }
 
-void Telescope::update_results() {
-  results.clear();
-  scan_directory(root_dir, 0);
+// The index covers root_dir when it is at or below the index root, so
+// entering a directory only narrows the range; leaving the indexed tree
+// re-indexes from the new root.
+void Telescope::ensure_indexed() {
+  std::string rel;
+  const std::string dir = root_dir.string();
+  index.set_root(relative_to(index.root(), dir, rel) ? index.root() : dir);
+}
 
-  std::error_code ec;
-  const std::string query_lc = lower_copy(query);
-  std::vector<FileMatch> filtered;
-  filtered.reserve(results.size());
-
-  for (auto match : results) {
-    fs::path p(match.path);
-    std::string rel = fs::relative(p, root_dir, ec).string();
-    if (ec || rel.empty()) {
-      rel = p.string();
-      ec.clear();
-    }
-    if (!query_lc.empty() &&
-        !fuzzy_match(match.name, query_lc) && !fuzzy_match(rel, query_lc)) {
-      continue;
-    }
+void Telescope::set_ready_callback(std::function<void()> callback) {
+  index.set_ready_callback(callback);
+  search.set_ready_callback(callback);
+  content.set_ready_callback(std::move(callback));
+}
 
-    int score_name = fuzzy_score(match.name, query_lc);
-    int score_path = fuzzy_score(rel, query_lc);
-    int bonus = 0;
-    std::string name_lc = lower_copy(match.name);
-    std::string rel_lc = lower_copy(rel);
-    if (!query_lc.empty() && name_lc.find(query_lc) != std::string::npos) {
-      bonus += 30;
-    }
-    if (!query_lc.empty() && rel_lc.find("/" + query_lc) != std::string::npos) {
-      bonus += 12;
-    }
-    if (match.is_directory) {
-      bonus -= 6;
+bool Telescope::refresh_results() {
+  if (!active) {
+    return false;
+  }
+  bool changed = false;
+  const auto snap = index.snapshot();
+  // Searching contents takes long enough that restarting on every partial
+  // snapshot of a first scan would never let one finish.
+  if (snap->sequence != shown_sequence &&
+      (!content_mode || !search_running || snap->complete)) {
+    update_results();
+    changed = true;
+  }
+  if (content_mode) {
+    const auto found = content.results();
+    if (search_running && found != shown_content &&
+        found->generation == content.generation()) {
+      shown_content = found;
+      search_running = !found->done;
+      show_content(*found);
+      changed = true;
     }
-
-    match.score = score_name * 2 + score_path + bonus;
-    filtered.push_back(std::move(match));
+    return changed;
+  }
+  const auto found = search.results();
+  if (search_running && found != shown_search &&
+      found->generation == search.generation()) {
+    shown_search = found;
+    search_running = !found->done;
+    show_hits(*found->snapshot, found->hits, found->done);
+    changed = true;
   }
+  return changed;
+}
 
-  std::sort(filtered.begin(), filtered.end(),
-            [&](const FileMatch &a, const FileMatch &b) {
-              if (query_lc.empty()) {
-                if (a.is_directory != b.is_directory) {
-                  return a.is_directory;
-                }
-                return lower_copy(a.name) < lower_copy(b.name);
-              }
-              if (a.score != b.score) {
-                return a.score > b.score;
-              }
-              if (a.is_directory != b.is_directory) {
-                return !a.is_directory;
-              }
-              return lower_copy(a.name) < lower_copy(b.name);
-            });
+bool Telescope::indexing() const {
+  const auto snap = index.snapshot();
+  std::string rel;
+  return !snap->complete || !relative_to(snap->root, root_dir.string(), rel);
+}
 
-  if ((int)filtered.size() > kMaxResults) {
-    filtered.resize(kMaxResults);
-  }
-  results = std::move(filtered);
+std::size_t Telescope::indexed_count() const {
+  return index.snapshot()->size();
+}
 
-  if (selected_index >= (int)results.size()) {
-    selected_index = std::max(0, (int)results.size() - 1);
-  }
-  if (selected_index < 0) {
-    selected_index = 0;
-  }
+double Telescope::take_time_to_first_result_ms() {
+  const double ms = first_result_ms;
+  first_result_ms = -1;
+  return ms;
 }
 
-void Telescope::scan_directory(const fs::path &dir, int depth) {
-  if (depth > kMaxDepth) {
+void Telescope::update_results() {
+  const auto snap = index.snapshot();
+  shown_sequence = snap->sequence;
+  query_started = std::chrono::steady_clock::now();
+  awaiting_first_result = true;
+
+  std::string prefix;
+  const bool indexed = relative_to(snap->root, root_dir.string(), prefix);
+  if (content_mode) {
+    if (!indexed || query.empty()) {
+      content.cancel();
+      search_running = false;
+      show_results({}, indexed);
+      return;
+    }
+    content.start(snap, prefix, query, kMaxContentMatches);
+    search_running = true;
     return;
   }
-
-  std::error_code ec;
-  std::vector<fs::directory_entry> entries;
-  for (auto it = fs::directory_iterator(dir, ec); !ec && it != fs::end(it);
-       it.increment(ec)) {
-    entries.push_back(*it);
+  if (!indexed) {
+    search.cancel();
+    search_running = false;
+    show_hits(*snap, {}, true);
+    return;
   }
-  if (ec) {
+  const auto range = snap->subtree(prefix);
+  if (range.second - range.first <= kInlineSearchEntries) {
+    search.cancel();
+    search_running = false;
+    show_hits(*snap, rank_file_index(*snap, prefix, query, kMaxResults), true);
     return;
   }
+  // The current results stay up until the new ones start arriving.
+  search.start(snap, prefix, query, kMaxResults);
+  search_running = true;
+}
 
-  std::sort(entries.begin(), entries.end(),
-            [](const fs::directory_entry &a, const fs::directory_entry &b) {
-              bool ad = false;
-              bool bd = false;
-              std::error_code e1, e2;
-              ad = a.is_directory(e1);
-              bd = b.is_directory(e2);
-              if (ad != bd) {
-                return ad;
-              }
-              std::string an = lower_copy(a.path().filename().string());
-              std::string bn = lower_copy(b.path().filename().string());
-              return an < bn;
-            });
-
-  for (const auto &entry : entries) {
-    std::string name = entry.path().filename().string();
-    if (should_skip_name(name)) {
-      continue;
-    }
-
-    bool is_dir = false;
-    std::error_code type_ec;
-    is_dir = entry.is_directory(type_ec);
-    if (type_ec) {
-      continue;
-    }
-
-    if (is_dir && should_skip_dir_name(name)) {
-      continue;
-    }
+void Telescope::show_hits(const FileIndexSnapshot &snap,
+                          const std::vector<FuzzyHit> &hits, bool complete) {
+  std::vector<FileMatch> next;
+  next.reserve(hits.size());
+  const fs::path index_root(snap.root);
+  for (const FuzzyHit &hit : hits) {
+    FileMatch match;
+    match.path = (index_root / std::string(snap.path(hit.index))).string();
+    match.name = std::string(snap.name(hit.index));
+    match.is_directory = snap.is_directory(hit.index);
+    match.score = hit.score;
+    next.push_back(std::move(match));
+  }
+  show_results(std::move(next), complete);
+}
 
+void Telescope::show_content(const ContentSearchResults &found) {
+  std::vector<FileMatch> next;
+  next.reserve(found.matches.size());
+  const fs::path index_root(found.root);
+  for (const ContentMatch &hit : found.matches) {
     FileMatch match;
-    match.path = entry.path().string();
-    match.name = name;
-    match.is_directory = is_dir;
+    match.path = (index_root / hit.path).string();
+    // The full path is above the preview; the list has room for the line.
+    const std::size_t slash = hit.path.rfind('/');
+    match.name =
+        slash == std::string::npos ? hit.path : hit.path.substr(slash + 1);
+    match.name += ":" + std::to_string(hit.line + 1) + ": ";
+    const std::size_t indent = hit.text.find_first_not_of(" \t");
+    match.name +=
+        indent == std::string::npos ? std::string() : hit.text.substr(indent);
     match.score = 0;
-    results.push_back(std::move(match));
-
-    if ((int)results.size() >= kMaxResults) {
-      return;
-    }
+    match.is_directory = false;
+    match.line = (int)hit.line;
+    match.column = (int)hit.column;
+    next.push_back(std::move(match));
+  }
+  show_results(std::move(next), found.done);
+}
 
-    if (is_dir && depth < kMaxDepth) {
-      scan_directory(entry.path(), depth + 1);
-      if ((int)results.size() >= kMaxResults) {
-        return;
+void Telescope::show_results(std::vector<FileMatch> next, bool complete) {
+  if (selection_moved && selected_index >= 0 &&
+      selected_index < (int)results.size()) {
+    const FileMatch &selected = results[selected_index];
+    for (std::size_t i = 0; i < next.size(); i++) {
+      if (next[i].path == selected.path && next[i].line == selected.line) {
+        selected_index = (int)i;
+        break;
       }
     }
   }
+  results = std::move(next);
+
+  if (selected_index >= (int)results.size()) {
+    selected_index = std::max(0, (int)results.size() - 1);
+  }
+  if (selected_index < 0) {
+    selected_index = 0;
+  }
+  if (awaiting_first_result && (!results.empty() || complete)) {
+    awaiting_first_result = false;
+    first_result_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - query_started)
+                          .count();
+  }
 }
 
 void Telescope::move_up() {
-  if (selected_index > 0)
+  if (selected_index > 0) {
     selected_index--;
+    selection_moved = true;
+  }
 }
 
 void Telescope::move_down() {
-  if (selected_index < (int)results.size() - 1)
+  if (selected_index < (int)results.size() - 1) {
     selected_index++;
+    selection_moved = true;
+  }
 }
 
 void Telescope::select() {
   if (selected_index >= 0 && selected_index < (int)results.size()) {
     if (results[selected_index].is_directory) {
-      root_dir = fs::path(results[selected_index].path);
+      root_dir = normalized_dir(results[selected_index].path);
       query.clear();
+      results.clear();
       selected_index = 0;
+      selection_moved = false;
       update_results();
     }
   }
@@ -245,7 +334,10 @@ void Telescope::go_parent() {
   if (root_dir.has_parent_path()) {
     root_dir = root_dir.parent_path();
     query.clear();
+    results.clear();
     selected_index = 0;
+    selection_moved = false;
+    ensure_indexed();
     update_results();
   }
 }
@@ -257,6 +349,20 @@ std::string Telescope::get_selected_path() const {
   return "";
 }
 
+int Telescope::get_selected_line() const {
+  if (selected_index >= 0 && selected_index < (int)results.size()) {
+    return results[selected_index].line;
+  }
+  return -1;
+}
+
+int Telescope::get_selected_column() const {
+  if (selected_index >= 0 && selected_index < (int)results.size()) {
+    return results[selected_index].column;
+  }
+  return 0;
+}
+
 std::vector<std::string> Telescope::get_preview_lines() const {
   if (selected_index < 0 || selected_index >= (int)results.size()) {
     return {};
@@ -265,6 +371,9 @@ std::vector<std::string> Telescope::get_preview_lines() const {
   if (path.empty() || results[selected_index].is_directory) {
     return {};
   }
+  if (results[selected_index].line >= 0) {
+    return load_preview_around(path, results[selected_index].line);
+  }
   return load_preview(path);
 }
 
@@ -305,62 +414,40 @@ std::vector<std::string> Telescope::load_preview(const std::string &path) const
   return lines;
 }
 
-bool Telescope::fuzzy_match(const std::string &text, const std::string &pattern) {
-  if (pattern.empty())
-    return true;
-
-  std::string text_lower = lower_copy(text);
-  std::string pattern_lower = lower_copy(pattern);
-
-  size_t pattern_idx = 0;
-  for (size_t i = 0; i < text_lower.length() && pattern_idx < pattern_lower.length();
-       i++) {
-    if (text_lower[i] == pattern_lower[pattern_idx]) {
-      pattern_idx++;
-    }
-  }
-  return pattern_idx == pattern_lower.length();
-}
-
-int Telescope::fuzzy_score(const std::string &text, const std::string &pattern) {
-  if (pattern.empty())
-    return 0;
-
-  std::string text_lower = lower_copy(text);
-  std::string pattern_lower = lower_copy(pattern);
-  if (text_lower.empty()) {
-    return 0;
-  }
-
-  if (text_lower == pattern_lower) {
-    return 500;
-  }
-  if (text_lower.find(pattern_lower) != std::string::npos) {
-    return 300;
+// Numbered lines around a content match, which is marked. The file was
+// searched already, so it is neither binary nor skipped for its size.
+std::vector<std::string>
+Telescope::load_preview_around(const std::string &path, int line) const {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return {"[Unable to open file]"};
   }
-
-  int score = 0;
-  size_t pi = 0;
-  int prev = -2;
-  for (size_t i = 0; i < text_lower.size() && pi < pattern_lower.size(); i++) {
-    if (text_lower[i] != pattern_lower[pi]) {
+  std::vector<std::string> lines;
+  const int first = std::max(0, line - kPreviewContextLines);
+  std::string text;
+  for (int n = 0; n < first + kMaxPreviewLines && std::getline(file, text);
+       n++) {
+    if (n < first) {
       continue;
     }
-    score += 12;
-    if ((int)i == prev + 1) {
-      score += 10;
+    if (!text.empty() && text.back() == '\r') {
+      text.pop_back();
     }
-    if (i == 0 || text_lower[i - 1] == '/' || text_lower[i - 1] == '_' ||
-        text_lower[i - 1] == '-' || text_lower[i - 1] == ' ') {
-      score += 8;
+    if ((int)text.length() > kMaxPreviewLineLength) {
+      text = text.substr(0, kMaxPreviewLineLength) + "...";
     }
-    score += std::max(0, 12 - (int)i);
-    prev = (int)i;
-    pi++;
+    char number[16];
+    std::snprintf(number, sizeof(number), "%c%5d  ", n == line ? '>' : ' ',
+                  n + 1);
+    lines.push_back(number + text);
   }
+  return lines;
+}
 
-  if (pi != pattern_lower.size()) {
-    return 0;
-  }
-  return score;
+bool Telescope::fuzzy_match(const std::string &text, const std::string &pattern) {
+  return FuzzyPattern(pattern).matches(lower_copy(text));
+}
+
+int Telescope::fuzzy_score(const std::string &text, const std::string &pattern) {
+  return FuzzyPattern(pattern).score(lower_copy(text));
 }
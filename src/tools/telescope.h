@@ -1,9 +1,15 @@
 #ifndef TELESCOPE_H
 #define TELESCOPE_H
 
+#include "content_search.h"
+#include "file_index.h"
+#include "file_search.h"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <string>
 #include <vector>
-#include <filesystem>
 
 namespace fs = std::filesystem;
 
@@ -12,6 +18,8 @@ struct FileMatch {
     std::string name;
     int score;
     bool is_directory;
+    int line = -1; // content matches only, from 0
+    int column = 0;
 };
 
 class Telescope {
@@ -19,11 +27,29 @@ public:
     Telescope();
     
     void open(const std::string& root = "");
+    // Live grep: the query searches the contents of the files below root
+    // instead of their names.
+    void open_content_search(const std::string& root = "",
+                             const std::string& q = "");
     void close();
     bool is_active() const { return active; }
+    bool is_content_search() const { return content_mode; }
     
     void set_query(const std::string& q);
+    // Small trees are ranked at once; larger ones on the search worker,
+    // whose results refresh_results() picks up as they stream in.
     void update_results();
+    // Takes in streamed search results, and searches again when the file
+    // index published something new. True when the results changed.
+    bool refresh_results();
+    // Runs on the index's and the search's workers when they publish.
+    void set_ready_callback(std::function<void()> callback);
+    bool indexing() const;
+    bool searching() const { return search_running; }
+    std::size_t indexed_count() const;
+    // Milliseconds from the latest query to its first results, once; -1
+    // before they arrive and after they were taken.
+    double take_time_to_first_result_ms();
     
     void move_up();
     void move_down();
@@ -31,6 +57,10 @@ public:
     void go_parent();
     
     std::string get_selected_path() const;
+    // Line (from 0) and byte column of the selected content match; -1
+    // and 0 in Find Files.
+    int get_selected_line() const;
+    int get_selected_column() const;
     std::vector<std::string> get_preview_lines() const;
     
     const std::vector<FileMatch>& get_results() const { return results; }
@@ -47,9 +77,30 @@ private:
     std::vector<FileMatch> results;
     int selected_index;
     fs::path root_dir;
-    
-    void scan_directory(const fs::path& dir, int depth = 0);
+    FileIndex index;
+    std::uint64_t shown_sequence = 0;
+    FileSearch search;
+    std::shared_ptr<const FileSearchResults> shown_search;
+    bool content_mode = false;
+    ContentSearch content;
+    std::shared_ptr<const ContentSearchResults> shown_content;
+    bool search_running = false;
+    // Once the user moves the selection it follows the entry, not the row.
+    bool selection_moved = false;
+    std::chrono::steady_clock::time_point query_started;
+    bool awaiting_first_result = false;
+    double first_result_ms = -1;
+
+    void open_in_mode(const std::string& root, bool content_search,
+                      const std::string& q);
+    void ensure_indexed();
+    void show_hits(const FileIndexSnapshot& snap,
+                   const std::vector<FuzzyHit>& hits, bool complete);
+    void show_content(const ContentSearchResults& found);
+    void show_results(std::vector<FileMatch> next, bool complete);
     std::vector<std::string> load_preview(const std::string& path) const;
+    std::vector<std::string> load_preview_around(const std::string& path,
+                                                 int line) const;
 };
 
 #endif
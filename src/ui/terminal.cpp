@@ -3,14 +3,88 @@
 #include <fcntl.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <poll.h>
+#include <cerrno>
+#include <csignal>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <unistd.h>
 
 static struct termios orig_termios;
 
+// Write end of the active terminal's resize pipe, for the signal handler.
+static volatile sig_atomic_t resize_notify_fd = -1;
+static struct sigaction orig_sigwinch;
+
+static void on_sigwinch(int) {
+  const int saved_errno = errno;
+  const char byte = 1;
+  // A full pipe already guarantees a wakeup.
+  (void)!::write(resize_notify_fd, &byte, 1);
+  errno = saved_errno;
+}
+
+static void drain_pipe(int fd) {
+  char drained[64];
+  while (fd >= 0 && read(fd, drained, sizeof(drained)) > 0) {
+  }
+}
+
+// Typical frame size; keeps most frames from growing the buffer.
+static constexpr std::size_t kFrameBufferReserve = 64 * 1024;
+
+// Writes all of `parts`, resuming after partial writes and waiting for a
+// non-blocking tty to drain. Returns the number of syscalls made.
+static std::uint64_t write_fully(int fd, struct iovec *parts, int count) {
+  std::uint64_t syscalls = 0;
+  while (count > 0) {
+    const ssize_t written = writev(fd, parts, count);
+    syscalls++;
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        poll(&pfd, 1, -1);
+        continue;
+      }
+      return syscalls; // the tty is gone
+    }
+    std::size_t left = (std::size_t)written;
+    while (count > 0 && left >= parts->iov_len) {
+      left -= parts->iov_len;
+      parts++;
+      count--;
+    }
+    if (count > 0) {
+      parts->iov_base = (char *)parts->iov_base + left;
+      parts->iov_len -= left;
+    }
+  }
+  return syscalls;
+}
+
+// REP is missing from the Linux console and GNU screen, and a dumb or
+// unknown terminal may not erase with the background colour either.
+static ScreenEncoder::Caps caps_for_term(const char *term) {
+  ScreenEncoder::Caps caps;
+  const std::string name = term ? term : "";
+  if (name.empty() || name == "dumb") {
+    caps.erase_chars = false;
+    caps.repeat_char = false;
+  } else if (name.rfind("linux", 0) == 0 || name.rfind("screen", 0) == 0) {
+    caps.repeat_char = false;
+  }
+  return caps;
+}
+
 static bool read_char_with_timeout(char &out, int timeout_ms) {
   struct pollfd pfd;
   pfd.fd = STDIN_FILENO;
@@ -25,9 +99,28 @@ static bool read_char_with_timeout(char &out, int timeout_ms) {
   return read(STDIN_FILENO, &out, 1) == 1;
 }
 
-Terminal::Terminal() : width(80), height(24), poll_timeout_ms(8), raw_mode(false) {}
+Terminal::Terminal() : width(80), height(24), poll_timeout_ms(8), raw_mode(false) {
+  buffer.reserve(kFrameBufferReserve);
+  encoder.set_caps(caps_for_term(std::getenv("TERM")));
+  encoder.set_columns(width);
+  for (int *fds : {wake_pipe, resize_pipe}) {
+    if (pipe(fds) == 0) {
+      for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+      }
+    }
+  }
+}
 
-Terminal::~Terminal() { cleanup(); }
+Terminal::~Terminal() {
+  cleanup();
+  for (int fd : {wake_pipe[0], wake_pipe[1], resize_pipe[0], resize_pipe[1]}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
 
 void Terminal::enable_raw_mode() {
   if (raw_mode)
@@ -78,11 +171,31 @@ void Terminal::init() {
     width = std::max(1, (int)ws.ws_col);
     height = std::max(1, (int)ws.ws_row);
   }
+  encoder.set_columns(width);
+  encoder.cursor_moved_to(0, 0);
+
+  if (resize_pipe[1] >= 0) {
+    resize_notify_fd = resize_pipe[1];
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sigwinch;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, &orig_sigwinch);
+  }
 
   enable_mouse();
+  // Ask whether synchronized updates are supported; read_key() picks up
+  // the reply whenever it arrives, and frames are unwrapped until then.
+  buffer += "\x1b[?2026$p";
+  flush();
 }
 
 void Terminal::cleanup() {
+  if (resize_notify_fd >= 0 && resize_notify_fd == resize_pipe[1]) {
+    sigaction(SIGWINCH, &orig_sigwinch, nullptr);
+    resize_notify_fd = -1;
+  }
   disable_mouse();
   disable_raw_mode();
   restore_terminal();
@@ -274,6 +387,24 @@ int Terminal::read_key() {
             return '\x1b';
           }
         }
+      } else if (seq[1] == '?') {
+        // Private mode report (DECRPM, "ESC[?2026;2$y") answering the query
+        // from init(); not a key.
+        std::string report;
+        char next;
+        while (read_char_with_timeout(next, 5)) {
+          report += next;
+          if (next >= 0x40 && next <= 0x7E) {
+            break;
+          }
+        }
+        int mode = 0;
+        int state = 0;
+        if (sscanf(report.c_str(), "%d;%d$y", &mode, &state) == 2 &&
+            mode == 2026) {
+          sync_output = state == 1 || state == 2;
+        }
+        return -1;
       } else if (seq[1] == '<') {
         // Mouse
         mouse_event_buffer.clear();
@@ -377,13 +508,23 @@ void Terminal::parse_mouse_event(int ch, MouseEvent &event) {
 }
 
 Event Terminal::poll_event() {
-  Event ev;
+  struct pollfd pfds[2];
+  pfds[0].fd = STDIN_FILENO;
+  pfds[0].events = POLLIN;
+  pfds[0].revents = 0;
+  pfds[1].fd = wake_pipe[0];
+  pfds[1].events = POLLIN;
+  pfds[1].revents = 0;
+  poll(pfds, wake_pipe[0] >= 0 ? 2 : 1, std::max(0, poll_timeout_ms));
+  return read_event();
+}
 
-  struct pollfd pfd;
-  pfd.fd = STDIN_FILENO;
-  pfd.events = POLLIN;
-  pfd.revents = 0;
-  poll(&pfd, 1, std::max(0, poll_timeout_ms));
+int Terminal::input_fd() const { return STDIN_FILENO; }
+
+Event Terminal::read_event() {
+  Event ev;
+  drain_pipe(wake_pipe[0]);
+  drain_pipe(resize_pipe[0]);
 
   // Check for terminal resize first (even when no input)
   struct winsize ws;
@@ -391,6 +532,7 @@ Event Terminal::poll_event() {
     if (ws.ws_col != width || ws.ws_row != height) {
       width = std::max(1, (int)ws.ws_col);
       height = std::max(1, (int)ws.ws_row);
+      encoder.set_columns(width);
       ev.type = EVENT_RESIZE;
       ev.resize.width = width;
       ev.resize.height = height;
@@ -463,36 +605,74 @@ void Terminal::set_poll_timeout_ms(int timeout_ms) {
   poll_timeout_ms = std::clamp(timeout_ms, 1, 250);
 }
 
+void Terminal::wake() {
+  if (wake_pipe[1] >= 0) {
+    const char byte = 1;
+    // A full pipe already guarantees a wakeup.
+    (void)!::write(wake_pipe[1], &byte, 1);
+  }
+}
+
 void Terminal::flush() {
-  fwrite(buffer.c_str(), 1, buffer.length(), stdout);
-  fflush(stdout);
+  if (buffer.empty()) {
+    return;
+  }
+  static const char kBeginSync[] = "\x1b[?2026h";
+  static const char kEndSync[] = "\x1b[?2026l";
+  struct iovec parts[3];
+  int count = 0;
+  if (sync_output) {
+    parts[count++] = {(void *)kBeginSync, sizeof(kBeginSync) - 1};
+  }
+  parts[count++] = {(void *)buffer.data(), buffer.size()};
+  if (sync_output) {
+    parts[count++] = {(void *)kEndSync, sizeof(kEndSync) - 1};
+  }
+  stats.syscalls += write_fully(STDOUT_FILENO, parts, count);
+  stats.writes++;
+  stats.bytes += buffer.size();
+  stats.last_write_bytes = buffer.size();
+  stats.peak_write_bytes = std::max(stats.peak_write_bytes, buffer.size());
   buffer.clear();
 }
 
+void Terminal::draw_cells(const GlyphTable &glyphs, const Cell *row,
+                          const Cell *shown, int y, int x0, int x1) {
+  encoder.encode_span(buffer, glyphs, row, shown, y, x0, x1);
+}
+
 void Terminal::clear() {
   buffer += "\x1b[2J";
   buffer += "\x1b[H";
+  encoder.cursor_moved_to(0, 0);
 }
 
-void Terminal::move_cursor(int x, int y) {
-  char buf[32];
-  snprintf(buf, sizeof(buf), "\x1b[%d;%dH", y + 1, x + 1);
-  buffer += buf;
-}
+void Terminal::move_cursor(int x, int y) { encoder.move_to(buffer, x, y); }
 
 void Terminal::hide_cursor() { buffer += "\x1b[?25l"; }
 
 void Terminal::show_cursor() { buffer += "\x1b[?25h"; }
 
+void Terminal::set_cursor_style(int style) {
+  buffer += "\x1b[";
+  buffer += std::to_string(style);
+  buffer += " q";
+}
+
 void Terminal::set_color(int fg, int bg) {
   char buf[32];
   snprintf(buf, sizeof(buf), "\x1b[38;5;%dm\x1b[48;5;%dm", fg, bg);
   buffer += buf;
+  encoder.forget_style();
 }
 
-void Terminal::reset_color() { buffer += "\x1b[0m"; }
+void Terminal::reset_color() {
+  buffer += "\x1b[0m";
+  encoder.style_was_reset();
+}
 
 void Terminal::set_bold(bool on) {
+  encoder.forget_style();
   if (on) {
     buffer += "\x1b[1m";
   } else {
@@ -501,6 +681,7 @@ void Terminal::set_bold(bool on) {
 }
 
 void Terminal::set_italic(bool on) {
+  encoder.forget_style();
   if (on) {
     buffer += "\x1b[3m";
   } else {
@@ -509,6 +690,7 @@ void Terminal::set_italic(bool on) {
 }
 
 void Terminal::set_reverse(bool on) {
+  encoder.forget_style();
   if (on) {
     buffer += "\x1b[7m";
   } else {
@@ -516,16 +698,22 @@ void Terminal::set_reverse(bool on) {
   }
 }
 
-void Terminal::write(const std::string &str) { buffer += str; }
+// Text of unknown width moves the cursor somewhere the encoder cannot tell.
+void Terminal::write(const std::string &str) {
+  buffer += str;
+  encoder.forget_cursor();
+}
 
-void Terminal::write_char(char c) { buffer += c; }
+void Terminal::write_char(char c) {
+  buffer += c;
+  encoder.forget_cursor();
+}
 
 void Terminal::enable_mouse() {
   buffer += "\x1b[?1000h";
   buffer += "\x1b[?1002h";
   buffer += "\x1b[?1015h";
   buffer += "\x1b[?1006h";
-  flush();
 }
 
 void Terminal::disable_mouse() {
@@ -533,12 +721,14 @@ void Terminal::disable_mouse() {
   buffer += "\x1b[?1015l";
   buffer += "\x1b[?1002l";
   buffer += "\x1b[?1000l";
-  flush();
 }
 
 void Terminal::save_cursor() { buffer += "\x1b[s"; }
 
-void Terminal::restore_cursor() { buffer += "\x1b[u"; }
+void Terminal::restore_cursor() {
+  buffer += "\x1b[u";
+  encoder.forget_cursor();
+}
 
 void Terminal::clear_line() { buffer += "\x1b[2K"; }
 
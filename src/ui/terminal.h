@@ -1,6 +1,8 @@
 #ifndef TERMINAL_H
 #define TERMINAL_H
 
+#include "screen_encoder.h"
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -35,12 +37,28 @@ struct Event {
 };
 
 class Terminal {
+public:
+  // Output handed to the tty. Each flush() that has output is one write,
+  // and normally one syscall; partial writes to a busy tty take more.
+  struct OutputStats {
+    std::uint64_t writes = 0;
+    std::uint64_t syscalls = 0;
+    std::uint64_t bytes = 0;
+    std::size_t last_write_bytes = 0;
+    std::size_t peak_write_bytes = 0;
+  };
+
 private:
   int width, height;
   int poll_timeout_ms;
   bool raw_mode;
+  bool sync_output = false; // DEC mode 2026, once the terminal reports it
   std::string buffer;
   std::string mouse_event_buffer;
+  int wake_pipe[2] = {-1, -1};
+  int resize_pipe[2] = {-1, -1}; // written by the SIGWINCH handler
+  ScreenEncoder encoder;
+  OutputStats stats;
 
   void enable_raw_mode();
   void disable_raw_mode();
@@ -59,14 +77,37 @@ public:
   int get_width() const { return width; }
   int get_height() const { return height; }
 
+  // Waits up to the poll timeout for input or a wake(), then read_event().
   Event poll_event();
+  // The next pending event without waiting; EVENT_REDRAW when there is
+  // none. Drains the wake and resize pipes.
+  Event read_event();
+  // Sources for an outside poll(); -1 where there is no such fd.
+  int input_fd() const;
+  int wake_fd() const { return wake_pipe[0]; }
+  int resize_fd() const { return resize_pipe[0]; }
   void set_poll_timeout_ms(int timeout_ms);
+  // Makes a pending or the next poll_event() return right away with
+  // EVENT_REDRAW. Safe to call from any thread.
+  void wake();
+  // Writes everything buffered since the last flush in one piece, inside
+  // synchronized-update markers when the terminal supports them, so a
+  // frame never shows half drawn.
   void flush();
+  bool synchronized_output() const { return sync_output; }
+  const OutputStats &output_stats() const { return stats; }
+  const ScreenEncoder::Stats &encoder_stats() const { return encoder.stats(); }
+
+  // Sends the cells of row y in [x0, x1) that differ from `shown`, with
+  // the cursor motion and SGR changes kept to a minimum.
+  void draw_cells(const GlyphTable &glyphs, const Cell *row, const Cell *shown,
+                  int y, int x0, int x1);
 
   void clear();
   void move_cursor(int x, int y);
   void hide_cursor();
   void show_cursor();
+  void set_cursor_style(int style); // DECSCUSR
   void set_color(int fg, int bg);
   void reset_color();
   void set_bold(bool on);
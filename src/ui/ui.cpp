@@ -54,19 +54,18 @@ std::string sanitized_cell_text(const std::string &ch) {
 }
 } // namespace
 
+namespace {
+const Cell kBlankCell = Cell::make(' ', 7, 0, 0);
+// Never equal to a drawn cell, so everything is sent on the next render.
+const Cell kUnknownCell = Cell::make(GlyphTable::kNone, 0, 0, 0);
+} // namespace
+
 UI::UI(Terminal *t)
     : term(t), width(80), height(24), cursor_x(-1), cursor_y(-1),
       cursor_hidden(true) {
-  grid.resize(height);
-  last_grid.resize(height);
-  for (int y = 0; y < height; y++) {
-    grid[y].resize(width);
-    last_grid[y].resize(width);
-    for (int x = 0; x < width; x++) {
-      grid[y][x] = {" ", 7, 0, false, false, false};
-      last_grid[y][x] = {"", -1, -1, false, false, false}; // Force redraw initially
-    }
-  }
+  grid.resize(width, height, kBlankCell);
+  last_grid.resize(width, height, kUnknownCell);
+  damage_all();
 }
 
 void UI::resize(int w, int h) {
@@ -75,16 +74,9 @@ void UI::resize(int w, int h) {
   cursor_x = -1;
   cursor_y = -1;
   cursor_hidden = true;
-  grid.resize(height);
-  last_grid.resize(height);
-  for (int y = 0; y < height; y++) {
-    grid[y].resize(width);
-    last_grid[y].resize(width);
-    for (int x = 0; x < width; x++) {
-      grid[y][x] = {" ", 7, 0, false, false, false};
-      last_grid[y][x] = {"", -1, -1, false, false, false};
-    }
-  }
+  grid.resize(width, height, kBlankCell);
+  last_grid.resize(width, height, kUnknownCell);
+  damage_all();
   term->clear(); // Clear only on resize
 }
 
@@ -92,123 +84,73 @@ void UI::invalidate() {
   cursor_x = -1;
   cursor_y = -1;
   cursor_hidden = true;
-  for (int y = 0; y < height; y++) {
-    for (int x = 0; x < width; x++) {
-      last_grid[y][x] = {"", -1, -1, false, false, false};
-    }
-  }
+  last_grid.fill(kUnknownCell);
+  damage_all();
   term->clear();
 }
 
 void UI::clear() {
-  for (auto &row : grid) {
-    for (auto &cell : row) {
-      cell = {" ", 7, 0, false, false, false};
-    }
-  }
+  grid.fill(kBlankCell);
+  damage_all();
 }
 
-void UI::set_cell(int x, int y, const UICell &cell) {
-  if (x >= 0 && x < width && y >= 0 && y < height) {
-    grid[y][x] = cell;
+void UI::clear_rect(const UIRect &rect) { fill_rect(rect, " ", 7, 0); }
+
+void UI::damage(const UIRect &rect) {
+  const int x0 = std::max(0, rect.x);
+  const int x1 = std::min(width, rect.x + rect.w);
+  if (x0 >= x1) {
+    return;
+  }
+  for (int y = std::max(0, rect.y); y < std::min(height, rect.y + rect.h);
+       y++) {
+    damage_span(y, x0, x1);
   }
 }
 
-UICell UI::get_cell(int x, int y) const {
+void UI::damage_all() { damage_spans.assign(height, {0, width}); }
+
+void UI::set_cell(int x, int y, const Cell &cell) {
   if (x >= 0 && x < width && y >= 0 && y < height) {
-    return grid[y][x];
+    grid.at(x, y) = cell;
+    damage_span(y, x, x + 1);
   }
-  return {" ", 7, 0, false, false, false};
 }
 
-void UI::render() {
-  // Remove full clear to prevent blinking
-  // term->clear();
-
-  int last_fg = -1, last_bg = -1;
-  bool last_bold = false, last_italic = false, last_reverse = false;
-  int draw_cursor_x = -1, draw_cursor_y = -1;
+std::uint32_t UI::glyph_for(const std::string &text) {
+  return glyphs.intern(sanitized_cell_text(text));
+}
 
+void UI::render() {
+  rows_rendered = 0;
   for (int y = 0; y < height; y++) {
-    int x = 0;
-    while (x < width) {
-      const auto &cell = grid[y][x];
-      if (cell == last_grid[y][x]) {
-        x++;
-        continue;
-      }
-
-      if (draw_cursor_y != y || draw_cursor_x != x) {
-        term->move_cursor(x, y);
-        draw_cursor_x = x;
-        draw_cursor_y = y;
-      }
-
-      if (cell.fg != last_fg || cell.bg != last_bg || cell.bold != last_bold ||
-          cell.italic != last_italic || cell.reverse != last_reverse) {
-        term->reset_color();
-        if (cell.bold)
-          term->set_bold(true);
-        if (cell.italic)
-          term->set_italic(true);
-        if (cell.reverse)
-          term->set_reverse(true);
-        term->set_color(cell.fg, cell.bg);
-        last_fg = cell.fg;
-        last_bg = cell.bg;
-        last_bold = cell.bold;
-        last_italic = cell.italic;
-        last_reverse = cell.reverse;
-      }
-
-      std::string run;
-      int run_start = x;
-      int run_end = x;
-      for (; run_end < width; run_end++) {
-        const auto &rc = grid[y][run_end];
-        if (rc == last_grid[y][run_end])
-          break;
-        if (rc.fg != cell.fg || rc.bg != cell.bg || rc.bold != cell.bold ||
-            rc.italic != cell.italic || rc.reverse != cell.reverse) {
-          break;
-        }
-        run += sanitized_cell_text(rc.ch);
-      }
-
-      if (run.empty()) {
-        run = sanitized_cell_text(cell.ch);
-        run_end = x + 1;
-      }
-
-      term->write(run);
-      draw_cursor_x += (run_end - run_start);
-
-      for (int i = run_start; i < run_end; i++) {
-        last_grid[y][i] = grid[y][i];
-      }
-      x = run_end;
+    const int x0 = damage_spans[y].x0;
+    const int x1 = damage_spans[y].x1;
+    if (x0 >= x1) {
+      continue;
     }
+    damage_spans[y] = {width, 0};
+    rows_rendered++;
+    term->draw_cells(glyphs, grid.row(y), last_grid.row(y), y, x0, x1);
+    last_grid.copy_span_from(grid, y, x0, x1);
   }
-
-  term->reset_color();
-  term->flush();
 }
 
 void UI::draw_text(int x, int y, const std::string &text, int fg, int bg,
                    bool bold, bool italic) {
+  if (y < 0 || y >= height) {
+    return;
+  }
+  const std::uint8_t attrs =
+      (std::uint8_t)((bold ? CELL_BOLD : 0) | (italic ? CELL_ITALIC : 0));
+  Cell cell = Cell::make(' ', fg, bg, attrs);
   int i = 0;
   int cell_offset = 0;
   while (i < (int)text.length() && x + cell_offset < width) {
     int char_len = utf8_char_len(text, i);
     if (char_len <= 0) {
-      UICell bad;
-      bad.ch = "?";
-      bad.fg = fg;
-      bad.bg = bg;
-      bad.bold = bold;
-      bad.italic = italic;
-      bad.reverse = false;
-      set_cell(x + cell_offset, y, bad);
+      cell.glyph = '?';
+      set_cell(x + cell_offset, y, cell);
       i += 1;
       cell_offset++;
       continue;
@@ -217,13 +159,9 @@ void UI::draw_text(int x, int y, const std::string &text, int fg, int bg,
       break;
     }
 
-    UICell cell;
-    cell.ch = sanitized_cell_text(text.substr(i, char_len));
-    cell.fg = fg;
-    cell.bg = bg;
-    cell.bold = bold;
-    cell.italic = italic;
-    cell.reverse = false;
+    // ASCII is its own glyph id; only wider characters go to the table.
+    cell.glyph = char_len == 1 ? (unsigned char)text[i]
+                               : glyph_for(text.substr(i, char_len));
     set_cell(x + cell_offset, y, cell);
 
     i += char_len;
@@ -231,64 +169,49 @@ void UI::draw_text(int x, int y, const std::string &text, int fg, int bg,
   }
 }
 
-void UI::draw_rect(const UIRect &rect, int fg, int bg) {
-  for (int y = rect.y; y < rect.y + rect.h && y < height; y++) {
-    for (int x = rect.x; x < rect.x + rect.w && x < width; x++) {
-      UICell cell;
-      cell.ch = " ";
-      cell.fg = fg;
-      cell.bg = bg;
-      cell.bold = false;
-      cell.italic = false;
-      cell.reverse = false;
-      set_cell(x, y, cell);
-    }
+void UI::draw_cells(int x, int y, const Cell *cells, int count,
+                    int max_width) {
+  if (y < 0 || y >= height) {
+    return;
   }
+  const int n = std::min({count, max_width, width - x});
+  for (int i = 0; i < n; i++) {
+    Cell cell = cells[i];
+    cell.glyph = glyphs.intern_code_point(cell.glyph);
+    set_cell(x + i, y, cell);
+  }
+}
+
+void UI::draw_rect(const UIRect &rect, int fg, int bg) {
+  fill_rect(rect, " ", fg, bg);
 }
 
 void UI::draw_border(const UIRect &rect, int fg, int bg) {
+  const std::uint32_t horizontal = glyph_for("─"); // U+2500
+  const std::uint32_t vertical = glyph_for("│");   // U+2502
+  const std::uint32_t top_left = glyph_for("┌");   // U+250C
+  const std::uint32_t top_right = glyph_for("┐");  // U+2510
+  const std::uint32_t bottom_left = glyph_for("└"); // U+2514
+  const std::uint32_t bottom_right = glyph_for("┘"); // U+2518
+  Cell cell = Cell::make(horizontal, fg, bg, 0);
+
   // Top and Bottom
   for (int x = rect.x; x < rect.x + rect.w && x < width; x++) {
-    UICell cell;
-    cell.ch = "─"; // U+2500
-    cell.fg = fg;
-    cell.bg = bg;
-    cell.bold = false;
-    cell.italic = false;
-    cell.reverse = false;
-
-    if (x == rect.x)
-      cell.ch = "┌"; // U+250C
-    else if (x == rect.x + rect.w - 1)
-      cell.ch = "┐"; // U+2510 (Top Right)
+    const bool left = x == rect.x;
+    const bool right = x == rect.x + rect.w - 1;
 
-    // Draw top
+    cell.glyph = left ? top_left : right ? top_right : horizontal;
     if (rect.y >= 0 && rect.y < height)
       set_cell(x, rect.y, cell);
 
-    // Prepare bottom corners
-    if (x == rect.x)
-      cell.ch = "└"; // U+2514
-    else if (x == rect.x + rect.w - 1)
-      cell.ch = "┘"; // U+2518
-    else
-      cell.ch = "─";
-
-    // Draw bottom
+    cell.glyph = left ? bottom_left : right ? bottom_right : horizontal;
     if (rect.y + rect.h - 1 < height && rect.y + rect.h - 1 >= 0)
       set_cell(x, rect.y + rect.h - 1, cell);
   }
 
   // Left and Right (excluding corners which are already drawn)
+  cell.glyph = vertical;
   for (int y = rect.y + 1; y < rect.y + rect.h - 1 && y < height; y++) {
-    UICell cell;
-    cell.ch = "│"; // U+2502
-    cell.fg = fg;
-    cell.bg = bg;
-    cell.bold = false;
-    cell.italic = false;
-    cell.reverse = false;
-
     if (rect.x >= 0 && rect.x < width)
       set_cell(rect.x, y, cell);
 
@@ -298,17 +221,18 @@ void UI::draw_border(const UIRect &rect, int fg, int bg) {
 }
 
 void UI::fill_rect(const UIRect &rect, const std::string &ch, int fg, int bg) {
-  for (int y = rect.y; y < rect.y + rect.h && y < height; y++) {
-    for (int x = rect.x; x < rect.x + rect.w && x < width; x++) {
-      UICell cell;
-      cell.ch = ch;
-      cell.fg = fg;
-      cell.bg = bg;
-      cell.bold = false;
-      cell.italic = false;
-      cell.reverse = false;
-      set_cell(x, y, cell);
-    }
+  const Cell cell = Cell::make(glyph_for(ch), fg, bg, 0);
+  const int x0 = std::max(0, rect.x);
+  const int x1 = std::min(width, rect.x + rect.w);
+  const int y0 = std::max(0, rect.y);
+  const int y1 = std::min(height, rect.y + rect.h);
+  if (x0 >= x1) {
+    return;
+  }
+  for (int y = y0; y < y1; y++) {
+    Cell *row = grid.row(y);
+    std::fill(row + x0, row + x1, cell);
+    damage_span(y, x0, x1);
   }
 }
 
@@ -316,10 +240,12 @@ void UI::set_cursor(int x, int y) {
   if (x >= 0 && x < width && y >= 0 && y < height) {
     // Always reposition cursor after a frame. Rendering moves terminal cursor
     // while diff-drawing cells, so cached coordinates may be stale even when
-    // logical cursor position is unchanged.
+    // logical cursor position is unchanged. The terminal knows where the
+    // frame left it and sends nothing if that is already the spot.
     term->move_cursor(x, y);
-    term->show_cursor();
-    term->flush();
+    if (cursor_hidden) {
+      term->show_cursor();
+    }
     cursor_x = x;
     cursor_y = y;
     cursor_hidden = false;
@@ -331,6 +257,5 @@ void UI::hide_cursor() {
     return;
   }
   term->hide_cursor();
-  term->flush();
   cursor_hidden = true;
 }
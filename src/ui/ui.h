@@ -1,7 +1,10 @@
 #ifndef UI_H
 #define UI_H
 
+#include "cell_grid.h"
 #include "terminal.h"
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -10,44 +13,54 @@ struct UIRect {
   int x, y, w, h;
 };
 
-struct UICell {
-  std::string ch;
-  int fg;
-  int bg;
-  bool bold;
-  bool italic;
-  bool reverse;
-
-  bool operator==(const UICell &other) const {
-    return ch == other.ch && fg == other.fg && bg == other.bg &&
-           bold == other.bold && italic == other.italic &&
-           reverse == other.reverse;
-  }
-  bool operator!=(const UICell &other) const { return !(*this == other); }
-};
-
 class UI {
 private:
   Terminal *term;
-  std::vector<std::vector<UICell>> grid;
-  std::vector<std::vector<UICell>> last_grid;
+  GlyphTable glyphs;
+  CellGrid grid;
+  CellGrid last_grid; // what the terminal shows
+  // Columns [x0, x1) of each row that may differ from last_grid. Drawing
+  // extends them; render() compares only these and resets them.
+  struct RowDamage {
+    int x0, x1;
+  };
+  std::vector<RowDamage> damage_spans;
+  int rows_rendered = 0;
   int width, height;
   int cursor_x, cursor_y;
   bool cursor_hidden;
 
-  void set_cell(int x, int y, const UICell &cell);
-  UICell get_cell(int x, int y) const;
+  void set_cell(int x, int y, const Cell &cell);
+  void damage_span(int y, int x0, int x1) {
+    RowDamage &span = damage_spans[y];
+    span.x0 = std::min(span.x0, x0);
+    span.x1 = std::max(span.x1, x1);
+  }
+  std::uint32_t glyph_for(const std::string &text);
 
 public:
   UI(Terminal *t);
   void resize(int w, int h);
   void invalidate();
 
+  // Blanks the whole grid. Components that are not redrawn every frame
+  // use clear_rect() on their own area instead, so the cells of others are
+  // kept and not compared again.
   void clear();
+  void clear_rect(const UIRect &rect);
+  void damage(const UIRect &rect);
+  void damage_all();
   void render();
+  // Sends the frame built by render() and the cursor calls in one write.
+  void present() { term->flush(); }
+  // Rows the last render() had to compare.
+  int last_rendered_rows() const { return rows_rendered; }
 
   void draw_text(int x, int y, const std::string &text, int fg = 7, int bg = 0,
                  bool bold = false, bool italic = false);
+  // Cells whose glyphs are Unicode code points, as terminal screens hold
+  // them, clipped to max_width columns.
+  void draw_cells(int x, int y, const Cell *cells, int count, int max_width);
   void draw_rect(const UIRect &rect, int fg, int bg);
   void draw_border(const UIRect &rect, int fg, int bg);
   void fill_rect(const UIRect &rect, const std::string &ch, int fg, int bg);
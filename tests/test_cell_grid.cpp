@@ -0,0 +1,50 @@
+#include "cell_grid.h"
+#include "test_framework.h"
+#include <string>
+
+TEST(TestGlyphTableInternsNonAscii) {
+  GlyphTable glyphs;
+  ASSERT_EQ(glyphs.intern("a"), (std::uint32_t)'a');
+  ASSERT_EQ(glyphs.size(), (std::size_t)0);
+  const std::uint32_t box = glyphs.intern("─");
+  ASSERT_TRUE(box >= 0x80);
+  ASSERT_EQ(glyphs.intern("─"), box);
+  ASSERT_TRUE(glyphs.intern("完") != box);
+  ASSERT_EQ(std::string(glyphs.text(box)), std::string("─"));
+  ASSERT_EQ(std::string(glyphs.text('a')), std::string("a"));
+  ASSERT_TRUE(glyphs.text(GlyphTable::kNone).empty());
+}
+
+TEST(TestCellGridFindsFirstDifference) {
+  const Cell blank = Cell::make(' ', 7, 0, 0);
+  CellGrid a;
+  CellGrid b;
+  a.resize(37, 2, blank);
+  b.resize(37, 2, blank);
+  ASSERT_TRUE(a.row_equals(b, 0));
+  ASSERT_EQ(first_cell_difference(a.row(0), b.row(0), 0, 37), 37);
+
+  // Style-only changes count, in both the 4-cell blocks and the tail.
+  a.at(9, 0) = Cell::make(' ', 7, 0, CELL_BOLD);
+  a.at(35, 0) = Cell::make(' ', 300, 0, 0);
+  ASSERT_TRUE(!a.row_equals(b, 0));
+  ASSERT_TRUE(a.row_equals(b, 1));
+  ASSERT_EQ(first_cell_difference(a.row(0), b.row(0), 0, 37), 9);
+  ASSERT_EQ(first_cell_difference(a.row(0), b.row(0), 10, 37), 35);
+  ASSERT_EQ(a.at(35, 0).fg, 255);
+
+  b.copy_row_from(a, 0);
+  ASSERT_TRUE(a.row_equals(b, 0));
+}
+
+TEST(TestGlyphTableInternsCodePoints) {
+  GlyphTable glyphs;
+  ASSERT_EQ(glyphs.intern_code_point('a'), (std::uint32_t)'a');
+  ASSERT_EQ(glyphs.intern_code_point(0x2500), glyphs.intern("─"));
+  ASSERT_EQ(glyphs.intern_code_point(0x2500), glyphs.intern("─"));
+  ASSERT_EQ(glyphs.size(), (std::size_t)1);
+  ASSERT_EQ(glyphs.intern_code_point(0x1B), (std::uint32_t)'?');
+  ASSERT_EQ(glyphs.intern_code_point(0x9B), (std::uint32_t)'?');
+  ASSERT_EQ(glyphs.intern_code_point(0xD800), (std::uint32_t)'?');
+  ASSERT_EQ(glyphs.intern_code_point(0x110000), (std::uint32_t)'?');
+}
@@ -0,0 +1,128 @@
+#include "content_search.h"
+#include "test_framework.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+const char *naive_find(const std::string &hay, const std::string &needle) {
+  const std::size_t at = hay.find(needle);
+  return at == std::string::npos ? nullptr : hay.data() + at;
+}
+
+void write(const fs::path &path, const std::string &text) {
+  fs::create_directories(path.parent_path());
+  std::ofstream(path, std::ios::binary) << text;
+}
+
+std::shared_ptr<const ContentSearchResults> wait_done(const ContentSearch &search) {
+  const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  auto results = search.results();
+  while (!(results->generation == search.generation() && results->done) &&
+         std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    results = search.results();
+  }
+  return results;
+}
+} // namespace
+
+TEST(TestLiteralFinderAgreesWithNaiveSearch) {
+  std::string hay;
+  for (int i = 0; i < 300; i++) {
+    hay += static_cast<char>('a' + (i * 7) % 26);
+  }
+  hay += "needle";
+  const LiteralFinder finder("needle");
+  ASSERT_TRUE(!finder.case_sensitive());
+  // Many start offsets and lengths, so both the vector loop and the tail
+  // see the match at many alignments.
+  for (std::size_t from = 0; from < hay.size(); from += 13) {
+    for (std::size_t to = from; to <= hay.size(); to += 5) {
+      const std::string part = hay.substr(from, to - from);
+      const char *expect = naive_find(part, "needle");
+      const char *got = finder.find(part.data(), part.data() + part.size());
+      ASSERT_EQ(got == nullptr, expect == nullptr);
+      if (got) {
+        ASSERT_EQ(got - part.data(), expect - part.data());
+      }
+    }
+  }
+
+  const std::string mixed = "xx NEEDLE yy Needle";
+  ASSERT_EQ(finder.find(mixed.data(), mixed.data() + mixed.size()) -
+                mixed.data(),
+            3);
+  const LiteralFinder exact("Needle");
+  ASSERT_TRUE(exact.case_sensitive());
+  ASSERT_EQ(exact.find(mixed.data(), mixed.data() + mixed.size()) -
+                mixed.data(),
+            13);
+  // Case folding must not make '@' match '`' or '[' match '{'.
+  const std::string punct = "@[";
+  const LiteralFinder brace("`{");
+  ASSERT_TRUE(brace.find(punct.data(), punct.data() + punct.size()) == nullptr);
+}
+
+TEST(TestContentSearchHonorsGitIgnoreAndSkipsBinaries) {
+  const fs::path root = fs::temp_directory_path() / "jot-test-content-search";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  write(root / ".gitignore", "gen/\n*.log\n");
+  write(root / "a.txt", "nothing here\r\nfind Marker one\r\n");
+  write(root / "bin.dat", std::string("marker\0binary", 13));
+  write(root / "gen" / "out.txt", "marker in ignored dir\n");
+  write(root / "src" / ".gitignore", "!keep.log\n");
+  write(root / "src" / "keep.log", "a\nb\n  MARKER two\n");
+  write(root / "src" / "skip.log", "marker\n");
+  write(root / "src" / "z.cpp", "marker marker\nmarker\n");
+
+  auto snap = std::make_shared<FileIndexSnapshot>();
+  snap->root = root.string();
+  for (const char *path : {"a.txt", "bin.dat", "gen", "gen/out.txt", "src",
+                           "src/keep.log", "src/skip.log", "src/z.cpp"}) {
+    snap->append(path, fs::is_directory(root / path));
+  }
+  snap->complete = true;
+
+  const std::vector<std::uint32_t> files = content_search_files(*snap, "");
+  ASSERT_EQ(files.size(), 4u); // a.txt, bin.dat, src/keep.log, src/z.cpp
+
+  ContentSearch search;
+  search.start(snap, "", "marker", 100);
+  auto results = wait_done(search);
+  ASSERT_TRUE(results->done);
+  ASSERT_EQ(results->files_searched, 4u);
+  ASSERT_EQ(results->matches.size(), 4u);
+  ASSERT_EQ(results->matches[0].path, std::string("a.txt"));
+  ASSERT_EQ(results->matches[0].line, 1u);
+  ASSERT_EQ(results->matches[0].column, 5u);
+  ASSERT_EQ(results->matches[0].text, std::string("find Marker one"));
+  ASSERT_EQ(results->matches[1].path, std::string("src/keep.log"));
+  ASSERT_EQ(results->matches[1].line, 2u);
+  ASSERT_EQ(results->matches[2].path, std::string("src/z.cpp"));
+  ASSERT_EQ(results->matches[2].line, 0u);
+  ASSERT_EQ(results->matches[3].line, 1u);
+
+  // Smart case: an uppercase letter makes the search exact.
+  search.start(snap, "src", "MARKER", 100);
+  results = wait_done(search);
+  ASSERT_EQ(results->matches.size(), 1u);
+  ASSERT_EQ(results->matches[0].path, std::string("src/keep.log"));
+
+  search.start(snap, "", "marker", 2);
+  results = wait_done(search);
+  ASSERT_EQ(results->matches.size(), 2u);
+  ASSERT_TRUE(results->truncated);
+
+  search.cancel();
+  ASSERT_TRUE(search.generation() > results->generation);
+  fs::remove_all(root, ec);
+}
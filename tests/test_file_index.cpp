@@ -0,0 +1,138 @@
+#include "file_index.h"
+#include "test_framework.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+namespace fs = std::filesystem;
+
+std::vector<std::string> all_paths(const FileIndexSnapshot &snap) {
+  std::vector<std::string> out;
+  for (std::size_t i = 0; i < snap.size(); i++) {
+    out.push_back(std::string(snap.path(i)) + (snap.is_directory(i) ? "/" : ""));
+  }
+  return out;
+}
+
+// Polls the index until `done` holds for its snapshot, for up to 5 s.
+template <typename Pred>
+std::shared_ptr<const FileIndexSnapshot> wait_for(const FileIndex &index,
+                                                  Pred done) {
+  const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  auto snap = index.snapshot();
+  while (!done(*snap) && std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    snap = index.snapshot();
+  }
+  return snap;
+}
+
+void touch(const fs::path &path) {
+  fs::create_directories(path.parent_path());
+  std::ofstream(path) << "x\n";
+}
+} // namespace
+
+TEST(TestFileIndexSnapshotKeepsTreeOrder) {
+  ASSERT_TRUE(file_index_path_less("a", "a/b"));
+  ASSERT_TRUE(file_index_path_less("a/z", "a-b"));
+  ASSERT_TRUE(!file_index_path_less("a-b", "a/z"));
+
+  FileIndexSnapshot snap;
+  snap.append("Src", true);
+  snap.append("Src/Main.cpp", false);
+  snap.append("Src/util", true);
+  snap.append("Src/util/Str.h", false);
+  snap.append("Src-old", false);
+  snap.append("readme", false);
+  ASSERT_EQ(snap.lower_path(1), std::string_view("src/main.cpp"));
+  ASSERT_EQ(snap.name(3), std::string_view("Str.h"));
+  ASSERT_EQ(snap.lower_name(3), std::string_view("str.h"));
+  ASSERT_EQ(snap.find("Src/util"), 2u);
+  ASSERT_EQ(snap.find("Src/utils"), FileIndexSnapshot::npos);
+  ASSERT_EQ(snap.lower_bound("Src/A"), 1u);
+  using Range = std::pair<std::size_t, std::size_t>;
+  ASSERT_TRUE(snap.subtree("Src") == Range(1, 4));
+  ASSERT_TRUE(snap.subtree("Src/util") == Range(3, 4));
+  ASSERT_TRUE(snap.subtree("") == Range(0, 6));
+
+  FileIndexSnapshot copy;
+  copy.append_range(snap, 2, 5);
+  ASSERT_EQ(copy.size(), 3u);
+  ASSERT_EQ(copy.path(2), std::string_view("Src-old"));
+  ASSERT_EQ(copy.lower_name(1), std::string_view("str.h"));
+
+  // Entry lengths are 16-bit; a longer path is refused, not truncated.
+  const std::string deep = "Src/" + std::string(0x10000, 'x');
+  ASSERT_TRUE(!copy.append(deep, false));
+  ASSERT_TRUE(copy.append(deep.substr(0, 0xFFFF), false));
+  ASSERT_EQ(copy.size(), 4u);
+  ASSERT_EQ(copy.path(3).size(), (std::size_t)0xFFFF);
+}
+
+TEST(TestFileIndexRankerBonusNeedsSubstring) {
+  FileIndexSnapshot snap;
+  snap.append("telescope_x_results", false);
+  snap.append("telescoperesults.h", false);
+  FileIndexRanker ranker(snap, "", "telescoperesults");
+  const FuzzyPattern pattern("telescoperesults");
+  // Scores as high as a substring would, without being one.
+  const int gapped = pattern.score("telescope_x_results");
+  ASSERT_TRUE(gapped >= 300);
+  ASSERT_EQ(ranker.score(0), gapped * 3);
+  ASSERT_EQ(ranker.score(1), 300 * 3 + 30);
+}
+
+TEST(TestFileIndexScansAndFollowsChanges) {
+  const fs::path root = fs::temp_directory_path() / "jot-test-file-index";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  touch(root / "b.txt");
+  touch(root / "a" / "deep" / "deeper" / "deepest" / "x" / "y.cpp");
+  touch(root / "a" / "one.h");
+  touch(root / ".hidden" / "skip.txt");
+  touch(root / "node_modules" / "skip.js");
+
+  FileIndex index;
+  index.set_root(root.string());
+  auto snap = wait_for(index, [](const FileIndexSnapshot &s) { return s.complete; });
+  ASSERT_TRUE(snap->complete);
+  ASSERT_EQ(snap->root, root.string());
+  // No depth limit; hidden and build/vendor directories are left out.
+  const std::vector<std::string> expected = {
+      "a/",
+      "a/deep/",
+      "a/deep/deeper/",
+      "a/deep/deeper/deepest/",
+      "a/deep/deeper/deepest/x/",
+      "a/deep/deeper/deepest/x/y.cpp",
+      "a/one.h",
+      "b.txt"};
+  ASSERT_TRUE(all_paths(*snap) == expected);
+
+#if defined(__linux__)
+  touch(root / "a" / "new" / "n.txt");
+  touch(root / "c.txt");
+  fs::remove_all(root / "a" / "deep");
+  fs::rename(root / "b.txt", root / "a" / "b2.txt");
+  const std::vector<std::string> after = {"a/", "a/b2.txt", "a/new/",
+                                          "a/new/n.txt", "a/one.h", "c.txt"};
+  snap = wait_for(index, [&](const FileIndexSnapshot &s) {
+    return all_paths(s) == after;
+  });
+  ASSERT_TRUE(all_paths(*snap) == after);
+
+  // Directories created after the first scan are watched too.
+  touch(root / "a" / "new" / "m.txt");
+  snap = wait_for(index, [](const FileIndexSnapshot &s) {
+    return s.find("a/new/m.txt") != FileIndexSnapshot::npos;
+  });
+  ASSERT_TRUE(snap->find("a/new/m.txt") != FileIndexSnapshot::npos);
+#endif
+  fs::remove_all(root, ec);
+}
@@ -0,0 +1,93 @@
+#include "file_loader.h"
+#include "test_framework.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+TEST(TestSplitLines) {
+  std::vector<std::string> lines;
+  const std::string text = "one\r\ntwo\n\nthree\r";
+  split_lines(text.data(), text.size(), lines);
+  ASSERT_EQ(lines.size(), (std::size_t)4);
+  ASSERT_EQ(lines[0], std::string("one"));
+  ASSERT_EQ(lines[1], std::string("two"));
+  ASSERT_EQ(lines[2], std::string(""));
+  ASSERT_EQ(lines[3], std::string("three"));
+
+  lines.clear();
+  split_lines("a\n", 2, lines);
+  ASSERT_EQ(lines.size(), (std::size_t)1);
+  lines.clear();
+  split_lines("", 0, lines);
+  ASSERT_TRUE(lines.empty());
+}
+
+TEST(TestLoadFileLines) {
+  const fs::path root = fs::temp_directory_path() / "jot-test-file-loader";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  const fs::path file = root / "big.log";
+  // Large enough to be split in parallel and in several slices.
+  {
+    std::ofstream out(file, std::ios::binary);
+    for (int i = 0; i < 600000; i++) {
+      out << "line " << i << " of the log" << (i % 7 == 0 ? "\r\n" : "\n");
+    }
+    out << "tail without newline";
+  }
+
+  LineStore lines = {"stale"};
+  ASSERT_TRUE(load_file_lines(file.string(), lines));
+  ASSERT_EQ(lines.size(), (std::size_t)600001);
+  ASSERT_EQ(lines[0], std::string("line 0 of the log"));
+  ASSERT_EQ(lines[314159], std::string("line 314159 of the log"));
+  ASSERT_EQ(lines[600000], std::string("tail without newline"));
+  ASSERT_TRUE(!load_file_lines((root / "missing").string(), lines));
+  ASSERT_EQ(lines.size(), (std::size_t)600001);
+
+  BackgroundFileLoad load(file.string(), nullptr);
+  std::vector<std::string> streamed;
+  while (!load.done()) {
+    load.take(streamed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(!load.failed());
+  ASSERT_EQ(streamed.size(), (std::size_t)600001);
+  ASSERT_EQ(streamed[314159], std::string("line 314159 of the log"));
+  ASSERT_EQ(load.bytes_done(), load.bytes_total());
+  fs::remove_all(root, ec);
+}
+
+TEST(TestLoadedLinesStayOutOfUndoSteps) {
+  FileBuffer buf{};
+  buf.lines.push_back("");
+  State state{};
+
+  append_loaded_lines(buf, {"a", "b", "c"});
+  ASSERT_EQ(buf.lines.size(), (std::size_t)3);
+  ASSERT_EQ(buf.lines[0], std::string("a"));
+
+  // An edit whose undo step is still open when the next batch arrives.
+  buf.undo.record(buf.lines, 1, 1, state);
+  buf.lines.set(1, "B");
+  buf.lines.insert(buf.lines.begin() + 2, "new");
+  buf.modified = true;
+  append_loaded_lines(buf, {"d", "e"});
+  append_loaded_lines(buf, {"f"});
+  ASSERT_EQ(buf.lines.size(), (std::size_t)7);
+
+  ASSERT_TRUE(buf.undo.undo(buf.lines, state));
+  ASSERT_EQ(buf.lines.size(), (std::size_t)6);
+  ASSERT_EQ(buf.lines[1], std::string("b"));
+  ASSERT_EQ(buf.lines[2], std::string("c"));
+  ASSERT_EQ(buf.lines[5], std::string("f"));
+
+  ASSERT_TRUE(buf.undo.redo(buf.lines, state));
+  ASSERT_EQ(buf.lines.size(), (std::size_t)7);
+  ASSERT_EQ(buf.lines[2], std::string("new"));
+  ASSERT_EQ(buf.lines[6], std::string("f"));
+}
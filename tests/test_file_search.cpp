@@ -0,0 +1,88 @@
+#include "file_search.h"
+#include "test_framework.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// One directory of `count` files in tree order.
+std::shared_ptr<FileIndexSnapshot> make_snapshot(int count) {
+  auto snap = std::make_shared<FileIndexSnapshot>();
+  snap->root = "/search";
+  snap->append("src", true);
+  std::vector<std::string> names;
+  for (int i = 0; i < count; i++) {
+    names.push_back("src/" + std::string(i % 7 == 0 ? "Widget" : "other") +
+                    std::to_string(i) + (i % 3 == 0 ? ".cpp" : ".h"));
+  }
+  std::sort(names.begin(), names.end());
+  for (const auto &name : names) {
+    snap->append(name, false);
+  }
+  snap->complete = true;
+  return snap;
+}
+
+bool same_hits(const std::vector<FuzzyHit> &a, const std::vector<FuzzyHit> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); i++) {
+    if (a[i].index != b[i].index || a[i].score != b[i].score) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<const FileSearchResults> wait_done(const FileSearch &search) {
+  const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  auto results = search.results();
+  while (!(results->generation == search.generation() && results->done) &&
+         std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    results = search.results();
+  }
+  return results;
+}
+} // namespace
+
+TEST(TestFileIndexRankerInPiecesMatchesAtOnce) {
+  const auto snap = make_snapshot(5000);
+  const FileIndexRanker ranker(*snap, "src", "wcpp");
+  std::vector<FuzzyHit> best;
+  for (std::size_t from = ranker.first(); from < ranker.last(); from += 333) {
+    ranker.rank(from, std::min(ranker.last(), from + 333), 50, best);
+  }
+  ASSERT_TRUE(same_hits(best, rank_file_index(*snap, "src", "wcpp", 50)));
+  ASSERT_EQ(best.size(), 50u);
+}
+
+TEST(TestFileSearchStreamsAndCancels) {
+  const auto snap = make_snapshot(300000);
+  FileSearch search;
+  std::atomic<int> published{0};
+  search.set_ready_callback([&] { published++; });
+
+  // The first search is superseded at once and never shows up.
+  const std::uint64_t first = search.start(snap, "", "other", 100);
+  const std::uint64_t second = search.start(snap, "src", "widget1cpp", 100);
+  ASSERT_TRUE(second > first);
+  const auto results = wait_done(search);
+  ASSERT_EQ(results->generation, second);
+  ASSERT_TRUE(results->done);
+  ASSERT_EQ(results->searched, results->total);
+  ASSERT_EQ(results->total, snap->size() - 1);
+  ASSERT_TRUE(same_hits(results->hits,
+                        rank_file_index(*snap, "src", "widget1cpp", 100)));
+  ASSERT_TRUE(published >= 1);
+
+  search.cancel();
+  ASSERT_TRUE(search.generation() > second);
+  ASSERT_EQ(search.results()->generation, second);
+  search.set_ready_callback(nullptr);
+}
@@ -0,0 +1,75 @@
+#include "fuzzy_match.h"
+#include "test_framework.h"
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST(TestFuzzyPatternMatchesAndScores) {
+  const FuzzyPattern pattern("CmdP");
+  ASSERT_EQ(pattern.text(), std::string("cmdp"));
+  ASSERT_TRUE(pattern.matches("command_palette.cpp"));
+  ASSERT_TRUE(!pattern.matches("palette_cmd.h"));
+  ASSERT_TRUE(FuzzyPattern("").matches("anything"));
+  ASSERT_EQ(FuzzyPattern("main").score("main"), 500);
+  ASSERT_EQ(FuzzyPattern("main").score("src/main.cpp"), 300);
+  ASSERT_EQ(FuzzyPattern("xyz").score("main"), 0);
+  // A run at a word start beats the same letters scattered.
+  ASSERT_TRUE(FuzzyPattern("fi").score("src/file") >
+              FuzzyPattern("fi").score("src/of_i"));
+}
+
+TEST(TestFuzzyPrefilterKeepsEveryPossibleMatch) {
+  std::vector<std::string> texts;
+  std::vector<std::uint64_t> masks;
+  for (int i = 0; i < 1000; i++) {
+    std::string text = "f" + std::to_string(i * 7919 % 1000);
+    text += (i % 3 == 0) ? "_Index.cpp" : (i % 3 == 1 ? "/util.h" : "");
+    texts.push_back(text);
+    masks.push_back(fuzzy_char_mask(text));
+  }
+  for (const char *query : {"idx", "u7h", "f99", "zz", ".c", "_"}) {
+    const FuzzyPattern pattern(query);
+    std::vector<std::uint32_t> passed;
+    // Odd bounds exercise the scalar head and tail around the SIMD steps.
+    fuzzy_prefilter(masks.data(), 3, 997, pattern.mask(), passed);
+    std::size_t next = 0;
+    for (std::uint32_t i = 3; i < 997; i++) {
+      std::string lower = texts[i];
+      for (char &c : lower) {
+        c = (char)std::tolower((unsigned char)c);
+      }
+      const bool kept = next < passed.size() && passed[next] == i;
+      if (kept) {
+        next++;
+      }
+      ASSERT_TRUE(kept == ((masks[i] & pattern.mask()) == pattern.mask()));
+      if (pattern.matches(lower)) {
+        ASSERT_TRUE(kept);
+      }
+    }
+    ASSERT_EQ(next, passed.size());
+  }
+}
+
+TEST(TestFuzzyRankKeepsTheBestInOrder) {
+  // Enough candidates to be split across workers where there are cores.
+  const std::size_t count = 200000;
+  const auto hits = fuzzy_rank(
+      count, 50, nullptr, 0,
+      [](std::size_t i) { return i % 10 == 0 ? -1 : (int)(i % 1000); },
+      [](const FuzzyHit &a, const FuzzyHit &b) {
+        return a.score != b.score ? a.score > b.score : a.index < b.index;
+      });
+  ASSERT_EQ(hits.size(), 50u);
+  ASSERT_EQ(hits[0].score, 999);
+  ASSERT_EQ(hits[0].index, 999u);
+  ASSERT_EQ(hits[1].index, 1999u);
+  ASSERT_EQ(hits[49].score, 999);
+  ASSERT_EQ(hits[49].index, 49999u);
+
+  const auto none = fuzzy_rank(
+      count, 10, nullptr, 0, [](std::size_t) { return -1; },
+      [](const FuzzyHit &a, const FuzzyHit &b) { return a.score > b.score; });
+  ASSERT_TRUE(none.empty());
+}
@@ -0,0 +1,41 @@
+#include "gitignore.h"
+#include "test_framework.h"
+
+TEST(TestGitIgnoreGlob) {
+  ASSERT_TRUE(gitignore_glob_match("*.o", "main.o"));
+  ASSERT_TRUE(!gitignore_glob_match("*.o", "src/main.o"));
+  ASSERT_TRUE(gitignore_glob_match("src/*.o", "src/main.o"));
+  ASSERT_TRUE(gitignore_glob_match("?.txt", "a.txt"));
+  ASSERT_TRUE(!gitignore_glob_match("?.txt", "ab.txt"));
+  ASSERT_TRUE(gitignore_glob_match("**/gen", "gen"));
+  ASSERT_TRUE(gitignore_glob_match("**/gen", "a/b/gen"));
+  ASSERT_TRUE(gitignore_glob_match("docs/**/*.md", "docs/a/b/c.md"));
+  ASSERT_TRUE(gitignore_glob_match("docs/**/*.md", "docs/c.md"));
+  ASSERT_TRUE(gitignore_glob_match("out/**", "out/x/y"));
+  ASSERT_TRUE(gitignore_glob_match("file[0-9].log", "file7.log"));
+  ASSERT_TRUE(!gitignore_glob_match("file[!0-9].log", "file7.log"));
+  ASSERT_TRUE(gitignore_glob_match("\\*star", "*star"));
+  ASSERT_TRUE(!gitignore_glob_match("\\*star", "xstar"));
+}
+
+TEST(TestGitIgnoreRules) {
+  GitIgnoreRules rules;
+  rules.add_text("# comment\n"
+                 "*.log\n"
+                 "!keep.log\n"
+                 "build/\n"
+                 "/top.txt\n"
+                 "docs/tmp\n"
+                 "trailing   \r\n");
+  ASSERT_EQ(rules.match("a/debug.log", false), 1);
+  ASSERT_EQ(rules.match("a/keep.log", false), -1);
+  ASSERT_EQ(rules.match("build", true), 1);
+  ASSERT_EQ(rules.match("src/build", true), 1);
+  ASSERT_EQ(rules.match("build", false), 0);
+  ASSERT_EQ(rules.match("top.txt", false), 1);
+  ASSERT_EQ(rules.match("sub/top.txt", false), 0);
+  ASSERT_EQ(rules.match("docs/tmp", true), 1);
+  ASSERT_EQ(rules.match("x/docs/tmp", true), 0);
+  ASSERT_EQ(rules.match("trailing", false), 1);
+  ASSERT_EQ(rules.match("main.cpp", false), 0);
+}
@@ -0,0 +1,181 @@
+#include "line_store.h"
+#include "test_framework.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+bool same_lines(const LineStore &store, const std::vector<std::string> &ref) {
+  if (store.size() != ref.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < ref.size(); ++i) {
+    if (store[i] != ref[i]) {
+      return false;
+    }
+  }
+  return std::equal(store.begin(), store.end(), ref.begin());
+}
+} // namespace
+
+TEST(TestLineStoreMatchesVector) {
+  LineStore store;
+  std::vector<std::string> ref;
+  for (int i = 0; i < 5000; ++i) {
+    store.push_back("line " + std::to_string(i));
+    ref.push_back("line " + std::to_string(i));
+  }
+
+  // Deterministic mix of inserts and erases that forces block splits,
+  // merges and cross-block range erases.
+  unsigned seed = 12345;
+  for (int step = 0; step < 4000; ++step) {
+    seed = seed * 1103515245u + 12345u;
+    const std::size_t at = (seed >> 8) % (ref.size() + 1);
+    if (step % 3 != 0 || ref.size() < 10) {
+      const std::string line = "ins " + std::to_string(step);
+      store.insert(store.begin() + at, line);
+      ref.insert(ref.begin() + at, line);
+    } else {
+      const std::size_t first = std::min(at, ref.size() - 1);
+      const std::size_t count =
+          std::min<std::size_t>(ref.size() - first, (seed >> 4) % 1500);
+      store.erase(store.begin() + first, store.begin() + first + count);
+      ref.erase(ref.begin() + first, ref.begin() + first + count);
+    }
+  }
+  ASSERT_TRUE(same_lines(store, ref));
+}
+
+TEST(TestLineStoreAlgorithms) {
+  LineStore store = {"c", "a", "d", "b"};
+  std::sort(store.mut_begin(), store.mut_end());
+  ASSERT_EQ(store.join(','), "a,b,c,d");
+
+  std::rotate(store.mut_begin(), store.mut_begin() + 1, store.mut_end());
+  ASSERT_EQ(store.join(','), "b,c,d,a");
+
+  store.erase(store.begin() + 1);
+  store.pop_back();
+  ASSERT_EQ(store.join('\n'), "b\nd");
+  ASSERT_EQ(store.byte_size(), 2u);
+}
+
+TEST(TestLineStoreJournal) {
+  LineStore store = {"a", "b", "c"};
+  const auto id = store.journal_id();
+  const auto version = store.journal_version();
+
+  store.insert(store.begin() + 1, "x");
+  store.set(0, "changed"); // content edits are not journaled
+  store.erase(store.begin() + 2, store.begin() + 4);
+
+  std::vector<LineStore::Edit> edits;
+  ASSERT_TRUE(store.edits_since(version, edits));
+  ASSERT_EQ(edits.size(), 2u);
+  ASSERT_EQ(edits[0].index, 1u);
+  ASSERT_EQ(edits[0].count, 1);
+  ASSERT_EQ(edits[1].index, 2u);
+  ASSERT_EQ(edits[1].count, -2);
+  ASSERT_EQ(store.journal_id(), id);
+
+  LineStore copy = store;
+  ASSERT_TRUE(copy.journal_id() != id);
+  store = std::vector<std::string>{"fresh"};
+  ASSERT_TRUE(store.journal_id() != id);
+}
+
+TEST(TestLineStoreRevision) {
+  LineStore store({"a", "b"});
+  auto revision = store.revision();
+  ASSERT_EQ(store[0], "a");
+  ASSERT_EQ(store.front(), "a");
+  std::size_t bytes = 0;
+  for (const auto &line : store) {
+    bytes += line.size();
+  }
+  ASSERT_EQ(bytes, (std::size_t)2);
+  store.set(0, "a"); // same text
+  ASSERT_EQ(store.revision(), revision); // reads
+  ASSERT_EQ(store.touch_count(), 0u);
+
+  store.set(1, "changed");
+  ASSERT_TRUE(store.revision() != revision);
+  revision = store.revision();
+  *store.mut_begin() = "x";
+  ASSERT_TRUE(store.revision() != revision);
+  revision = store.revision();
+  store.push_back("c");
+  ASSERT_TRUE(store.revision() != revision);
+}
+
+TEST(TestLineStoreTouchLog) {
+  LineStore store({"a", "b", "c", "d", "e"});
+  ASSERT_EQ(store[2], "c");
+  ASSERT_EQ(store.touch_count(), 0u); // reads
+  const auto count = store.touch_count();
+
+  store.mut(1) += "1";
+  store.mut(2) += "2"; // grows the touch before
+  store.insert(store.begin(), "new");
+  *(store.mut_begin() + 4) = "x";
+
+  std::vector<LineStore::Touch> touches;
+  ASSERT_TRUE(store.touches_since(count, touches));
+  ASSERT_EQ(touches.size(), 2u);
+  ASSERT_EQ(touches[0].first, 1u);
+  ASSERT_EQ(touches[0].last, 3u);
+  ASSERT_EQ(touches[1].first, 4u);
+  ASSERT_EQ(touches[1].last, 5u);
+  ASSERT_EQ(touches[1].version, touches[0].version + 1);
+
+  // The last touch read is reported again, since it may have grown.
+  touches.clear();
+  ASSERT_TRUE(store.touches_since(store.touch_count(), touches));
+  ASSERT_EQ(touches.size(), 1u);
+  ASSERT_EQ(touches[0].first, 4u);
+}
+
+TEST(TestLineStoreAppend) {
+  LineStore store;
+  std::vector<std::string> ref;
+  store.push_back("first");
+  ref.push_back("first");
+  const std::uint64_t version = store.journal_version();
+  for (int round = 0; round < 3; ++round) {
+    std::vector<std::string> batch;
+    for (int i = 0; i < 1500; ++i) {
+      batch.push_back("batch " + std::to_string(round) + ":" +
+                      std::to_string(i));
+    }
+    ref.insert(ref.end(), batch.begin(), batch.end());
+    store.append(std::move(batch));
+  }
+  ASSERT_TRUE(same_lines(store, ref));
+  ASSERT_EQ(store[2500], ref[2500]);
+
+  std::vector<LineStore::Edit> edits;
+  ASSERT_TRUE(store.edits_since(version, edits));
+  ASSERT_EQ(edits.size(), 3u);
+  ASSERT_EQ(edits[1].index, 1501u);
+  ASSERT_EQ(edits[1].count, 1500);
+}
+
+TEST(TestLineStoreCopiesAreSnapshots) {
+  LineStore store;
+  std::vector<std::string> ref;
+  for (int i = 0; i < 3000; ++i) {
+    ref.push_back("line " + std::to_string(i));
+  }
+  store.append(ref);
+  const LineStore snapshot = store;
+  ASSERT_TRUE(snapshot == store);
+
+  store.set(10, "changed");
+  store.insert(store.begin() + 2000, "new");
+  store.erase(store.begin(), store.begin() + 5);
+  ASSERT_TRUE(same_lines(snapshot, ref));
+  ASSERT_EQ(store[5], "changed");
+  ASSERT_EQ(store[1995], "new");
+  ASSERT_TRUE(!(snapshot == store));
+}
@@ -0,0 +1,127 @@
+#include "json_reader.h"
+#include "lsp_protocol.h"
+#include "test_framework.h"
+#include <climits>
+#include <string>
+
+TEST(TestJsonReaderSkipsAndDecodes) {
+  const std::string text =
+      R"({"skip": {"a": [1, "]}", {"b": null}], "c": true},)"
+      R"( "plain": "abc", "escaped": "a\"b\\n\u00e9\ud83d\ude00",)"
+      R"( "n": -42.5e1, "flag": false})";
+  JsonReader reader(text);
+  ASSERT_TRUE(reader.begin_object());
+  std::string_view key;
+  std::string_view value;
+  ASSERT_TRUE(reader.next_key(key));
+  ASSERT_EQ(std::string(key), "skip");
+  ASSERT_TRUE(reader.skip(value));
+  ASSERT_EQ(std::string(value), R"({"a": [1, "]}", {"b": null}], "c": true})");
+
+  ASSERT_TRUE(reader.next_key(key));
+  ASSERT_TRUE(reader.read_string(value));
+  ASSERT_EQ(std::string(value), "abc");
+  // Unescaped strings are views into the input.
+  ASSERT_TRUE(value.data() > text.data() &&
+              value.data() < text.data() + text.size());
+
+  ASSERT_TRUE(reader.next_key(key));
+  ASSERT_TRUE(reader.read_string(value));
+  ASSERT_EQ(std::string(value), "a\"b\\n\xC3\xA9\xF0\x9F\x98\x80");
+
+  long long number = 0;
+  bool flag = true;
+  ASSERT_TRUE(reader.next_key(key));
+  ASSERT_TRUE(reader.read_int(number));
+  ASSERT_EQ(number, -42);
+  ASSERT_TRUE(reader.next_key(key));
+  ASSERT_TRUE(reader.read_bool(flag));
+  ASSERT_TRUE(!flag);
+  ASSERT_TRUE(!reader.next_key(key));
+  ASSERT_TRUE(!reader.failed());
+
+  JsonReader broken(R"({"a": [1, 2)");
+  ASSERT_TRUE(broken.begin_object());
+  ASSERT_TRUE(broken.next_key(key));
+  ASSERT_TRUE(!broken.skip());
+  ASSERT_TRUE(!broken.next_key(key));
+  ASSERT_TRUE(broken.failed());
+}
+
+TEST(TestJsonReaderRejectsOverflow) {
+  long long number = 0;
+  JsonReader largest("[9223372036854775807, -9223372036854775808]");
+  ASSERT_TRUE(largest.begin_array());
+  ASSERT_TRUE(largest.next_element());
+  ASSERT_TRUE(largest.read_int(number));
+  ASSERT_EQ(number, LLONG_MAX);
+  ASSERT_TRUE(largest.next_element());
+  ASSERT_TRUE(largest.read_int(number));
+  ASSERT_EQ(number, LLONG_MIN);
+
+  JsonReader twenty_digits("12345678901234567890");
+  ASSERT_TRUE(!twenty_digits.read_int(number));
+  ASSERT_TRUE(twenty_digits.failed());
+  JsonReader past_min("-9223372036854775809");
+  ASSERT_TRUE(!past_min.read_int(number));
+}
+
+TEST(TestLspProtocolDecodesMessages) {
+  LSPEnvelope envelope;
+  ASSERT_TRUE(read_lsp_envelope(
+      R"({"jsonrpc":"2.0","method":"textDocument/publishDiagnostics",)"
+      R"("params":{"uri":"file:///a.rs","version":3,"diagnostics":[)"
+      R"({"range":{"start":{"line":4,"character":2},)"
+      R"("end":{"line":4,"character":9}},"severity":2,"code":"E1",)"
+      R"("message":"unused \"x\"","relatedInformation":[]},)"
+      R"({"range":{"start":{"line":7,"character":1}},"message":"m"}]}})",
+      envelope));
+  ASSERT_EQ(envelope.method, "textDocument/publishDiagnostics");
+  ASSERT_TRUE(!envelope.has_id);
+  std::string uri;
+  std::vector<Diagnostic> diagnostics;
+  ASSERT_TRUE(read_lsp_diagnostics(envelope.params, uri, diagnostics));
+  ASSERT_EQ(uri, "file:///a.rs");
+  ASSERT_EQ((int)diagnostics.size(), 2);
+  ASSERT_EQ(diagnostics[0].line, 4);
+  ASSERT_EQ(diagnostics[0].end_col, 9);
+  ASSERT_EQ(diagnostics[0].severity, 2);
+  ASSERT_EQ(diagnostics[0].message, "unused \"x\"");
+  // A missing end collapses onto the start; severity defaults to error.
+  ASSERT_EQ(diagnostics[1].end_line, 7);
+  ASSERT_EQ(diagnostics[1].end_col, 1);
+  ASSERT_EQ(diagnostics[1].severity, 1);
+
+  ASSERT_TRUE(read_lsp_envelope(
+      R"({"jsonrpc":"2.0","id":12,"result":{"isIncomplete":false,"items":[)"
+      R"({"label":"push","kind":2,"insertTextFormat":2,)"
+      R"json("textEdit":{"newText":"push($0)","range":{"start":{"line":1,)json"
+      R"("character":4},"end":{"line":1,"character":6}}}},)"
+      R"({"label":"len","data":{"x":[1,2]}},{"insertText":"only"},{}]}})",
+      envelope));
+  ASSERT_TRUE(envelope.has_id);
+  ASSERT_EQ((int)envelope.id, 12);
+  std::vector<LSPCompletionItem> items;
+  ASSERT_TRUE(read_lsp_completion_items(envelope.result, items));
+  ASSERT_EQ((int)items.size(), 3);
+  ASSERT_EQ(items[0].insert_text, "push($0)");
+  ASSERT_TRUE(items[0].has_text_edit_range);
+  ASSERT_EQ(items[0].edit_end_char, 6);
+  ASSERT_EQ(items[0].insert_text_format, 2);
+  ASSERT_EQ(items[1].insert_text, "len");
+  ASSERT_EQ(items[2].label, "only");
+
+  ASSERT_EQ(read_lsp_text_sync_kind(
+                R"({"capabilities":{"textDocumentSync":{"change":2}}})"),
+            LSP_SYNC_INCREMENTAL);
+  ASSERT_EQ(read_lsp_text_sync_kind(R"({"capabilities":{"textDocumentSync":0}})"),
+            LSP_SYNC_NONE);
+  ASSERT_EQ(read_lsp_text_sync_kind(R"({"capabilities":{}})"), LSP_SYNC_FULL);
+
+  std::size_t length = 0;
+  ASSERT_TRUE(read_lsp_content_length(
+      "Content-Type: application/vscode-jsonrpc\r\nContent-Length: 123\r",
+      length));
+  ASSERT_EQ((int)length, 123);
+  ASSERT_TRUE(!read_lsp_content_length("Content-Type: x\r", length));
+}
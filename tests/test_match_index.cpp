@@ -0,0 +1,129 @@
+#include "match_index.h"
+#include "test_framework.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+namespace {
+std::string lower(std::string text) {
+  for (char &c : text) {
+    c = (char)std::tolower((unsigned char)c);
+  }
+  return text;
+}
+
+// What in-buffer find used to do: lowercase copies and std::string::find.
+std::vector<MatchIndex::Match> naive(const LineStore &lines,
+                                     const std::string &query,
+                                     bool case_sensitive) {
+  std::vector<MatchIndex::Match> out;
+  const std::string q = case_sensitive ? query : lower(query);
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    const std::string line = case_sensitive ? lines[i] : lower(lines[i]);
+    for (std::size_t pos = line.find(q); pos != std::string::npos;
+         pos = line.find(q, pos + 1)) {
+      out.push_back({(int)i, (int)pos});
+    }
+  }
+  return out;
+}
+
+void scan_all(MatchIndex &index, const LineStore &lines) {
+  index.sync(lines);
+  index.scan(lines, 0, lines.size() + 1);
+}
+
+LineStore make_lines(int count) {
+  LineStore lines;
+  for (int i = 0; i < count; i++) {
+    lines.push_back(i % 5 == 0 ? "  Widget widget_" + std::to_string(i)
+                               : "line " + std::to_string(i) + " widgets");
+  }
+  return lines;
+}
+} // namespace
+
+TEST(TestMatchIndexScansFromTheCursor) {
+  const LineStore lines = make_lines(3000);
+  MatchIndex index;
+  index.set_query(lines, "widget", false, false);
+  ASSERT_TRUE(!index.complete());
+
+  index.scan(lines, 2000, 100);
+  ASSERT_TRUE(index.scanned(2000, 2100));
+  ASSERT_TRUE(!index.scanned(1999, 2000));
+  ASSERT_EQ(index.matches().front().first, 2000);
+
+  // The rest wraps around to the top.
+  index.scan(lines, 2100, 3000);
+  ASSERT_TRUE(index.complete());
+  ASSERT_TRUE(index.matches() == naive(lines, "widget", false));
+}
+
+TEST(TestMatchIndexNarrowsAndRestarts) {
+  const LineStore lines = make_lines(500);
+  MatchIndex index;
+  index.set_query(lines, "widget_", false, false);
+  scan_all(index, lines);
+  index.set_query(lines, "widget_1", false, false);
+  ASSERT_TRUE(index.complete()); // narrowed, nothing to rescan
+  ASSERT_TRUE(index.matches() == naive(lines, "widget_1", false));
+
+  // Too many matches to recheck at once: scanned again from the cursor.
+  index.set_query(lines, "wid", false, false);
+  scan_all(index, lines);
+  index.set_query(lines, "widg", false, false);
+  ASSERT_TRUE(!index.complete());
+
+  index.set_query(lines, "Widget", true, false);
+  ASSERT_TRUE(!index.complete());
+  scan_all(index, lines);
+  ASSERT_TRUE(index.matches() == naive(lines, "Widget", true));
+
+  index.set_query(lines, "widget", false, true);
+  scan_all(index, lines);
+  ASSERT_EQ(index.matches().size(), 100u); // "Widget", not "widget_" or "widgets"
+}
+
+TEST(TestMatchIndexFollowsEdits) {
+  LineStore lines = make_lines(4000);
+  MatchIndex index;
+  index.set_query(lines, "widget", false, false);
+  scan_all(index, lines);
+
+  lines.set(10, "no match here");
+  lines.mut(11) += " WIDGET";
+  lines.insert(lines.begin() + 100, "widget inserted");
+  lines.erase(lines.begin() + 2000, lines.begin() + 2500);
+  lines.set(3000, "widget widget");
+  index.sync(lines);
+  ASSERT_TRUE(!index.complete());
+  ASSERT_TRUE(index.scanned(200, 1000)); // untouched lines stay scanned
+  index.scan(lines, 0, 100);
+  ASSERT_TRUE(index.complete());
+  ASSERT_TRUE(index.matches() == naive(lines, "widget", false));
+
+  // Sorting touches every line it moves.
+  std::sort(lines.mut_begin() + 50, lines.mut_begin() + 3000);
+  lines.push_back("widget at the end");
+  scan_all(index, lines);
+  ASSERT_TRUE(index.matches() == naive(lines, "widget", false));
+
+  lines = std::vector<std::string>{"fresh widget"};
+  scan_all(index, lines);
+  ASSERT_TRUE(index.matches() == naive(lines, "widget", false));
+}
+
+TEST(TestMatchIndexSeesRepeatedTouches) {
+  LineStore lines = make_lines(100);
+  MatchIndex index;
+  index.set_query(lines, "widget", false, false);
+  for (std::size_t i = 0; i < 30; i++) {
+    (void)lines[i]; // a redraw reading through a non-const store
+  }
+  scan_all(index, lines);
+  lines.mut(12) += " widget"; // inside the touch already read
+  scan_all(index, lines);
+  ASSERT_TRUE(index.matches() == naive(lines, "widget", false));
+}
@@ -0,0 +1,50 @@
+#include "mpsc_queue.h"
+#include "test_framework.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TestMpscQueueKeepsPerProducerOrder) {
+  MpscQueue<std::string> queue;
+  std::string value;
+  ASSERT_TRUE(!queue.pop(value));
+  queue.push("a");
+  queue.push("b");
+  ASSERT_TRUE(queue.pop(value));
+  ASSERT_EQ(value, "a");
+  ASSERT_TRUE(queue.pop(value));
+  ASSERT_EQ(value, "b");
+  ASSERT_TRUE(!queue.pop(value));
+
+  constexpr int kProducers = 4;
+  constexpr int kItems = 20000;
+  MpscQueue<int> numbers;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&numbers, p] {
+      for (int i = 0; i < kItems; ++i) {
+        numbers.push(p * kItems + i);
+      }
+    });
+  }
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  bool ordered = true;
+  while (received < kProducers * kItems) {
+    int item = 0;
+    if (!numbers.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    const int producer = item / kItems;
+    ordered = ordered && item % kItems == next[producer];
+    next[producer] = item % kItems + 1;
+    ++received;
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  ASSERT_TRUE(ordered);
+  int leftover = 0;
+  ASSERT_TRUE(!numbers.pop(leftover));
+}
@@ -0,0 +1,61 @@
+#include "pane_rows.h"
+#include "test_framework.h"
+#include <string>
+
+namespace {
+LineStore numbered_lines(int count) {
+  LineStore lines;
+  for (int i = 0; i < count; ++i) {
+    lines.push_back("line " + std::to_string(i));
+  }
+  return lines;
+}
+
+// One frame of 20 rows from `top`, keyed the way render_buffer_content()
+// keys them: by line and by whether the cursor is on it. Returns the rows
+// that would be drawn.
+int draw(PaneRows &rows, const LineStore &lines, int top, int cursor_y,
+         bool all = false) {
+  const int count = 20;
+  rows.begin(lines, (std::size_t)top, count, all);
+  for (int row = 0; row < count; ++row) {
+    const int line = top + row;
+    rows.damaged(row, (std::uint64_t)line * 2 + (line == cursor_y ? 1 : 0));
+  }
+  return rows.damaged_rows();
+}
+} // namespace
+
+TEST(TestPaneRowsCursorMove) {
+  LineStore lines = numbered_lines(100);
+  PaneRows rows;
+  ASSERT_EQ(draw(rows, lines, 0, 5), 20);
+  ASSERT_EQ(draw(rows, lines, 0, 5), 0);
+  // The row the cursor left and the one it entered.
+  ASSERT_EQ(draw(rows, lines, 0, 6), 2);
+  ASSERT_EQ(draw(rows, lines, 0, 6, true), 20);
+}
+
+TEST(TestPaneRowsLineEdit) {
+  LineStore lines = numbered_lines(100);
+  PaneRows rows;
+  draw(rows, lines, 0, 5);
+  lines.mut(5) += "x";
+  ASSERT_EQ(draw(rows, lines, 0, 5), 1);
+  // Lines outside the pane do not damage it.
+  lines.set(50, "elsewhere");
+  ASSERT_EQ(draw(rows, lines, 0, 5), 0);
+}
+
+TEST(TestPaneRowsStructuralEdit) {
+  LineStore lines = numbered_lines(100);
+  PaneRows rows;
+  draw(rows, lines, 0, 5);
+  // Every line from the inserted one on moved down a row.
+  lines.insert(lines.begin() + 12, "new");
+  ASSERT_EQ(draw(rows, lines, 0, 5), 8);
+  lines.erase(lines.begin() + 30);
+  ASSERT_EQ(draw(rows, lines, 0, 5), 0);
+  lines.erase(lines.begin() + 3);
+  ASSERT_EQ(draw(rows, lines, 0, 5), 17);
+}
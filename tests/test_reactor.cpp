@@ -0,0 +1,63 @@
+#include "reactor.h"
+#include "test_framework.h"
+#include <chrono>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <unistd.h>
+
+TEST(TestReactorReportsReadableFds) {
+  int a[2];
+  int b[2];
+  ASSERT_TRUE(pipe(a) == 0 && pipe(b) == 0);
+  Reactor reactor;
+  reactor.reset();
+  const int slot_a = reactor.watch(a[0]);
+  const int slot_b = reactor.watch(b[0]);
+  ASSERT_EQ(reactor.watch(-1), -1);
+
+  const auto start = std::chrono::steady_clock::now();
+  reactor.wait(30);
+  ASSERT_TRUE(std::chrono::steady_clock::now() - start >=
+              std::chrono::milliseconds(25));
+  ASSERT_TRUE(!reactor.ready(slot_a) && !reactor.ready(slot_b));
+
+  ASSERT_EQ(write(b[1], "x", 1), 1);
+  reactor.wait(-1);
+  ASSERT_TRUE(!reactor.ready(slot_a));
+  ASSERT_TRUE(reactor.ready(slot_b));
+  ASSERT_TRUE(!reactor.ready(-1));
+
+  close(a[1]); // a hung-up source wakes the wait too
+  reactor.wait(-1);
+  ASSERT_TRUE(reactor.ready(slot_a));
+  for (int fd : {a[0], b[0], b[1]}) {
+    close(fd);
+  }
+}
+#endif
+
+TEST(TestLoopStatsCountsIdleWakeupsAndLatency) {
+  using Clock = LoopStats::Clock;
+  LoopStats stats;
+  const Clock::time_point t0 = Clock::now();
+  auto at = [&](int ms) { return t0 + std::chrono::milliseconds(ms); };
+
+  stats.woke(at(0), true);
+  stats.woke(at(2), true); // only the first input of a frame counts
+  stats.frame_done(at(5), true);
+  ASSERT_EQ(stats.painted_inputs, 1u);
+  ASSERT_TRUE(stats.last_input_to_paint_ms > 4.9 &&
+              stats.last_input_to_paint_ms < 5.1);
+
+  stats.woke(at(100), false);
+  stats.frame_done(at(101), false);
+  stats.frame_done(at(102), false); // no wakeup in between
+  ASSERT_EQ(stats.wakeups, 3u);
+  ASSERT_EQ(stats.idle_wakeups, 1u);
+
+  stats.woke(at(1000), false);
+  stats.frame_done(at(1000), false);
+  ASSERT_TRUE(stats.idle_wakeups_per_second > 1.9 &&
+              stats.idle_wakeups_per_second < 2.1);
+  ASSERT_EQ(stats.painted_inputs, 1u);
+}
@@ -0,0 +1,93 @@
+#include "save_pipeline.h"
+#include "test_framework.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if defined(JOT_PLATFORM_POSIX)
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::string read_all(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+} // namespace
+
+TEST(TestSavePipelineWritesAtomically) {
+  const fs::path root = fs::temp_directory_path() / "jot-test-save-pipeline";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  const fs::path file = root / "a.txt";
+  std::ofstream(file) << "old\n";
+  chmod(file.c_str(), 0640);
+  fs::create_symlink(file, root / "link.txt");
+
+  std::string error;
+  ASSERT_TRUE(SavePipeline::write_atomic((root / "link.txt").string(),
+                                         "new\ntext\n", error));
+  ASSERT_EQ(read_all(file), std::string("new\ntext\n"));
+  ASSERT_TRUE(fs::is_symlink(root / "link.txt"));
+  struct stat st;
+  ASSERT_EQ(stat(file.c_str(), &st), 0);
+  ASSERT_EQ((int)(st.st_mode & 0777), 0640);
+  // Only the two files are left, no temporaries.
+  int entries = 0;
+  for (const auto &entry : fs::directory_iterator(root)) {
+    (void)entry;
+    entries++;
+  }
+  ASSERT_EQ(entries, 2);
+
+  ASSERT_TRUE(!SavePipeline::write_atomic(
+      (root / "missing" / "b.txt").string(), "x", error));
+  ASSERT_TRUE(!error.empty());
+  fs::remove_all(root, ec);
+}
+
+TEST(TestSavePipelineRunsJobsAndFormatter) {
+  const fs::path root = fs::temp_directory_path() / "jot-test-save-jobs";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  fs::create_directories(root);
+  const fs::path file = root / "b.txt";
+
+  SavePipeline pipeline;
+  SavePipeline::Job job;
+  job.path = file.string();
+  job.lines = LineStore({"int  x;"});
+  job.formatter = "tr -s ' ' < '" + file.string() + "'";
+  job.formatter_name = "tr";
+  job.journal_id = 7;
+  job.revision = 3;
+  pipeline.submit(job);
+  pipeline.wait_idle();
+
+  std::vector<SavePipeline::Result> results;
+  ASSERT_TRUE(pipeline.take(results));
+  ASSERT_EQ(results.size(), (std::size_t)1);
+  ASSERT_TRUE(results[0].ok);
+  ASSERT_TRUE(results[0].formatted);
+  ASSERT_EQ(results[0].formatted_text, std::string("int x;\n"));
+  ASSERT_EQ(results[0].revision, (std::uint64_t)3);
+  ASSERT_EQ(read_all(file), std::string("int  x;\n"));
+  ASSERT_TRUE(!pipeline.take(results));
+
+  // A failing formatter leaves the save itself successful.
+  job.lines = LineStore({"y"});
+  job.formatter = "false";
+  pipeline.submit(job);
+  pipeline.wait_idle();
+  results.clear();
+  ASSERT_TRUE(pipeline.take(results));
+  ASSERT_TRUE(results[0].ok);
+  ASSERT_TRUE(!results[0].formatted);
+  ASSERT_EQ(read_all(file), std::string("y\n"));
+  fs::remove_all(root, ec);
+}
+#endif
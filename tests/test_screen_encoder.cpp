@@ -0,0 +1,228 @@
+#include "screen_encoder.h"
+#include "test_framework.h"
+#include <string>
+#include <vector>
+
+namespace {
+constexpr int kCols = 120;
+constexpr int kRows = 40;
+
+// Replays the escape sequences the encoder uses onto a cell grid, so a
+// test can check that the output draws exactly the frame it was given.
+struct ReplayScreen {
+  GlyphTable &glyphs;
+  CellGrid cells;
+  int x = 0;
+  int y = 0;
+  Cell pen;
+  std::uint32_t last_glyph = ' ';
+
+  explicit ReplayScreen(GlyphTable &table) : glyphs(table) {
+    cells.resize(kCols, kRows, Cell::make(GlyphTable::kNone, 0, 0, 0));
+  }
+
+  void put(std::uint32_t glyph) {
+    ASSERT_TRUE(x < kCols); // never writes into a pending wrap
+    Cell cell = pen;
+    cell.glyph = glyph;
+    cells.at(x++, y) = cell;
+    last_glyph = glyph;
+  }
+  void erase(int from, int to) {
+    for (int k = from; k < to && k < kCols; k++) {
+      Cell cell = pen;
+      cell.glyph = ' ';
+      cells.at(k, y) = cell;
+    }
+  }
+  void sgr(const std::vector<int> &params) {
+    for (std::size_t i = 0; i < params.size(); i++) {
+      const int p = params[i];
+      if (p == 0) {
+        pen = Cell::make(' ', 0, 0, 0);
+      } else if (p == 1 || p == 3 || p == 7) {
+        pen.attrs |= p == 1 ? CELL_BOLD : p == 3 ? CELL_ITALIC : CELL_REVERSE;
+      } else if (p == 22 || p == 23 || p == 27) {
+        pen.attrs &= ~(p == 22 ? CELL_BOLD : p == 23 ? CELL_ITALIC : CELL_REVERSE);
+      } else if ((p == 38 || p == 48) && i + 2 < params.size()) {
+        (p == 38 ? pen.fg : pen.bg) = (std::uint8_t)params[i + 2];
+        i += 2;
+      }
+    }
+  }
+
+  void feed(const std::string &out) {
+    std::size_t i = 0;
+    while (i < out.size()) {
+      const unsigned char c = out[i];
+      if (c == '\r') {
+        x = 0;
+        i++;
+      } else if (c == '\n') {
+        y++;
+        i++;
+      } else if (c == 0x1b) {
+        ASSERT_EQ(out[i + 1], '[');
+        i += 2;
+        std::vector<int> params(1, -1);
+        while (out[i] == ';' || (out[i] >= '0' && out[i] <= '9')) {
+          if (out[i] == ';') {
+            params.push_back(-1);
+          } else {
+            params.back() = std::max(0, params.back()) * 10 + (out[i] - '0');
+          }
+          i++;
+        }
+        const char final = out[i++];
+        const int n = params[0] < 0 ? 1 : params[0];
+        switch (final) {
+        case 'H':
+          y = n - 1;
+          x = params.size() > 1 && params[1] > 0 ? params[1] - 1 : 0;
+          break;
+        case 'A': y -= n; break;
+        case 'B': y += n; break;
+        case 'C': x += n; break;
+        case 'D': x -= n; break;
+        case 'X': erase(x, x + n); break;
+        case 'K': erase(x, kCols); break;
+        case 'b':
+          for (int k = 0; k < n; k++) {
+            put(last_glyph);
+          }
+          break;
+        case 'm': sgr(params); break;
+        default: ASSERT_TRUE(false);
+        }
+        ASSERT_TRUE(x >= 0 && x <= kCols && y >= 0 && y < kRows);
+      } else {
+        std::size_t len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        put(glyphs.intern(out.substr(i, len)));
+        i += len;
+      }
+    }
+  }
+};
+
+// An editor-like frame: tab bar, two bordered panes of code with a cursor
+// line, and a status line.
+void draw_frame(GlyphTable &glyphs, CellGrid &grid, int scroll, int cursor) {
+  static const char *const kCode[] = {
+      "int main(int argc, char **argv) {", "  // naïve grüße — λx → x²",
+      "  for (auto &name : names) {",      "    print(name);",
+      "  }",                               "  return 0; // 完成",
+      "}",                                 ""};
+  auto text = [&](int x, int y, const std::string &s, int fg, int bg,
+                  std::uint8_t attrs) {
+    for (std::size_t i = 0; i < s.size() && x < kCols;) {
+      const unsigned char c = s[i];
+      const std::size_t len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+      grid.at(x++, y) = Cell::make(glyphs.intern(s.substr(i, len)), fg, bg, attrs);
+      i += len;
+    }
+  };
+  grid.fill(Cell::make(' ', 7, 0, 0));
+  for (int x = 0; x < kCols; x++) {
+    grid.at(x, 0) = Cell::make(' ', 7, 4, 0);
+  }
+  text(1, 0, " main.cpp × ", 7, 4, CELL_BOLD);
+  text(14, 0, " util.h ", 8, 4, 0);
+  for (int pane = 0; pane < 2; pane++) {
+    const int x0 = pane * kCols / 2;
+    const int w = kCols / 2;
+    const std::uint32_t h = glyphs.intern("─"), v = glyphs.intern("│");
+    for (int x = x0; x < x0 + w; x++) {
+      grid.at(x, 1) = grid.at(x, kRows - 2) = Cell::make(h, 8, 0, 0);
+    }
+    for (int y = 2; y < kRows - 2; y++) {
+      grid.at(x0, y) = grid.at(x0 + w - 1, y) = Cell::make(v, 8, 0, 0);
+      const int line = scroll + y + pane * 3;
+      const int bg = pane == 0 && y == 2 + cursor ? 236 : 0;
+      for (int x = x0 + 1; x < x0 + w - 1; x++) {
+        grid.at(x, y) = Cell::make(' ', 7, bg, 0);
+      }
+      text(x0 + 1, y, std::to_string(1000 + line), 8, bg, 0);
+      text(x0 + 6, y, kCode[line % 8], 6 + line % 2, bg, 0);
+    }
+  }
+  for (int x = 0; x < kCols; x++) {
+    grid.at(x, kRows - 1) = Cell::make(' ', 0, 2, 0);
+  }
+  text(0, kRows - 1, " NORMAL  main.cpp  Ln " + std::to_string(cursor + 1), 0, 2,
+       CELL_BOLD | CELL_REVERSE);
+}
+
+std::size_t encode(ScreenEncoder &encoder, const GlyphTable &glyphs,
+                   const CellGrid &grid, CellGrid &shown, std::string &out) {
+  out.clear();
+  for (int y = 0; y < kRows; y++) {
+    encoder.encode_span(out, glyphs, grid.row(y), shown.row(y), y, 0, kCols);
+    shown.copy_row_from(grid, y);
+  }
+  return out.size();
+}
+} // namespace
+
+TEST(TestScreenEncoderPicksShortMotionAndStyle) {
+  ScreenEncoder encoder;
+  encoder.set_columns(80);
+  std::string out;
+  encoder.move_to(out, 4, 2);
+  ASSERT_EQ(out, std::string("\x1b[3;5H"));
+  out.clear();
+  encoder.move_to(out, 4, 3);
+  ASSERT_EQ(out, std::string("\n"));
+  out.clear();
+  encoder.move_to(out, 0, 3);
+  ASSERT_EQ(out, std::string("\r"));
+  out.clear();
+  encoder.move_to(out, 1, 3);
+  ASSERT_EQ(out, std::string("\x1b[C"));
+
+  out.clear();
+  encoder.set_style(out, Cell::make(' ', 7, 0, CELL_BOLD));
+  ASSERT_EQ(out, std::string("\x1b[0;1;38;5;7;48;5;0m"));
+  out.clear();
+  encoder.set_style(out, Cell::make('x', 7, 0, CELL_BOLD));
+  ASSERT_TRUE(out.empty());
+  encoder.set_style(out, Cell::make(' ', 7, 236, 0));
+  ASSERT_EQ(out, std::string("\x1b[22;48;5;236m"));
+}
+
+// Byte counts of recorded scenes, with and without ECH/REP; the output
+// must keep drawing the exact frame and must not grow past the recording.
+TEST(TestScreenEncoderSceneBytes) {
+  struct Scene {
+    int scroll, cursor;
+    std::size_t max_bytes, max_bytes_plain;
+  };
+  const Scene scenes[] = {
+      {0, 0, 4924, 7813}, // first frame
+      {0, 1, 171, 226},   // cursor down a line
+      {0, 1, 0, 0},       // nothing changed
+      {1, 1, 3676, 3884}, // scrolled
+  };
+  for (const bool plain : {false, true}) {
+    GlyphTable glyphs;
+    ScreenEncoder encoder;
+    ScreenEncoder::Caps caps;
+    caps.erase_chars = caps.repeat_char = !plain;
+    encoder.set_caps(caps);
+    encoder.set_columns(kCols);
+    CellGrid grid;
+    CellGrid shown;
+    grid.resize(kCols, kRows, Cell());
+    shown.resize(kCols, kRows, Cell::make(GlyphTable::kNone, 0, 0, 0));
+    ReplayScreen screen(glyphs);
+    std::string out;
+    for (const Scene &scene : scenes) {
+      draw_frame(glyphs, grid, scene.scroll, scene.cursor);
+      const std::size_t bytes = encode(encoder, glyphs, grid, shown, out);
+      screen.feed(out);
+      for (int y = 0; y < kRows; y++) {
+        ASSERT_TRUE(screen.cells.row_equals(grid, y));
+      }
+      ASSERT_TRUE(bytes <= (plain ? scene.max_bytes_plain : scene.max_bytes));
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#include "scrollback.h"
+#include "test_framework.h"
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<Cell> make_row(const std::string &text) {
+  std::vector<Cell> row;
+  for (char c : text) {
+    row.push_back(Cell::make((unsigned char)c, 7, 0, 0));
+  }
+  return row;
+}
+
+std::string line_text(const Scrollback &lines, std::size_t i) {
+  const CellSpan span = lines.line(i);
+  std::string text;
+  for (int x = 0; x < span.width; x++) {
+    text += (char)span.cells[x].glyph;
+  }
+  return text;
+}
+} // namespace
+
+TEST(TestScrollbackKeepsNewestLines) {
+  Scrollback lines(3);
+  ASSERT_EQ(lines.memory_bytes(), (std::size_t)0);
+  for (int i = 0; i < 5; i++) {
+    const auto row = make_row("row " + std::to_string(i));
+    lines.push(row.data(), (int)row.size());
+  }
+  lines.push(nullptr, 0);
+  ASSERT_EQ(lines.size(), (std::size_t)3);
+  ASSERT_EQ(line_text(lines, 0), std::string("row 3"));
+  ASSERT_EQ(line_text(lines, 1), std::string("row 4"));
+  ASSERT_EQ(lines.line(2).width, 0);
+
+  lines.clear();
+  ASSERT_EQ(lines.size(), (std::size_t)0);
+  ASSERT_EQ(lines.memory_bytes(), (std::size_t)0);
+}
+
+TEST(TestScrollbackGrowsAndWrapsWithoutSplittingRows) {
+  // Rows of uneven widths through growth, then many times around the ring
+  // once the cell cap (4096 cells for a small line limit) is reached.
+  Scrollback lines(10);
+  std::vector<std::string> pushed;
+  for (int i = 0; i < 2000; i++) {
+    const std::string text(37 + (i * 131) % 900, (char)('a' + i % 26));
+    const auto row = make_row(text);
+    lines.push(row.data(), (int)row.size());
+    pushed.push_back(text);
+  }
+  ASSERT_TRUE(lines.size() <= 10);
+  ASSERT_TRUE(lines.size() >= 4);
+  const std::size_t first = pushed.size() - lines.size();
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    ASSERT_EQ(line_text(lines, i), pushed[first + i]);
+  }
+  ASSERT_TRUE(lines.memory_bytes() <= 4096 * sizeof(Cell) + 64 * 8);
+
+  // A larger limit grows instead of dropping, keeping every row intact.
+  Scrollback deep(100000);
+  for (int i = 0; i < 20000; i++) {
+    const auto row = make_row("line " + std::to_string(i));
+    deep.push(row.data(), (int)row.size());
+  }
+  ASSERT_EQ(deep.size(), (std::size_t)20000);
+  ASSERT_EQ(line_text(deep, 0), std::string("line 0"));
+  ASSERT_EQ(line_text(deep, 12345), std::string("line 12345"));
+  ASSERT_EQ(line_text(deep, 19999), std::string("line 19999"));
+}
@@ -0,0 +1,141 @@
+#include "highlight_scheduler.h"
+#include "syntax.h"
+#include "syntax_cache.h"
+#include "test_framework.h"
+#include <string>
+#include <vector>
+
+namespace {
+// One digit per byte: the color index, or 0 for plain text.
+std::string color_string(const std::string &ext, const std::string &line) {
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(ext);
+  std::string out;
+  for (const auto &cell : highlighter.get_colors(line)) {
+    out.push_back(static_cast<char>('0' + cell.second));
+  }
+  return out;
+}
+} // namespace
+
+TEST(TestSyntaxLexerTokens) {
+  ASSERT_EQ(color_string(".cpp", "int x = 0x1F;"), "1110000044440");
+  ASSERT_EQ(color_string(".cpp", "#include <map>"), "55555555666666");
+  ASSERT_EQ(color_string(".cpp", "if (f(2.5e3)) // done"),
+            "660060444440003333333");
+  ASSERT_EQ(color_string(".py", "@cache"), "666666");
+  ASSERT_EQ(color_string(".py", "from a import b"), "555500055555500");
+  ASSERT_EQ(color_string(".sql", "SELECT 'x'"), "1111110222");
+  ASSERT_EQ(color_string(".json", "\"k\": -1"), "2225004");
+  ASSERT_EQ(color_string(".txt", "int"), "000");
+}
+
+TEST(TestSyntaxLexerStringsBeforeComments) {
+  // Comment markers inside a string stay part of the string.
+  ASSERT_EQ(color_string(".cpp", "\"a//b\" x"), "22222200");
+  ASSERT_EQ(color_string(".sh", "echo \"#\" # c"), "111102220333");
+}
+
+namespace {
+// Lexes `lines` in order, carrying the end-of-line state between them.
+std::vector<std::string> color_lines(const std::string &ext,
+                                     const std::vector<std::string> &lines) {
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(ext);
+  SyntaxState state = 0;
+  std::vector<std::string> out;
+  for (const auto &line : lines) {
+    std::string colors;
+    for (const auto &cell : highlighter.get_colors(line, state)) {
+      colors.push_back(static_cast<char>('0' + cell.second));
+    }
+    out.push_back(colors);
+  }
+  return out;
+}
+} // namespace
+
+TEST(TestSyntaxLexerCarriesStateAcrossLines) {
+  const auto c = color_lines(".cpp", {"int a; /* open", "int b;", "*/ int c;"});
+  ASSERT_EQ(c[0], "11100003333333");
+  ASSERT_EQ(c[1], "333333");
+  ASSERT_EQ(c[2], "330111000");
+
+  const auto py = color_lines(".py", {"x = \"\"\"doc", "if", "\"\"\" if"});
+  ASSERT_EQ(py[1], "22");
+  ASSERT_EQ(py[2], "222011");
+
+  const auto raw = color_lines(".cpp", {"auto s = R\"x(a", ")\" )x\"; if"});
+  ASSERT_EQ(raw[1], "2222220011");
+
+  const auto sh = color_lines(".sh", {"cat <<-EOF", "if", "\tEOF", "if"});
+  ASSERT_EQ(sh[0], "0000555555");
+  ASSERT_EQ(sh[1], "22");
+  ASSERT_EQ(sh[3], "11");
+
+  const auto md = color_lines(".md", {"```", "# not a header", "```", "# h"});
+  ASSERT_EQ(md[1], std::string(14, '2'));
+  ASSERT_EQ(md[3], "555");
+}
+
+TEST(TestSyntaxCacheShiftsOnInsertAndErase) {
+  LineStore lines = {"int a;", "/* open", "still comment", "*/ int b;"};
+  SyntaxHighlighter highlighter;
+  highlighter.set_language(".cpp");
+  SyntaxCache cache;
+  for (int i = 0; i < 4; ++i) {
+    cache.line_colors(lines, i, highlighter);
+  }
+  ASSERT_EQ(cache.stats().misses, 4u);
+
+  // A new line inside the comment is lexed; the shifted lines are reused.
+  cache.reset_stats();
+  lines.insert(lines.begin() + 2, "int c;");
+  const auto &inserted = cache.line_colors(lines, 2, highlighter);
+  ASSERT_EQ(inserted[0].second, 3);
+  cache.line_colors(lines, 3, highlighter);
+  cache.line_colors(lines, 4, highlighter);
+  ASSERT_EQ(cache.stats().misses, 1u);
+  ASSERT_EQ(cache.stats().hits, 2u);
+
+  // Erasing the opener changes the state below it, so those lines re-lex.
+  cache.reset_stats();
+  lines.erase(lines.begin() + 1);
+  ASSERT_EQ(cache.line_colors(lines, 1, highlighter)[0].second, 1);
+  ASSERT_EQ(cache.line_colors(lines, 3, highlighter)[0].second, 0);
+  ASSERT_EQ(cache.stats().misses, 3u);
+}
+
+TEST(TestHighlightSchedulerPublishesIntoCache) {
+  LineStore lines = {"int a;", "/* open", "still comment", "*/ int b;"};
+  for (int i = 0; i < 3000; ++i) {
+    lines.push_back("x = 1;");
+  }
+  SyntaxCache cache;
+  HighlightScheduler scheduler;
+  scheduler.schedule(HighlightScheduler::make_job(lines, cache, ".cpp", 2, 4));
+  scheduler.wait_idle();
+
+  std::vector<HighlightScheduler::Batch> batches;
+  ASSERT_TRUE(scheduler.take(batches));
+  for (auto &batch : batches) {
+    HighlightScheduler::apply(lines, cache, batch);
+  }
+  ASSERT_EQ(cache.settled_lines(), lines.size());
+  ASSERT_EQ(cache.entry(2).colors[0].second, 3);
+  ASSERT_EQ(cache.entry(3).colors[3].second, 1);
+  ASSERT_EQ(cache.entry(3000).colors[4].second, 4);
+
+  // Batches computed before an edit are dropped instead of stored.
+  scheduler.schedule(HighlightScheduler::make_job(lines, cache, ".cpp", 0, 4));
+  cache.invalidate_from(1);
+  scheduler.schedule(HighlightScheduler::make_job(lines, cache, ".cpp", 0, 4));
+  scheduler.wait_idle();
+  batches.clear();
+  scheduler.take(batches);
+  lines.insert(lines.begin(), "int z;");
+  for (auto &batch : batches) {
+    ASSERT_TRUE(!HighlightScheduler::apply(lines, cache, batch));
+  }
+  ASSERT_EQ(cache.settled_lines(), 0u);
+}
@@ -0,0 +1,127 @@
+#include "test_framework.h"
+#include "text_delta.h"
+#include <string>
+
+namespace {
+// Byte offset of (line, UTF-16 column) in `text`.
+std::size_t offset_of(const std::string &text, int line, int character) {
+  std::size_t pos = 0;
+  for (int i = 0; i < line; ++i) {
+    pos = text.find('\n', pos) + 1;
+  }
+  for (int units = 0; units < character && pos < text.size();) {
+    const unsigned char c = (unsigned char)text[pos];
+    units += c >= 0xF0 ? 2 : 1;
+    pos += c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+  }
+  return pos;
+}
+
+// Applies `delta` to `text`, the way a server would.
+std::string apply_to_text(const std::string &text, const TextDelta &delta) {
+  const std::size_t start =
+      offset_of(text, delta.start_line, delta.start_character);
+  const std::size_t end = offset_of(text, delta.end_line, delta.end_character);
+  return text.substr(0, start) + delta.text + text.substr(end);
+}
+
+// Runs `edit` on a copy of `base` and checks the delta from the journal
+// turns the old text into the new one.
+template <typename Edit> void check_delta(const LineStore &base, Edit edit) {
+  LineStore lines;
+  lines.append(base.to_vector());
+  const std::string before = lines.join('\n');
+  const TextSyncPoint sent = text_sync_point(lines);
+  edit(lines);
+  TextDelta delta;
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_RANGE);
+  ASSERT_EQ(apply_to_text(before, delta), lines.join('\n'));
+}
+} // namespace
+
+TEST(TestTextDeltaFromJournal) {
+  LineStore lines;
+  lines.append({"int a;", "int b;", "int c;"});
+  TextSyncPoint sent = text_sync_point(lines);
+  TextDelta delta;
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_NONE);
+
+  lines.mut(1).insert(5, "x");
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_RANGE);
+  ASSERT_EQ(delta.start_line, 1);
+  ASSERT_EQ(delta.start_character, 0);
+  ASSERT_EQ(delta.end_line, 2);
+  ASSERT_EQ(delta.end_character, 0);
+  ASSERT_EQ(delta.text, "int bx;\n");
+
+  // Typing on, into the line touched before the last sync.
+  sent = text_sync_point(lines);
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_NONE);
+  lines.mut(1).insert(6, "y");
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_RANGE);
+  ASSERT_EQ(delta.start_line, 1);
+  ASSERT_EQ(delta.text, "int bxy;\n");
+
+  // Replacing the contents wholesale leaves nothing to build a range from.
+  sent = text_sync_point(lines);
+  lines = LineStore({"other"});
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_FULL);
+
+  // Nor does a journal that no longer reaches back.
+  sent = text_sync_point(lines);
+  for (int i = 0; i < 1000; ++i) {
+    lines.push_back("line");
+  }
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_FULL);
+}
+
+TEST(TestTextDeltaEndColumnsCountUtf16) {
+  // One unit for the e-acute, a surrogate pair for the emoji.
+  const std::string prefix = "\xc3\xa9"
+                             "\xf0\x9f\x98\x80";
+  ASSERT_EQ(prefix.size(), (std::size_t)6);
+  ASSERT_EQ(utf16_length(prefix, prefix.size()), 3);
+
+  LineStore lines;
+  lines.append({"x", prefix + "a"});
+  const TextSyncPoint sent = text_sync_point(lines);
+  lines.push_back("y");
+  TextDelta delta;
+  ASSERT_EQ(compute_text_delta(sent, lines, delta), TEXT_DELTA_RANGE);
+  ASSERT_EQ(delta.start_line, 1);
+  ASSERT_EQ(delta.start_character, 4);
+  ASSERT_EQ(delta.end_line, 1);
+  ASSERT_EQ(delta.end_character, 4);
+  ASSERT_EQ(delta.text, "\ny");
+
+  check_delta(lines, [&](LineStore &l) { l.set(2, prefix + "b"); });
+  check_delta(lines, [](LineStore &l) { l.pop_back(); });
+}
+
+TEST(TestTextDeltaRoundTrips) {
+  const LineStore base = {"one", "two", "three", "four", "five"};
+  check_delta(base, [](LineStore &l) { l.push_back("six"); });
+  check_delta(base, [](LineStore &l) { l.insert(l.begin(), "zero"); });
+  check_delta(base, [](LineStore &l) { l.erase(l.begin() + 1); });
+  check_delta(base, [](LineStore &l) { l.erase(l.begin() + 1, l.end()); });
+  check_delta(base, [](LineStore &l) { l.erase(l.begin(), l.end() - 1); });
+  check_delta(base, [](LineStore &l) { l.pop_back(); });
+  check_delta(base, [](LineStore &l) {
+    l.insert(l.begin() + 2, "new");
+    l.mut(4) += "!";
+  });
+  check_delta(base, [](LineStore &l) {
+    l.mut(1) += l[2];
+    l.erase(l.begin() + 2);
+  });
+  check_delta(base, [](LineStore &l) {
+    l.set(4, "");
+    l.insert(l.begin() + 1, "a");
+    l.erase(l.begin() + 3, l.begin() + 5);
+    l.push_back("end");
+  });
+  check_delta(base, [](LineStore &l) {
+    l.erase(l.begin(), l.end());
+    l.push_back("");
+  });
+}
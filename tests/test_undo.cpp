@@ -0,0 +1,66 @@
+#include "test_framework.h"
+#include "types.h"
+
+namespace {
+State state_at(int x, int y) {
+  State s{};
+  s.cursor = {x, y};
+  s.selection = {{x, y}, {x, y}, false};
+  return s;
+}
+} // namespace
+
+TEST(TestUndoRestoresEditedRange) {
+  LineStore lines = {"one", "two", "three"};
+  UndoHistory history;
+
+  history.record(lines, 1, 1, state_at(3, 1));
+  lines.mut(1) += "!";
+  lines.insert(lines.begin() + 2, "inserted");
+
+  State state = state_at(0, 2);
+  ASSERT_TRUE(history.undo(lines, state));
+  ASSERT_EQ(lines.size(), 3u);
+  ASSERT_EQ(lines[1], "two");
+  ASSERT_EQ(state.cursor.x, 3);
+
+  ASSERT_TRUE(history.redo(lines, state));
+  ASSERT_EQ(lines.size(), 4u);
+  ASSERT_EQ(lines[1], "two!");
+  ASSERT_EQ(lines[2], "inserted");
+  ASSERT_EQ(state.cursor.y, 2);
+}
+
+TEST(TestUndoGroupsTyping) {
+  LineStore lines = {""};
+  UndoHistory history;
+
+  for (int i = 0; i < 5; ++i) {
+    history.record(lines, 0, 0, state_at(i, 0), true, 100 + i);
+    lines.mut(0).push_back('a' + i);
+  }
+  // A pause starts a new step.
+  history.record(lines, 0, 0, state_at(5, 0), true, 5000);
+  lines.mut(0).push_back('z');
+
+  State state = state_at(6, 0);
+  ASSERT_TRUE(history.undo(lines, state));
+  ASSERT_EQ(lines[0], "abcde");
+  ASSERT_TRUE(history.undo(lines, state));
+  ASSERT_EQ(lines[0], "");
+  ASSERT_TRUE(!history.undo(lines, state));
+}
+
+TEST(TestUndoDropsNoopSteps) {
+  LineStore lines = {"a", "b"};
+  UndoHistory history;
+
+  history.record(lines, 0, 1, state_at(0, 0));
+  history.record(lines, 0, 0, state_at(0, 0));
+  lines.erase(lines.begin());
+
+  State state = state_at(0, 0);
+  ASSERT_TRUE(history.undo(lines, state));
+  ASSERT_EQ(lines.size(), 2u);
+  ASSERT_EQ(history.undo_depth(), 0u);
+}
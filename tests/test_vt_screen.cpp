@@ -0,0 +1,125 @@
+#include "test_framework.h"
+#include "vt_screen.h"
+#include <string>
+
+TEST(TestVtScreenCursorAddressingAndErase) {
+  VtScreen screen(10, 4);
+  screen.feed("hello\r\nworld");
+  ASSERT_EQ(screen.row_text(0), std::string("hello"));
+  ASSERT_EQ(screen.row_text(1), std::string("world"));
+
+  // Progress bars redraw a line in place instead of appending.
+  screen.feed("\x1b[A\r50%\x1b[K\x1b[B\x1b[D!");
+  ASSERT_EQ(screen.row_text(0), std::string("50%"));
+  ASSERT_EQ(screen.row_text(1), std::string("wo!ld"));
+
+  screen.feed("\x1b[3;4Hx\x1b[4;10Hy");
+  ASSERT_EQ(screen.row_text(2), std::string("   x"));
+  ASSERT_EQ(screen.row_text(3), std::string("         y"));
+  ASSERT_EQ(screen.cursor_x(), 9);
+  ASSERT_EQ(screen.cursor_y(), 3);
+
+  screen.feed("\x1b[2;3H\x1b[1J");
+  ASSERT_EQ(screen.row_text(0), std::string(""));
+  ASSERT_EQ(screen.row_text(1), std::string("   ld"));
+  screen.feed("\x1b[2J");
+  ASSERT_EQ(screen.row_text(3), std::string(""));
+  ASSERT_EQ(screen.history_size(), (std::size_t)0);
+}
+
+TEST(TestVtScreenWrapsAndScrollsIntoHistory) {
+  VtScreen screen(4, 2);
+  // The last column defers the wrap until the next character.
+  screen.feed("abcd");
+  ASSERT_EQ(screen.cursor_x(), 3);
+  ASSERT_EQ(screen.cursor_y(), 0);
+  screen.feed("ef\r\ngh\r\nij");
+  ASSERT_EQ(screen.history_size(), (std::size_t)2);
+  ASSERT_EQ(screen.history_row(0).width, 4);
+  ASSERT_EQ(screen.history_row(1).width, 2);
+  ASSERT_EQ(screen.history_row(1).cells[1].glyph, (std::uint32_t)'f');
+  ASSERT_EQ(screen.row_text(0), std::string("gh"));
+  ASSERT_EQ(screen.row_text(1), std::string("ij"));
+
+  VtScreen capped(4, 2, 3);
+  for (int i = 0; i < 10; i++) {
+    capped.feed(std::to_string(i) + "\r\n");
+  }
+  ASSERT_EQ(capped.history_size(), (std::size_t)3);
+  ASSERT_EQ(capped.history_row(0).cells[0].glyph, (std::uint32_t)'6');
+}
+
+TEST(TestVtScreenScrollRegion) {
+  VtScreen screen(5, 5);
+  screen.feed("top\r\n1\r\n2\r\n3\r\nbot");
+  // Scroll rows 2-4 only, as a pager with a fixed header and status line.
+  screen.feed("\x1b[2;4r\x1b[4;1H\nnew");
+  ASSERT_EQ(screen.row_text(0), std::string("top"));
+  ASSERT_EQ(screen.row_text(1), std::string("2"));
+  ASSERT_EQ(screen.row_text(2), std::string("3"));
+  ASSERT_EQ(screen.row_text(3), std::string("new"));
+  ASSERT_EQ(screen.row_text(4), std::string("bot"));
+  ASSERT_EQ(screen.history_size(), (std::size_t)0);
+
+  // Reverse index at the top margin and line insert push the region down.
+  screen.feed("\x1b[2;1H\x1bMrev");
+  ASSERT_EQ(screen.row_text(1), std::string("rev"));
+  ASSERT_EQ(screen.row_text(2), std::string("2"));
+  ASSERT_EQ(screen.row_text(3), std::string("3"));
+  screen.feed("\x1b[3;1H\x1b[M");
+  ASSERT_EQ(screen.row_text(2), std::string("3"));
+  ASSERT_EQ(screen.row_text(3), std::string(""));
+  ASSERT_EQ(screen.row_text(4), std::string("bot"));
+}
+
+TEST(TestVtScreenAlternateScreen) {
+  VtScreen screen(8, 3);
+  screen.feed("$ less\r\n$ ");
+  screen.feed("\x1b[?1049h\x1b[H\x1b[2Jpage 1\r\n\r\n:");
+  ASSERT_TRUE(screen.alternate_screen());
+  ASSERT_EQ(screen.row_text(0), std::string("page 1"));
+  screen.feed("\n\n\n");
+  ASSERT_EQ(screen.history_size(), (std::size_t)0);
+
+  screen.feed("\x1b[?1049l");
+  ASSERT_TRUE(!screen.alternate_screen());
+  ASSERT_EQ(screen.row_text(0), std::string("$ less"));
+  ASSERT_EQ(screen.row_text(1), std::string("$"));
+  ASSERT_EQ(screen.cursor_x(), 2);
+  ASSERT_EQ(screen.cursor_y(), 1);
+}
+
+TEST(TestVtScreenStylesCharsetsAndReplies) {
+  VtScreen screen(10, 2);
+  screen.feed("\x1b[1;31ma\x1b[38;5;200;48;2;0;0;255mb\x1b[0mc");
+  const Cell *row = screen.row(0);
+  ASSERT_EQ((int)row[0].fg, 1);
+  ASSERT_TRUE((row[0].attrs & CELL_BOLD) != 0);
+  ASSERT_EQ((int)row[1].fg, 200);
+  ASSERT_EQ((int)row[1].bg, 21);
+  ASSERT_EQ((int)row[2].fg, 7);
+  ASSERT_EQ((int)row[2].attrs, 0);
+
+  // UTF-8, split across feeds, and DEC line drawing both end up as code
+  // points; window titles are swallowed.
+  screen.feed("\r\n\xc3");
+  screen.feed("\xa9\x1b]0;title\x07\x1b(0lq\x1b(Bx");
+  ASSERT_EQ(screen.row_text(1), std::string("\xc3\xa9\xe2\x94\x8c\xe2\x94\x80x"));
+
+  screen.feed("\x1b[6n\x1b[c");
+  ASSERT_EQ(screen.take_replies(), std::string("\x1b[2;5R\x1b[?62;22c"));
+  ASSERT_TRUE(screen.take_replies().empty());
+}
+
+TEST(TestVtScreenResizeKeepsCursorRow) {
+  VtScreen screen(6, 4);
+  screen.feed("a\r\nb\r\nc\r\nd");
+  screen.resize(3, 2);
+  ASSERT_EQ(screen.history_size(), (std::size_t)2);
+  ASSERT_EQ(screen.row_text(0), std::string("c"));
+  ASSERT_EQ(screen.row_text(1), std::string("d"));
+  ASSERT_EQ(screen.cursor_y(), 1);
+  screen.feed("\r\nlonger");
+  ASSERT_EQ(screen.row_text(0), std::string("lon"));
+  ASSERT_EQ(screen.row_text(1), std::string("ger"));
+}